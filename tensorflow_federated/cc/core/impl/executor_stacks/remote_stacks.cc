@@ -30,6 +30,7 @@ limitations under the License
 #include "tensorflow_federated/cc/core/impl/executors/remote_executor.h"
 #include "tensorflow_federated/cc/core/impl/executors/status_macros.h"
 #include "tensorflow_federated/cc/core/impl/executors/tensorflow_executor.h"
+#include "tensorflow_federated/cc/core/impl/executors/thread_pool.h"
 #include "tensorflow_federated/cc/core/impl/executors/threading.h"
 
 namespace tensorflow_federated {
@@ -45,6 +46,7 @@ std::vector<std::shared_ptr<grpc::ChannelInterface>> FilterToLiveChannels_(
   auto wait_connected =
       [&wait_connected_duration_millis](
           std::shared_ptr<grpc::ChannelInterface> channel) -> absl::Status {
+    ThreadPool::ScopedBlockingCall blocking_call;
     bool connected = channel->WaitForConnected(
         std::chrono::system_clock::now() +
         std::chrono::milliseconds(wait_connected_duration_millis));
@@ -141,7 +143,7 @@ absl::StatusOr<std::shared_ptr<Executor>> CreateRemoteExecutorStack(
   }
   VLOG(2) << "Addressing: " << remote_executors.size() << " Live TFF workers.";
   return CreateReferenceResolvingExecutor(
-      CreateComposingExecutor(server, remote_executors));
+      TFF_TRY(CreateComposingExecutor(server, remote_executors)));
 }
 
 }  // namespace tensorflow_federated
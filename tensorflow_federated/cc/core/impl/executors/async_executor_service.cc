@@ -0,0 +1,384 @@
+/* Copyright 2022, The TensorFlow Federated Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+#include "tensorflow_federated/cc/core/impl/executors/async_executor_service.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <future>  // NOLINT
+#include <limits>
+#include <memory>
+#include <thread>  // NOLINT
+
+#include "absl/synchronization/mutex.h"
+#include "grpcpp/grpcpp.h"
+#include "tensorflow_federated/cc/core/impl/executors/async_grpc.h"
+#include "tensorflow_federated/cc/core/impl/executors/executor_service.h"
+#include "tensorflow_federated/cc/core/impl/executors/thread_pool.h"
+#include "tensorflow_federated/proto/v0/executor.grpc.pb.h"
+#include "tensorflow_federated/proto/v0/executor.pb.h"
+
+namespace tensorflow_federated {
+
+namespace {
+
+// A tag for a single operation on a stream, which fulfills a promise when the
+// operation completes. Deletes itself once fulfilled, so that the thread
+// waiting on the promise owns nothing the polling thread may still touch.
+class StreamOperationTag : public CompletionQueueTag {
+ public:
+  std::future<bool> GetResult() { return ok_.get_future(); }
+
+  void OnCompleted(bool ok) override {
+    ok_.set_value(ok);
+    delete this;
+  }
+
+ private:
+  std::promise<bool> ok_;
+};
+
+// Starts a stream operation with `start(tag)`, and blocks until it has
+// completed on a polling thread. Returns whether the operation succeeded.
+template <typename StartFn>
+bool RunStreamOperation(StartFn start) {
+  auto* tag = new StreamOperationTag();
+  std::future<bool> ok = tag->GetResult();
+  start(tag);
+  ThreadPool::ScopedBlockingCall blocking_call;
+  return ok.get();
+}
+
+// Adapts the stream of an asynchronous client-streaming call to the blocking
+// interface taken by `ExecutorService`.
+template <typename Request, typename Response>
+class BlockingServerReader : public grpc::ServerReaderInterface<Request> {
+ public:
+  explicit BlockingServerReader(
+      grpc::ServerAsyncReader<Response, Request>* reader)
+      : reader_(reader) {}
+
+  void SendInitialMetadata() override {
+    RunStreamOperation(
+        [this](void* tag) { reader_->SendInitialMetadata(tag); });
+  }
+
+  bool NextMessageSize(uint32_t* size) override {
+    *size = std::numeric_limits<uint32_t>::max();
+    return true;
+  }
+
+  bool Read(Request* message) override {
+    return RunStreamOperation(
+        [this, message](void* tag) { reader_->Read(message, tag); });
+  }
+
+ private:
+  grpc::ServerAsyncReader<Response, Request>* const reader_;
+};
+
+// Adapts the stream of an asynchronous server-streaming call to the blocking
+// interface taken by `ExecutorService`.
+template <typename Response>
+class BlockingServerWriter : public grpc::ServerWriterInterface<Response> {
+ public:
+  explicit BlockingServerWriter(grpc::ServerAsyncWriter<Response>* writer)
+      : writer_(writer) {}
+
+  void SendInitialMetadata() override {
+    RunStreamOperation(
+        [this](void* tag) { writer_->SendInitialMetadata(tag); });
+  }
+
+  using grpc::ServerWriterInterface<Response>::Write;
+  bool Write(const Response& message, grpc::WriteOptions options) override {
+    return RunStreamOperation([this, &message, options](void* tag) {
+      writer_->Write(message, options, tag);
+    });
+  }
+
+ private:
+  grpc::ServerAsyncWriter<Response>* const writer_;
+};
+
+}  // namespace
+
+// The state of a single call of one `ExecutorGroup` method.
+//
+// A call is created to request the next call of its method. Once a call has
+// been received, it requests the next one (so that calls of each method are
+// always being accepted), runs the handler on `pool`, and finishes the call.
+// It deletes itself once the call has finished, or when the request fails
+// because the server is shutting down.
+//
+// Subclasses implement `RequestNext` and `Handle` for each kind of method.
+class AsyncExecutorService::CallBase : public CompletionQueueTag {
+ public:
+  void OnCompleted(bool ok) override {
+    if (finishing_ || !ok) {
+      AsyncExecutorService* service = service_;
+      delete this;
+      service->RemoveCall();
+      return;
+    }
+    RequestNext();
+    pool_->Schedule([this]() { Handle(); });
+  }
+
+ protected:
+  CallBase(AsyncExecutorService* service, ThreadPool* pool,
+           grpc::ServerCompletionQueue* queue)
+      : service_(service), pool_(pool), queue_(queue) {}
+
+  // Requests the next call of the same method.
+  virtual void RequestNext() = 0;
+  // Runs the handler of the received call, and then finishes the call (with
+  // this object as the tag) after setting `finishing_`.
+  virtual void Handle() = 0;
+
+  AsyncExecutorService* const service_;
+  ThreadPool* const pool_;
+  grpc::ServerCompletionQueue* const queue_;
+  grpc::ServerContext context_;
+  bool finishing_ = false;
+};
+
+// A call of a unary method.
+template <typename Request, typename Response>
+class AsyncExecutorService::UnaryCall : public CallBase {
+ public:
+  using RequestFn = void (v0::ExecutorGroup::AsyncService::*)(
+      grpc::ServerContext*, Request*,
+      grpc::ServerAsyncResponseWriter<Response>*, grpc::CompletionQueue*,
+      grpc::ServerCompletionQueue*, void*);
+  using HandlerFn = grpc::Status (ExecutorService::*)(grpc::ServerContext*,
+                                                      const Request*,
+                                                      Response*);
+
+  static void Start(AsyncExecutorService* service, RequestFn request_fn,
+                    HandlerFn handler_fn, ThreadPool* pool,
+                    grpc::ServerCompletionQueue* queue) {
+    service->AddCall();
+    auto* call = new UnaryCall(service, request_fn, handler_fn, pool, queue);
+    (service->async_service_.*request_fn)(&call->context_, &call->request_,
+                                          &call->responder_, queue, queue,
+                                          call);
+  }
+
+ private:
+  UnaryCall(AsyncExecutorService* service, RequestFn request_fn,
+            HandlerFn handler_fn, ThreadPool* pool,
+            grpc::ServerCompletionQueue* queue)
+      : CallBase(service, pool, queue),
+        request_fn_(request_fn),
+        handler_fn_(handler_fn),
+        responder_(&context_) {}
+
+  void RequestNext() override {
+    Start(service_, request_fn_, handler_fn_, pool_, queue_);
+  }
+
+  void Handle() override {
+    grpc::Status status =
+        (service_->service_.*handler_fn_)(&context_, &request_, &response_);
+    finishing_ = true;
+    responder_.Finish(response_, status, this);
+  }
+
+  const RequestFn request_fn_;
+  const HandlerFn handler_fn_;
+  Request request_;
+  Response response_;
+  grpc::ServerAsyncResponseWriter<Response> responder_;
+};
+
+// A call of `CreateValueStream`, whose requests are streamed by the client.
+class AsyncExecutorService::CreateValueStreamCall : public CallBase {
+ public:
+  static void Start(AsyncExecutorService* service, ThreadPool* pool,
+                    grpc::ServerCompletionQueue* queue) {
+    service->AddCall();
+    auto* call = new CreateValueStreamCall(service, pool, queue);
+    service->async_service_.RequestCreateValueStream(
+        &call->context_, &call->reader_, queue, queue, call);
+  }
+
+ private:
+  CreateValueStreamCall(AsyncExecutorService* service, ThreadPool* pool,
+                        grpc::ServerCompletionQueue* queue)
+      : CallBase(service, pool, queue), reader_(&context_) {}
+
+  void RequestNext() override { Start(service_, pool_, queue_); }
+
+  void Handle() override {
+    BlockingServerReader<v0::CreateValueStreamRequest, v0::CreateValueResponse>
+        reader(&reader_);
+    grpc::Status status =
+        service_->service_.CreateValueStream(&context_, &reader, &response_);
+    finishing_ = true;
+    reader_.Finish(response_, status, this);
+  }
+
+  v0::CreateValueResponse response_;
+  grpc::ServerAsyncReader<v0::CreateValueResponse,
+                          v0::CreateValueStreamRequest>
+      reader_;
+};
+
+// A call of `ComputeStream`, whose responses are streamed to the client.
+class AsyncExecutorService::ComputeStreamCall : public CallBase {
+ public:
+  static void Start(AsyncExecutorService* service, ThreadPool* pool,
+                    grpc::ServerCompletionQueue* queue) {
+    service->AddCall();
+    auto* call = new ComputeStreamCall(service, pool, queue);
+    service->async_service_.RequestComputeStream(
+        &call->context_, &call->request_, &call->writer_, queue, queue, call);
+  }
+
+ private:
+  ComputeStreamCall(AsyncExecutorService* service, ThreadPool* pool,
+                    grpc::ServerCompletionQueue* queue)
+      : CallBase(service, pool, queue), writer_(&context_) {}
+
+  void RequestNext() override { Start(service_, pool_, queue_); }
+
+  void Handle() override {
+    BlockingServerWriter<v0::ComputeStreamResponse> writer(&writer_);
+    grpc::Status status =
+        service_->service_.ComputeStream(&context_, &request_, &writer);
+    finishing_ = true;
+    writer_.Finish(status, this);
+  }
+
+  v0::ComputeRequest request_;
+  grpc::ServerAsyncWriter<v0::ComputeStreamResponse> writer_;
+};
+
+AsyncExecutorService::AsyncExecutorService(
+    const ExecutorFactory& executor_factory, const Options& options)
+    : options_(options),
+      service_(executor_factory),
+      handler_pool_(options.num_handler_threads) {}
+
+AsyncExecutorService::~AsyncExecutorService() { Shutdown(); }
+
+void AsyncExecutorService::RegisterWith(grpc::ServerBuilder& builder) {
+  builder.RegisterService(&async_service_);
+  int32_t num_queues = std::max<int32_t>(1, options_.num_completion_queues);
+  for (int32_t i = 0; i < num_queues; i++) {
+    queues_.push_back(builder.AddCompletionQueue());
+  }
+}
+
+void AsyncExecutorService::Start() {
+  {
+    absl::MutexLock lock(&mutex_);
+    started_ = true;
+  }
+  for (std::unique_ptr<grpc::ServerCompletionQueue>& queue : queues_) {
+    RequestCalls(queue.get());
+  }
+  for (std::unique_ptr<grpc::ServerCompletionQueue>& queue : queues_) {
+    grpc::ServerCompletionQueue* raw_queue = queue.get();
+    threads_.emplace_back([this, raw_queue]() { PollLoop(raw_queue); });
+  }
+}
+
+void AsyncExecutorService::Shutdown() {
+  {
+    absl::MutexLock lock(&mutex_);
+    if (shut_down_) {
+      return;
+    }
+    shut_down_ = true;
+    // Once the server has shut down, every outstanding request completes
+    // (with `ok == false`) and every running call finishes, so the number of
+    // calls drops to zero while the polling threads are still running.
+    if (started_) {
+      mutex_.Await(absl::Condition(this, &AsyncExecutorService::NoCalls));
+    }
+  }
+  for (std::unique_ptr<grpc::ServerCompletionQueue>& queue : queues_) {
+    queue->Shutdown();
+  }
+  if (threads_.empty()) {
+    // gRPC requires completion queues to be drained before destruction.
+    for (std::unique_ptr<grpc::ServerCompletionQueue>& queue : queues_) {
+      PollLoop(queue.get());
+    }
+  }
+  for (std::thread& thread : threads_) {
+    thread.join();
+  }
+}
+
+void AsyncExecutorService::RequestCalls(grpc::ServerCompletionQueue* queue) {
+  using AsyncService = v0::ExecutorGroup::AsyncService;
+  ThreadPool* handler_pool = &handler_pool_;
+  UnaryCall<v0::GetExecutorRequest, v0::GetExecutorResponse>::Start(
+      this, &AsyncService::RequestGetExecutor, &ExecutorService::GetExecutor,
+      handler_pool, queue);
+  UnaryCall<v0::CreateValueRequest, v0::CreateValueResponse>::Start(
+      this, &AsyncService::RequestCreateValue, &ExecutorService::CreateValue,
+      handler_pool, queue);
+  UnaryCall<v0::CreateCallRequest, v0::CreateCallResponse>::Start(
+      this, &AsyncService::RequestCreateCall, &ExecutorService::CreateCall,
+      handler_pool, queue);
+  UnaryCall<v0::CreateStructRequest, v0::CreateStructResponse>::Start(
+      this, &AsyncService::RequestCreateStruct, &ExecutorService::CreateStruct,
+      handler_pool, queue);
+  UnaryCall<v0::CreateSelectionRequest, v0::CreateSelectionResponse>::Start(
+      this, &AsyncService::RequestCreateSelection,
+      &ExecutorService::CreateSelection, handler_pool, queue);
+  UnaryCall<v0::ExecuteBatchRequest, v0::ExecuteBatchResponse>::Start(
+      this, &AsyncService::RequestExecuteBatch, &ExecutorService::ExecuteBatch,
+      handler_pool, queue);
+  // `Compute` blocks until the value has been computed, so it runs on the
+  // global pool, whose threads are compensated while blocked.
+  UnaryCall<v0::ComputeRequest, v0::ComputeResponse>::Start(
+      this, &AsyncService::RequestCompute, &ExecutorService::Compute,
+      &ThreadPool::Global(), queue);
+  // The streaming methods block while waiting on the network (as well as in
+  // `Materialize`), and so also run on the global pool.
+  CreateValueStreamCall::Start(this, &ThreadPool::Global(), queue);
+  ComputeStreamCall::Start(this, &ThreadPool::Global(), queue);
+  UnaryCall<v0::DisposeRequest, v0::DisposeResponse>::Start(
+      this, &AsyncService::RequestDispose, &ExecutorService::Dispose,
+      handler_pool, queue);
+  UnaryCall<v0::DisposeExecutorRequest, v0::DisposeExecutorResponse>::Start(
+      this, &AsyncService::RequestDisposeExecutor,
+      &ExecutorService::DisposeExecutor, handler_pool, queue);
+}
+
+void AsyncExecutorService::PollLoop(grpc::ServerCompletionQueue* queue) {
+  void* tag;
+  bool ok;
+  while (queue->Next(&tag, &ok)) {
+    static_cast<CompletionQueueTag*>(tag)->OnCompleted(ok);
+  }
+}
+
+void AsyncExecutorService::AddCall() {
+  absl::MutexLock lock(&mutex_);
+  num_calls_++;
+}
+
+void AsyncExecutorService::RemoveCall() {
+  absl::MutexLock lock(&mutex_);
+  num_calls_--;
+}
+
+}  // namespace tensorflow_federated
@@ -0,0 +1,133 @@
+/* Copyright 2022, The TensorFlow Federated Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+#ifndef THIRD_PARTY_TENSORFLOW_FEDERATED_CC_CORE_IMPL_EXECUTORS_ASYNC_EXECUTOR_SERVICE_H_
+#define THIRD_PARTY_TENSORFLOW_FEDERATED_CC_CORE_IMPL_EXECUTORS_ASYNC_EXECUTOR_SERVICE_H_
+
+#include <cstdint>
+#include <memory>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "grpcpp/grpcpp.h"
+#include "tensorflow_federated/cc/core/impl/executors/executor_service.h"
+#include "tensorflow_federated/cc/core/impl/executors/thread_pool.h"
+#include "tensorflow_federated/proto/v0/executor.grpc.pb.h"
+
+namespace tensorflow_federated {
+
+// Serves the `ExecutorGroup` API of `ExecutorService` using gRPC's
+// asynchronous (completion queue) server API.
+//
+// The synchronous `ExecutorService` runs each request on a thread of the gRPC
+// server's own pool for the duration of the request, so that a burst of
+// long-running `Compute` requests (which block in `Materialize`) can occupy
+// every server thread and stall the cheap `Create...` and `Dispose` requests
+// on which those very computations may depend.
+//
+// This service instead receives requests on `num_completion_queues` polling
+// threads and hands them off for execution:
+// * `Compute` requests run on the process-wide `ThreadPool`, which starts
+//   compensating threads while `Materialize` is blocked waiting on results.
+// * `CreateValueStream` and `ComputeStream` requests also run on the
+//   process-wide `ThreadPool`, blocking (with compensation) while waiting for
+//   each message of their streams.
+// * All other requests run on a dedicated pool of `num_handler_threads`
+//   threads, and so are never queued behind a `Compute`.
+//
+// Request handling itself is delegated to an `ExecutorService`, and so behaves
+// identically to the synchronous service.
+//
+// Usage:
+//
+//   AsyncExecutorService service(executor_factory, options);
+//   grpc::ServerBuilder builder;
+//   ...
+//   service.RegisterWith(builder);
+//   std::unique_ptr<grpc::Server> server = builder.BuildAndStart();
+//   service.Start();
+//   ...
+//   server->Shutdown();
+//   service.Shutdown();
+class AsyncExecutorService {
+ public:
+  struct Options {
+    // The number of completion queues (each polled by its own thread) on
+    // which requests are received. Non-positive values use a single queue.
+    int32_t num_completion_queues = 1;
+    // The number of threads running requests other than `Compute`.
+    // Non-positive values use the number of hardware threads.
+    int32_t num_handler_threads = -1;
+  };
+
+  AsyncExecutorService(const ExecutorFactory& executor_factory,
+                       const Options& options);
+
+  // Calls `Shutdown` if the service was started and not yet shut down.
+  ~AsyncExecutorService();
+
+  AsyncExecutorService(const AsyncExecutorService&) = delete;
+  AsyncExecutorService& operator=(const AsyncExecutorService&) = delete;
+
+  // Registers the service and its completion queues with `builder`. Must be
+  // called exactly once, before `builder.BuildAndStart()`.
+  void RegisterWith(grpc::ServerBuilder& builder);
+
+  // Starts receiving requests. Must be called once, after the server built by
+  // the builder passed to `RegisterWith` has started.
+  void Start();
+
+  // Waits for all outstanding requests to complete and stops the polling
+  // threads. The server must have been shut down beforehand.
+  void Shutdown();
+
+ private:
+  class CallBase;
+  template <typename Request, typename Response>
+  class UnaryCall;
+  class CreateValueStreamCall;
+  class ComputeStreamCall;
+
+  // Requests a new call of each method on `queue`.
+  void RequestCalls(grpc::ServerCompletionQueue* queue);
+
+  void PollLoop(grpc::ServerCompletionQueue* queue);
+
+  // Tracks the number of calls which have been requested and not yet deleted,
+  // so that `Shutdown` can wait for them to drain.
+  void AddCall();
+  void RemoveCall();
+  bool NoCalls() const ABSL_SHARED_LOCKS_REQUIRED(mutex_) {
+    return num_calls_ == 0;
+  }
+
+  const Options options_;
+  ExecutorService service_;
+  v0::ExecutorGroup::AsyncService async_service_;
+  ThreadPool handler_pool_;
+  std::vector<std::unique_ptr<grpc::ServerCompletionQueue>> queues_;
+  std::vector<std::thread> threads_;
+
+  absl::Mutex mutex_;
+  int64_t num_calls_ ABSL_GUARDED_BY(mutex_) = 0;
+  bool started_ ABSL_GUARDED_BY(mutex_) = false;
+  bool shut_down_ ABSL_GUARDED_BY(mutex_) = false;
+};
+
+}  // namespace tensorflow_federated
+
+#endif  // THIRD_PARTY_TENSORFLOW_FEDERATED_CC_CORE_IMPL_EXECUTORS_ASYNC_EXECUTOR_SERVICE_H_
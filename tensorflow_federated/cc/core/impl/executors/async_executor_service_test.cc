@@ -0,0 +1,268 @@
+/* Copyright 2022, The TensorFlow Federated Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+#include "tensorflow_federated/cc/core/impl/executors/async_executor_service.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "googlemock/include/gmock/gmock.h"
+#include "googletest/include/gtest/gtest.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/time.h"
+#include "grpcpp/grpcpp.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow_federated/cc/core/impl/executors/executor.h"
+#include "tensorflow_federated/cc/core/impl/executors/mock_executor.h"
+#include "tensorflow_federated/cc/core/impl/executors/protobuf_matchers.h"
+#include "tensorflow_federated/cc/core/impl/executors/status_conversion.h"
+#include "tensorflow_federated/cc/core/impl/executors/status_matchers.h"
+#include "tensorflow_federated/cc/core/impl/executors/value_streaming.h"
+#include "tensorflow_federated/cc/core/impl/executors/value_test_utils.h"
+#include "tensorflow_federated/proto/v0/executor.grpc.pb.h"
+#include "tensorflow_federated/proto/v0/executor.pb.h"
+
+namespace tensorflow_federated {
+
+namespace {
+
+class AsyncExecutorServiceTest : public ::testing::Test {
+ protected:
+  AsyncExecutorServiceTest()
+      : executor_ptr_(std::make_shared<::testing::StrictMock<MockExecutor>>()),
+        service_(
+            [this](const CardinalityMap&) -> std::shared_ptr<Executor> {
+              return executor_ptr_;
+            },
+            {/*num_completion_queues=*/2, /*num_handler_threads=*/1}) {
+    grpc::ServerBuilder builder;
+    builder.AddListeningPort(
+        "localhost:0", grpc::experimental::LocalServerCredentials(LOCAL_TCP),
+        &port_);
+    service_.RegisterWith(builder);
+    server_ = builder.BuildAndStart();
+    service_.Start();
+    stub_ = v0::ExecutorGroup::NewStub(
+        grpc::CreateChannel(absl::StrCat("localhost:", port_),
+                            grpc::experimental::LocalCredentials(LOCAL_TCP)));
+  }
+
+  ~AsyncExecutorServiceTest() override {
+    server_->Shutdown();
+    service_.Shutdown();
+  }
+
+  void SetUp() override {
+    v0::GetExecutorRequest request_pb;
+    v0::Cardinality* cardinality = request_pb.add_cardinalities();
+    cardinality->mutable_placement()->set_uri("clients");
+    cardinality->set_cardinality(1);
+    v0::GetExecutorResponse response_pb;
+    grpc::ClientContext context;
+    TFF_ASSERT_OK(grpc_to_absl(
+        stub_->GetExecutor(&context, request_pb, &response_pb)));
+    executor_pb_ = response_pb.executor();
+  }
+
+  absl::StatusOr<OwnedValueId> TestId(uint64_t id) {
+    return OwnedValueId(executor_ptr_, id);
+  }
+
+  std::shared_ptr<::testing::StrictMock<MockExecutor>> executor_ptr_;
+  AsyncExecutorService service_;
+  int port_ = 0;
+  std::unique_ptr<grpc::Server> server_;
+  std::unique_ptr<v0::ExecutorGroup::Stub> stub_;
+  v0::ExecutorId executor_pb_;
+};
+
+TEST_F(AsyncExecutorServiceTest, CreateValueReturnsRef) {
+  v0::CreateValueRequest request_pb;
+  *request_pb.mutable_executor() = executor_pb_;
+  *request_pb.mutable_value() = testing::TensorV(2.0f);
+  v0::CreateValueResponse response_pb;
+  grpc::ClientContext context;
+
+  EXPECT_CALL(*executor_ptr_, CreateValue(::testing::_)).WillOnce([this] {
+    return TestId(0);
+  });
+
+  TFF_ASSERT_OK(
+      grpc_to_absl(stub_->CreateValue(&context, request_pb, &response_pb)));
+  EXPECT_THAT(response_pb, testing::EqualsProto("value_ref { id: '0' }"));
+}
+
+TEST_F(AsyncExecutorServiceTest, ReturnsHandlerError) {
+  v0::CreateValueRequest request_pb;
+  v0::CreateValueResponse response_pb;
+  grpc::ClientContext context;
+
+  // No executor ID is set on the request.
+  EXPECT_THAT(stub_->CreateValue(&context, request_pb, &response_pb),
+              GrpcStatusIs(grpc::StatusCode::FAILED_PRECONDITION,
+                           "No executor found for ID: ''."));
+}
+
+TEST_F(AsyncExecutorServiceTest, BlockedComputeDoesNotStallOtherRequests) {
+  absl::Notification compute_started;
+  absl::Notification release_compute;
+  EXPECT_CALL(*executor_ptr_, Materialize(0, ::testing::_))
+      .WillOnce([&](ValueId, v0::Value* value) {
+        compute_started.Notify();
+        release_compute.WaitForNotification();
+        *value = testing::TensorV(1.0f);
+        return absl::OkStatus();
+      });
+  v0::ComputeRequest compute_request_pb;
+  *compute_request_pb.mutable_executor() = executor_pb_;
+  compute_request_pb.mutable_value_ref()->set_id("0");
+  v0::ComputeResponse compute_response_pb;
+  grpc::ClientContext compute_context;
+  std::unique_ptr<grpc::ClientAsyncResponseReader<v0::ComputeResponse>>
+      compute_reader;
+  grpc::CompletionQueue queue;
+  compute_reader =
+      stub_->AsyncCompute(&compute_context, compute_request_pb, &queue);
+  grpc::Status compute_status;
+  compute_reader->Finish(&compute_response_pb, &compute_status, nullptr);
+  compute_started.WaitForNotification();
+
+  // With `Compute` still blocked, cheap requests complete on the single
+  // handler thread.
+  for (uint64_t id = 1; id <= 3; id++) {
+    v0::CreateValueRequest request_pb;
+    *request_pb.mutable_executor() = executor_pb_;
+    *request_pb.mutable_value() = testing::TensorV(2.0f);
+    v0::CreateValueResponse response_pb;
+    grpc::ClientContext context;
+    EXPECT_CALL(*executor_ptr_, CreateValue(::testing::_)).WillOnce([this, id] {
+      return TestId(id);
+    });
+    TFF_ASSERT_OK(
+        grpc_to_absl(stub_->CreateValue(&context, request_pb, &response_pb)));
+    EXPECT_EQ(response_pb.value_ref().id(), absl::StrCat(id));
+  }
+
+  release_compute.Notify();
+  void* tag;
+  bool ok;
+  ASSERT_TRUE(queue.Next(&tag, &ok));
+  EXPECT_TRUE(ok);
+  TFF_EXPECT_OK(grpc_to_absl(compute_status));
+  EXPECT_THAT(compute_response_pb.value(),
+              testing::EqualsProto(testing::TensorV(1.0f)));
+  queue.Shutdown();
+  ASSERT_FALSE(queue.Next(&tag, &ok));
+}
+
+TEST_F(AsyncExecutorServiceTest, ShutdownWaitsForRunningCalls) {
+  absl::Notification compute_started;
+  EXPECT_CALL(*executor_ptr_, Materialize(0, ::testing::_))
+      .WillOnce([&](ValueId, v0::Value* value) {
+        compute_started.Notify();
+        absl::SleepFor(absl::Milliseconds(100));
+        *value = testing::TensorV(1.0f);
+        return absl::OkStatus();
+      });
+  v0::ComputeRequest compute_request_pb;
+  *compute_request_pb.mutable_executor() = executor_pb_;
+  compute_request_pb.mutable_value_ref()->set_id("0");
+  v0::ComputeResponse compute_response_pb;
+  grpc::ClientContext compute_context;
+  grpc::CompletionQueue queue;
+  std::unique_ptr<grpc::ClientAsyncResponseReader<v0::ComputeResponse>>
+      compute_reader =
+          stub_->AsyncCompute(&compute_context, compute_request_pb, &queue);
+  grpc::Status compute_status;
+  compute_reader->Finish(&compute_response_pb, &compute_status, nullptr);
+  compute_started.WaitForNotification();
+
+  server_->Shutdown();
+  service_.Shutdown();
+
+  void* tag;
+  bool ok;
+  ASSERT_TRUE(queue.Next(&tag, &ok));
+  TFF_EXPECT_OK(grpc_to_absl(compute_status));
+  queue.Shutdown();
+  ASSERT_FALSE(queue.Next(&tag, &ok));
+}
+
+// Returns a float tensor large enough to be streamed in several chunks.
+v0::Value LargeTensorV() {
+  constexpr int64_t kNumElements = 100000;
+  tensorflow::Tensor tensor(tensorflow::DT_FLOAT,
+                            tensorflow::TensorShape({kNumElements}));
+  auto flat = tensor.flat<float>();
+  for (int64_t i = 0; i < kNumElements; i++) {
+    flat(i) = static_cast<float>(i);
+  }
+  return testing::TensorV(tensor);
+}
+
+TEST_F(AsyncExecutorServiceTest, CreateValueStreamCreatesValue) {
+  v0::Value value_pb = LargeTensorV();
+  EXPECT_CALL(*executor_ptr_, CreateValue(testing::EqualsProto(value_pb)))
+      .WillOnce([this] { return TestId(0); });
+
+  v0::CreateValueResponse response_pb;
+  grpc::ClientContext context;
+  std::unique_ptr<grpc::ClientWriter<v0::CreateValueStreamRequest>> stream =
+      stub_->CreateValueStream(&context, &response_pb);
+  ValueChunkWriter writer(value_pb, /*max_chunk_bytes=*/64 * 1024);
+  v0::CreateValueStreamRequest request_pb;
+  *request_pb.mutable_executor() = executor_pb_;
+  while (writer.Next(request_pb.mutable_chunk())) {
+    ASSERT_TRUE(stream->Write(request_pb));
+    request_pb.clear_executor();
+  }
+  ASSERT_TRUE(stream->WritesDone());
+  TFF_ASSERT_OK(grpc_to_absl(stream->Finish()));
+  EXPECT_THAT(response_pb, testing::EqualsProto("value_ref { id: '0' }"));
+}
+
+TEST_F(AsyncExecutorServiceTest, ComputeStreamReturnsValueInChunks) {
+  v0::Value value_pb = LargeTensorV();
+  EXPECT_CALL(*executor_ptr_, Materialize(0, ::testing::_))
+      .WillOnce([&](ValueId, v0::Value* value) {
+        *value = value_pb;
+        return absl::OkStatus();
+      });
+
+  v0::ComputeRequest request_pb;
+  *request_pb.mutable_executor() = executor_pb_;
+  request_pb.mutable_value_ref()->set_id("0");
+  grpc::ClientContext context;
+  std::unique_ptr<grpc::ClientReader<v0::ComputeStreamResponse>> stream =
+      stub_->ComputeStream(&context, request_pb);
+  ValueChunkReader reader;
+  int32_t num_chunks = 0;
+  v0::ComputeStreamResponse response_pb;
+  while (stream->Read(&response_pb)) {
+    TFF_ASSERT_OK(reader.Add(response_pb.chunk()));
+    num_chunks++;
+  }
+  TFF_ASSERT_OK(grpc_to_absl(stream->Finish()));
+  EXPECT_GT(num_chunks, 1);
+  EXPECT_THAT(reader.Finish(), IsOkAndHolds(testing::EqualsProto(value_pb)));
+}
+
+}  // namespace
+
+}  // namespace tensorflow_federated
@@ -0,0 +1,109 @@
+/* Copyright 2022, The TensorFlow Federated Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+#include "tensorflow_federated/cc/core/impl/executors/async_grpc.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>  // NOLINT
+#include <utility>
+
+#include "absl/time/time.h"
+#include "grpcpp/alarm.h"
+#include "grpcpp/grpcpp.h"
+
+namespace tensorflow_federated {
+
+namespace {
+
+// The number of threads polling the process-wide completion queues. Polling
+// threads only run completion handlers, so a handful suffices regardless of
+// the number of RPCs in flight.
+constexpr int32_t kNumGlobalPollingThreads = 2;
+
+// An alarm set by `RunAtDeadline`.
+class DeadlineAlarm : public CompletionQueueTag {
+ public:
+  explicit DeadlineAlarm(std::function<void()> callback)
+      : callback_(std::move(callback)) {}
+
+  void Set(grpc::CompletionQueue* queue, absl::Time deadline) {
+    alarm_.Set(queue, absl::ToChronoTime(deadline), this);
+  }
+
+  void OnCompleted(bool ok) override {
+    callback_();
+    delete this;
+  }
+
+ private:
+  const std::function<void()> callback_;
+  grpc::Alarm alarm_;
+};
+
+}  // namespace
+
+void RunAtDeadline(CompletionQueuePoller& poller, absl::Time deadline,
+                   std::function<void()> callback) {
+  // Owned by the completion queue until `OnCompleted` runs.
+  auto* alarm = new DeadlineAlarm(std::move(callback));
+  alarm->Set(poller.NextQueue(), deadline);
+}
+
+CompletionQueuePoller::CompletionQueuePoller(int32_t num_threads) {
+  num_threads = std::max<int32_t>(1, num_threads);
+  queues_.reserve(num_threads);
+  threads_.reserve(num_threads);
+  for (int32_t i = 0; i < num_threads; i++) {
+    queues_.push_back(std::make_unique<grpc::CompletionQueue>());
+  }
+  for (int32_t i = 0; i < num_threads; i++) {
+    grpc::CompletionQueue* queue = queues_[i].get();
+    threads_.emplace_back([this, queue]() { PollLoop(queue); });
+  }
+}
+
+CompletionQueuePoller::~CompletionQueuePoller() {
+  for (std::unique_ptr<grpc::CompletionQueue>& queue : queues_) {
+    queue->Shutdown();
+  }
+  for (std::thread& thread : threads_) {
+    thread.join();
+  }
+}
+
+grpc::CompletionQueue* CompletionQueuePoller::NextQueue() {
+  uint32_t index = next_queue_.fetch_add(1, std::memory_order_relaxed);
+  return queues_[index % queues_.size()].get();
+}
+
+CompletionQueuePoller& CompletionQueuePoller::Global() {
+  static CompletionQueuePoller* poller =
+      new CompletionQueuePoller(kNumGlobalPollingThreads);
+  return *poller;
+}
+
+void CompletionQueuePoller::PollLoop(grpc::CompletionQueue* queue) {
+  void* tag;
+  bool ok;
+  // `Next` returns false only once the queue has been shut down and drained.
+  while (queue->Next(&tag, &ok)) {
+    static_cast<CompletionQueueTag*>(tag)->OnCompleted(ok);
+  }
+}
+
+}  // namespace tensorflow_federated
@@ -0,0 +1,176 @@
+/* Copyright 2022, The TensorFlow Federated Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+#ifndef THIRD_PARTY_TENSORFLOW_FEDERATED_CC_CORE_IMPL_EXECUTORS_ASYNC_GRPC_H_
+#define THIRD_PARTY_TENSORFLOW_FEDERATED_CC_CORE_IMPL_EXECUTORS_ASYNC_GRPC_H_
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>  // NOLINT
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/time/time.h"
+#include "absl/types/optional.h"
+#include "grpcpp/grpcpp.h"
+#include "grpcpp/support/async_unary_call.h"
+#include "tensorflow_federated/cc/core/impl/executors/cancellation.h"
+#include "tensorflow_federated/cc/core/impl/executors/status_conversion.h"
+#include "tensorflow_federated/cc/core/impl/executors/threading.h"
+
+namespace tensorflow_federated {
+
+// An operation waiting on a `grpc::CompletionQueue` owned by a
+// `CompletionQueuePoller`. Its address is used as the queue's tag.
+class CompletionQueueTag {
+ public:
+  virtual ~CompletionQueueTag() = default;
+
+  // Called on a polling thread once the operation has completed. `ok` is the
+  // value reported by `grpc::CompletionQueue::Next`. Implementations are
+  // responsible for their own deletion, and must not block.
+  virtual void OnCompleted(bool ok) = 0;
+};
+
+// A fixed set of threads, each polling its own `grpc::CompletionQueue`.
+//
+// Asynchronous RPCs started on one of the queues (see `NextQueue`) occupy no
+// thread while in flight, so any number of them may be outstanding at once;
+// the polling threads only run the (cheap) completion handlers.
+class CompletionQueuePoller {
+ public:
+  // Creates a poller with `num_threads` polling threads. Non-positive values
+  // use a single thread.
+  explicit CompletionQueuePoller(int32_t num_threads);
+
+  // Shuts down the queues, runs the handlers of all outstanding operations and
+  // joins the polling threads.
+  ~CompletionQueuePoller();
+
+  CompletionQueuePoller(const CompletionQueuePoller&) = delete;
+  CompletionQueuePoller& operator=(const CompletionQueuePoller&) = delete;
+
+  // Returns the queue on which to start the next operation. Operations are
+  // spread round-robin across the queues. The tag passed to the operation must
+  // be a `CompletionQueueTag*`.
+  grpc::CompletionQueue* NextQueue();
+
+  int32_t num_threads() const { return static_cast<int32_t>(threads_.size()); }
+
+  // Returns the process-wide poller used by the executor runtime. It is created
+  // on first use and never destroyed.
+  static CompletionQueuePoller& Global();
+
+ private:
+  void PollLoop(grpc::CompletionQueue* queue);
+
+  std::vector<std::unique_ptr<grpc::CompletionQueue>> queues_;
+  std::vector<std::thread> threads_;
+  std::atomic<uint32_t> next_queue_{0};
+};
+
+// Runs `callback` on one of `poller`'s polling threads once `deadline` has
+// passed, without occupying a thread in the meantime. `callback` must be cheap
+// and must not block. If the poller is shut down first, `callback` runs then.
+void RunAtDeadline(CompletionQueuePoller& poller, absl::Time deadline,
+                   std::function<void()> callback);
+
+// The state of an RPC started by `AsyncUnaryCall`, which fulfills a promise
+// when the RPC completes.
+template <typename Response, typename Result>
+class AsyncUnaryCall_ : public CompletionQueueTag {
+ public:
+  using Reader = grpc::ClientAsyncResponseReaderInterface<Response>;
+  using StartFn = std::function<std::unique_ptr<Reader>(
+      grpc::ClientContext*, grpc::CompletionQueue*)>;
+  using TransformFn = std::function<absl::StatusOr<Result>(Response&&)>;
+
+  static SharedFuture<absl::StatusOr<Result>> Start(
+      CompletionQueuePoller& poller, const StartFn& start,
+      TransformFn transform) {
+    // Owned by the completion queue until `OnCompleted` runs, after which it
+    // must no longer be touched here.
+    auto* call = new AsyncUnaryCall_(std::move(transform));
+    SharedFuture<absl::StatusOr<Result>> result = call->promise_.get_future();
+    std::shared_ptr<CancellationToken> token =
+        call->promise_.cancellation_token();
+    if (token->IsCancelled()) {
+      call->promise_.set_value(token->CheckNotCancelled());
+      delete call;
+      return result;
+    }
+    // `TryCancel` may be called before the RPC starts, in which case the RPC
+    // fails as soon as it does.
+    call->cancel_rpc_.emplace(std::move(token),
+                              [call]() { call->context_.TryCancel(); });
+    call->reader_ = start(&call->context_, poller.NextQueue());
+    call->reader_->Finish(&call->response_, &call->status_, call);
+    return result;
+  }
+
+  void OnCompleted(bool ok) override {
+    cancel_rpc_.reset();
+    if (status_.ok()) {
+      promise_.set_value(transform_(std::move(response_)));
+    } else {
+      promise_.set_value(grpc_to_absl(status_));
+    }
+    delete this;
+  }
+
+ private:
+  explicit AsyncUnaryCall_(TransformFn transform)
+      : transform_(std::move(transform)) {}
+
+  const TransformFn transform_;
+  Promise<absl::StatusOr<Result>> promise_;
+  grpc::ClientContext context_;
+  Response response_;
+  grpc::Status status_;
+  std::unique_ptr<Reader> reader_;
+  absl::optional<ScopedCancellationCallback> cancel_rpc_;
+};
+
+// Starts a unary RPC on one of `poller`'s completion queues and returns a
+// future for `transform(response)`, or for the RPC's error.
+//
+// `start(context, queue)` must start the RPC and return its reader, typically
+// by calling a stub's `Async<Method>(context, request, queue)`. The request
+// need only live until `start` returns.
+//
+// `transform` runs on a polling thread once the RPC succeeds, and so must be
+// cheap and must not block. No thread is occupied while the RPC is in flight.
+//
+// The RPC is skipped or cancelled (via `grpc::ClientContext::TryCancel`) if
+// the returned future is abandoned, or if `CancellationToken::Current()` at
+// the time of the call is cancelled.
+template <typename Response, typename StartFn, typename TransformFn,
+          typename Result = typename std::result_of_t<
+              TransformFn(Response&&)>::value_type>
+SharedFuture<absl::StatusOr<Result>> AsyncUnaryCall(
+    CompletionQueuePoller& poller, const StartFn& start,
+    TransformFn transform) {
+  return AsyncUnaryCall_<Response, Result>::Start(poller, start,
+                                                  std::move(transform));
+}
+
+}  // namespace tensorflow_federated
+
+#endif  // THIRD_PARTY_TENSORFLOW_FEDERATED_CC_CORE_IMPL_EXECUTORS_ASYNC_GRPC_H_
@@ -0,0 +1,155 @@
+/* Copyright 2022, The TensorFlow Federated Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+#include "tensorflow_federated/cc/core/impl/executors/async_grpc.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "googlemock/include/gmock/gmock.h"
+#include "googletest/include/gtest/gtest.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/time.h"
+#include "grpcpp/grpcpp.h"
+#include "tensorflow_federated/cc/core/impl/executors/cancellation.h"
+#include "tensorflow_federated/cc/core/impl/executors/mock_grpc.h"
+#include "tensorflow_federated/cc/core/impl/executors/status_matchers.h"
+#include "tensorflow_federated/cc/core/impl/executors/threading.h"
+#include "tensorflow_federated/proto/v0/executor.grpc.pb.h"
+#include "tensorflow_federated/proto/v0/executor.pb.h"
+
+namespace tensorflow_federated {
+
+namespace {
+
+using ::absl::StatusCode;
+
+class AsyncGrpcTest : public ::testing::Test {
+ protected:
+  AsyncGrpcTest()
+      : mock_service_(mock_server_.service()),
+        stub_(mock_server_.NewStub()),
+        poller_(/*num_threads=*/1) {}
+
+  // Starts a `CreateValue` RPC and returns a future for the ID of the
+  // returned `ValueRef`.
+  SharedFuture<absl::StatusOr<std::string>> StartCreateValue() {
+    v0::CreateValueRequest request;
+    return AsyncUnaryCall<v0::CreateValueResponse>(
+        poller_,
+        [this, &request](grpc::ClientContext* context,
+                         grpc::CompletionQueue* queue) {
+          return stub_->AsyncCreateValue(context, request, queue);
+        },
+        [](v0::CreateValueResponse&& response) -> absl::StatusOr<std::string> {
+          return response.value_ref().id();
+        });
+  }
+
+  MockGrpcExecutorServer mock_server_;
+  MockGrpcExecutorService* mock_service_;
+  std::unique_ptr<v0::ExecutorGroup::StubInterface> stub_;
+  CompletionQueuePoller poller_;
+};
+
+TEST_F(AsyncGrpcTest, ReturnsTransformedResponse) {
+  EXPECT_CALL(*mock_service_, CreateValue(::testing::_, ::testing::_,
+                                          ::testing::_))
+      .WillOnce([](grpc::ServerContext*, const v0::CreateValueRequest*,
+                   v0::CreateValueResponse* response) {
+        response->mutable_value_ref()->set_id("value");
+        return grpc::Status::OK;
+      });
+  EXPECT_THAT(Wait(StartCreateValue()), IsOkAndHolds("value"));
+}
+
+TEST_F(AsyncGrpcTest, ReturnsRpcError) {
+  EXPECT_CALL(*mock_service_, CreateValue(::testing::_, ::testing::_,
+                                          ::testing::_))
+      .WillOnce(::testing::Return(
+          grpc::Status(grpc::StatusCode::UNAVAILABLE, "Unavailable")));
+  EXPECT_THAT(Wait(StartCreateValue()), StatusIs(StatusCode::kUnavailable));
+}
+
+TEST_F(AsyncGrpcTest, ManyRpcsInFlightOnOnePollingThread) {
+  constexpr int32_t kNumCalls = 256;
+  EXPECT_CALL(*mock_service_, CreateValue(::testing::_, ::testing::_,
+                                          ::testing::_))
+      .Times(kNumCalls)
+      .WillRepeatedly([](grpc::ServerContext*, const v0::CreateValueRequest*,
+                         v0::CreateValueResponse* response) {
+        response->mutable_value_ref()->set_id("value");
+        return grpc::Status::OK;
+      });
+  // All of the RPCs are started before any of them is waited upon.
+  std::vector<SharedFuture<absl::StatusOr<std::string>>> futures;
+  for (int32_t i = 0; i < kNumCalls; i++) {
+    futures.push_back(StartCreateValue());
+  }
+  for (const auto& future : futures) {
+    EXPECT_THAT(Wait(future), IsOkAndHolds("value"));
+  }
+}
+
+TEST_F(AsyncGrpcTest, CancelledCallIsNotStarted) {
+  EXPECT_CALL(*mock_service_, CreateValue(::testing::_, ::testing::_,
+                                          ::testing::_))
+      .Times(0);
+  auto token = std::make_shared<CancellationToken>();
+  token->Cancel();
+  ScopedCancellationToken scoped_token(token);
+  EXPECT_THAT(Wait(StartCreateValue()), StatusIs(StatusCode::kCancelled));
+}
+
+TEST_F(AsyncGrpcTest, AbandoningFutureCancelsRpc) {
+  absl::Notification rpc_started;
+  absl::Notification rpc_cancelled;
+  EXPECT_CALL(*mock_service_, CreateValue(::testing::_, ::testing::_,
+                                          ::testing::_))
+      .WillOnce([&](grpc::ServerContext* context,
+                    const v0::CreateValueRequest*, v0::CreateValueResponse*) {
+        rpc_started.Notify();
+        while (!context->IsCancelled()) {
+          absl::SleepFor(absl::Milliseconds(1));
+        }
+        rpc_cancelled.Notify();
+        return grpc::Status::CANCELLED;
+      });
+  {
+    SharedFuture<absl::StatusOr<std::string>> future = StartCreateValue();
+    rpc_started.WaitForNotification();
+  }
+  EXPECT_TRUE(rpc_cancelled.WaitForNotificationWithTimeout(absl::Seconds(10)));
+}
+
+TEST_F(AsyncGrpcTest, RunAtDeadlineRunsOnceDeadlinePasses) {
+  absl::Notification ran;
+  absl::Time deadline = absl::Now() + absl::Milliseconds(20);
+  absl::Time ran_at;
+  RunAtDeadline(poller_, deadline, [&]() {
+    ran_at = absl::Now();
+    ran.Notify();
+  });
+  ASSERT_TRUE(ran.WaitForNotificationWithTimeout(absl::Seconds(10)));
+  EXPECT_GE(ran_at, deadline);
+}
+
+}  // namespace
+
+}  // namespace tensorflow_federated
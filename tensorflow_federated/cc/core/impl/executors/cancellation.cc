@@ -0,0 +1,137 @@
+/* Copyright 2022, The TensorFlow Federated Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+#include "tensorflow_federated/cc/core/impl/executors/cancellation.h"
+
+#include <functional>
+#include <memory>
+#include <thread>  // NOLINT
+#include <utility>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/synchronization/mutex.h"
+
+namespace tensorflow_federated {
+
+namespace {
+
+thread_local std::shared_ptr<CancellationToken> current_token;
+
+}  // namespace
+
+CancellationToken::~CancellationToken() {
+  std::shared_ptr<CancellationToken> parent = parent_.lock();
+  if (parent != nullptr) {
+    parent->RemoveCallback(parent_callback_id_);
+  }
+}
+
+std::shared_ptr<CancellationToken> CancellationToken::CreateChildOf(
+    const std::shared_ptr<CancellationToken>& parent) {
+  auto token = std::make_shared<CancellationToken>();
+  if (parent != nullptr) {
+    token->parent_ = parent;
+    token->parent_callback_id_ =
+        parent->AddCallback([child = std::weak_ptr<CancellationToken>(token)]() {
+          std::shared_ptr<CancellationToken> locked_child = child.lock();
+          if (locked_child != nullptr) {
+            locked_child->Cancel();
+          }
+        });
+  }
+  return token;
+}
+
+const std::shared_ptr<CancellationToken>& CancellationToken::Current() {
+  return current_token;
+}
+
+void CancellationToken::Cancel() {
+  absl::flat_hash_map<CallbackId, std::function<void()>> callbacks;
+  {
+    absl::MutexLock lock(&mutex_);
+    if (cancelled_.load()) {
+      return;
+    }
+    cancelled_.store(true);
+    callbacks.swap(callbacks_);
+    callbacks_running_ = true;
+    cancelling_thread_ = std::this_thread::get_id();
+  }
+  for (auto& [id, callback] : callbacks) {
+    callback();
+  }
+  absl::MutexLock lock(&mutex_);
+  callbacks_running_ = false;
+}
+
+absl::Status CancellationToken::CheckNotCancelled() const {
+  if (IsCancelled()) {
+    return absl::CancelledError("The operation was cancelled.");
+  }
+  return absl::OkStatus();
+}
+
+CancellationToken::CallbackId CancellationToken::AddCallback(
+    std::function<void()> callback) {
+  {
+    absl::MutexLock lock(&mutex_);
+    if (!cancelled_.load()) {
+      CallbackId id = next_callback_id_++;
+      callbacks_.emplace(id, std::move(callback));
+      return id;
+    }
+  }
+  callback();
+  return 0;
+}
+
+void CancellationToken::RemoveCallback(CallbackId id) {
+  absl::MutexLock lock(&mutex_);
+  callbacks_.erase(id);
+  if (callbacks_running_ && cancelling_thread_ != std::this_thread::get_id()) {
+    mutex_.Await(
+        absl::Condition(this, &CancellationToken::CallbacksNotRunning));
+  }
+}
+
+bool CancellationToken::CallbacksNotRunning() const {
+  return !callbacks_running_;
+}
+
+ScopedCancellationToken::ScopedCancellationToken(
+    std::shared_ptr<CancellationToken> token)
+    : previous_(std::exchange(current_token, std::move(token))) {}
+
+ScopedCancellationToken::~ScopedCancellationToken() {
+  current_token = std::move(previous_);
+}
+
+ScopedCancellationCallback::ScopedCancellationCallback(
+    std::shared_ptr<CancellationToken> token, std::function<void()> callback)
+    : token_(std::move(token)) {
+  if (token_ != nullptr) {
+    id_ = token_->AddCallback(std::move(callback));
+  }
+}
+
+ScopedCancellationCallback::~ScopedCancellationCallback() {
+  if (token_ != nullptr && id_ != 0) {
+    token_->RemoveCallback(id_);
+  }
+}
+
+}  // namespace tensorflow_federated
@@ -0,0 +1,134 @@
+/* Copyright 2022, The TensorFlow Federated Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+#ifndef THIRD_PARTY_TENSORFLOW_FEDERATED_CC_CORE_IMPL_EXECUTORS_CANCELLATION_H_
+#define THIRD_PARTY_TENSORFLOW_FEDERATED_CC_CORE_IMPL_EXECUTORS_CANCELLATION_H_
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>  // NOLINT
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/synchronization/mutex.h"
+
+namespace tensorflow_federated {
+
+// A thread-safe flag used to cooperatively cancel outstanding work.
+//
+// Work which may take a long time (waiting for a session, issuing an RPC,
+// running a queued task) should check `IsCancelled` before starting, or
+// register a callback which interrupts it (e.g. `grpc::ClientContext::
+// TryCancel`) using a `ScopedCancellationCallback`.
+//
+// Tokens travel implicitly with asynchronous work: `ThreadRun`, `Then`,
+// `MapAsync` and `ParallelTasks` run their functions with
+// `CancellationToken::Current()` set to a token which is cancelled once the
+// result of the work is no longer wanted, or once the work that scheduled it
+// has itself been cancelled.
+class CancellationToken {
+ public:
+  using CallbackId = uint64_t;
+
+  CancellationToken() = default;
+  ~CancellationToken();
+
+  CancellationToken(const CancellationToken&) = delete;
+  CancellationToken& operator=(const CancellationToken&) = delete;
+
+  // Creates a token which is cancelled whenever `parent` is. `parent` may be
+  // null, in which case the new token has no parent.
+  static std::shared_ptr<CancellationToken> CreateChildOf(
+      const std::shared_ptr<CancellationToken>& parent);
+
+  // Returns the token associated with the work running on the current thread,
+  // or null if there is none.
+  static const std::shared_ptr<CancellationToken>& Current();
+
+  // Cancels the token, running all registered callbacks. Has no effect if the
+  // token was already cancelled.
+  void Cancel();
+
+  bool IsCancelled() const { return cancelled_.load(); }
+
+  // Returns a `CancelledError` if the token has been cancelled, `ok`
+  // otherwise.
+  absl::Status CheckNotCancelled() const;
+
+  // Registers `callback` to be run when the token is cancelled. If the token is
+  // already cancelled, `callback` is run immediately and 0 is returned.
+  CallbackId AddCallback(std::function<void()> callback);
+
+  // Deregisters a callback previously registered with `AddCallback`. If the
+  // callback is concurrently being run by `Cancel` on another thread, blocks
+  // until it has returned, so that it is safe to destroy anything referenced
+  // by the callback once this method returns.
+  void RemoveCallback(CallbackId id);
+
+ private:
+  bool CallbacksNotRunning() const ABSL_SHARED_LOCKS_REQUIRED(mutex_);
+
+  std::atomic<bool> cancelled_{false};
+  mutable absl::Mutex mutex_;
+  CallbackId next_callback_id_ ABSL_GUARDED_BY(mutex_) = 1;
+  absl::flat_hash_map<CallbackId, std::function<void()>> callbacks_
+      ABSL_GUARDED_BY(mutex_);
+  // The thread running callbacks inside of `Cancel`, if any.
+  bool callbacks_running_ ABSL_GUARDED_BY(mutex_) = false;
+  std::thread::id cancelling_thread_ ABSL_GUARDED_BY(mutex_);
+
+  // The parent of this token (if any) and the ID of the callback registered
+  // with it.
+  std::weak_ptr<CancellationToken> parent_;
+  CallbackId parent_callback_id_ = 0;
+};
+
+// Sets `CancellationToken::Current()` to `token` for the lifetime of this
+// object, restoring the previous token on destruction.
+class ScopedCancellationToken {
+ public:
+  explicit ScopedCancellationToken(std::shared_ptr<CancellationToken> token);
+  ~ScopedCancellationToken();
+
+  ScopedCancellationToken(const ScopedCancellationToken&) = delete;
+  ScopedCancellationToken& operator=(const ScopedCancellationToken&) = delete;
+
+ private:
+  std::shared_ptr<CancellationToken> previous_;
+};
+
+// Registers a callback with a `CancellationToken` for the lifetime of this
+// object. `token` may be null, in which case this object does nothing.
+class ScopedCancellationCallback {
+ public:
+  ScopedCancellationCallback(std::shared_ptr<CancellationToken> token,
+                             std::function<void()> callback);
+  ~ScopedCancellationCallback();
+
+  ScopedCancellationCallback(const ScopedCancellationCallback&) = delete;
+  ScopedCancellationCallback& operator=(const ScopedCancellationCallback&) =
+      delete;
+
+ private:
+  std::shared_ptr<CancellationToken> token_;
+  CancellationToken::CallbackId id_ = 0;
+};
+
+}  // namespace tensorflow_federated
+
+#endif  // THIRD_PARTY_TENSORFLOW_FEDERATED_CC_CORE_IMPL_EXECUTORS_CANCELLATION_H_
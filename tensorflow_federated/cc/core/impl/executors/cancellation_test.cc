@@ -0,0 +1,114 @@
+/* Copyright 2022, The TensorFlow Federated Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+#include "tensorflow_federated/cc/core/impl/executors/cancellation.h"
+
+#include <memory>
+
+#include "googlemock/include/gmock/gmock.h"
+#include "googletest/include/gtest/gtest.h"
+#include "absl/status/status.h"
+#include "tensorflow_federated/cc/core/impl/executors/status_matchers.h"
+
+namespace tensorflow_federated {
+
+namespace {
+
+class CancellationTest : public ::testing::Test {};
+
+TEST_F(CancellationTest, CancelRunsCallbacksOnce) {
+  CancellationToken token;
+  int32_t calls = 0;
+  token.AddCallback([&calls]() { calls++; });
+  EXPECT_FALSE(token.IsCancelled());
+  EXPECT_THAT(token.CheckNotCancelled(), IsOk());
+  token.Cancel();
+  token.Cancel();
+  EXPECT_TRUE(token.IsCancelled());
+  EXPECT_THAT(token.CheckNotCancelled(),
+              StatusIs(absl::StatusCode::kCancelled));
+  EXPECT_EQ(calls, 1);
+}
+
+TEST_F(CancellationTest, CallbackAddedAfterCancelRunsImmediately) {
+  CancellationToken token;
+  token.Cancel();
+  bool called = false;
+  token.AddCallback([&called]() { called = true; });
+  EXPECT_TRUE(called);
+}
+
+TEST_F(CancellationTest, RemovedCallbackIsNotRun) {
+  CancellationToken token;
+  bool called = false;
+  CancellationToken::CallbackId id =
+      token.AddCallback([&called]() { called = true; });
+  token.RemoveCallback(id);
+  token.Cancel();
+  EXPECT_FALSE(called);
+}
+
+TEST_F(CancellationTest, ScopedCallbackIsRemovedOnDestruction) {
+  auto token = std::make_shared<CancellationToken>();
+  bool called = false;
+  { ScopedCancellationCallback callback(token, [&called]() { called = true; }); }
+  token->Cancel();
+  EXPECT_FALSE(called);
+}
+
+TEST_F(CancellationTest, ScopedCallbackWithNullTokenDoesNothing) {
+  ScopedCancellationCallback callback(nullptr, []() { FAIL(); });
+}
+
+TEST_F(CancellationTest, CancellingParentCancelsChild) {
+  auto parent = std::make_shared<CancellationToken>();
+  auto child = CancellationToken::CreateChildOf(parent);
+  EXPECT_FALSE(child->IsCancelled());
+  parent->Cancel();
+  EXPECT_TRUE(child->IsCancelled());
+}
+
+TEST_F(CancellationTest, CancellingChildDoesNotCancelParent) {
+  auto parent = std::make_shared<CancellationToken>();
+  auto child = CancellationToken::CreateChildOf(parent);
+  child->Cancel();
+  EXPECT_FALSE(parent->IsCancelled());
+}
+
+TEST_F(CancellationTest, ChildOfCancelledParentIsCancelled) {
+  auto parent = std::make_shared<CancellationToken>();
+  parent->Cancel();
+  EXPECT_TRUE(CancellationToken::CreateChildOf(parent)->IsCancelled());
+}
+
+TEST_F(CancellationTest, ScopedTokenSetsAndRestoresCurrent) {
+  EXPECT_EQ(CancellationToken::Current(), nullptr);
+  auto outer = std::make_shared<CancellationToken>();
+  {
+    ScopedCancellationToken scoped_outer(outer);
+    EXPECT_EQ(CancellationToken::Current(), outer);
+    auto inner = std::make_shared<CancellationToken>();
+    {
+      ScopedCancellationToken scoped_inner(inner);
+      EXPECT_EQ(CancellationToken::Current(), inner);
+    }
+    EXPECT_EQ(CancellationToken::Current(), outer);
+  }
+  EXPECT_EQ(CancellationToken::Current(), nullptr);
+}
+
+}  // namespace
+
+}  // namespace tensorflow_federated
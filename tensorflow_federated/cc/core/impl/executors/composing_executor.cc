@@ -15,13 +15,18 @@ limitations under the License
 
 #include "tensorflow_federated/cc/core/impl/executors/composing_executor.h"
 
+#include <algorithm>
+#include <cmath>
 #include <cstddef>
+#include <cstdint>
 #include <functional>
-#include <future>  // NOLINT
+#include <iterator>
+#include <limits>
 #include <memory>
 #include <string>
 #include <tuple>
 #include <utility>
+#include <vector>
 
 #include "google/protobuf/repeated_field.h"
 #include "absl/base/thread_annotations.h"
@@ -30,15 +35,20 @@ limitations under the License
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 #include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "absl/types/optional.h"
 #include "absl/types/span.h"
 #include "absl/types/variant.h"
 #include "tensorflow/core/platform/macros.h"
+#include "tensorflow_federated/cc/core/impl/executors/cancellation.h"
 #include "tensorflow_federated/cc/core/impl/executors/cardinalities.h"
 #include "tensorflow_federated/cc/core/impl/executors/computations.h"
 #include "tensorflow_federated/cc/core/impl/executors/executor.h"
 #include "tensorflow_federated/cc/core/impl/executors/federated_intrinsics.h"
 #include "tensorflow_federated/cc/core/impl/executors/status_macros.h"
+#include "tensorflow_federated/cc/core/impl/executors/tensor_accumulator.h"
+#include "tensorflow_federated/cc/core/impl/executors/thread_pool.h"
 #include "tensorflow_federated/cc/core/impl/executors/threading.h"
 #include "tensorflow_federated/cc/core/impl/executors/value_validation.h"
 #include "tensorflow_federated/proto/v0/computation.pb.h"
@@ -50,7 +60,7 @@ namespace {
 
 class ExecutorValue;
 
-using ValueFuture = std::shared_future<absl::StatusOr<ExecutorValue>>;
+using ValueFuture = SharedFuture<absl::StatusOr<ExecutorValue>>;
 using Children = std::tuple<uint32_t>;
 
 inline std::shared_ptr<OwnedValueId> ShareValueId(OwnedValueId&& id) {
@@ -176,12 +186,6 @@ using Structure = std::shared_ptr<std::vector<ExecutorValue>>;
 using ValueVariant = absl::variant<Unplaced, Server, Clients, Structure,
                                    enum FederatedIntrinsic>;
 
-inline Clients NewClients(uint32_t num_clients) {
-  auto v = std::make_shared<std::vector<std::shared_ptr<OwnedValueId>>>();
-  v->reserve(num_clients);
-  return v;
-}
-
 inline Structure NewStructure() {
   return std::make_shared<std::vector<ExecutorValue>>();
 }
@@ -343,14 +347,236 @@ class ExecutorValue {
   ValueType type_;
 };
 
+// Merges the non-empty `values` on `server` from left to right.
+absl::StatusOr<OwnedValueId> MergeInOrder(Executor& server, ValueId merge,
+                                          std::vector<OwnedValueId> values) {
+  OwnedValueId current = std::move(values[0]);
+  for (size_t i = 1; i < values.size(); i++) {
+    OwnedValueId merge_arg = TFF_TRY(server.CreateStruct({current, values[i]}));
+    current = TFF_TRY(server.CreateCall(merge, merge_arg));
+  }
+  return current;
+}
+
+// Runs `federated_aggregate` over the clients of `child` holding `value`,
+// given the intrinsic followed by its (non-`value`) arguments, and returns the
+// materialized partial aggregate.
+absl::StatusOr<v0::Value> ComputePartialAggregate(
+    Executor& child, ValueId value,
+    const std::vector<v0::Value>& intrinsic_and_args) {
+  std::vector<const v0::Value*> value_pbs;
+  for (const v0::Value& value_pb : intrinsic_and_args) {
+    value_pbs.push_back(&value_pb);
+  }
+  std::vector<OwnedValueId> child_ids = TFF_TRY(child.CreateValues(value_pbs));
+  std::vector<ValueId> arg_ids;
+  arg_ids.emplace_back(value);
+  for (size_t j = 1; j < child_ids.size(); j++) {
+    arg_ids.emplace_back(child_ids[j].ref());
+  }
+  auto child_arg_id = TFF_TRY(child.CreateStruct(std::move(arg_ids)));
+  auto child_result_id = TFF_TRY(child.CreateCall(child_ids[0], child_arg_id));
+  v0::Value child_result = TFF_TRY(child.Materialize(child_result_id));
+  if (!child_result.has_federated() ||
+      child_result.federated().type().placement().value().uri() !=
+          kServerUri) {
+    return absl::InternalError(
+        "Child executor returned non-server-placed value");
+  }
+  return std::move(*child_result.mutable_federated()->mutable_value(0));
+}
+
+// Calls the federated intrinsic `uri` on `arg` in `child` and returns the
+// member of its materialized server-placed result.
+absl::StatusOr<v0::Value> CallChildIntrinsicAtServer(Executor& child,
+                                                     absl::string_view uri,
+                                                     ValueId arg) {
+  v0::Value intrinsic_pb;
+  intrinsic_pb.mutable_computation()->mutable_intrinsic()->mutable_uri()->assign(
+      uri.data(), uri.size());
+  OwnedValueId intrinsic = TFF_TRY(child.CreateValue(intrinsic_pb));
+  OwnedValueId result_id = TFF_TRY(child.CreateCall(intrinsic, arg));
+  v0::Value result = TFF_TRY(child.Materialize(result_id));
+  if (!result.has_federated() ||
+      result.federated().type().placement().value().uri() != kServerUri) {
+    return absl::InternalError(
+        "Child executor returned non-server-placed value");
+  }
+  return std::move(*result.mutable_federated()->mutable_value(0));
+}
+
+// The partial aggregates of the children of a `ComposingExecutor` in a round
+// of `federated_aggregate`, collected in the order in which they arrive.
+//
+// A round is shared with the tasks computing the partial aggregates, which may
+// outlive the call to `federated_aggregate` when their children are dropped as
+// stragglers.
+class AggregationRound {
+ public:
+  AggregationRound(std::shared_ptr<Executor> server,
+                   std::shared_ptr<OwnedValueId> merge, uint32_t num_children,
+                   uint32_t merge_fan_in, bool merge_is_commutative)
+      : server_(std::move(server)),
+        merge_(std::move(merge)),
+        num_children_(num_children),
+        merge_fan_in_(merge_fan_in),
+        merge_is_commutative_(merge_is_commutative),
+        child_partial_aggregates_(num_children) {}
+
+  // Records the (materialized) partial aggregate of the child at `index`,
+  // which holds `num_clients` clients, embedding it in the server. If `merge`
+  // is commutative, partial aggregates are merged as soon as `merge_fan_in` of
+  // them are available. Partial aggregates arriving after `Close` are
+  // dropped.
+  void Add(uint32_t index, uint32_t num_clients,
+           absl::StatusOr<v0::Value> partial_aggregate_pb) {
+    absl::StatusOr<OwnedValueId> partial_aggregate =
+        absl::CancelledError("The round was closed.");
+    if (!partial_aggregate_pb.ok()) {
+      partial_aggregate = partial_aggregate_pb.status();
+    } else if (!closed()) {
+      partial_aggregate = server_->CreateValue(*partial_aggregate_pb);
+    }
+    std::vector<OwnedValueId> subtree;
+    {
+      absl::MutexLock lock(&mutex_);
+      num_finished_children_++;
+      if (closed_) {
+        return;
+      }
+      if (!partial_aggregate.ok()) {
+        status_.Update(partial_aggregate.status());
+        return;
+      }
+      num_arrived_children_++;
+      num_arrived_clients_ += num_clients;
+      if (!merge_is_commutative_) {
+        child_partial_aggregates_[index] = std::move(*partial_aggregate);
+        return;
+      }
+      if (!QueueForMergeLocked(std::move(*partial_aggregate), &subtree)) {
+        return;
+      }
+    }
+    while (true) {
+      absl::StatusOr<OwnedValueId> merged =
+          MergeInOrder(*server_, merge_->ref(), std::move(subtree));
+      absl::MutexLock lock(&mutex_);
+      num_merging_--;
+      if (!merged.ok()) {
+        status_.Update(merged.status());
+        return;
+      }
+      if (!QueueForMergeLocked(std::move(*merged), &subtree)) {
+        return;
+      }
+    }
+  }
+
+  // Fails the round, unblocking `Close`.
+  void Cancel() {
+    absl::MutexLock lock(&mutex_);
+    status_.Update(absl::CancelledError("federated_aggregate was cancelled"));
+  }
+
+  // Waits until every child has finished, `min_arrived_clients` clients have
+  // arrived or `deadline` has passed, and closes the round. Returns the
+  // partial aggregates which have arrived, in the order of the children unless
+  // `merge` is commutative, or the first failure of a child.
+  absl::StatusOr<std::vector<OwnedValueId>> Close(uint32_t min_arrived_clients,
+                                                  absl::Time deadline,
+                                                  AggregationStats* stats) {
+    absl::MutexLock lock(&mutex_);
+    auto can_close = [this, min_arrived_clients]()
+                         ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+                           return num_finished_children_ == num_children_ ||
+                                  num_arrived_clients_ >= min_arrived_clients ||
+                                  !status_.ok();
+                         };
+    auto not_merging = [this]() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+      return num_merging_ == 0;
+    };
+    {
+      ThreadPool::ScopedBlockingCall blocking_call;
+      mutex_.AwaitWithDeadline(absl::Condition(&can_close), deadline);
+      closed_ = true;
+      mutex_.Await(absl::Condition(&not_merging));
+    }
+    TFF_TRY(status_);
+    stats->num_clients = num_arrived_clients_;
+    stats->num_dropped_children = num_children_ - num_arrived_children_;
+    if (num_arrived_children_ == 0) {
+      return absl::DeadlineExceededError(
+          "No child produced its partial aggregate before the round closed");
+    }
+    std::vector<OwnedValueId> partial_aggregates =
+        std::move(unmerged_partial_aggregates_);
+    for (absl::optional<OwnedValueId>& partial_aggregate :
+         child_partial_aggregates_) {
+      if (partial_aggregate.has_value()) {
+        partial_aggregates.push_back(std::move(*partial_aggregate));
+      }
+    }
+    return partial_aggregates;
+  }
+
+ private:
+  bool closed() {
+    absl::MutexLock lock(&mutex_);
+    return closed_;
+  }
+
+  // Queues `partial_aggregate` to be merged. Once `merge_fan_in_` partial
+  // aggregates are queued, moves them to `subtree` and returns true, in which
+  // case the caller must merge them and queue the result in turn.
+  bool QueueForMergeLocked(OwnedValueId partial_aggregate,
+                           std::vector<OwnedValueId>* subtree)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    unmerged_partial_aggregates_.push_back(std::move(partial_aggregate));
+    if (unmerged_partial_aggregates_.size() < merge_fan_in_) {
+      return false;
+    }
+    *subtree = std::move(unmerged_partial_aggregates_);
+    unmerged_partial_aggregates_.clear();
+    num_merging_++;
+    return true;
+  }
+
+  const std::shared_ptr<Executor> server_;
+  const std::shared_ptr<OwnedValueId> merge_;
+  const uint32_t num_children_;
+  const uint32_t merge_fan_in_;
+  const bool merge_is_commutative_;
+  absl::Mutex mutex_;
+  bool closed_ ABSL_GUARDED_BY(mutex_) = false;
+  absl::Status status_ ABSL_GUARDED_BY(mutex_);
+  uint32_t num_finished_children_ ABSL_GUARDED_BY(mutex_) = 0;
+  uint32_t num_arrived_children_ ABSL_GUARDED_BY(mutex_) = 0;
+  uint32_t num_arrived_clients_ ABSL_GUARDED_BY(mutex_) = 0;
+  uint32_t num_merging_ ABSL_GUARDED_BY(mutex_) = 0;
+  // Used if `merge` is not commutative.
+  std::vector<absl::optional<OwnedValueId>> child_partial_aggregates_
+      ABSL_GUARDED_BY(mutex_);
+  // Used if `merge` is commutative.
+  std::vector<OwnedValueId> unmerged_partial_aggregates_
+      ABSL_GUARDED_BY(mutex_);
+};
+
 class ComposingExecutor : public ExecutorBase<ValueFuture> {
  public:
   explicit ComposingExecutor(std::shared_ptr<Executor> server,
                              std::vector<ComposingChild> children,
-                             uint32_t total_clients)
+                             uint32_t total_clients,
+                             ComposingExecutorOptions options)
       : server_(std::move(server)),
         children_(std::move(children)),
-        total_clients_(total_clients) {}
+        total_clients_(total_clients),
+        merge_fan_in_(std::max<uint32_t>(options.merge_fan_in, 2)),
+        merge_is_commutative_(options.merge_is_commutative),
+        aggregation_deadline_(options.aggregation_deadline),
+        aggregation_quorum_(options.aggregation_quorum),
+        aggregation_stats_callback_(
+            std::move(options.aggregation_stats_callback)) {}
   ~ComposingExecutor() override {
     // Delete `OwnedValueId` and release them from the child executor before
     // destroying it.
@@ -373,47 +599,44 @@ class ComposingExecutor : public ExecutorBase<ValueFuture> {
 
   absl::StatusOr<ValueFuture> CreateCall(
       ValueFuture function, absl::optional<ValueFuture> argument) final {
-    return ThreadRun([function = std::move(function),
-                      argument = std::move(argument), this,
-                      this_keepalive = shared_from_this()]()
-                         -> absl::StatusOr<ExecutorValue> {
-      ExecutorValue fn = TFF_TRY(Wait(function));
-      absl::optional<ExecutorValue> arg = absl::nullopt;
-      if (argument.has_value()) {
-        arg = TFF_TRY(Wait(argument.value()));
-      }
-
-      switch (fn.type()) {
-        case ExecutorValue::ValueType::CLIENTS:
-        case ExecutorValue::ValueType::SERVER: {
-          return absl::InvalidArgumentError("Cannot call a federated value.");
-        }
-        case ExecutorValue::ValueType::STRUCTURE: {
-          return absl::InvalidArgumentError("Cannot call a structure.");
-        }
-        case ExecutorValue::ValueType::UNPLACED: {
-          // We need to materialize functions into the server
-          // executor in order to execute them.
-          auto fn_id = TFF_TRY(fn.unplaced()->Embedded(*server_));
-          absl::optional<std::shared_ptr<OwnedValueId>> arg_owner;
-          absl::optional<ValueId> arg_id = absl::nullopt;
-          if (arg.has_value()) {
-            arg_owner = TFF_TRY(arg.value().Embed(*server_));
-            arg_id = arg_owner.value()->ref();
-          }
-          return ExecutorValue::CreateUnplaced(std::make_shared<UnplacedInner>(
-              TFF_TRY(server_->CreateCall(fn_id->ref(), arg_id))));
-        }
-        case ExecutorValue::ValueType::INTRINSIC: {
-          if (!arg.has_value()) {
-            return absl::InvalidArgumentError(
-                "no argument provided for federated intrinsic");
+    return MapCallAsync(
+        std::move(function), std::move(argument),
+        [this, this_keepalive = shared_from_this()](
+            ExecutorValue fn, absl::optional<ExecutorValue> arg)
+            -> absl::StatusOr<ExecutorValue> {
+          switch (fn.type()) {
+            case ExecutorValue::ValueType::CLIENTS:
+            case ExecutorValue::ValueType::SERVER: {
+              return absl::InvalidArgumentError(
+                  "Cannot call a federated value.");
+            }
+            case ExecutorValue::ValueType::STRUCTURE: {
+              return absl::InvalidArgumentError("Cannot call a structure.");
+            }
+            case ExecutorValue::ValueType::UNPLACED: {
+              // We need to materialize functions into the server
+              // executor in order to execute them.
+              auto fn_id = TFF_TRY(fn.unplaced()->Embedded(*server_));
+              absl::optional<std::shared_ptr<OwnedValueId>> arg_owner;
+              absl::optional<ValueId> arg_id = absl::nullopt;
+              if (arg.has_value()) {
+                arg_owner = TFF_TRY(arg.value().Embed(*server_));
+                arg_id = arg_owner.value()->ref();
+              }
+              return ExecutorValue::CreateUnplaced(
+                  std::make_shared<UnplacedInner>(
+                      TFF_TRY(server_->CreateCall(fn_id->ref(), arg_id))));
+            }
+            case ExecutorValue::ValueType::INTRINSIC: {
+              if (!arg.has_value()) {
+                return absl::InvalidArgumentError(
+                    "no argument provided for federated intrinsic");
+              }
+              return this->CallFederatedIntrinsic(fn.intrinsic(),
+                                                  std::move(arg.value()));
+            }
           }
-          return this->CallFederatedIntrinsic(fn.intrinsic(),
-                                              std::move(arg.value()));
-        }
-      }
-    });
+        });
   }
 
   absl::StatusOr<ValueFuture> CreateStruct(
@@ -473,9 +696,57 @@ class ComposingExecutor : public ExecutorBase<ValueFuture> {
   std::shared_ptr<Executor> server_;
   std::vector<ComposingChild> children_;
   uint32_t total_clients_;
+  const uint32_t merge_fan_in_;
+  const bool merge_is_commutative_;
+  const absl::Duration aggregation_deadline_;
+  const double aggregation_quorum_;
+  const std::function<void(const AggregationStats&)>
+      aggregation_stats_callback_;
+
+  // Runs `fn` with the index of each child concurrently, so that the blocking
+  // calls made on one child do not hold up those on the others. Returns the
+  // first failure, if any.
+  absl::Status ForEachChild(
+      const std::function<absl::Status(uint32_t)>& fn) const {
+    ParallelTasks tasks;
+    for (uint32_t i = 0; i < children_.size(); i++) {
+      tasks.add_task([&fn, i]() { return fn(i); });
+    }
+    return tasks.WaitAll();
+  }
 
-  Clients NewClients() const {
-    return ::tensorflow_federated::NewClients(children_.size());
+  // Merges `values` on the server as a balanced tree in which each subtree
+  // merges up to `merge_fan_in_` adjacent values, so that the depth of the
+  // chain of `merge` calls grows logarithmically in the number of values. The
+  // subtrees at each level of the tree are merged concurrently.
+  absl::StatusOr<OwnedValueId> MergeAsTree(
+      ValueId merge, std::vector<OwnedValueId> values) const {
+    if (values.empty()) {
+      return absl::InternalError("No partial aggregates to merge");
+    }
+    while (values.size() > 1) {
+      size_t num_subtrees = (values.size() + merge_fan_in_ - 1) / merge_fan_in_;
+      std::vector<absl::optional<OwnedValueId>> merged(num_subtrees);
+      ParallelTasks tasks;
+      for (size_t i = 0; i < num_subtrees; i++) {
+        tasks.add_task([&, i]() -> absl::Status {
+          auto begin = values.begin() + i * merge_fan_in_;
+          auto end = values.begin() +
+                     std::min<size_t>((i + 1) * merge_fan_in_, values.size());
+          merged[i] = TFF_TRY(MergeInOrder(
+              *server_, merge,
+              std::vector<OwnedValueId>(std::make_move_iterator(begin),
+                                        std::make_move_iterator(end))));
+          return absl::OkStatus();
+        });
+      }
+      TFF_TRY(tasks.WaitAll());
+      values.clear();
+      for (absl::optional<OwnedValueId>& value : merged) {
+        values.push_back(std::move(value.value()));
+      }
+    }
+    return std::move(values[0]);
   }
 
   absl::StatusOr<ExecutorValue> CreateFederatedValue(
@@ -487,21 +758,28 @@ class ComposingExecutor : public ExecutorBase<ValueFuture> {
             ShareValueId(std::move(value)));
       }
       case FederatedKind::CLIENTS: {
-        auto clients = NewClients();
+        std::vector<uint32_t> first_client_indices;
+        first_client_indices.reserve(children_.size());
         uint32_t next_client_index = 0;
-        for (uint32_t i = 0; i < children_.size(); i++) {
-          auto child = children_[i];
+        for (const auto& child : children_) {
+          first_client_indices.push_back(next_client_index);
+          next_client_index += child.num_clients();
+        }
+        std::vector<std::shared_ptr<OwnedValueId>> clients(children_.size());
+        TFF_TRY(ForEachChild([&](uint32_t i) -> absl::Status {
+          const auto& child = children_[i];
           v0::Value child_value;
           v0::Value_Federated* child_value_fed =
               child_value.mutable_federated();
           *child_value_fed->mutable_type() = federated.type();
-          uint32_t stop_index = next_client_index + child.num_clients();
-          for (; next_client_index < stop_index; next_client_index++) {
-            *child_value_fed->add_value() = federated.value(next_client_index);
+          uint32_t stop_index = first_client_indices[i] + child.num_clients();
+          for (uint32_t j = first_client_indices[i]; j < stop_index; j++) {
+            *child_value_fed->add_value() = federated.value(j);
           }
-          auto child_id = TFF_TRY(child.executor()->CreateValue(child_value));
-          clients->emplace_back(ShareValueId(std::move(child_id)));
-        }
+          clients[i] =
+              ShareValueId(TFF_TRY(child.executor()->CreateValue(child_value)));
+          return absl::OkStatus();
+        }));
         return ExecutorValue::CreateClientsPlaced(std::move(clients));
       }
       case FederatedKind::CLIENTS_ALL_EQUAL: {
@@ -526,11 +804,12 @@ class ComposingExecutor : public ExecutorBase<ValueFuture> {
 
   absl::StatusOr<ExecutorValue> AllEqualToAll(
       const v0::Value& all_equal_value) const {
-    auto clients = NewClients();
-    for (const auto& child : children_) {
-      auto child_id = TFF_TRY(child.executor()->CreateValue(all_equal_value));
-      clients->emplace_back(ShareValueId(std::move(child_id)));
-    }
+    std::vector<std::shared_ptr<OwnedValueId>> clients(children_.size());
+    TFF_TRY(ForEachChild([&](uint32_t i) -> absl::Status {
+      clients[i] = ShareValueId(
+          TFF_TRY(children_[i].executor()->CreateValue(all_equal_value)));
+      return absl::OkStatus();
+    }));
     return ExecutorValue::CreateClientsPlaced(std::move(clients));
   }
 
@@ -565,19 +844,21 @@ class ComposingExecutor : public ExecutorBase<ValueFuture> {
       ExecutorValue&& arg) const {
     auto fn_to_eval =
         TFF_TRY(arg.GetUnplacedFunctionProto("federated_eval_at_clients_fn"));
-    auto clients = NewClients();
-    for (const auto& child : children_) {
-      v0::Value eval_at_clients;
-      eval_at_clients.mutable_computation()
-          ->mutable_intrinsic()
-          ->mutable_uri()
-          ->assign(kFederatedEvalAtClientsUri.data(),
-                   kFederatedEvalAtClientsUri.size());
-      auto eval_id = TFF_TRY(child.executor()->CreateValue(eval_at_clients));
-      auto fn_id = TFF_TRY(child.executor()->CreateValue(*fn_to_eval));
-      auto res_id = TFF_TRY(child.executor()->CreateCall(eval_id, fn_id));
-      clients->emplace_back(ShareValueId(std::move(res_id)));
-    }
+    v0::Value eval_at_clients;
+    eval_at_clients.mutable_computation()
+        ->mutable_intrinsic()
+        ->mutable_uri()
+        ->assign(kFederatedEvalAtClientsUri.data(),
+                 kFederatedEvalAtClientsUri.size());
+    std::vector<std::shared_ptr<OwnedValueId>> clients(children_.size());
+    TFF_TRY(ForEachChild([&](uint32_t i) -> absl::Status {
+      const std::shared_ptr<Executor>& child = children_[i].executor();
+      std::vector<OwnedValueId> child_ids =
+          TFF_TRY(child->CreateValues({&eval_at_clients, fn_to_eval.get()}));
+      clients[i] =
+          ShareValueId(TFF_TRY(child->CreateCall(child_ids[0], child_ids[1])));
+      return absl::OkStatus();
+    }));
     return ExecutorValue::CreateClientsPlaced(std::move(clients));
   }
 
@@ -613,57 +894,128 @@ class ComposingExecutor : public ExecutorBase<ValueFuture> {
     aggregate.mutable_computation()->mutable_intrinsic()->mutable_uri()->assign(
         kFederatedAggregateUri.data(), kFederatedAggregateUri.size());
 
-    // Initiate the aggregation in each child.
-    std::vector<OwnedValueId> child_result_ids;
-    child_result_ids.reserve(children_.size());
-    for (uint32_t i = 0; i < children_.size(); i++) {
-      const auto& child = children_[i].executor();
-      ValueId child_val = value.clients()->at(i)->ref();
-      std::vector<OwnedValueId> arg_owners;
-      std::vector<ValueId> arg_ids;
-      arg_ids.emplace_back(child_val);
-      for (const v0::Value& arg_value :
-           {zero_val, *accumulate_val, *merge_val, null_report_val}) {
-        OwnedValueId child_id = TFF_TRY(child->CreateValue(arg_value));
-        arg_ids.emplace_back(child_id.ref());
-        arg_owners.emplace_back(std::move(child_id));
-      }
-      auto child_arg_id = TFF_TRY(child->CreateStruct(std::move(arg_ids)));
-      auto child_aggregate_id = TFF_TRY(child->CreateValue(aggregate));
-      auto child_result_id =
-          TFF_TRY(child->CreateCall(child_aggregate_id, child_arg_id));
-      child_result_ids.push_back(std::move(child_result_id));
-    }
-
-    // Materialize and merge the results from each child executor.
-    // TODO(b/192457028): parallelize this so that we're materializing more than
-    // one value at a time and so that we can begin merging as soon as any
-    // result is available.
-    absl::optional<OwnedValueId> current = absl::nullopt;
+    // Run the aggregation in each child concurrently, embedding each child's
+    // partial aggregate in the server as soon as it has been materialized.
+    // When `merge` is commutative, the partial aggregates are also merged as
+    // soon as `merge_fan_in_` of them are available, in the order in which
+    // they were produced.
+    auto intrinsic_and_args = std::make_shared<const std::vector<v0::Value>>(
+        std::vector<v0::Value>{aggregate, zero_val, *accumulate_val,
+                               *merge_val, null_report_val});
+    auto round = std::make_shared<AggregationRound>(
+        server_, merge_id, children_.size(), merge_fan_in_,
+        merge_is_commutative_);
+    std::vector<SharedFuture<absl::Status>> child_tasks;
+    child_tasks.reserve(children_.size());
     for (uint32_t i = 0; i < children_.size(); i++) {
-      const auto& child = children_[i].executor();
-      v0::Value child_result = TFF_TRY(child->Materialize(child_result_ids[i]));
-      if (!child_result.has_federated() ||
-          child_result.federated().type().placement().value().uri() !=
-              kServerUri) {
-        return absl::InternalError(
-            "Child executor returned non-server-placed value");
-      }
-      auto child_result_server_id =
-          TFF_TRY(server_->CreateValue(child_result.federated().value(0)));
-      if (current.has_value()) {
-        auto merge_arg = TFF_TRY(
-            server_->CreateStruct({current.value(), child_result_server_id}));
-        current = TFF_TRY(server_->CreateCall(merge_id->ref(), merge_arg));
-      } else {
-        current = std::move(child_result_server_id);
-      }
+      child_tasks.push_back(ThreadRun(
+          [round, intrinsic_and_args, i, child = children_[i].executor(),
+           num_clients = children_[i].num_clients(),
+           child_val = value.clients()->at(i)]() -> absl::Status {
+            round->Add(i, num_clients,
+                       ComputePartialAggregate(*child, child_val->ref(),
+                                               *intrinsic_and_args));
+            return absl::OkStatus();
+          }));
+    }
+    // Report over the partial aggregates which have arrived once all children
+    // have finished, the quorum has been met or the deadline has passed.
+    // Abandoning `child_tasks` on return cancels the stragglers.
+    uint32_t min_arrived_clients = std::numeric_limits<uint32_t>::max();
+    if (aggregation_quorum_ < 1.0) {
+      min_arrived_clients = static_cast<uint32_t>(
+          std::ceil(aggregation_quorum_ * total_clients_));
+    }
+    AggregationStats stats;
+    std::vector<OwnedValueId> partial_aggregates;
+    {
+      ScopedCancellationCallback cancel_round(
+          CancellationToken::Current(), [round]() { round->Cancel(); });
+      partial_aggregates = TFF_TRY(
+          round->Close(min_arrived_clients,
+                       absl::Now() + aggregation_deadline_, &stats));
+    }
+    stats.num_dropped_clients = total_clients_ - stats.num_clients;
+    if (aggregation_stats_callback_) {
+      aggregation_stats_callback_(stats);
     }
-    auto result =
-        TFF_TRY(server_->CreateCall(report_id->ref(), current.value()));
+    OwnedValueId merged = TFF_TRY(
+        MergeAsTree(merge_id->ref(), std::move(partial_aggregates)));
+    auto result = TFF_TRY(server_->CreateCall(report_id->ref(), merged));
     return ExecutorValue::CreateServerPlaced(ShareValueId(std::move(result)));
   }
 
+  // Computes `federated_sum`, `federated_mean` or `federated_weighted_mean`
+  // natively: each child reduces its own clients with the same intrinsic, and
+  // the partial results are combined in C++ on arrival, weighted by the number
+  // of clients (for `federated_mean`) or the total client weight (for
+  // `federated_weighted_mean`) of their child.
+  absl::StatusOr<ExecutorValue> CallIntrinsicNativeAggregate(
+      FederatedIntrinsic intrinsic, ExecutorValue&& arg) const {
+    const ExecutorValue* value = &arg;
+    const ExecutorValue* weight = nullptr;
+    if (intrinsic == FederatedIntrinsic::WEIGHTED_MEAN) {
+      TFF_TRY(arg.CheckLenForUseAsArgument("federated_weighted_mean", 2));
+      value = &arg.structure()->at(0);
+      weight = &arg.structure()->at(1);
+      if (weight->type() != ExecutorValue::ValueType::CLIENTS) {
+        return absl::InvalidArgumentError(
+            "Cannot average with weights not placed at clients");
+      }
+    }
+    if (value->type() != ExecutorValue::ValueType::CLIENTS) {
+      return absl::InvalidArgumentError(
+          "Cannot aggregate a value not placed at clients");
+    }
+    absl::Mutex mutex;
+    TensorAccumulator accumulator;
+    TFF_TRY(ForEachChild([&](uint32_t i) -> absl::Status {
+      const ComposingChild& child = children_[i];
+      if (child.num_clients() == 0) {
+        return absl::OkStatus();
+      }
+      Executor& executor = *child.executor();
+      ValueId child_value = value->clients()->at(i)->ref();
+      v0::Value partial;
+      double partial_weight = 1.0;
+      switch (intrinsic) {
+        case FederatedIntrinsic::SUM: {
+          partial = TFF_TRY(
+              CallChildIntrinsicAtServer(executor, kFederatedSumUri,
+                                         child_value));
+          break;
+        }
+        case FederatedIntrinsic::MEAN: {
+          partial = TFF_TRY(CallChildIntrinsicAtServer(
+              executor, kFederatedMeanUri, child_value));
+          partial_weight = child.num_clients();
+          break;
+        }
+        default: {
+          ValueId child_weight = weight->clients()->at(i)->ref();
+          partial_weight = TFF_TRY(DeserializeScalarWeight(TFF_TRY(
+              CallChildIntrinsicAtServer(executor, kFederatedSumUri,
+                                         child_weight))));
+          if (partial_weight == 0) {
+            return absl::OkStatus();
+          }
+          OwnedValueId child_arg =
+              TFF_TRY(executor.CreateStruct({child_value, child_weight}));
+          partial = TFF_TRY(CallChildIntrinsicAtServer(
+              executor, kFederatedWeightedMeanUri, child_arg));
+          break;
+        }
+      }
+      absl::MutexLock lock(&mutex);
+      return accumulator.Add(partial, partial_weight);
+    }));
+    v0::Value result = TFF_TRY(intrinsic == FederatedIntrinsic::SUM
+                                   ? accumulator.Sum()
+                                   : accumulator.Mean());
+    return ExecutorValue::CreateServerPlaced(
+        ShareValueId(TFF_TRY(server_->CreateValue(result))));
+  }
+
   absl::StatusOr<ExecutorValue> CallIntrinsicBroadcast(
       ExecutorValue&& arg) const {
     if (arg.type() != ExecutorValue::ValueType::SERVER) {
@@ -681,7 +1033,6 @@ class ComposingExecutor : public ExecutorBase<ValueFuture> {
     const auto& fn = arg.structure()->at(0);
     const auto& data = arg.structure()->at(1);
     if (data.type() == ExecutorValue::ValueType::CLIENTS) {
-      Clients results = NewClients();
       v0::Value fn_val;
       ParallelTasks tasks;
       TFF_TRY(MaterializeValue(fn, &fn_val, tasks));
@@ -689,15 +1040,18 @@ class ComposingExecutor : public ExecutorBase<ValueFuture> {
       v0::Value map_val;
       map_val.mutable_computation()->mutable_intrinsic()->mutable_uri()->assign(
           kFederatedMapAtClientsUri.data(), kFederatedMapAtClientsUri.size());
-      for (uint32_t i = 0; i < children_.size(); i++) {
+      std::vector<std::shared_ptr<OwnedValueId>> results(children_.size());
+      TFF_TRY(ForEachChild([&](uint32_t i) -> absl::Status {
         const auto& child = children_[i].executor();
-        auto child_map = TFF_TRY(child->CreateValue(map_val));
-        auto child_fn = TFF_TRY(child->CreateValue(fn_val));
+        std::vector<OwnedValueId> child_ids =
+            TFF_TRY(child->CreateValues({&map_val, &fn_val}));
         auto child_data = data.clients()->at(i)->ref();
-        auto map_args = TFF_TRY(child->CreateStruct({child_fn, child_data}));
-        auto result = TFF_TRY(child->CreateCall(child_map, map_args));
-        results->emplace_back(ShareValueId(std::move(result)));
-      }
+        auto map_args =
+            TFF_TRY(child->CreateStruct({child_ids[1], child_data}));
+        results[i] =
+            ShareValueId(TFF_TRY(child->CreateCall(child_ids[0], map_args)));
+        return absl::OkStatus();
+      }));
       return ExecutorValue::CreateClientsPlaced(std::move(results));
     } else if (data.type() == ExecutorValue::ValueType::SERVER) {
       auto embedded_fn = TFF_TRY(fn.Embed(*server_));
@@ -738,27 +1092,25 @@ class ComposingExecutor : public ExecutorBase<ValueFuture> {
     select.mutable_computation()->mutable_intrinsic()->mutable_uri()->assign(
         kFederatedSelectUri.data(), kFederatedSelectUri.size());
 
-    std::vector<std::shared_ptr<OwnedValueId>> child_result_ids;
-    child_result_ids.reserve(children_.size());
-    for (uint32_t i = 0; i < children_.size(); i++) {
+    std::vector<std::shared_ptr<OwnedValueId>> child_result_ids(
+        children_.size());
+    TFF_TRY(ForEachChild([&](uint32_t i) -> absl::Status {
       const std::shared_ptr<Executor>& child = children_[i].executor();
       ValueId child_keys = keys_child_ids->at(i)->ref();
-      std::vector<OwnedValueId> arg_owners;
+      // Creates the intrinsic followed by its (non-`keys`) arguments.
+      std::vector<OwnedValueId> child_ids = TFF_TRY(child->CreateValues(
+          {&select, &max_key_pb, &server_val_pb, select_fn_val.get()}));
       std::vector<ValueId> arg_ids;
       arg_ids.emplace_back(child_keys);
-      for (const v0::Value& arg_value :
-           {max_key_pb, server_val_pb, *select_fn_val}) {
-        OwnedValueId child_id = TFF_TRY(child->CreateValue(arg_value));
-        arg_ids.emplace_back(child_id.ref());
-        arg_owners.emplace_back(std::move(child_id));
+      for (size_t j = 1; j < child_ids.size(); j++) {
+        arg_ids.emplace_back(child_ids[j].ref());
       }
       OwnedValueId child_arg_id =
           TFF_TRY(child->CreateStruct(std::move(arg_ids)));
-      OwnedValueId child_select_id = TFF_TRY(child->CreateValue(select));
-      OwnedValueId child_result_id =
-          TFF_TRY(child->CreateCall(child_select_id, child_arg_id));
-      child_result_ids.push_back(ShareValueId(std::move(child_result_id)));
-    }
+      child_result_ids[i] =
+          ShareValueId(TFF_TRY(child->CreateCall(child_ids[0], child_arg_id)));
+      return absl::OkStatus();
+    }));
     return ExecutorValue::CreateClientsPlaced(std::move(child_result_ids));
   }
 
@@ -802,15 +1154,16 @@ class ComposingExecutor : public ExecutorBase<ValueFuture> {
         ->mutable_uri()
         ->assign(kFederatedZipAtClientsUri.data(),
                  kFederatedZipAtClientsUri.size());
-    Clients pairs = NewClients();
-    for (uint32_t i = 0; i < children_.size(); i++) {
+    std::vector<std::shared_ptr<OwnedValueId>> pairs(children_.size());
+    TFF_TRY(ForEachChild([&](uint32_t i) -> absl::Status {
       const std::shared_ptr<Executor>& child = children_[i].executor();
       OwnedValueId zip = TFF_TRY(child->CreateValue(zip_at_clients));
       std::shared_ptr<OwnedValueId> arg_struct_in_child =
           TFF_TRY(ZipStructIntoChild(arg, i));
-      pairs->push_back(ShareValueId(
-          TFF_TRY(child->CreateCall(zip, arg_struct_in_child->ref()))));
-    }
+      pairs[i] = ShareValueId(
+          TFF_TRY(child->CreateCall(zip, arg_struct_in_child->ref())));
+      return absl::OkStatus();
+    }));
     return ExecutorValue::CreateClientsPlaced(std::move(pairs));
   }
 
@@ -869,7 +1222,8 @@ class ComposingExecutor : public ExecutorBase<ValueFuture> {
       case FederatedIntrinsic::BROADCAST: {
         return CallIntrinsicBroadcast(std::move(arg));
       }
-      case FederatedIntrinsic::MAP: {
+      case FederatedIntrinsic::MAP:
+      case FederatedIntrinsic::MAP_ALL_EQUAL: {
         return CallIntrinsicMap(std::move(arg));
       }
       case FederatedIntrinsic::SELECT: {
@@ -881,6 +1235,11 @@ class ComposingExecutor : public ExecutorBase<ValueFuture> {
       case FederatedIntrinsic::ZIP_AT_SERVER: {
         return CallIntrinsicZipAtServer(std::move(arg));
       }
+      case FederatedIntrinsic::SUM:
+      case FederatedIntrinsic::MEAN:
+      case FederatedIntrinsic::WEIGHTED_MEAN: {
+        return CallIntrinsicNativeAggregate(function, std::move(arg));
+      }
     }
   }
 
@@ -1001,14 +1360,22 @@ class ComposingExecutor : public ExecutorBase<ValueFuture> {
 
 }  // namespace
 
-std::shared_ptr<Executor> CreateComposingExecutor(
-    std::shared_ptr<Executor> server, std::vector<ComposingChild> children) {
+absl::StatusOr<std::shared_ptr<Executor>> CreateComposingExecutor(
+    std::shared_ptr<Executor> server, std::vector<ComposingChild> children,
+    const ComposingExecutorOptions& options) {
+  // Written so that NaN is rejected too.
+  if (!(options.aggregation_quorum > 0.0 &&
+        options.aggregation_quorum <= 1.0)) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("aggregation_quorum must be in (0, 1], found ",
+                     options.aggregation_quorum, "."));
+  }
   uint32_t total_clients = 0;
   for (const auto& child : children) {
     total_clients += child.num_clients();
   }
   return std::make_shared<ComposingExecutor>(
-      std::move(server), std::move(children), total_clients);
+      std::move(server), std::move(children), total_clients, options);
 }
 
 }  // namespace tensorflow_federated
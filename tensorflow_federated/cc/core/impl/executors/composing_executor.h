@@ -17,11 +17,13 @@ limitations under the License
 #define THIRD_PARTY_TENSORFLOW_FEDERATED_CC_CORE_IMPL_EXECUTORS_COMPOSING_EXECUTOR_H_
 
 #include <cstdint>
+#include <functional>
 #include <memory>
 #include <utility>
 #include <vector>
 
 #include "absl/status/statusor.h"
+#include "absl/time/time.h"
 #include "tensorflow_federated/cc/core/impl/executors/cardinalities.h"
 #include "tensorflow_federated/cc/core/impl/executors/executor.h"
 #include "tensorflow_federated/cc/core/impl/executors/status_macros.h"
@@ -51,6 +53,39 @@ class ComposingChild {
       : executor_(std::move(executor)), num_clients_(num_clients) {}
 };
 
+// The default number of partial aggregates combined by each `merge` subtree
+// when reducing the results of the children in `federated_aggregate`.
+constexpr uint32_t kDefaultMergeFanIn = 2;
+
+// Statistics about a round of `federated_aggregate` on a `ComposingExecutor`.
+struct AggregationStats {
+  // The number of clients whose values were aggregated.
+  uint32_t num_clients = 0;
+  // The number of clients whose child did not produce its partial aggregate
+  // before the round was closed, and which were therefore left out of the
+  // result.
+  uint32_t num_dropped_clients = 0;
+  // The number of children which were left out of the result.
+  uint32_t num_dropped_children = 0;
+};
+
+struct ComposingExecutorOptions {
+  // The number of partial aggregates combined by each `merge` subtree.
+  uint32_t merge_fan_in = kDefaultMergeFanIn;
+  // Whether partial aggregates may be merged in the order in which the
+  // children produce them rather than in the order of the children.
+  bool merge_is_commutative = false;
+  // How long `federated_aggregate` waits for the partial aggregates of the
+  // children before reporting over those which have arrived.
+  absl::Duration aggregation_deadline = absl::InfiniteDuration();
+  // The fraction of clients whose partial aggregates, once arrived, allow
+  // `federated_aggregate` to report without waiting for the others. Must be in
+  // (0, 1]; a value of 1.0 waits for every child.
+  double aggregation_quorum = 1.0;
+  // Called with the statistics of every round of `federated_aggregate`.
+  std::function<void(const AggregationStats&)> aggregation_stats_callback;
+};
+
 // Returns an executor that splits handling of federated values and intrinsics
 // across multiple child executors.
 //
@@ -59,8 +94,25 @@ class ComposingChild {
 //
 // The `children` executors will be used for executing shards of federated
 // computations and must be able to resolve federated values and intrinsics.
-std::shared_ptr<Executor> CreateComposingExecutor(
-    std::shared_ptr<Executor> server, std::vector<ComposingChild> children);
+//
+// `federated_aggregate` merges the partial aggregates of the children on the
+// `server` as a balanced tree in which each subtree merges up to
+// `merge_fan_in` values, so that independent `merge` calls can run
+// concurrently. A `merge_fan_in` of at least the number of children yields a
+// single left fold. If `merge_is_commutative`, partial aggregates are merged in
+// the order in which the children produce them rather than in the order of the
+// children.
+//
+// If an `aggregation_deadline` passes or an `aggregation_quorum` of clients
+// has arrived, `federated_aggregate` reports over the partial aggregates which
+// have arrived so far and drops the children which are still computing
+// theirs. A round in which no partial aggregate arrives before the deadline
+// fails with `DeadlineExceededError`.
+//
+// Returns `InvalidArgumentError` if `aggregation_quorum` is not in (0, 1].
+absl::StatusOr<std::shared_ptr<Executor>> CreateComposingExecutor(
+    std::shared_ptr<Executor> server, std::vector<ComposingChild> children,
+    const ComposingExecutorOptions& options = {});
 
 }  // namespace tensorflow_federated
 
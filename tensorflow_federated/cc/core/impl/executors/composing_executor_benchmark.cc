@@ -0,0 +1,154 @@
+/* Copyright 2022, The TensorFlow Federated Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+// Measures a round of `federated_aggregate` on a `ComposingExecutor` whose
+// children take a different amount of time to produce their partial
+// aggregates, as remote workers would. The `i`th of the `N` children takes
+// `i + 1` milliseconds, so a round should take roughly `N` milliseconds (the
+// slowest child) rather than `N * (N + 1) / 2` milliseconds (all children one
+// after another).
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "tensorflow_federated/cc/core/impl/executors/cardinalities.h"
+#include "tensorflow_federated/cc/core/impl/executors/composing_executor.h"
+#include "tensorflow_federated/cc/core/impl/executors/executor.h"
+#include "tensorflow_federated/cc/core/impl/executors/federated_intrinsics.h"
+#include "tensorflow_federated/cc/core/impl/executors/thread_pool.h"
+#include "tensorflow_federated/proto/v0/executor.pb.h"
+
+namespace tensorflow_federated {
+
+namespace {
+
+// An executor which answers every call immediately except `Materialize`,
+// which blocks for `latency` before returning `result`.
+class DelayedExecutor : public Executor,
+                        public std::enable_shared_from_this<DelayedExecutor> {
+ public:
+  DelayedExecutor(absl::Duration latency, v0::Value result)
+      : latency_(latency), result_(std::move(result)) {}
+
+  absl::StatusOr<OwnedValueId> CreateValue(const v0::Value& value_pb) final {
+    return NewValue();
+  }
+
+  absl::StatusOr<OwnedValueId> CreateCall(
+      const ValueId function,
+      const absl::optional<const ValueId> argument) final {
+    return NewValue();
+  }
+
+  absl::StatusOr<OwnedValueId> CreateStruct(
+      const absl::Span<const ValueId> members) final {
+    return NewValue();
+  }
+
+  absl::StatusOr<OwnedValueId> CreateSelection(const ValueId source,
+                                               const uint32_t index) final {
+    return NewValue();
+  }
+
+  absl::Status Materialize(const ValueId value, v0::Value* value_pb) final {
+    ThreadPool::ScopedBlockingCall blocking_call;
+    absl::SleepFor(latency_);
+    *value_pb = result_;
+    return absl::OkStatus();
+  }
+
+  absl::Status Dispose(const ValueId value) final { return absl::OkStatus(); }
+
+ private:
+  OwnedValueId NewValue() { return OwnedValueId(weak_from_this(), next_id_++); }
+
+  const absl::Duration latency_;
+  const v0::Value result_;
+  std::atomic<ValueId> next_id_{0};
+};
+
+v0::Value ServerPlaced(v0::Value member) {
+  v0::Value value_pb;
+  v0::FederatedType* type_pb = value_pb.mutable_federated()->mutable_type();
+  type_pb->set_all_equal(true);
+  *type_pb->mutable_placement()->mutable_value()->mutable_uri() =
+      std::string(kServerUri);
+  *value_pb.mutable_federated()->add_value() = std::move(member);
+  return value_pb;
+}
+
+v0::Value AllEqualAtClients(v0::Value member) {
+  v0::Value value_pb = ServerPlaced(std::move(member));
+  *value_pb.mutable_federated()
+       ->mutable_type()
+       ->mutable_placement()
+       ->mutable_value()
+       ->mutable_uri() = std::string(kClientsUri);
+  return value_pb;
+}
+
+void BM_AggregateRound(benchmark::State& state) {
+  // The values are never inspected by the delayed executors, so an empty
+  // structure and an empty TensorFlow computation stand in for all of them.
+  v0::Value empty;
+  empty.mutable_struct_();
+  v0::Value function_pb;
+  function_pb.mutable_computation()->mutable_tensorflow();
+  std::vector<ComposingChild> children;
+  for (int64_t i = 0; i < state.range(0); i++) {
+    auto child = std::make_shared<DelayedExecutor>(absl::Milliseconds(i + 1),
+                                                   ServerPlaced(empty));
+    children.push_back(ComposingChild::Make(child, {{"clients", 1}}).value());
+  }
+  auto server = std::make_shared<DelayedExecutor>(absl::ZeroDuration(), empty);
+  std::shared_ptr<Executor> executor =
+      CreateComposingExecutor(server, std::move(children)).value();
+
+  v0::Value aggregate;
+  *aggregate.mutable_computation()->mutable_intrinsic()->mutable_uri() =
+      std::string(kFederatedAggregateUri);
+  OwnedValueId value = executor->CreateValue(AllEqualAtClients(empty)).value();
+  OwnedValueId zero = executor->CreateValue(empty).value();
+  OwnedValueId function = executor->CreateValue(function_pb).value();
+  OwnedValueId intrinsic = executor->CreateValue(aggregate).value();
+  OwnedValueId arg =
+      executor->CreateStruct({value, zero, function, function, function})
+          .value();
+  for (auto _ : state) {
+    OwnedValueId result = executor->CreateCall(intrinsic, arg).value();
+    benchmark::DoNotOptimize(executor->Materialize(result).value());
+  }
+}
+BENCHMARK(BM_AggregateRound)
+    ->Arg(1)
+    ->Arg(4)
+    ->Arg(16)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+}  // namespace
+
+}  // namespace tensorflow_federated
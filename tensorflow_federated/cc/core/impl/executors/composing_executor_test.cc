@@ -15,13 +15,19 @@ limitations under the License
 
 #include "tensorflow_federated/cc/core/impl/executors/composing_executor.h"
 
+#include <cmath>
 #include <cstddef>
+#include <functional>
+#include <memory>
 #include <utility>
 #include <vector>
 
 #include "googlemock/include/gmock/gmock.h"
 #include "googletest/include/gtest/gtest.h"
 #include "absl/status/status.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "absl/types/optional.h"
 #include "absl/types/span.h"
 #include "tensorflow_federated/cc/core/impl/executors/computations.h"
@@ -30,6 +36,7 @@ limitations under the License
 #include "tensorflow_federated/cc/core/impl/executors/federated_intrinsics.h"
 #include "tensorflow_federated/cc/core/impl/executors/mock_executor.h"
 #include "tensorflow_federated/cc/core/impl/executors/status_matchers.h"
+#include "tensorflow_federated/cc/core/impl/executors/thread_pool.h"
 #include "tensorflow_federated/cc/core/impl/executors/value_test_utils.h"
 #include "tensorflow_federated/proto/v0/computation.pb.h"
 #include "tensorflow_federated/proto/v0/executor.pb.h"
@@ -52,9 +59,12 @@ using testing::intrinsic::FederatedEvalAtClientsV;
 using testing::intrinsic::FederatedEvalAtServerV;
 using testing::intrinsic::FederatedMapAllEqualV;
 using testing::intrinsic::FederatedMapV;
+using testing::intrinsic::FederatedMeanV;
 using testing::intrinsic::FederatedSelectV;
+using testing::intrinsic::FederatedSumV;
 using testing::intrinsic::FederatedValueAtClientsV;
 using testing::intrinsic::FederatedValueAtServerV;
+using testing::intrinsic::FederatedWeightedMeanV;
 using testing::intrinsic::FederatedZipAtClientsV;
 using testing::intrinsic::FederatedZipAtServerV;
 
@@ -64,25 +74,98 @@ class ComposingExecutorTest : public ExecutorTestBase {
     // Extra method required in order to use `TFF_ASSERT_OK_AND_ASSIGN`.
     Initialize();
   }
-  ~ComposingExecutorTest() override {}
+  void TearDown() override {
+    // Values may be released asynchronously by a task of the pool after the
+    // test's last materialization. Let the mocks verify their disposals only
+    // once those tasks have finished.
+    test_executor_.reset();
+    composing_children_.clear();
+    ThreadPool::Global().WaitUntilIdle();
+    EXPECT_EQ(mock_server_.use_count(), 1)
+        << "The mock server is still referenced after the test.";
+    for (const auto& child : mock_children_) {
+      EXPECT_EQ(child.use_count(), 1)
+          << "A mock child is still referenced after the test.";
+    }
+  }
 
   void Initialize() {
     // Test with a few different sizes of client to ensure they're all handled
     // appropriately.
     clients_per_child_ = {0, 1, 2, 3};
     total_clients_ = 0;
-    std::vector<ComposingChild> composing_children;
     for (uint32_t num_clients : clients_per_child_) {
       total_clients_ += num_clients;
       auto exec = std::make_shared<::testing::StrictMock<MockExecutor>>();
       TFF_ASSERT_OK_AND_ASSIGN(
           auto child, ComposingChild::Make(exec, {{"clients", num_clients}}));
-      composing_children.push_back(child);
+      composing_children_.push_back(child);
       mock_children_.push_back(std::move(exec));
     }
     mock_server_ = std::make_shared<::testing::StrictMock<MockExecutor>>();
-    test_executor_ =
-        CreateComposingExecutor(mock_server_, std::move(composing_children));
+    TFF_ASSERT_OK_AND_ASSIGN(
+        test_executor_,
+        CreateComposingExecutor(mock_server_, composing_children_));
+  }
+
+  // Runs a `federated_aggregate` on `executor` in which every child produces
+  // the same partial aggregate. `expect_merges` is called with the ids of the
+  // `merge` function and of the partial aggregate on the server, and must set
+  // up the expected merges and return the id of the fully merged value.
+  void TestAggregate(
+      const std::shared_ptr<Executor>& executor,
+      const std::function<ValueId(ValueId, ValueId)>& expect_merges) {
+    v0::Value value = ClientsV({TensorV("value")}, true);
+    v0::Value zero = TensorV("zero");
+    v0::Value accumulate = TensorV("accumulate");
+    v0::Value merge = TensorV("merge");
+    v0::Value report = TensorV("report");
+    v0::Value result_from_child = ServerV(TensorV("result from child"));
+    v0::Value final_result_unfed = TensorV("final result");
+    for (const auto& child : mock_children_) {
+      auto child_value = child->ExpectCreateValue(value);
+      auto child_zero = child->ExpectCreateValue(zero);
+      auto child_accumulate = child->ExpectCreateValue(accumulate);
+      auto child_merge = child->ExpectCreateValue(merge);
+      v0::Value report_val;
+      *report_val.mutable_computation() = IdentityComp();
+      auto child_report = child->ExpectCreateValue(report_val);
+      auto child_agg = child->ExpectCreateValue(FederatedAggregateV());
+      auto arg = child->ExpectCreateStruct({child_value, child_zero,
+                                            child_accumulate, child_merge,
+                                            child_report});
+      auto res = child->ExpectCreateCall(child_agg, arg);
+      child->ExpectMaterialize(res, result_from_child);
+    }
+    // `merge` is used both on the server/controller and in the children.
+    auto server_merge = mock_server_->ExpectCreateValue(merge);
+    auto server_report = mock_server_->ExpectCreateValue(report);
+    auto result_from_child_on_server = mock_server_->ExpectCreateValue(
+        result_from_child.federated().value(0),
+        ::testing::Exactly(mock_children_.size()));
+    auto merged = expect_merges(server_merge, result_from_child_on_server);
+    auto post_report = mock_server_->ExpectCreateCall(server_report, merged);
+    mock_server_->ExpectMaterialize(post_report, final_result_unfed);
+    TFF_ASSERT_OK_AND_ASSIGN(auto controller_value,
+                             executor->CreateValue(value));
+    TFF_ASSERT_OK_AND_ASSIGN(auto controller_zero, executor->CreateValue(zero));
+    TFF_ASSERT_OK_AND_ASSIGN(auto controller_accumulate,
+                             executor->CreateValue(accumulate));
+    TFF_ASSERT_OK_AND_ASSIGN(auto controller_merge,
+                             executor->CreateValue(merge));
+    TFF_ASSERT_OK_AND_ASSIGN(auto controller_report,
+                             executor->CreateValue(report));
+    TFF_ASSERT_OK_AND_ASSIGN(auto controller_agg,
+                             executor->CreateValue(FederatedAggregateV()));
+    TFF_ASSERT_OK_AND_ASSIGN(
+        auto agg_arg,
+        executor->CreateStruct({controller_value, controller_zero,
+                                controller_accumulate, controller_merge,
+                                controller_report}));
+    TFF_ASSERT_OK_AND_ASSIGN(auto res,
+                             executor->CreateCall(controller_agg, agg_arg));
+    TFF_ASSERT_OK_AND_ASSIGN(auto result, executor->Materialize(res));
+    EXPECT_THAT(result, testing::EqualsProto(ServerV(final_result_unfed)));
   }
 
  protected:
@@ -91,6 +174,7 @@ class ComposingExecutorTest : public ExecutorTestBase {
   std::shared_ptr<::testing::StrictMock<MockExecutor>> mock_server_;
   std::vector<std::shared_ptr<::testing::StrictMock<MockExecutor>>>
       mock_children_;
+  std::vector<ComposingChild> composing_children_;
 };
 
 TEST_F(ComposingExecutorTest, ChildConstructionWithNoClientCardinalitiesFails) {
@@ -327,6 +411,94 @@ TEST_F(ComposingExecutorTest, CreateCallStructFails) {
 }
 
 TEST_F(ComposingExecutorTest, CreateCallFederatedAggregate) {
+  // The four partial aggregates are merged as a balanced binary tree.
+  TestAggregate(test_executor_, [this](ValueId merge, ValueId partial) {
+    auto pair_of_partials = mock_server_->ExpectCreateStruct(
+        {partial, partial}, ::testing::Exactly(2));
+    auto merged_pair = mock_server_->ExpectCreateCall(merge, pair_of_partials,
+                                                      ::testing::Exactly(2));
+    auto pair_of_merged =
+        mock_server_->ExpectCreateStruct({merged_pair, merged_pair});
+    return mock_server_->ExpectCreateCall(merge, pair_of_merged);
+  });
+}
+
+TEST_F(ComposingExecutorTest,
+       CreateCallFederatedAggregateWithLargeFanInMergesLeftToRight) {
+  ComposingExecutorOptions options;
+  options.merge_fan_in = mock_children_.size();
+  TFF_ASSERT_OK_AND_ASSIGN(
+      auto executor,
+      CreateComposingExecutor(mock_server_, composing_children_, options));
+  TestAggregate(executor, [this](ValueId merge, ValueId partial) {
+    auto merged = partial;
+    for (size_t i = 1; i < mock_children_.size(); i++) {
+      auto merge_arg = mock_server_->ExpectCreateStruct({merged, partial});
+      merged = mock_server_->ExpectCreateCall(merge, merge_arg);
+    }
+    return merged;
+  });
+}
+
+TEST_F(ComposingExecutorTest,
+       CreateCallFederatedAggregateWithCommutativeMergeMergesAsProduced) {
+  // The partial aggregates are merged by the child which produces the last of
+  // them, in the order in which they were produced.
+  ComposingExecutorOptions options;
+  options.merge_fan_in = mock_children_.size();
+  options.merge_is_commutative = true;
+  TFF_ASSERT_OK_AND_ASSIGN(
+      auto executor,
+      CreateComposingExecutor(mock_server_, composing_children_, options));
+  TestAggregate(executor, [this](ValueId merge, ValueId partial) {
+    auto merged = partial;
+    for (size_t i = 1; i < mock_children_.size(); i++) {
+      auto merge_arg = mock_server_->ExpectCreateStruct({merged, partial});
+      merged = mock_server_->ExpectCreateCall(merge, merge_arg);
+    }
+    return merged;
+  });
+}
+
+TEST_F(ComposingExecutorTest, CreateWithAggregationQuorumOutOfRangeFails) {
+  for (double quorum : {0.0, -0.5, 1.5, std::nan("")}) {
+    ComposingExecutorOptions options;
+    options.aggregation_quorum = quorum;
+    EXPECT_THAT(
+        CreateComposingExecutor(mock_server_, composing_children_, options),
+        StatusIs(StatusCode::kInvalidArgument))
+        << "aggregation_quorum = " << quorum;
+  }
+}
+
+TEST_F(ComposingExecutorTest,
+       CreateCallFederatedAggregateWithQuorumDropsStragglers) {
+  // The last child holds half of the clients and does not produce its partial
+  // aggregate until the round has been reported over the other two, which
+  // wait for it to have started.
+  std::vector<uint32_t> clients_per_child = {1, 1, 2};
+  std::vector<std::shared_ptr<::testing::StrictMock<MockExecutor>>> children;
+  std::vector<ComposingChild> composing_children;
+  for (uint32_t num_clients : clients_per_child) {
+    auto child = std::make_shared<::testing::StrictMock<MockExecutor>>();
+    TFF_ASSERT_OK_AND_ASSIGN(
+        auto composing_child,
+        ComposingChild::Make(child, {{"clients", num_clients}}));
+    composing_children.push_back(composing_child);
+    children.push_back(std::move(child));
+  }
+  AggregationStats stats;
+  absl::Notification straggler_started;
+  absl::Notification release_straggler;
+  ComposingExecutorOptions options;
+  options.aggregation_quorum = 0.5;
+  options.aggregation_stats_callback = [&stats](const AggregationStats& s) {
+    stats = s;
+  };
+  TFF_ASSERT_OK_AND_ASSIGN(
+      auto executor,
+      CreateComposingExecutor(mock_server_, composing_children, options));
+
   v0::Value value = ClientsV({TensorV("value")}, true);
   v0::Value zero = TensorV("zero");
   v0::Value accumulate = TensorV("accumulate");
@@ -334,7 +506,7 @@ TEST_F(ComposingExecutorTest, CreateCallFederatedAggregate) {
   v0::Value report = TensorV("report");
   v0::Value result_from_child = ServerV(TensorV("result from child"));
   v0::Value final_result_unfed = TensorV("final result");
-  for (const auto& child : mock_children_) {
+  for (const auto& child : children) {
     auto child_value = child->ExpectCreateValue(value);
     auto child_zero = child->ExpectCreateValue(zero);
     auto child_accumulate = child->ExpectCreateValue(accumulate);
@@ -346,44 +518,66 @@ TEST_F(ComposingExecutorTest, CreateCallFederatedAggregate) {
     auto arg = child->ExpectCreateStruct(
         {child_value, child_zero, child_accumulate, child_merge, child_report});
     auto res = child->ExpectCreateCall(child_agg, arg);
-    child->ExpectMaterialize(res, result_from_child);
+    if (child != children.back()) {
+      EXPECT_CALL(*child, Materialize(res, ::testing::_))
+          .WillOnce([&](ValueId, v0::Value* value_pb) {
+            ThreadPool::ScopedBlockingCall blocking_call;
+            straggler_started.WaitForNotification();
+            *value_pb = result_from_child;
+            return absl::OkStatus();
+          });
+    } else {
+      EXPECT_CALL(*child, Materialize(res, ::testing::_))
+          .WillOnce([&](ValueId, v0::Value* value_pb) {
+            ThreadPool::ScopedBlockingCall blocking_call;
+            straggler_started.Notify();
+            release_straggler.WaitForNotification();
+            *value_pb = result_from_child;
+            return absl::OkStatus();
+          });
+    }
   }
-  // `merge` is used both on the server/controller and in the children.
   auto server_merge = mock_server_->ExpectCreateValue(merge);
   auto server_report = mock_server_->ExpectCreateValue(report);
+  // Only the partial aggregates of the first two children reach the server.
   auto result_from_child_on_server = mock_server_->ExpectCreateValue(
-      result_from_child.federated().value(0),
-      ::testing::Exactly(mock_children_.size()));
-  size_t num_total_merges = mock_children_.size() - 1;
-  auto prev_merge_result = result_from_child_on_server;
-  for (uint32_t i = 0; i < num_total_merges; i++) {
-    auto merge_arg = mock_server_->ExpectCreateStruct(
-        {prev_merge_result, result_from_child_on_server});
-    prev_merge_result = mock_server_->ExpectCreateCall(server_merge, merge_arg);
-  }
-  auto post_report =
-      mock_server_->ExpectCreateCall(server_report, prev_merge_result);
+      result_from_child.federated().value(0), ::testing::Exactly(2));
+  auto merge_arg = mock_server_->ExpectCreateStruct(
+      {result_from_child_on_server, result_from_child_on_server});
+  auto merged = mock_server_->ExpectCreateCall(server_merge, merge_arg);
+  auto post_report = mock_server_->ExpectCreateCall(server_report, merged);
   mock_server_->ExpectMaterialize(post_report, final_result_unfed);
-  TFF_ASSERT_OK_AND_ASSIGN(auto controller_value,
-                           test_executor_->CreateValue(value));
-  TFF_ASSERT_OK_AND_ASSIGN(auto controller_zero,
-                           test_executor_->CreateValue(zero));
+
+  TFF_ASSERT_OK_AND_ASSIGN(auto controller_value, executor->CreateValue(value));
+  TFF_ASSERT_OK_AND_ASSIGN(auto controller_zero, executor->CreateValue(zero));
   TFF_ASSERT_OK_AND_ASSIGN(auto controller_accumulate,
-                           test_executor_->CreateValue(accumulate));
-  TFF_ASSERT_OK_AND_ASSIGN(auto controller_merge,
-                           test_executor_->CreateValue(merge));
+                           executor->CreateValue(accumulate));
+  TFF_ASSERT_OK_AND_ASSIGN(auto controller_merge, executor->CreateValue(merge));
   TFF_ASSERT_OK_AND_ASSIGN(auto controller_report,
-                           test_executor_->CreateValue(report));
+                           executor->CreateValue(report));
   TFF_ASSERT_OK_AND_ASSIGN(auto controller_agg,
-                           test_executor_->CreateValue(FederatedAggregateV()));
+                           executor->CreateValue(FederatedAggregateV()));
   TFF_ASSERT_OK_AND_ASSIGN(
       auto agg_arg,
-      test_executor_->CreateStruct({controller_value, controller_zero,
-                                    controller_accumulate, controller_merge,
-                                    controller_report}));
+      executor->CreateStruct({controller_value, controller_zero,
+                              controller_accumulate, controller_merge,
+                              controller_report}));
   TFF_ASSERT_OK_AND_ASSIGN(auto res,
-                           test_executor_->CreateCall(controller_agg, agg_arg));
-  ExpectMaterialize(res, ServerV(final_result_unfed));
+                           executor->CreateCall(controller_agg, agg_arg));
+  TFF_ASSERT_OK_AND_ASSIGN(auto result, executor->Materialize(res));
+  EXPECT_THAT(result, testing::EqualsProto(ServerV(final_result_unfed)));
+  EXPECT_EQ(stats.num_clients, 2);
+  EXPECT_EQ(stats.num_dropped_clients, 2);
+  EXPECT_EQ(stats.num_dropped_children, 1);
+
+  // Let the straggler finish, and wait for it to release its child, so that
+  // its late partial aggregate is seen to be dropped.
+  release_straggler.Notify();
+  executor = nullptr;
+  composing_children.clear();
+  while (children.back().use_count() > 1) {
+    absl::SleepFor(absl::Milliseconds(1));
+  }
 }
 
 TEST_F(ComposingExecutorTest,
@@ -405,6 +599,100 @@ TEST_F(ComposingExecutorTest,
               StatusIs(StatusCode::kInvalidArgument));
 }
 
+TEST_F(ComposingExecutorTest, CreateCallFederatedSum) {
+  v0::Value value = ClientsV({TensorV(1.0f)}, true);
+  for (uint32_t i = 0; i < mock_children_.size(); i++) {
+    const auto& child = mock_children_[i];
+    auto child_value = child->ExpectCreateValue(value);
+    // Children without clients are not asked for a partial sum.
+    if (clients_per_child_[i] == 0) {
+      continue;
+    }
+    auto child_sum = child->ExpectCreateValue(FederatedSumV());
+    auto child_result = child->ExpectCreateCall(child_sum, child_value);
+    child->ExpectMaterialize(
+        child_result,
+        ServerV(TensorV(static_cast<float>(clients_per_child_[i]))));
+  }
+  mock_server_->ExpectCreateMaterialize(
+      TensorV(static_cast<float>(total_clients_)));
+  TFF_ASSERT_OK_AND_ASSIGN(auto controller_value,
+                           test_executor_->CreateValue(value));
+  TFF_ASSERT_OK_AND_ASSIGN(auto controller_sum,
+                           test_executor_->CreateValue(FederatedSumV()));
+  TFF_ASSERT_OK_AND_ASSIGN(
+      auto res, test_executor_->CreateCall(controller_sum, controller_value));
+  ExpectMaterialize(res,
+                    ServerV(TensorV(static_cast<float>(total_clients_))));
+}
+
+TEST_F(ComposingExecutorTest, CreateCallFederatedMean) {
+  v0::Value value = ClientsV({TensorV(1.0f)}, true);
+  // The partial means of the children are weighted by their number of
+  // clients: (1 * 6 + 2 * 3 + 3 * 0) / 6 == 2.
+  std::vector<float> child_means = {0, 6, 3, 0};
+  for (uint32_t i = 0; i < mock_children_.size(); i++) {
+    const auto& child = mock_children_[i];
+    auto child_value = child->ExpectCreateValue(value);
+    if (clients_per_child_[i] == 0) {
+      continue;
+    }
+    auto child_mean = child->ExpectCreateValue(FederatedMeanV());
+    auto child_result = child->ExpectCreateCall(child_mean, child_value);
+    child->ExpectMaterialize(child_result, ServerV(TensorV(child_means[i])));
+  }
+  mock_server_->ExpectCreateMaterialize(TensorV(2.0f));
+  TFF_ASSERT_OK_AND_ASSIGN(auto controller_value,
+                           test_executor_->CreateValue(value));
+  TFF_ASSERT_OK_AND_ASSIGN(auto controller_mean,
+                           test_executor_->CreateValue(FederatedMeanV()));
+  TFF_ASSERT_OK_AND_ASSIGN(
+      auto res, test_executor_->CreateCall(controller_mean, controller_value));
+  ExpectMaterialize(res, ServerV(TensorV(2.0f)));
+}
+
+TEST_F(ComposingExecutorTest, CreateCallFederatedWeightedMean) {
+  v0::Value value = ClientsV({TensorV(1.0f)}, true);
+  v0::Value weight = ClientsV({TensorV(2.0f)}, true);
+  // Child 3's clients have a total weight of zero, so it is skipped.
+  std::vector<float> child_weights = {0, 1, 3, 0};
+  std::vector<float> child_means = {0, 5, 1, 0};
+  for (uint32_t i = 0; i < mock_children_.size(); i++) {
+    const auto& child = mock_children_[i];
+    auto child_value = child->ExpectCreateValue(value);
+    auto child_weight = child->ExpectCreateValue(weight);
+    if (clients_per_child_[i] == 0) {
+      continue;
+    }
+    auto child_sum = child->ExpectCreateValue(FederatedSumV());
+    auto child_weight_sum = child->ExpectCreateCall(child_sum, child_weight);
+    child->ExpectMaterialize(child_weight_sum,
+                             ServerV(TensorV(child_weights[i])));
+    if (child_weights[i] == 0) {
+      continue;
+    }
+    auto child_arg = child->ExpectCreateStruct({child_value, child_weight});
+    auto child_mean = child->ExpectCreateValue(FederatedWeightedMeanV());
+    auto child_result = child->ExpectCreateCall(child_mean, child_arg);
+    child->ExpectMaterialize(child_result, ServerV(TensorV(child_means[i])));
+  }
+  // (1 * 5 + 3 * 1) / 4 == 2.
+  mock_server_->ExpectCreateMaterialize(TensorV(2.0f));
+  TFF_ASSERT_OK_AND_ASSIGN(auto controller_value,
+                           test_executor_->CreateValue(value));
+  TFF_ASSERT_OK_AND_ASSIGN(auto controller_weight,
+                           test_executor_->CreateValue(weight));
+  TFF_ASSERT_OK_AND_ASSIGN(
+      auto controller_arg,
+      test_executor_->CreateStruct({controller_value, controller_weight}));
+  TFF_ASSERT_OK_AND_ASSIGN(
+      auto controller_mean,
+      test_executor_->CreateValue(FederatedWeightedMeanV()));
+  TFF_ASSERT_OK_AND_ASSIGN(
+      auto res, test_executor_->CreateCall(controller_mean, controller_arg));
+  ExpectMaterialize(res, ServerV(TensorV(2.0f)));
+}
+
 TEST_F(ComposingExecutorTest, CreateCallFederatedBroadcast) {
   v0::Value tensor = TensorV(1);
   mock_server_->ExpectCreateMaterialize(tensor);
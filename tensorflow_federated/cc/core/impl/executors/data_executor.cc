@@ -15,7 +15,6 @@ limitations under the License
 
 #include "tensorflow_federated/cc/core/impl/executors/data_executor.h"
 
-#include <future>  // NOLINT
 #include <memory>
 #include <utility>
 
@@ -29,7 +28,7 @@ namespace tensorflow_federated {
 namespace {
 
 using SharedId = std::shared_ptr<const OwnedValueId>;
-using ValueFuture = std::shared_future<absl::StatusOr<SharedId>>;
+using ValueFuture = SharedFuture<absl::StatusOr<SharedId>>;
 
 class DataExecutor : public ExecutorBase<ValueFuture> {
  public:
@@ -70,23 +69,17 @@ class DataExecutor : public ExecutorBase<ValueFuture> {
   absl::StatusOr<ValueFuture> CreateCall(
       ValueFuture function_future,
       absl::optional<ValueFuture> argument_future) final {
-    std::vector<ValueFuture> futures = {function_future};
-    if (argument_future.has_value()) {
-      futures.push_back(std::move(*argument_future));
-    }
-    return Map(
-        std::move(futures),
+    return MapCall(
+        std::move(function_future), std::move(argument_future),
         [this, this_keepalive = shared_from_this()](
-            std::vector<SharedId> values) -> absl::StatusOr<SharedId> {
-          // `values` holds the resolved `futures`, either
-          // `{function}` or `{function, argument}`.
-          ValueId function_id = values[0]->ref();
+            SharedId function, absl::optional<SharedId> argument)
+            -> absl::StatusOr<SharedId> {
           absl::optional<ValueId> argument_id = absl::nullopt;
-          if (values.size() == 2) {
-            argument_id = values[1]->ref();
+          if (argument.has_value()) {
+            argument_id = (*argument)->ref();
           }
           OwnedValueId child_value =
-              TFF_TRY(child_->CreateCall(function_id, argument_id));
+              TFF_TRY(child_->CreateCall(function->ref(), argument_id));
           return std::make_shared<const OwnedValueId>(std::move(child_value));
         });
   }
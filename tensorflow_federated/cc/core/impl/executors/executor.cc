@@ -15,4 +15,52 @@ limitations under the License
 
 #include "tensorflow_federated/cc/core/impl/executors/executor.h"
 
-namespace tensorflow_federated {}  // namespace tensorflow_federated
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "tensorflow_federated/cc/core/impl/executors/status_macros.h"
+#include "tensorflow_federated/proto/v0/executor.pb.h"
+
+namespace tensorflow_federated {
+
+absl::StatusOr<std::vector<OwnedValueId>> Executor::CreateValues(
+    absl::Span<const v0::Value* const> values_pb) {
+  std::vector<OwnedValueId> ids;
+  ids.reserve(values_pb.size());
+  for (const v0::Value* value_pb : values_pb) {
+    ids.push_back(TFF_TRY(CreateValue(*value_pb)));
+  }
+  return ids;
+}
+
+absl::StatusOr<std::vector<OwnedValueId>> Executor::CreateCalls(
+    const ValueId function, absl::Span<const ValueId> arguments) {
+  std::vector<OwnedValueId> ids;
+  ids.reserve(arguments.size());
+  for (ValueId argument : arguments) {
+    ids.push_back(TFF_TRY(CreateCall(function, argument)));
+  }
+  return ids;
+}
+
+absl::StatusOr<std::vector<OwnedValueId>> Executor::CreateSelections(
+    const ValueId source, absl::Span<const uint32_t> indices) {
+  std::vector<OwnedValueId> ids;
+  ids.reserve(indices.size());
+  for (uint32_t index : indices) {
+    ids.push_back(TFF_TRY(CreateSelection(source, index)));
+  }
+  return ids;
+}
+
+absl::Status Executor::DisposeMany(absl::Span<const ValueId> values) {
+  absl::Status status;
+  for (ValueId value : values) {
+    status.Update(Dispose(value));
+  }
+  return status;
+}
+
+}  // namespace tensorflow_federated
@@ -24,17 +24,15 @@ limitations under the License
 #include <utility>
 #include <vector>
 
-#include "absl/base/thread_annotations.h"
-#include "absl/container/flat_hash_map.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
-#include "absl/synchronization/mutex.h"
 #include "absl/types/optional.h"
 #include "absl/types/span.h"
 #include "tensorflow/core/profiler/lib/traceme.h"
 #include "tensorflow_federated/cc/core/impl/executors/status_macros.h"
+#include "tensorflow_federated/cc/core/impl/executors/value_table.h"
 #include "tensorflow_federated/proto/v0/computation.pb.h"
 #include "tensorflow_federated/proto/v0/executor.pb.h"
 
@@ -142,6 +140,22 @@ class Executor {
   virtual absl::StatusOr<OwnedValueId> CreateSelection(
       const ValueId source, const uint32_t index) = 0;
 
+  // Batched versions of `CreateValue`, `CreateCall` and `CreateSelection`.
+  //
+  // Each is equivalent to calling the scalar method once per element of the
+  // batch and returns the results in the same order, but allows
+  // implementations to amortize per-call costs (locking, dispatch, RPCs)
+  // across the batch. If any element fails, an error is returned and any
+  // values already created for the batch are disposed.
+  //
+  // The default implementations simply call the scalar methods in a loop.
+  virtual absl::StatusOr<std::vector<OwnedValueId>> CreateValues(
+      absl::Span<const v0::Value* const> values_pb);
+  virtual absl::StatusOr<std::vector<OwnedValueId>> CreateCalls(
+      const ValueId function, absl::Span<const ValueId> arguments);
+  virtual absl::StatusOr<std::vector<OwnedValueId>> CreateSelections(
+      const ValueId source, absl::Span<const uint32_t> indices);
+
   // Materialize the value as a concrete structure.
   //
   // This method is blocking: it may synchronously wait for the result of
@@ -162,6 +176,10 @@ class Executor {
   // The `OwnedValueId`s returned will `Dispose` of themselves on destruction.
   virtual absl::Status Dispose(const ValueId value) = 0;
 
+  // Batched version of `Dispose`. Attempts to dispose of every value, even if
+  // some of them fail, and returns the first error encountered.
+  virtual absl::Status DisposeMany(absl::Span<const ValueId> values);
+
   virtual ~Executor() {}
 };
 
@@ -230,34 +248,57 @@ class ExecutorBase : public Executor,
   static_assert(std::is_copy_constructible<ExecutorValue>::value,
                 "`ExecutorValue`s (the type parameter passed to `ExecutorBase`)"
                 " must be copy-constructible. Consider wrapping with "
-                "`std::shared_ptr`, `std::shared_future`, or other similar "
+                "`std::shared_ptr`, `SharedFuture`, or other similar "
                 "container like: `class MyExecutor: public "
                 "ExecutorBase<std::shared_ptr<MyExecutorValue>>`");
 
  private:
-  absl::Mutex mutex_;
-  ValueId next_value_id_ ABSL_GUARDED_BY(mutex_) = 0;
-  absl::flat_hash_map<ValueId, ExecutorValue> tracked_values_
-      ABSL_GUARDED_BY(mutex_);
+  ValueTable<ExecutorValue> tracked_values_;
 
   // Tracks the provided value and returns the ID which refers to it.
   absl::StatusOr<OwnedValueId> TrackValue(ExecutorValue value) {
-    absl::WriterMutexLock lock(&mutex_);
-    ValueId id = next_value_id_++;
-    tracked_values_.emplace(id, std::move(value));
+    ValueId id = tracked_values_.Insert(std::move(value));
     return absl::StatusOr<OwnedValueId>(absl::in_place_t(), shared_from_this(),
                                         id);
   }
 
   // Returns a copy of the value previously stored with `TrackValue`.
   absl::StatusOr<ExecutorValue> GetTracked(ValueId value_id) {
-    absl::ReaderMutexLock lock(&mutex_);
-    auto value_iter = tracked_values_.find(value_id);
-    if (value_iter == tracked_values_.end()) {
+    absl::optional<ExecutorValue> value = tracked_values_.Get(value_id);
+    if (!value.has_value()) {
       return absl::NotFoundError(
           absl::StrCat(ExecutorName(), " value not found: ", value_id));
     }
-    return value_iter->second;
+    return std::move(value).value();
+  }
+
+  // Batched version of `TrackValue`.
+  std::vector<OwnedValueId> TrackValues(std::vector<ExecutorValue> values) {
+    std::vector<ValueId> ids = tracked_values_.InsertMany(std::move(values));
+    std::weak_ptr<Executor> self = shared_from_this();
+    std::vector<OwnedValueId> owned_ids;
+    owned_ids.reserve(ids.size());
+    for (ValueId id : ids) {
+      owned_ids.emplace_back(self, id);
+    }
+    return owned_ids;
+  }
+
+  // Batched version of `GetTracked`.
+  absl::StatusOr<std::vector<ExecutorValue>> GetTrackedMany(
+      absl::Span<const ValueId> value_ids) {
+    std::vector<absl::optional<ExecutorValue>> found =
+        tracked_values_.GetMany(value_ids);
+    std::vector<ExecutorValue> values;
+    values.reserve(found.size());
+    for (size_t i = 0; i < found.size(); i++) {
+      if (!found[i].has_value()) {
+        return absl::NotFoundError(
+            absl::StrCat(ExecutorName(), " value not found: ", value_ids[i]));
+      }
+      values.push_back(std::move(found[i]).value());
+    }
+    return values;
   }
 
  protected:
@@ -279,10 +320,7 @@ class ExecutorBase : public Executor,
   // This method is intended to be used by child class destructors to ensure
   // that the `ExecutorValue` references held by `tracked_values_` have been
   // destroyed.
-  void ClearTracked() {
-    absl::WriterMutexLock lock(&mutex_);
-    tracked_values_.clear();
-  }
+  void ClearTracked() { tracked_values_.Clear(); }
 
   // Returns the string name of the current executor.
   virtual absl::string_view ExecutorName() = 0;
@@ -296,6 +334,39 @@ class ExecutorBase : public Executor,
       ExecutorValue value, const uint32_t index) = 0;
   virtual absl::Status Materialize(ExecutorValue value,
                                    v0::Value* value_pb) = 0;
+
+  // Batched versions of the methods above, backing the batched methods of
+  // `Executor`. The default implementations call the scalar methods in a loop;
+  // executors which can do better (e.g. by making a single call to a child
+  // executor) should override them.
+  virtual absl::StatusOr<std::vector<ExecutorValue>> CreateExecutorValues(
+      absl::Span<const v0::Value* const> values_pb) {
+    std::vector<ExecutorValue> values;
+    values.reserve(values_pb.size());
+    for (const v0::Value* value_pb : values_pb) {
+      values.push_back(TFF_TRY(CreateExecutorValue(*value_pb)));
+    }
+    return values;
+  }
+  virtual absl::StatusOr<std::vector<ExecutorValue>> CreateCalls(
+      ExecutorValue function, std::vector<ExecutorValue> arguments) {
+    std::vector<ExecutorValue> results;
+    results.reserve(arguments.size());
+    for (ExecutorValue& argument : arguments) {
+      results.push_back(TFF_TRY(CreateCall(function, std::move(argument))));
+    }
+    return results;
+  }
+  virtual absl::StatusOr<std::vector<ExecutorValue>> CreateSelections(
+      ExecutorValue source, absl::Span<const uint32_t> indices) {
+    std::vector<ExecutorValue> results;
+    results.reserve(indices.size());
+    for (uint32_t index : indices) {
+      results.push_back(TFF_TRY(CreateSelection(source, index)));
+    }
+    return results;
+  }
+
   ~ExecutorBase() override {}
 
  public:
@@ -334,6 +405,29 @@ class ExecutorBase : public Executor,
         TFF_TRY(CreateSelection(TFF_TRY(GetTracked(source)), index)));
   }
 
+  absl::StatusOr<std::vector<OwnedValueId>> CreateValues(
+      absl::Span<const v0::Value* const> values_pb) final {
+    auto trace = Trace("CreateValues");
+    return TrackValues(TFF_TRY(CreateExecutorValues(values_pb)));
+  }
+
+  absl::StatusOr<std::vector<OwnedValueId>> CreateCalls(
+      const ValueId function, absl::Span<const ValueId> arguments) final {
+    auto trace = Trace("CreateCalls");
+    ExecutorValue function_val = TFF_TRY(GetTracked(function));
+    std::vector<ExecutorValue> argument_vals =
+        TFF_TRY(GetTrackedMany(arguments));
+    return TrackValues(TFF_TRY(
+        CreateCalls(std::move(function_val), std::move(argument_vals))));
+  }
+
+  absl::StatusOr<std::vector<OwnedValueId>> CreateSelections(
+      const ValueId source, absl::Span<const uint32_t> indices) final {
+    auto trace = Trace("CreateSelections");
+    return TrackValues(
+        TFF_TRY(CreateSelections(TFF_TRY(GetTracked(source)), indices)));
+  }
+
   absl::Status Materialize(const ValueId value_id, v0::Value* value_pb) final {
     auto trace = Trace("Materialize");
     return Materialize(TFF_TRY(GetTracked(value_id)), value_pb);
@@ -341,13 +435,30 @@ class ExecutorBase : public Executor,
 
   absl::Status Dispose(const ValueId value) final {
     auto trace = Trace("Dispose");
-    absl::WriterMutexLock lock(&mutex_);
-    auto value_iter = tracked_values_.find(value);
-    if (value_iter == tracked_values_.end()) {
+    // Destroyed only after the table's lock is released: dropping the last
+    // reference to a value that is still being computed cancels the
+    // outstanding work, which may run arbitrary cancellation callbacks.
+    absl::optional<ExecutorValue> disposed = tracked_values_.Remove(value);
+    if (!disposed.has_value()) {
       return absl::NotFoundError(absl::StrCat(
           ExecutorName(), " value not found: ", value, ", cannot dispose."));
     }
-    tracked_values_.erase(value_iter);
+    return absl::OkStatus();
+  }
+
+  absl::Status DisposeMany(absl::Span<const ValueId> values) final {
+    auto trace = Trace("DisposeMany");
+    // As in `Dispose`, the removed values are destroyed after the table's locks
+    // are released.
+    std::vector<absl::optional<ExecutorValue>> disposed =
+        tracked_values_.RemoveMany(values);
+    for (size_t i = 0; i < disposed.size(); i++) {
+      if (!disposed[i].has_value()) {
+        return absl::NotFoundError(absl::StrCat(ExecutorName(),
+                                                " value not found: ", values[i],
+                                                ", cannot dispose."));
+      }
+    }
     return absl::OkStatus();
   }
 };
@@ -23,15 +23,19 @@ limitations under the License
 //     `OwnedValueId` -> `ValueId`, etc).
 
 #include <cstdint>
+#include <functional>
 #include <limits>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
+#include "absl/time/time.h"
 #include "grpcpp/grpcpp.h"
 #include "include/pybind11/detail/common.h"
+#include "include/pybind11/functional.h"
 #include "include/pybind11/pybind11.h"
 #include "include/pybind11/pytypes.h"
 #include "include/pybind11/stl.h"
@@ -50,6 +54,7 @@ limitations under the License
 #include "tensorflow_federated/cc/core/impl/executors/federating_executor.h"
 #include "tensorflow_federated/cc/core/impl/executors/reference_resolving_executor.h"
 #include "tensorflow_federated/cc/core/impl/executors/remote_executor.h"
+#include "tensorflow_federated/cc/core/impl/executors/session_provider.h"
 #include "tensorflow_federated/cc/core/impl/executors/status_macros.h"
 #include "tensorflow_federated/cc/core/impl/executors/tensor_serialization.h"
 #include "tensorflow_federated/cc/core/impl/executors/tensorflow_executor.h"
@@ -112,6 +117,20 @@ PYBIND11_MODULE(executor_bindings, m) {
             "<ComposingChild with num clients: ", self.num_clients(), ">");
       });
 
+  // The statistics reported by a `ComposingExecutor` for each aggregation.
+  py::class_<AggregationStats>(m, "AggregationStats")
+      .def_readonly("num_clients", &AggregationStats::num_clients)
+      .def_readonly("num_dropped_clients",
+                    &AggregationStats::num_dropped_clients)
+      .def_readonly("num_dropped_children",
+                    &AggregationStats::num_dropped_children)
+      .def("__repr__", [](const AggregationStats& self) {
+        return absl::StrCat("<AggregationStats num_clients: ", self.num_clients,
+                            ", num_dropped_clients: ", self.num_dropped_clients,
+                            ", num_dropped_children: ",
+                            self.num_dropped_children, ">");
+      });
+
   // Provide the `Executor` interface.
   //
   // A `dispose` method is purposely not exposed. Though `Executor::Dispose`
@@ -150,19 +169,97 @@ PYBIND11_MODULE(executor_bindings, m) {
            py::call_guard<py::gil_scoped_release>());
 
   // Executor construction methods.
-  m.def("create_tensorflow_executor", &CreateTensorFlowExecutor,
-        py::arg("max_concurrent_computation_calls") = -1,
-        "Creates a TensorFlowExecutor.");
+  m.def(
+      "create_tensorflow_executor",
+      [](int32_t max_concurrent_computation_calls, int32_t max_call_batch_size,
+         double call_batch_window_seconds, int32_t function_cache_max_functions,
+         int64_t function_cache_max_bytes,
+         int32_t min_warm_sessions_per_function) {
+        TensorFlowExecutorOptions options;
+        options.max_concurrent_computation_calls =
+            max_concurrent_computation_calls;
+        options.max_call_batch_size = max_call_batch_size;
+        options.call_batch_window = absl::Seconds(call_batch_window_seconds);
+        options.function_cache_max_functions = function_cache_max_functions;
+        options.function_cache_max_bytes = function_cache_max_bytes;
+        options.min_warm_sessions_per_function =
+            min_warm_sessions_per_function;
+        return CreateTensorFlowExecutor(options);
+      },
+      py::arg("max_concurrent_computation_calls") = -1,
+      py::arg("max_call_batch_size") = 1,
+      py::arg("call_batch_window_seconds") = 0.001,
+      py::arg("function_cache_max_functions") = -1,
+      py::arg("function_cache_max_bytes") = -1,
+      py::arg("min_warm_sessions_per_function") = 0,
+      "Creates a TensorFlowExecutor.");
+  m.def(
+      "set_session_budget",
+      [](int32_t max_sessions, double idle_session_ttl_seconds) {
+        SessionBudgetOptions options;
+        options.max_sessions = max_sessions;
+        if (idle_session_ttl_seconds > 0) {
+          options.idle_session_ttl = absl::Seconds(idle_session_ttl_seconds);
+        }
+        SetSessionBudget(options);
+      },
+      py::arg("max_sessions") = -1, py::arg("idle_session_ttl_seconds") = -1,
+      "Limits the TensorFlow sessions kept open by all TensorFlowExecutors in "
+      "the process; non-positive values indicate no limit.");
   m.def("create_reference_resolving_executor",
         &CreateReferenceResolvingExecutor,
         "Creates a ReferenceResolvingExecutor", py::arg("inner_executor"));
   m.def("create_federating_executor", &CreateFederatingExecutor,
         py::arg("inner_executor"), py::arg("cardinalities"),
+        py::arg("num_aggregation_groups") = 1,
+        py::arg("select_slice_cache_size") = 0,
         "Creates a FederatingExecutor.");
   m.def("create_composing_child", &ComposingChild::Make, py::arg("executor"),
         py::arg("cardinalities"), "Creates a ComposingExecutor.");
-  m.def("create_composing_executor", &CreateComposingExecutor,
-        py::arg("server"), py::arg("children"), "Creates a ComposingExecutor.");
+  m.def(
+      "create_composing_executor",
+      [](std::shared_ptr<Executor> server, std::vector<ComposingChild> children,
+         uint32_t merge_fan_in, bool merge_is_commutative,
+         double aggregation_deadline_seconds, double aggregation_quorum,
+         std::function<void(const AggregationStats&)>
+             aggregation_stats_callback) {
+        // Written so that NaN is rejected too.
+        if (!(aggregation_quorum > 0.0 && aggregation_quorum <= 1.0)) {
+          throw py::value_error(
+              absl::StrCat("aggregation_quorum must be in (0, 1], found ",
+                           aggregation_quorum, "."));
+        }
+        ComposingExecutorOptions options;
+        options.merge_fan_in = merge_fan_in;
+        options.merge_is_commutative = merge_is_commutative;
+        options.aggregation_deadline =
+            absl::Seconds(aggregation_deadline_seconds);
+        options.aggregation_quorum = aggregation_quorum;
+        if (aggregation_stats_callback) {
+          // The callback runs on an executor thread, where an exception raised
+          // by the Python function cannot propagate.
+          options.aggregation_stats_callback =
+              [callback = std::move(aggregation_stats_callback)](
+                  const AggregationStats& stats) {
+                try {
+                  callback(stats);
+                } catch (py::error_already_set& e) {
+                  py::gil_scoped_acquire gil;
+                  e.discard_as_unraisable("aggregation_stats_callback");
+                }
+              };
+        }
+        return CreateComposingExecutor(std::move(server), std::move(children),
+                                       options);
+      },
+      py::arg("server"), py::arg("children"),
+      py::arg("merge_fan_in") = kDefaultMergeFanIn,
+      py::arg("merge_is_commutative") = false,
+      py::arg("aggregation_deadline_seconds") =
+          std::numeric_limits<double>::infinity(),
+      py::arg("aggregation_quorum") = 1.0,
+      py::arg("aggregation_stats_callback") = py::none(),
+      "Creates a ComposingExecutor.");
   m.def("create_remote_executor",
         py::overload_cast<std::shared_ptr<grpc::ChannelInterface>,
                           const CardinalityMap&>(&CreateRemoteExecutor),
@@ -18,12 +18,15 @@ limitations under the License
 #include <grpcpp/support/status.h>
 
 #include <algorithm>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
 #include "absl/strings/numbers.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_join.h"
@@ -35,6 +38,8 @@ limitations under the License
 #include "tensorflow_federated/cc/core/impl/executors/executor.h"
 #include "tensorflow_federated/cc/core/impl/executors/status_conversion.h"
 #include "tensorflow_federated/cc/core/impl/executors/status_macros.h"
+#include "tensorflow_federated/cc/core/impl/executors/value_cache.h"
+#include "tensorflow_federated/cc/core/impl/executors/value_streaming.h"
 #include "tensorflow_federated/proto/v0/computation.pb.h"
 #include "tensorflow_federated/proto/v0/executor.pb.h"
 
@@ -74,6 +79,113 @@ grpc::Status RemoteValueToId(const v0::ValueRef& remote_value_ref,
                    remote_value_ref.id()));
 }
 
+// Returns an error unless `fingerprint` is the `ValueFingerprint` of `value`,
+// so that no client can cache a value under the fingerprint of another.
+absl::Status VerifyValueFingerprint(const v0::Value& value,
+                                    absl::string_view fingerprint) {
+  std::string value_fingerprint = ValueFingerprint(value);
+  if (value_fingerprint != fingerprint) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Value fingerprint ", fingerprint,
+                     " does not match the fingerprint of the value sent, ",
+                     value_fingerprint, "."));
+  }
+  return absl::OkStatus();
+}
+
+// Creates the value of `request`, either from its `value` (caching it under
+// its `value_fingerprint`, if set) or, if it has none, from the value cached
+// under its `value_fingerprint`.
+absl::StatusOr<OwnedValueId> CreateValueForRequest(
+    Executor& executor, const v0::CreateValueRequest& request,
+    ValueCache& value_cache) {
+  if (request.value_fingerprint().empty()) {
+    return executor.CreateValue(request.value());
+  }
+  if (!request.has_value()) {
+    std::shared_ptr<const v0::Value> cached_value =
+        value_cache.Lookup(request.value_fingerprint());
+    if (cached_value == nullptr) {
+      return absl::NotFoundError(
+          absl::StrCat("No value is cached with fingerprint ",
+                       request.value_fingerprint(), "."));
+    }
+    return executor.CreateValue(*cached_value);
+  }
+  TFF_TRY(VerifyValueFingerprint(request.value(), request.value_fingerprint()));
+  // The value is copied into the cache only if it is not cached already, as
+  // when another client has sent it too.
+  if (value_cache.Lookup(request.value_fingerprint()) == nullptr) {
+    value_cache.Insert(request.value_fingerprint(),
+                       std::make_shared<const v0::Value>(request.value()));
+  }
+  return executor.CreateValue(request.value());
+}
+
+// The values created by the operations of an `ExecuteBatch` request, keyed by
+// their client-assigned IDs. Failed operations map to their error.
+using BatchValues = absl::flat_hash_map<std::string, absl::StatusOr<ValueId>>;
+
+absl::StatusOr<ValueId> ResolveBatchRef(const v0::ValueRef& value_ref,
+                                        const BatchValues& batch_values) {
+  auto it = batch_values.find(value_ref.id());
+  if (it != batch_values.end()) {
+    return it->second;
+  }
+  ValueId value_id;
+  if (absl::SimpleAtoi(value_ref.id(), &value_id)) {
+    return value_id;
+  }
+  return absl::InvalidArgumentError(
+      absl::StrCat("Expected value ref to be an integer id or the id of an "
+                   "earlier operation in the batch, found ",
+                   value_ref.id()));
+}
+
+absl::StatusOr<OwnedValueId> ExecuteOperation(
+    Executor& executor, const v0::ExecuteBatchRequest::Operation& operation,
+    const BatchValues& batch_values, ValueCache& value_cache) {
+  switch (operation.operation_case()) {
+    case v0::ExecuteBatchRequest::Operation::kCreateValue: {
+      return CreateValueForRequest(executor, operation.create_value(),
+                                   value_cache);
+    }
+    case v0::ExecuteBatchRequest::Operation::kCreateCall: {
+      const v0::CreateCallRequest& create_call = operation.create_call();
+      ValueId function =
+          TFF_TRY(ResolveBatchRef(create_call.function_ref(), batch_values));
+      absl::optional<ValueId> argument;
+      if (create_call.has_argument_ref()) {
+        argument =
+            TFF_TRY(ResolveBatchRef(create_call.argument_ref(), batch_values));
+      }
+      return executor.CreateCall(function, argument);
+    }
+    case v0::ExecuteBatchRequest::Operation::kCreateStruct: {
+      std::vector<ValueId> members;
+      members.reserve(operation.create_struct().element_size());
+      for (const v0::CreateStructRequest::Element& element :
+           operation.create_struct().element()) {
+        members.push_back(
+            TFF_TRY(ResolveBatchRef(element.value_ref(), batch_values)));
+      }
+      return executor.CreateStruct(members);
+    }
+    case v0::ExecuteBatchRequest::Operation::kCreateSelection: {
+      const v0::CreateSelectionRequest& create_selection =
+          operation.create_selection();
+      ValueId source = TFF_TRY(
+          ResolveBatchRef(create_selection.source_ref(), batch_values));
+      return executor.CreateSelection(source, create_selection.index());
+    }
+    case v0::ExecuteBatchRequest::Operation::OPERATION_NOT_SET: {
+      break;
+    }
+  }
+  return absl::InvalidArgumentError(
+      absl::StrCat("Operation '", operation.id(), "' has no operation set."));
+}
+
 }  // namespace
 
 using ExecutorId = std::string;
@@ -243,7 +355,8 @@ grpc::Status ExecutorService::CreateValue(grpc::ServerContext* context,
   std::shared_ptr<Executor> executor;
   TFF_TRYLOG_GRPC(
       RequireExecutor("CreateValue", request->executor(), executor));
-  absl::StatusOr<OwnedValueId> id = executor->CreateValue(request->value());
+  absl::StatusOr<OwnedValueId> id =
+      CreateValueForRequest(*executor, *request, value_cache_);
   if (!id.ok()) {
     return HandleNotOK(id.status(), request->executor());
   }
@@ -255,6 +368,53 @@ grpc::Status ExecutorService::CreateValue(grpc::ServerContext* context,
   return grpc::Status::OK;
 }
 
+grpc::Status ExecutorService::CreateValueStream(
+    grpc::ServerContext* context,
+    grpc::ServerReader<v0::CreateValueStreamRequest>* reader,
+    v0::CreateValueResponse* response) {
+  return CreateValueStream(
+      context,
+      static_cast<grpc::ServerReaderInterface<v0::CreateValueStreamRequest>*>(
+          reader),
+      response);
+}
+
+grpc::Status ExecutorService::CreateValueStream(
+    grpc::ServerContext* context,
+    grpc::ServerReaderInterface<v0::CreateValueStreamRequest>* reader,
+    v0::CreateValueResponse* response) {
+  v0::CreateValueStreamRequest request;
+  if (!reader->Read(&request)) {
+    return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT,
+                        "CreateValueStream received no requests.");
+  }
+  const v0::ExecutorId executor_pb = request.executor();
+  const std::string value_fingerprint = request.value_fingerprint();
+  std::shared_ptr<Executor> executor;
+  TFF_TRYLOG_GRPC(RequireExecutor("CreateValueStream", executor_pb, executor));
+  ValueChunkReader value_reader;
+  do {
+    TFF_TRYLOG_GRPC(
+        absl_to_grpc(value_reader.Add(std::move(*request.mutable_chunk()))));
+  } while (reader->Read(&request));
+  absl::StatusOr<v0::Value> value = value_reader.Finish();
+  TFF_TRYLOG_GRPC(absl_to_grpc(value.status()));
+  // The reassembled value is moved, not copied, into the cache.
+  auto shared_value = std::make_shared<const v0::Value>(std::move(*value));
+  if (!value_fingerprint.empty()) {
+    TFF_TRYLOG_GRPC(absl_to_grpc(
+        VerifyValueFingerprint(*shared_value, value_fingerprint)));
+    value_cache_.Insert(value_fingerprint, shared_value);
+  }
+  absl::StatusOr<OwnedValueId> id = executor->CreateValue(*shared_value);
+  if (!id.ok()) {
+    return HandleNotOK(id.status(), executor_pb);
+  }
+  *response->mutable_value_ref() = IdToRemoteValue(id.value());
+  id.value().forget();
+  return grpc::Status::OK;
+}
+
 grpc::Status ExecutorService::CreateCall(grpc::ServerContext* context,
                                          const v0::CreateCallRequest* request,
                                          v0::CreateCallResponse* response) {
@@ -322,6 +482,61 @@ grpc::Status ExecutorService::CreateSelection(
   return grpc::Status::OK;
 }
 
+grpc::Status ExecutorService::ExecuteBatch(
+    grpc::ServerContext* context, const v0::ExecuteBatchRequest* request,
+    v0::ExecuteBatchResponse* response) {
+  std::shared_ptr<Executor> executor;
+  TFF_TRYLOG_GRPC(
+      RequireExecutor("ExecuteBatch", request->executor(), executor));
+  absl::flat_hash_set<absl::string_view> operation_ids;
+  for (const v0::ExecuteBatchRequest::Operation& operation :
+       request->operation()) {
+    ValueId unused;
+    if (absl::SimpleAtoi(operation.id(), &unused) ||
+        !operation_ids.insert(operation.id()).second) {
+      return grpc::Status(
+          grpc::StatusCode::INVALID_ARGUMENT,
+          absl::StrCat("Expected unique, non-integer operation ids, found ",
+                       operation.id()));
+    }
+  }
+  BatchValues batch_values;
+  // Values are forgotten only once the whole batch has run, in the same way
+  // as the individual `Create...` methods do.
+  std::vector<OwnedValueId> created_values;
+  created_values.reserve(request->operation_size());
+  // Once an operation fails with `FailedPrecondition` the executor has been
+  // destroyed, and all remaining operations fail in the same way.
+  absl::Status executor_status;
+  for (const v0::ExecuteBatchRequest::Operation& operation :
+       request->operation()) {
+    absl::StatusOr<OwnedValueId> value =
+        executor_status.ok()
+            ? ExecuteOperation(*executor, operation, batch_values,
+                               value_cache_)
+            : executor_status;
+    v0::ExecuteBatchResponse::Result* result = response->add_result();
+    if (value.ok()) {
+      *result->mutable_value_ref() = IdToRemoteValue(value.value());
+      batch_values.emplace(operation.id(), value.value().ref());
+      created_values.push_back(std::move(value).value());
+      continue;
+    }
+    result->set_error_code(static_cast<int32_t>(value.status().code()));
+    result->set_error_message(std::string(value.status().message()));
+    batch_values.emplace(operation.id(), value.status());
+    if (executor_status.ok() &&
+        value.status().code() == absl::StatusCode::kFailedPrecondition) {
+      executor_status = value.status();
+      HandleNotOK(executor_status, request->executor());
+    }
+  }
+  for (OwnedValueId& value : created_values) {
+    value.forget();
+  }
+  return grpc::Status::OK;
+}
+
 grpc::Status ExecutorService::Compute(grpc::ServerContext* context,
                                       const v0::ComputeRequest* request,
                                       v0::ComputeResponse* response) {
@@ -337,6 +552,39 @@ grpc::Status ExecutorService::Compute(grpc::ServerContext* context,
   return HandleNotOK(status, request->executor());
 }
 
+grpc::Status ExecutorService::ComputeStream(
+    grpc::ServerContext* context, const v0::ComputeRequest* request,
+    grpc::ServerWriter<v0::ComputeStreamResponse>* writer) {
+  return ComputeStream(
+      context, request,
+      static_cast<grpc::ServerWriterInterface<v0::ComputeStreamResponse>*>(
+          writer));
+}
+
+grpc::Status ExecutorService::ComputeStream(
+    grpc::ServerContext* context, const v0::ComputeRequest* request,
+    grpc::ServerWriterInterface<v0::ComputeStreamResponse>* writer) {
+  std::shared_ptr<Executor> executor;
+  TFF_TRYLOG_GRPC(
+      RequireExecutor("ComputeStream", request->executor(), executor));
+  ValueId requested_value;
+  TFF_TRYLOG_GRPC(RemoteValueToId(request->value_ref(), requested_value));
+  v0::Value value;
+  absl::Status status = executor->Materialize(requested_value, &value);
+  if (!status.ok()) {
+    return HandleNotOK(status, request->executor());
+  }
+  ValueChunkWriter value_writer(value);
+  v0::ComputeStreamResponse response;
+  while (value_writer.Next(response.mutable_chunk())) {
+    if (!writer->Write(response)) {
+      return grpc::Status(grpc::StatusCode::CANCELLED,
+                          "ComputeStream was cancelled by the client.");
+    }
+  }
+  return grpc::Status::OK;
+}
+
 grpc::Status ExecutorService::Dispose(grpc::ServerContext* context,
                                       const v0::DisposeRequest* request,
                                       v0::DisposeResponse* response) {
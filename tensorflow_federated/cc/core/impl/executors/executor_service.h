@@ -16,6 +16,7 @@ limitations under the License
 #ifndef THIRD_PARTY_TENSORFLOW_FEDERATED_CC_CORE_IMPL_EXECUTORS_EXECUTOR_SERVICE_H_
 #define THIRD_PARTY_TENSORFLOW_FEDERATED_CC_CORE_IMPL_EXECUTORS_EXECUTOR_SERVICE_H_
 
+#include <cstddef>
 #include <functional>
 #include <memory>
 #include <string>
@@ -34,6 +35,7 @@ limitations under the License
 #include "tensorflow_federated/cc/core/impl/executors/cardinalities.h"
 #include "tensorflow_federated/cc/core/impl/executors/executor.h"
 #include "tensorflow_federated/cc/core/impl/executors/status_conversion.h"
+#include "tensorflow_federated/cc/core/impl/executors/value_cache.h"
 #include "tensorflow_federated/proto/v0/computation.pb.h"
 #include "tensorflow_federated/proto/v0/executor.grpc.pb.h"
 #include "tensorflow_federated/proto/v0/executor.pb.h"
@@ -61,6 +63,10 @@ using ExecutorFactory = std::function<absl::StatusOr<std::shared_ptr<Executor>>(
 // Finally, `Dispose` serves as an explicit resource-management request;
 // `Dispose` tells the service that it can free any resources
 // associated with the specified `ValueId`s.
+//
+// Values created with a `value_fingerprint` are kept in a `ValueCache` shared
+// by all executors of the service, so that clients may create the same value
+// again by sending only its fingerprint.
 class ExecutorService : public v0::ExecutorGroup::Service {
   using RemoteValueId = std::string;
 
@@ -70,9 +76,12 @@ class ExecutorService : public v0::ExecutorGroup::Service {
   // placements to integers. After the service is constructed, it must be
   // configured with a `GetExecutor` request (which instantiates an
   // underlying concrete tensorflow_federated::Executor) before it can start
-  // executing other requests.
-  explicit ExecutorService(const ExecutorFactory& executor_factory)
-      : executor_resolver_(executor_factory) {}
+  // executing other requests. At most `value_cache_bytes` of values created
+  // with a `value_fingerprint` are cached.
+  explicit ExecutorService(const ExecutorFactory& executor_factory,
+                           size_t value_cache_bytes = kDefaultValueCacheBytes)
+      : executor_resolver_(executor_factory),
+        value_cache_(value_cache_bytes) {}
 
   ~ExecutorService() override {}
 
@@ -88,6 +97,13 @@ class ExecutorService : public v0::ExecutorGroup::Service {
                            const v0::CreateValueRequest* request,
                            v0::CreateValueResponse* response) override;
 
+  // Embed a value received as a stream of `ValueChunk`s in the underlying
+  // executor stack.
+  grpc::Status CreateValueStream(
+      grpc::ServerContext* context,
+      grpc::ServerReader<v0::CreateValueStreamRequest>* reader,
+      v0::CreateValueResponse* response) override;
+
   // Invoke an embedded function on an embedded argument.
   grpc::Status CreateCall(grpc::ServerContext* context,
                           const v0::CreateCallRequest* request,
@@ -103,12 +119,35 @@ class ExecutorService : public v0::ExecutorGroup::Service {
                                const v0::CreateSelectionRequest* request,
                                v0::CreateSelectionResponse* response) override;
 
+  // Run a sequence of `Create...` operations, which may refer to the values
+  // created by earlier operations in the same batch by their client-assigned
+  // IDs. Each operation reports its own result; the batch fails as a whole
+  // only if it is malformed or its executor cannot be found.
+  grpc::Status ExecuteBatch(grpc::ServerContext* context,
+                            const v0::ExecuteBatchRequest* request,
+                            v0::ExecuteBatchResponse* response) override;
+
   // Materialize a value on the client. Blocking. The value requested to be
   // materialized must be non-functional.
   grpc::Status Compute(grpc::ServerContext* context,
                        const v0::ComputeRequest* request,
                        v0::ComputeResponse* response) override;
 
+  // Materialize a value on the client as a stream of `ValueChunk`s. Blocking.
+  grpc::Status ComputeStream(
+      grpc::ServerContext* context, const v0::ComputeRequest* request,
+      grpc::ServerWriter<v0::ComputeStreamResponse>* writer) override;
+
+  // Overloads of the streaming methods above for any implementation of the
+  // streams, as used by `AsyncExecutorService`.
+  grpc::Status CreateValueStream(
+      grpc::ServerContext* context,
+      grpc::ServerReaderInterface<v0::CreateValueStreamRequest>* reader,
+      v0::CreateValueResponse* response);
+  grpc::Status ComputeStream(
+      grpc::ServerContext* context, const v0::ComputeRequest* request,
+      grpc::ServerWriterInterface<v0::ComputeStreamResponse>* writer);
+
   // Free the resources associated to the embedded values specified.
   grpc::Status Dispose(grpc::ServerContext* context,
                        const v0::DisposeRequest* request,
@@ -224,6 +263,7 @@ class ExecutorService : public v0::ExecutorGroup::Service {
   };
 
   ExecutorResolver executor_resolver_;
+  ValueCache value_cache_;
 };
 }  // namespace tensorflow_federated
 #endif  // THIRD_PARTY_TENSORFLOW_FEDERATED_CC_CORE_IMPL_EXECUTORS_EXECUTOR_SERVICE_H_
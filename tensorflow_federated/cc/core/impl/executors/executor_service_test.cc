@@ -34,6 +34,7 @@ limitations under the License
 #include "tensorflow_federated/cc/core/impl/executors/protobuf_matchers.h"
 #include "tensorflow_federated/cc/core/impl/executors/status_conversion.h"
 #include "tensorflow_federated/cc/core/impl/executors/status_matchers.h"
+#include "tensorflow_federated/cc/core/impl/executors/value_cache.h"
 #include "tensorflow_federated/cc/core/impl/executors/value_test_utils.h"
 #include "tensorflow_federated/proto/v0/computation.pb.h"
 #include "tensorflow_federated/proto/v0/executor.pb.h"
@@ -203,6 +204,59 @@ TEST_F(ExecutorServiceTest, CreateValueReturnsZeroRef) {
   EXPECT_THAT(response_pb, testing::EqualsProto("value_ref { id: '0' }"));
 }
 
+TEST_F(ExecutorServiceTest, CreateValueByFingerprintUsesCachedValue) {
+  v0::CreateValueRequest request_pb = CreateValueFloatRequest(2.0f);
+  request_pb.set_value_fingerprint(ValueFingerprint(request_pb.value()));
+  v0::CreateValueRequest fingerprint_request_pb = request_pb;
+  fingerprint_request_pb.clear_value();
+  v0::CreateValueResponse response_pb;
+  grpc::ServerContext server_context;
+
+  EXPECT_CALL(*executor_ptr_,
+              CreateValue(testing::EqualsProto(testing::TensorV(2.0f))))
+      .WillOnce([this] { return TestId(0); })
+      .WillOnce([this] { return TestId(1); });
+
+  TFF_ASSERT_OK(grpc_to_absl(executor_service_.CreateValue(
+      &server_context, &request_pb, &response_pb)));
+  EXPECT_THAT(response_pb, testing::EqualsProto("value_ref { id: '0' }"));
+  TFF_ASSERT_OK(grpc_to_absl(executor_service_.CreateValue(
+      &server_context, &fingerprint_request_pb, &response_pb)));
+  EXPECT_THAT(response_pb, testing::EqualsProto("value_ref { id: '1' }"));
+}
+
+TEST_F(ExecutorServiceTest, CreateValueWithMismatchedFingerprintFails) {
+  v0::CreateValueRequest request_pb = CreateValueFloatRequest(2.0f);
+  request_pb.set_value_fingerprint(ValueFingerprint(testing::TensorV(3.0f)));
+  v0::CreateValueRequest fingerprint_request_pb = request_pb;
+  fingerprint_request_pb.clear_value();
+  v0::CreateValueResponse response_pb;
+  grpc::ServerContext server_context;
+
+  EXPECT_CALL(*executor_ptr_, CreateValue(::testing::_)).Times(0);
+
+  EXPECT_THAT(executor_service_.CreateValue(&server_context, &request_pb,
+                                            &response_pb),
+              GrpcStatusIs(grpc::StatusCode::INVALID_ARGUMENT));
+  // The mismatched value was not cached under the fingerprint it was sent
+  // with.
+  EXPECT_THAT(executor_service_.CreateValue(
+                  &server_context, &fingerprint_request_pb, &response_pb),
+              GrpcStatusIs(grpc::StatusCode::NOT_FOUND));
+}
+
+TEST_F(ExecutorServiceTest, CreateValueByUnknownFingerprintFails) {
+  v0::CreateValueRequest request_pb;
+  *request_pb.mutable_executor() = executor_pb_;
+  request_pb.set_value_fingerprint("fingerprint");
+  v0::CreateValueResponse response_pb;
+  grpc::ServerContext server_context;
+
+  EXPECT_THAT(executor_service_.CreateValue(&server_context, &request_pb,
+                                            &response_pb),
+              GrpcStatusIs(grpc::StatusCode::NOT_FOUND));
+}
+
 TEST_F(ExecutorServiceTest, CreateValueFailedPreconditionDestroysExecutor) {
   // If an executor returns FailedPrecondition, the service must invalidate any
   // outstanding references to this executor. This test asserts that once the
@@ -707,4 +761,72 @@ TEST_F(ExecutorServiceTest, CreateNamedNonemptyStruct) {
               testing::EqualsProto("value_ref { id: '0' }"));
 }
 
+TEST_F(ExecutorServiceTest, ExecuteBatchResolvesReferencesWithinBatch) {
+  v0::ExecuteBatchRequest request_pb;
+  *request_pb.mutable_executor() = executor_pb_;
+  v0::ExecuteBatchRequest::Operation* value_op = request_pb.add_operation();
+  value_op->set_id("v0");
+  value_op->mutable_create_value()->mutable_value()->MergeFrom(
+      testing::TensorV(2.0));
+  v0::ExecuteBatchRequest::Operation* selection_op =
+      request_pb.add_operation();
+  selection_op->set_id("v1");
+  selection_op->mutable_create_selection()->mutable_source_ref()->set_id(
+      "v0");
+  selection_op->mutable_create_selection()->set_index(3);
+  v0::ExecuteBatchResponse response_pb;
+  grpc::ServerContext server_context;
+
+  EXPECT_CALL(*executor_ptr_, CreateValue(::testing::_))
+      .WillOnce([this] { return TestId(0); });
+  EXPECT_CALL(*executor_ptr_, CreateSelection(0, 3))
+      .WillOnce([this] { return TestId(1); });
+  TFF_ASSERT_OK(grpc_to_absl(executor_service_.ExecuteBatch(
+      &server_context, &request_pb, &response_pb)));
+  EXPECT_THAT(response_pb, testing::EqualsProto("result { value_ref { id: '0' "
+                                                "} } result { value_ref { id: "
+                                                "'1' } }"));
+}
+
+TEST_F(ExecutorServiceTest, ExecuteBatchFailsDependentsOfFailedOperation) {
+  v0::ExecuteBatchRequest request_pb;
+  *request_pb.mutable_executor() = executor_pb_;
+  v0::ExecuteBatchRequest::Operation* value_op = request_pb.add_operation();
+  value_op->set_id("v0");
+  value_op->mutable_create_value()->mutable_value()->MergeFrom(
+      testing::TensorV(2.0));
+  v0::ExecuteBatchRequest::Operation* call_op = request_pb.add_operation();
+  call_op->set_id("v1");
+  call_op->mutable_create_call()->mutable_function_ref()->set_id("v0");
+  v0::ExecuteBatchResponse response_pb;
+  grpc::ServerContext server_context;
+
+  EXPECT_CALL(*executor_ptr_, CreateValue(::testing::_))
+      .WillOnce([] { return absl::InvalidArgumentError("Bad value"); });
+  TFF_ASSERT_OK(grpc_to_absl(executor_service_.ExecuteBatch(
+      &server_context, &request_pb, &response_pb)));
+  ASSERT_EQ(response_pb.result_size(), 2);
+  for (const v0::ExecuteBatchResponse::Result& result : response_pb.result()) {
+    EXPECT_FALSE(result.has_value_ref());
+    EXPECT_EQ(result.error_code(),
+              static_cast<int32_t>(absl::StatusCode::kInvalidArgument));
+    EXPECT_EQ(result.error_message(), "Bad value");
+  }
+}
+
+TEST_F(ExecutorServiceTest, ExecuteBatchRejectsIntegerOperationIds) {
+  v0::ExecuteBatchRequest request_pb;
+  *request_pb.mutable_executor() = executor_pb_;
+  v0::ExecuteBatchRequest::Operation* value_op = request_pb.add_operation();
+  value_op->set_id("0");
+  value_op->mutable_create_value()->mutable_value()->MergeFrom(
+      testing::TensorV(2.0));
+  v0::ExecuteBatchResponse response_pb;
+  grpc::ServerContext server_context;
+
+  EXPECT_THAT(executor_service_.ExecuteBatch(&server_context, &request_pb,
+                                             &response_pb),
+              GrpcStatusIs(grpc::StatusCode::INVALID_ARGUMENT));
+}
+
 }  // namespace tensorflow_federated
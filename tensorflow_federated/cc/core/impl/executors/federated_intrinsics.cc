@@ -26,9 +26,10 @@ namespace tensorflow_federated {
 
 absl::StatusOr<FederatedIntrinsic> FederatedIntrinsicFromUri(
     const absl::string_view uri) {
-  if (uri == kFederatedMapAtClientsUri || uri == "federated_apply" ||
-      uri == "federated_map_all_equal") {
+  if (uri == kFederatedMapAtClientsUri || uri == "federated_apply") {
     return FederatedIntrinsic::MAP;
+  } else if (uri == "federated_map_all_equal") {
+    return FederatedIntrinsic::MAP_ALL_EQUAL;
   } else if (uri == kFederatedZipAtClientsUri) {
     return FederatedIntrinsic::ZIP_AT_CLIENTS;
   } else if (uri == kFederatedZipAtServerUri) {
@@ -47,6 +48,12 @@ absl::StatusOr<FederatedIntrinsic> FederatedIntrinsicFromUri(
     return FederatedIntrinsic::EVAL_AT_SERVER;
   } else if (uri == "federated_select") {
     return FederatedIntrinsic::SELECT;
+  } else if (uri == kFederatedSumUri) {
+    return FederatedIntrinsic::SUM;
+  } else if (uri == kFederatedMeanUri) {
+    return FederatedIntrinsic::MEAN;
+  } else if (uri == kFederatedWeightedMeanUri) {
+    return FederatedIntrinsic::WEIGHTED_MEAN;
   } else {
     return absl::UnimplementedError(
         absl::StrCat("Unsupported intrinsic URI: ", uri));
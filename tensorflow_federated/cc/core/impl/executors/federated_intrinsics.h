@@ -28,9 +28,13 @@ const absl::string_view kFederatedZipAtClientsUri = "federated_zip_at_clients";
 const absl::string_view kFederatedZipAtServerUri = "federated_zip_at_server";
 const absl::string_view kFederatedAggregateUri = "federated_aggregate";
 const absl::string_view kFederatedSelectUri = "federated_select";
+const absl::string_view kFederatedSumUri = "federated_sum";
+const absl::string_view kFederatedMeanUri = "federated_mean";
+const absl::string_view kFederatedWeightedMeanUri = "federated_weighted_mean";
 
 enum class FederatedIntrinsic {
   MAP,
+  MAP_ALL_EQUAL,
   ZIP_AT_CLIENTS,
   ZIP_AT_SERVER,
   BROADCAST,
@@ -40,6 +44,9 @@ enum class FederatedIntrinsic {
   EVAL_AT_SERVER,
   AGGREGATE,
   SELECT,
+  SUM,
+  MEAN,
+  WEIGHTED_MEAN,
 };
 
 absl::StatusOr<FederatedIntrinsic> FederatedIntrinsicFromUri(
@@ -15,18 +15,24 @@ limitations under the License
 
 #include "tensorflow_federated/cc/core/impl/executors/federating_executor.h"
 
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
+#include <list>
 #include <memory>
 #include <string>
+#include <thread>  // NOLINT
 #include <utility>
 #include <vector>
 
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/types/optional.h"
 #include "absl/types/span.h"
 #include "absl/types/variant.h"
@@ -36,8 +42,10 @@ limitations under the License
 #include "tensorflow_federated/cc/core/impl/executors/executor.h"
 #include "tensorflow_federated/cc/core/impl/executors/federated_intrinsics.h"
 #include "tensorflow_federated/cc/core/impl/executors/status_macros.h"
+#include "tensorflow_federated/cc/core/impl/executors/tensor_accumulator.h"
 #include "tensorflow_federated/cc/core/impl/executors/tensor_serialization.h"
 #include "tensorflow_federated/cc/core/impl/executors/threading.h"
+#include "tensorflow_federated/cc/core/impl/executors/value_cache.h"
 #include "tensorflow_federated/cc/core/impl/executors/value_validation.h"
 #include "tensorflow_federated/proto/v0/computation.pb.h"
 #include "tensorflow_federated/proto/v0/executor.pb.h"
@@ -55,6 +63,7 @@ using Clients = std::shared_ptr<std::vector<std::shared_ptr<OwnedValueId>>>;
 using Structure = std::shared_ptr<std::vector<ExecutorValue>>;
 using ValueVariant = absl::variant<UnplacedOrServer, Clients, Structure,
                                    enum FederatedIntrinsic>;
+using ValueFuture = SharedFuture<absl::StatusOr<ExecutorValue>>;
 
 inline std::shared_ptr<OwnedValueId> ShareValueId(OwnedValueId&& id) {
   return std::make_shared<OwnedValueId>(std::move(id));
@@ -66,6 +75,15 @@ inline Clients NewClients(uint32_t num_clients) {
   return v;
 }
 
+// Converts the result of a batched child executor call into `Clients`.
+inline Clients ShareValueIds(std::vector<OwnedValueId>&& ids) {
+  Clients v = NewClients(ids.size());
+  for (OwnedValueId& id : ids) {
+    v->push_back(ShareValueId(std::move(id)));
+  }
+  return v;
+}
+
 inline Structure NewStructure() {
   return std::make_shared<std::vector<ExecutorValue>>();
 }
@@ -74,14 +92,22 @@ class ExecutorValue {
  public:
   enum class ValueType { UNPLACED, SERVER, CLIENTS, STRUCTURE, INTRINSIC };
 
-  inline static ExecutorValue CreateUnplaced(UnplacedOrServer id) {
-    return ExecutorValue(std::move(id), ValueType::UNPLACED);
+  inline static ExecutorValue CreateUnplaced(
+      UnplacedOrServer id,
+      std::shared_ptr<const std::string> fingerprint = nullptr) {
+    ExecutorValue value(std::move(id), ValueType::UNPLACED);
+    value.fingerprint_ = std::move(fingerprint);
+    return value;
   }
   inline const UnplacedOrServer& unplaced() const {
     return absl::get<UnplacedOrServer>(value_);
   }
-  inline static ExecutorValue CreateServerPlaced(UnplacedOrServer id) {
-    return ExecutorValue(std::move(id), ValueType::SERVER);
+  inline static ExecutorValue CreateServerPlaced(
+      UnplacedOrServer id,
+      std::shared_ptr<const std::string> fingerprint = nullptr) {
+    ExecutorValue value(std::move(id), ValueType::SERVER);
+    value.fingerprint_ = std::move(fingerprint);
+    return value;
   }
   inline const UnplacedOrServer& server() const {
     return absl::get<UnplacedOrServer>(value_);
@@ -89,9 +115,30 @@ class ExecutorValue {
   inline const Clients& clients() const {
     return absl::get<::tensorflow_federated::Clients>(value_);
   }
+  // Returns the value of the client at `client_index`.
+  inline const std::shared_ptr<OwnedValueId>& client(
+      uint32_t client_index) const {
+    return (*clients())[all_equal_ ? 0 : client_index];
+  }
+  // Whether every client holds the same value, in which case `clients()`
+  // holds that value once rather than once per client.
+  inline bool all_equal() const { return all_equal_; }
+  // Whether the value has an all-equal type, and so materializes as its single
+  // value. An `all_equal()` value whose type is not all-equal, such as the
+  // result of zipping all-equal values, materializes once per client.
+  inline bool all_equal_type() const { return all_equal_type_; }
   inline static ExecutorValue CreateClientsPlaced(Clients client_values) {
     return ExecutorValue(std::move(client_values), ValueType::CLIENTS);
   }
+  inline static ExecutorValue CreateClientsPlacedAllEqual(
+      std::shared_ptr<OwnedValueId> value, bool all_equal_type = true) {
+    ExecutorValue result(
+        std::make_shared<std::vector<std::shared_ptr<OwnedValueId>>>(
+            1, std::move(value)),
+        ValueType::CLIENTS, /*all_equal=*/true);
+    result.all_equal_type_ = all_equal_type;
+    return result;
+  }
   // Convenience constructor from an un-shared_ptr vector.
   inline static ExecutorValue CreateClientsPlaced(
       std::vector<std::shared_ptr<OwnedValueId>>&& client_values) {
@@ -115,6 +162,12 @@ class ExecutorValue {
 
   inline ValueType type() const { return type_; }
 
+  // The `ValueFingerprint` of the proto an unplaced or server-placed value was
+  // created from, or nullptr if it is not known.
+  inline const std::shared_ptr<const std::string>& fingerprint() const {
+    return fingerprint_;
+  }
+
   absl::Status CheckArgumentType(ValueType expected_type,
                                  absl::string_view argument_identifier) const {
     if (type() == expected_type) {
@@ -127,15 +180,123 @@ class ExecutorValue {
     }
   }
 
-  ExecutorValue(ValueVariant value, ValueType type)
-      : value_(std::move(value)), type_(type) {}
+  ExecutorValue(ValueVariant value, ValueType type, bool all_equal = false)
+      : value_(std::move(value)),
+        type_(type),
+        all_equal_(all_equal),
+        all_equal_type_(all_equal) {}
 
  private:
   ExecutorValue() = delete;
   ValueVariant value_;
   ValueType type_;
+  bool all_equal_;
+  bool all_equal_type_;
+  std::shared_ptr<const std::string> fingerprint_;
 };
 
+// Returns whether every client-placed value in `value`, a client-placed value
+// or a structure of them, is all-equal.
+bool IsAllEqualAtClients(const ExecutorValue& value) {
+  switch (value.type()) {
+    case ExecutorValue::ValueType::CLIENTS: {
+      return value.all_equal();
+    }
+    case ExecutorValue::ValueType::STRUCTURE: {
+      for (const ExecutorValue& element : *value.structure()) {
+        if (!IsAllEqualAtClients(element)) {
+          return false;
+        }
+      }
+      return true;
+    }
+    default: {
+      return false;
+    }
+  }
+}
+
+// A bounded cache of the slices computed by `federated_select`, keyed by the
+// identity of the `server_val` and `select_fn` they were computed from (their
+// scope) and by key. The least recently used slices are released once more
+// than `max_slices` are cached.
+//
+// This class is thread-safe.
+class SliceCache {
+ public:
+  explicit SliceCache(size_t max_slices) : max_slices_(max_slices) {}
+
+  SliceCache(const SliceCache&) = delete;
+  SliceCache& operator=(const SliceCache&) = delete;
+
+  // Returns the slice cached for `key` in `scope`, marking it as the most
+  // recently used, or nullptr if there is none.
+  std::shared_ptr<OwnedValueId> Lookup(const std::string& scope, int32_t key) {
+    absl::MutexLock lock(&mutex_);
+    auto scope_it = index_.find(scope);
+    if (scope_it == index_.end()) {
+      return nullptr;
+    }
+    auto it = scope_it->second.find(key);
+    if (it == scope_it->second.end()) {
+      return nullptr;
+    }
+    entries_.splice(entries_.begin(), entries_, it->second);
+    return it->second->slice;
+  }
+
+  // Caches `slice` for `key` in `scope`, evicting the least recently used
+  // slices as needed to stay within budget.
+  void Insert(const std::string& scope, int32_t key,
+              std::shared_ptr<OwnedValueId> slice) {
+    if (max_slices_ == 0) {
+      return;
+    }
+    absl::MutexLock lock(&mutex_);
+    auto& scope_index = index_[scope];
+    if (scope_index.contains(key)) {
+      return;
+    }
+    entries_.push_front({scope, key, std::move(slice)});
+    scope_index.emplace(key, entries_.begin());
+    while (entries_.size() > max_slices_) {
+      const Entry& oldest = entries_.back();
+      auto scope_it = index_.find(oldest.scope);
+      scope_it->second.erase(oldest.key);
+      if (scope_it->second.empty()) {
+        index_.erase(scope_it);
+      }
+      entries_.pop_back();
+    }
+  }
+
+ private:
+  struct Entry {
+    std::string scope;
+    int32_t key;
+    std::shared_ptr<OwnedValueId> slice;
+  };
+
+  const size_t max_slices_;
+  absl::Mutex mutex_;
+  // Ordered from the most to the least recently used.
+  std::list<Entry> entries_ ABSL_GUARDED_BY(mutex_);
+  absl::flat_hash_map<std::string,
+                      absl::flat_hash_map<int32_t, std::list<Entry>::iterator>>
+      index_ ABSL_GUARDED_BY(mutex_);
+};
+
+// Returns the part of a `SliceCache` scope identifying `value`: the
+// fingerprint of its content if known, so that equal values created in
+// different rounds share their slices, and otherwise its id in the child
+// executor (which is never reused for another value).
+std::string SliceScopeOf(const ExecutorValue& value) {
+  if (value.fingerprint() != nullptr) {
+    return absl::StrCat("fingerprint:", *value.fingerprint());
+  }
+  return absl::StrCat("id:", value.unplaced()->ref());
+}
+
 absl::Status CheckLenForUseAsArgument(const ExecutorValue& value,
                                       absl::string_view function_name,
                                       size_t len) {
@@ -149,11 +310,19 @@ absl::Status CheckLenForUseAsArgument(const ExecutorValue& value,
   return absl::OkStatus();
 }
 
-class FederatingExecutor : public ExecutorBase<ExecutorValue> {
+class FederatingExecutor : public ExecutorBase<ValueFuture> {
  public:
   explicit FederatingExecutor(std::shared_ptr<Executor> child,
-                              uint32_t num_clients)
-      : child_(child), num_clients_(num_clients) {}
+                              uint32_t num_clients,
+                              uint32_t num_aggregation_groups,
+                              size_t select_slice_cache_size)
+      : child_(child),
+        num_clients_(num_clients),
+        num_aggregation_groups_(num_aggregation_groups),
+        slice_cache_(select_slice_cache_size > 0
+                         ? std::make_unique<SliceCache>(
+                               select_slice_cache_size)
+                         : nullptr) {}
   ~FederatingExecutor() override {
     // We must make sure to delete all of our OwnedValueIds, releasing them from
     // the child executor as well, before deleting the child executor.
@@ -163,6 +332,19 @@ class FederatingExecutor : public ExecutorBase<ExecutorValue> {
  private:
   std::shared_ptr<Executor> child_;
   uint32_t num_clients_;
+  uint32_t num_aggregation_groups_;
+  // Caches the slices computed by `federated_select` across calls, if enabled.
+  std::unique_ptr<SliceCache> slice_cache_;
+
+  // Returns the fingerprint of `value_pb` if `federated_select` slices are
+  // cached, as the cache can then reuse slices of equal values.
+  std::shared_ptr<const std::string> FingerprintIfCaching(
+      const v0::Value& value_pb) const {
+    if (slice_cache_ == nullptr) {
+      return nullptr;
+    }
+    return std::make_shared<const std::string>(ValueFingerprint(value_pb));
+  }
 
   absl::string_view ExecutorName() final {
     static constexpr absl::string_view kExecutorName = "FederatingExecutor";
@@ -171,13 +353,15 @@ class FederatingExecutor : public ExecutorBase<ExecutorValue> {
 
   ExecutorValue ClientsAllEqualValue(
       const std::shared_ptr<OwnedValueId>& value) const {
-    // All-equal-ness is not stored by this executor. Instead, we create
-    // `num_clients_` non-all-equal references to the same value. This
-    // prevents optimization of the uncommon "materialize a broadcasted
-    // value" case, but allows for simpler handling of values throughout.
-    return ExecutorValue::CreateClientsPlaced(
-        std::make_shared<std::vector<std::shared_ptr<OwnedValueId>>>(
-            num_clients_, value));
+    return ExecutorValue::CreateClientsPlacedAllEqual(value);
+  }
+
+  // Returns a client-placed value of a type which is not all-equal, but whose
+  // clients all hold `value`, which is shared rather than repeated.
+  ExecutorValue ClientsSharedValue(
+      const std::shared_ptr<OwnedValueId>& value) const {
+    return ExecutorValue::CreateClientsPlacedAllEqual(
+        value, /*all_equal_type=*/false);
   }
 
   Clients NewClients() {
@@ -189,17 +373,17 @@ class FederatingExecutor : public ExecutorBase<ExecutorValue> {
     switch (kind) {
       case FederatedKind::SERVER: {
         return ExecutorValue::CreateServerPlaced(
-            ShareValueId(TFF_TRY(child_->CreateValue(federated.value(0)))));
+            ShareValueId(TFF_TRY(child_->CreateValue(federated.value(0)))),
+            FingerprintIfCaching(federated.value(0)));
       }
       case FederatedKind::CLIENTS: {
-        Clients values = NewClients();
+        std::vector<const v0::Value*> values_pb;
+        values_pb.reserve(federated.value_size());
         for (const auto& value_pb : federated.value()) {
-          values->emplace_back(
-              ShareValueId(TFF_TRY(child_->CreateValue(value_pb)
-
-                                       )));
+          values_pb.push_back(&value_pb);
         }
-        return ExecutorValue::CreateClientsPlaced(std::move(values));
+        return ExecutorValue::CreateClientsPlaced(
+            ShareValueIds(TFF_TRY(child_->CreateValues(values_pb))));
       }
       case FederatedKind::CLIENTS_ALL_EQUAL: {
         return ClientsAllEqualValue(
@@ -238,8 +422,13 @@ class FederatingExecutor : public ExecutorBase<ExecutorValue> {
     }
   }
 
-  absl::StatusOr<ExecutorValue> CreateExecutorValue(
+  absl::StatusOr<ValueFuture> CreateExecutorValue(
       const v0::Value& value_pb) final {
+    return ReadyFuture(TFF_TRY(ExecutorValueFromProto(value_pb)));
+  }
+
+  absl::StatusOr<ExecutorValue> ExecutorValueFromProto(
+      const v0::Value& value_pb) {
     switch (value_pb.value_case()) {
       case v0::Value::kFederated: {
         const v0::Value_Federated& federated = value_pb.federated();
@@ -251,7 +440,7 @@ class FederatingExecutor : public ExecutorBase<ExecutorValue> {
         elements->reserve(value_pb.struct_().element_size());
         for (const auto& element_pb : value_pb.struct_().element()) {
           elements->emplace_back(
-              TFF_TRY(CreateExecutorValue(element_pb.value())));
+              TFF_TRY(ExecutorValueFromProto(element_pb.value())));
         }
         return ExecutorValue::CreateStructure(std::move(elements));
       }
@@ -264,14 +453,58 @@ class FederatingExecutor : public ExecutorBase<ExecutorValue> {
       }
         TF_FALLTHROUGH_INTENDED;
       default: {
+        // Only computations (such as a `select_fn`) are fingerprinted, as
+        // they are small and unplaced tensors are never sliced by.
+        std::shared_ptr<const std::string> fingerprint = nullptr;
+        if (value_pb.has_computation()) {
+          fingerprint = FingerprintIfCaching(value_pb);
+        }
         return ExecutorValue::CreateUnplaced(
-            ShareValueId(TFF_TRY(child_->CreateValue(value_pb))));
+            ShareValueId(TFF_TRY(child_->CreateValue(value_pb))),
+            std::move(fingerprint));
       }
     }
   }
 
-  absl::StatusOr<ExecutorValue> CreateCall(
-      ExecutorValue function, absl::optional<ExecutorValue> argument) final {
+  absl::StatusOr<ValueFuture> CreateCall(
+      ValueFuture function, absl::optional<ValueFuture> argument) final {
+    bool blocking = IsBlockingIntrinsic(function);
+    auto call = [this, this_keepalive = shared_from_this()](
+                    ExecutorValue fn, absl::optional<ExecutorValue> arg)
+        -> absl::StatusOr<ExecutorValue> {
+      return CallValue(std::move(fn), std::move(arg));
+    };
+    if (blocking) {
+      return MapCallAsync(std::move(function), std::move(argument),
+                          std::move(call));
+    }
+    return MapCall(std::move(function), std::move(argument), std::move(call));
+  }
+
+  // Returns whether `function` is already known to be an intrinsic whose call
+  // blocks on materializing values in `child_`, and so must not run on the
+  // calling thread even if its argument is ready.
+  static bool IsBlockingIntrinsic(const ValueFuture& function) {
+    if (!IsReady(function) || !function.get().ok()) {
+      return false;
+    }
+    const ExecutorValue& value = function.get().value();
+    if (value.type() != ExecutorValue::ValueType::INTRINSIC) {
+      return false;
+    }
+    switch (value.intrinsic()) {
+      case FederatedIntrinsic::SELECT:
+      case FederatedIntrinsic::SUM:
+      case FederatedIntrinsic::MEAN:
+      case FederatedIntrinsic::WEIGHTED_MEAN:
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  absl::StatusOr<ExecutorValue> CallValue(
+      ExecutorValue function, absl::optional<ExecutorValue> argument) {
     switch (function.type()) {
       case ExecutorValue::ValueType::CLIENTS:
       case ExecutorValue::ValueType::SERVER: {
@@ -338,7 +571,7 @@ class FederatingExecutor : public ExecutorBase<ExecutorValue> {
       const ExecutorValue& arg, uint32_t client_index) {
     switch (arg.type()) {
       case ExecutorValue::ValueType::CLIENTS: {
-        return (*arg.clients())[client_index];
+        return arg.client(client_index);
       }
       case ExecutorValue::ValueType::STRUCTURE: {
         std::vector<std::shared_ptr<OwnedValueId>> owned_element_ids;
@@ -385,6 +618,33 @@ class FederatingExecutor : public ExecutorBase<ExecutorValue> {
         }
         return ExecutorValue::CreateClientsPlaced(std::move(client_values));
       }
+      case FederatedIntrinsic::SUM: {
+        TFF_TRY(arg.CheckArgumentType(ExecutorValue::ValueType::CLIENTS,
+                                      "`federated_sum`'s `value`"));
+        TensorAccumulator accumulator =
+            TFF_TRY(AccumulateClients(arg, absl::nullopt));
+        return CreateServerPlacedFromProto(TFF_TRY(accumulator.Sum()));
+      }
+      case FederatedIntrinsic::MEAN: {
+        TFF_TRY(arg.CheckArgumentType(ExecutorValue::ValueType::CLIENTS,
+                                      "`federated_mean`'s `value`"));
+        TensorAccumulator accumulator =
+            TFF_TRY(AccumulateClients(arg, absl::nullopt));
+        return CreateServerPlacedFromProto(TFF_TRY(accumulator.Mean()));
+      }
+      case FederatedIntrinsic::WEIGHTED_MEAN: {
+        TFF_TRY(CheckLenForUseAsArgument(arg, "federated_weighted_mean", 2));
+        const auto& value = arg.structure()->at(0);
+        const auto& weight = arg.structure()->at(1);
+        TFF_TRY(value.CheckArgumentType(ExecutorValue::ValueType::CLIENTS,
+                                        "`federated_weighted_mean`'s `value`"));
+        TFF_TRY(weight.CheckArgumentType(
+            ExecutorValue::ValueType::CLIENTS,
+            "`federated_weighted_mean`'s `weight`"));
+        TensorAccumulator accumulator =
+            TFF_TRY(AccumulateClients(value, weight));
+        return CreateServerPlacedFromProto(TFF_TRY(accumulator.Mean()));
+      }
       case FederatedIntrinsic::AGGREGATE: {
         TFF_TRY(CheckLenForUseAsArgument(arg, "federated_aggregate", 5));
         const auto& value = arg.structure()->at(0);
@@ -392,22 +652,66 @@ class FederatingExecutor : public ExecutorBase<ExecutorValue> {
         auto zero_child_id = TFF_TRY(Embed(zero));
         const auto& accumulate = arg.structure()->at(2);
         auto accumulate_child_id = TFF_TRY(Embed(accumulate));
-        // `merge` is unused (argument four).
+        const auto& merge = arg.structure()->at(3);
         const auto& report = arg.structure()->at(4);
         auto report_child_id = TFF_TRY(Embed(report));
         TFF_TRY(value.CheckArgumentType(ExecutorValue::ValueType::CLIENTS,
                                         "`federated_aggregate`'s `value`"));
-        absl::optional<OwnedValueId> current_owner = absl::nullopt;
-        ValueId current = zero_child_id->ref();
-        for (const auto& client_val_id : *value.clients()) {
-          auto acc_arg =
-              TFF_TRY(child_->CreateStruct({current, client_val_id->ref()}));
-          current_owner =
-              TFF_TRY(child_->CreateCall(accumulate_child_id->ref(), acc_arg));
-          current = current_owner.value().ref();
+        uint32_t num_groups = std::max<uint32_t>(
+            1, std::min<uint32_t>(num_aggregation_groups_, num_clients_));
+        if (num_groups == 1) {
+          // `merge` is unused (argument four).
+          absl::optional<OwnedValueId> current_owner = absl::nullopt;
+          ValueId current = zero_child_id->ref();
+          for (uint32_t i = 0; i < num_clients_; i++) {
+            auto acc_arg = TFF_TRY(
+                child_->CreateStruct({current, value.client(i)->ref()}));
+            current_owner = TFF_TRY(
+                child_->CreateCall(accumulate_child_id->ref(), acc_arg));
+            current = current_owner.value().ref();
+          }
+          auto result =
+              TFF_TRY(child_->CreateCall(report_child_id->ref(), current));
+          return ExecutorValue::CreateServerPlaced(
+              ShareValueId(std::move(result)));
+        }
+        // Accumulate each group of clients from `zero`. The calls on the
+        // child return immediately, so the accumulations of the groups are
+        // independent chains which the child may run concurrently.
+        std::vector<OwnedValueId> partials;
+        partials.reserve(num_groups);
+        for (uint32_t group = 0; group < num_groups; group++) {
+          size_t begin = size_t{group} * num_clients_ / num_groups;
+          size_t end = size_t{group + 1} * num_clients_ / num_groups;
+          absl::optional<OwnedValueId> current_owner = absl::nullopt;
+          ValueId current = zero_child_id->ref();
+          for (size_t i = begin; i < end; i++) {
+            auto acc_arg = TFF_TRY(
+                child_->CreateStruct({current, value.client(i)->ref()}));
+            current_owner = TFF_TRY(
+                child_->CreateCall(accumulate_child_id->ref(), acc_arg));
+            current = current_owner.value().ref();
+          }
+          partials.push_back(std::move(current_owner.value()));
+        }
+        // Merge adjacent pairs of partial aggregates until one remains.
+        auto merge_child_id = TFF_TRY(Embed(merge));
+        while (partials.size() > 1) {
+          std::vector<OwnedValueId> merged;
+          merged.reserve((partials.size() + 1) / 2);
+          for (size_t i = 0; i + 1 < partials.size(); i += 2) {
+            auto merge_arg =
+                TFF_TRY(child_->CreateStruct({partials[i], partials[i + 1]}));
+            merged.push_back(
+                TFF_TRY(child_->CreateCall(merge_child_id->ref(), merge_arg)));
+          }
+          if (partials.size() % 2 == 1) {
+            merged.push_back(std::move(partials.back()));
+          }
+          partials = std::move(merged);
         }
         auto result =
-            TFF_TRY(child_->CreateCall(report_child_id->ref(), current));
+            TFF_TRY(child_->CreateCall(report_child_id->ref(), partials[0]));
         return ExecutorValue::CreateServerPlaced(
             ShareValueId(std::move(result)));
       }
@@ -416,20 +720,28 @@ class FederatingExecutor : public ExecutorBase<ExecutorValue> {
                                       "`federated_broadcast`"));
         return ClientsAllEqualValue(arg.server());
       }
-      case FederatedIntrinsic::MAP: {
+      case FederatedIntrinsic::MAP:
+      case FederatedIntrinsic::MAP_ALL_EQUAL: {
         TFF_TRY(CheckLenForUseAsArgument(arg, "federated_map", 2));
         const auto& fn = arg.structure()->at(0);
         auto child_fn = TFF_TRY(Embed(fn));
         ValueId child_fn_ref = child_fn->ref();
         const auto& data = arg.structure()->at(1);
         if (data.type() == ExecutorValue::ValueType::CLIENTS) {
-          Clients results = NewClients();
-          for (int i = 0; i < num_clients_; i++) {
-            auto client_arg = data.clients()->at(i)->ref();
-            auto result = TFF_TRY(child_->CreateCall(child_fn_ref, client_arg));
-            results->emplace_back(ShareValueId(std::move(result)));
+          if (data.all_equal() &&
+              function == FederatedIntrinsic::MAP_ALL_EQUAL) {
+            // `federated_map_all_equal` promises an all-equal result, so the
+            // function is applied to the shared value once for all clients.
+            return ClientsAllEqualValue(ShareValueId(TFF_TRY(
+                child_->CreateCall(child_fn_ref, data.client(0)->ref()))));
           }
-          return ExecutorValue::CreateClientsPlaced(std::move(results));
+          std::vector<ValueId> client_args;
+          client_args.reserve(num_clients_);
+          for (uint32_t i = 0; i < num_clients_; i++) {
+            client_args.push_back(data.client(i)->ref());
+          }
+          return ExecutorValue::CreateClientsPlaced(ShareValueIds(
+              TFF_TRY(child_->CreateCalls(child_fn_ref, client_args))));
         } else if (data.type() == ExecutorValue::ValueType::SERVER) {
           auto res =
               TFF_TRY(child_->CreateCall(child_fn_ref, data.server()->ref()));
@@ -448,19 +760,18 @@ class FederatingExecutor : public ExecutorBase<ExecutorValue> {
         const auto& select_fn = arg.structure()->at(3);
         TFF_TRY(keys.CheckArgumentType(ExecutorValue::ValueType::CLIENTS,
                                        "`federated_select`'s `keys`"));
-        const Clients& keys_child_ids = keys.clients();
         TFF_TRY(
             server_val.CheckArgumentType(ExecutorValue::ValueType::SERVER,
                                          "`federated_select`'s `server_val`"));
-        ValueId server_val_child_id = server_val.server()->ref();
         TFF_TRY(
             select_fn.CheckArgumentType(ExecutorValue::ValueType::UNPLACED,
                                         "`federated_select`'s `select_fn`"));
-        ValueId select_fn_child_id = select_fn.unplaced()->ref();
-        return CallFederatedSelect(keys_child_ids, server_val_child_id,
-                                   select_fn_child_id);
+        return CallFederatedSelect(keys, server_val, select_fn);
       }
       case FederatedIntrinsic::ZIP_AT_CLIENTS: {
+        if (IsAllEqualAtClients(arg)) {
+          return ClientsSharedValue(TFF_TRY(ZipStructIntoClient(arg, 0)));
+        }
         Clients results = NewClients();
         for (uint32_t i = 0; i < num_clients_; i++) {
           results->push_back(TFF_TRY(ZipStructIntoClient(arg, i)));
@@ -474,100 +785,221 @@ class FederatingExecutor : public ExecutorBase<ExecutorValue> {
     }
   }
 
-  // A container for information about the keys in a `federated_select` round.
-  struct KeyData {
-    // The values of every key in a `federated_select`.
-    // `all` contains the joined values of all `for_clients`.
-    absl::flat_hash_set<int32_t> all;
-    // The list of keys to slices requested for each client.
-    // e.g. Client N's keys can be found at `for_clients[N]`.
-    std::vector<std::vector<int32_t>> for_clients;
-  };
+  // Materializes the values of the clients concurrently and sums them in C++,
+  // weighted by the scalar `weights` of the clients if given. An all-equal
+  // value is materialized once and weighted by the number of clients.
+  absl::StatusOr<TensorAccumulator> AccumulateClients(
+      const ExecutorValue& value,
+      const absl::optional<ExecutorValue>& weights) {
+    TensorAccumulator accumulator;
+    if (value.all_equal() &&
+        (!weights.has_value() || weights.value().all_equal())) {
+      double weight = 1.0;
+      if (weights.has_value()) {
+        weight = TFF_TRY(DeserializeScalarWeight(
+            TFF_TRY(child_->Materialize(weights.value().client(0)->ref()))));
+      }
+      TFF_TRY(accumulator.Add(
+          TFF_TRY(child_->Materialize(value.client(0)->ref())),
+          weight * num_clients_));
+      return accumulator;
+    }
+    absl::Mutex mutex;
+    ParallelTasks tasks;
+    for (uint32_t i = 0; i < num_clients_; i++) {
+      tasks.add_task([&, i]() -> absl::Status {
+        double weight = 1.0;
+        if (weights.has_value()) {
+          weight = TFF_TRY(DeserializeScalarWeight(
+              TFF_TRY(child_->Materialize(weights.value().client(i)->ref()))));
+        }
+        v0::Value client_value =
+            TFF_TRY(child_->Materialize(value.client(i)->ref()));
+        absl::MutexLock lock(&mutex);
+        return accumulator.Add(client_value, weight);
+      });
+    }
+    TFF_TRY(tasks.WaitAll());
+    return accumulator;
+  }
+
+  absl::StatusOr<ExecutorValue> CreateServerPlacedFromProto(
+      const v0::Value& value_pb) {
+    return ExecutorValue::CreateServerPlaced(
+        ShareValueId(TFF_TRY(child_->CreateValue(value_pb))));
+  }
 
+  // Materializes the keys of every client concurrently. The slice for each
+  // key is requested from `child_` as soon as the key is first seen, so that
+  // slices are computed while the keys of other clients are still being
+  // materialized. Slices cached by earlier calls with the same `server_val`
+  // and `select_fn` are reused rather than computed again.
   absl::StatusOr<ExecutorValue> CallFederatedSelect(
-      const Clients& keys_child_ids, ValueId server_val_child_id,
-      ValueId select_fn_child_id) {
-    KeyData keys = TFF_TRY(MaterializeKeys(keys_child_ids));
-    absl::flat_hash_map<int32_t, OwnedValueId> slice_for_key;
-    slice_for_key.reserve(keys.all.size());
-    for (int32_t key : keys.all) {
-      slice_for_key.insert(
-          {key, TFF_TRY(SelectSliceForKey(key, server_val_child_id,
-                                          select_fn_child_id))});
+      const ExecutorValue& keys_value, const ExecutorValue& server_val,
+      const ExecutorValue& select_fn) {
+    ValueId server_val_child_id = server_val.server()->ref();
+    ValueId select_fn_child_id = select_fn.unplaced()->ref();
+    std::string cache_scope;
+    if (slice_cache_ != nullptr) {
+      cache_scope =
+          absl::StrCat(SliceScopeOf(server_val), "/", SliceScopeOf(select_fn));
+    }
+    // If the keys are all-equal, `keys_child_ids` holds the keys of every
+    // client once.
+    const Clients& keys_child_ids = keys_value.clients();
+    std::vector<std::vector<int32_t>> keys_for_clients(keys_child_ids->size());
+    absl::Mutex mutex;
+    // Both guarded by `mutex`.
+    absl::flat_hash_set<int32_t> requested_keys;
+    absl::flat_hash_map<int32_t, std::shared_ptr<OwnedValueId>> slice_for_key;
+    ParallelTasks tasks;
+    for (size_t i = 0; i < keys_child_ids->size(); i++) {
+      tasks.add_task([&, i]() -> absl::Status {
+        keys_for_clients[i] =
+            TFF_TRY(MaterializeKeys(keys_child_ids->at(i)->ref()));
+        std::vector<int32_t> new_keys;
+        {
+          absl::MutexLock lock(&mutex);
+          for (int32_t key : keys_for_clients[i]) {
+            if (requested_keys.insert(key).second) {
+              new_keys.push_back(key);
+            }
+          }
+        }
+        std::vector<int32_t> uncached_keys;
+        std::vector<std::shared_ptr<OwnedValueId>> cached_slices;
+        for (int32_t key : new_keys) {
+          std::shared_ptr<OwnedValueId> slice = nullptr;
+          if (slice_cache_ != nullptr) {
+            slice = slice_cache_->Lookup(cache_scope, key);
+          }
+          if (slice == nullptr) {
+            uncached_keys.push_back(key);
+          }
+          cached_slices.push_back(std::move(slice));
+        }
+        std::vector<OwnedValueId> slices;
+        if (!uncached_keys.empty()) {
+          slices = TFF_TRY(SelectSlicesForKeys(
+              uncached_keys, server_val_child_id, select_fn_child_id));
+        }
+        absl::MutexLock lock(&mutex);
+        size_t next_slice = 0;
+        for (size_t j = 0; j < new_keys.size(); j++) {
+          std::shared_ptr<OwnedValueId> slice = std::move(cached_slices[j]);
+          if (slice == nullptr) {
+            slice = ShareValueId(std::move(slices[next_slice++]));
+            if (slice_cache_ != nullptr) {
+              slice_cache_->Insert(cache_scope, new_keys[j], slice);
+            }
+          }
+          slice_for_key.emplace(new_keys[j], std::move(slice));
+        }
+        return absl::OkStatus();
+      });
     }
+    TFF_TRY(tasks.WaitAll());
     v0::Value args_into_sequence_pb;
     args_into_sequence_pb.mutable_computation()->mutable_intrinsic()->set_uri(
         "args_into_sequence");
     OwnedValueId args_into_sequence_id =
         TFF_TRY(child_->CreateValue(args_into_sequence_pb));
-    Clients client_datasets = NewClients();
-    for (const auto& keys_for_client : keys.for_clients) {
+    std::vector<OwnedValueId> slices_for_clients;
+    std::vector<ValueId> slices_for_clients_refs;
+    slices_for_clients.reserve(keys_for_clients.size());
+    slices_for_clients_refs.reserve(keys_for_clients.size());
+    absl::MutexLock lock(&mutex);
+    for (const auto& keys_for_client : keys_for_clients) {
       std::vector<ValueId> slice_ids_for_client;
       slice_ids_for_client.reserve(keys_for_client.size());
       for (int32_t key : keys_for_client) {
-        slice_ids_for_client.push_back(slice_for_key.at(key).ref());
-      }
-      OwnedValueId slices = TFF_TRY(child_->CreateStruct(slice_ids_for_client));
-      OwnedValueId dataset =
-          TFF_TRY(child_->CreateCall(args_into_sequence_id, slices));
-      client_datasets->push_back(ShareValueId(std::move(dataset)));
-    }
-    return ExecutorValue::CreateClientsPlaced(std::move(client_datasets));
-  }
-
-  absl::StatusOr<KeyData> MaterializeKeys(const Clients& keys_child_ids) {
-    KeyData keys;
-    keys.for_clients.reserve(keys_child_ids->size());
-    for (const auto& keys_child_id : *keys_child_ids) {
-      // TODO(b/209504748) Make federating_executor value a future so that these
-      // materialize calls don't block.
-      v0::Value keys_for_client_pb =
-          TFF_TRY(child_->Materialize(keys_child_id->ref()));
-      tensorflow::Tensor keys_for_client_tensor =
-          TFF_TRY(DeserializeTensorValue(keys_for_client_pb));
-      if (keys_for_client_tensor.dtype() != tensorflow::DT_INT32) {
-        return absl::InvalidArgumentError(
-            absl::StrCat("Expected int32_t key, found key of tensor dtype ",
-                         keys_for_client_tensor.dtype()));
-      }
-      if (keys_for_client_tensor.dims() != 1) {
-        return absl::InvalidArgumentError(absl::StrCat(
-            "Expected key tensor to be rank one, but found tensor of rank ",
-            keys_for_client_tensor.dims()));
+        slice_ids_for_client.push_back(slice_for_key.at(key)->ref());
       }
-      int64_t num_keys = keys_for_client_tensor.NumElements();
-      std::vector<int32_t> keys_for_client;
-      keys_for_client.reserve(num_keys);
-      auto keys_for_client_eigen = keys_for_client_tensor.flat<int32_t>();
-      for (int64_t i = 0; i < num_keys; i++) {
-        int32_t key = keys_for_client_eigen(i);
-        keys_for_client.push_back(key);
-        keys.all.insert(key);
-      }
-      keys.for_clients.push_back(std::move(keys_for_client));
+      slices_for_clients.push_back(
+          TFF_TRY(child_->CreateStruct(slice_ids_for_client)));
+      slices_for_clients_refs.push_back(slices_for_clients.back().ref());
+    }
+    std::vector<OwnedValueId> sequences = TFF_TRY(
+        child_->CreateCalls(args_into_sequence_id, slices_for_clients_refs));
+    if (keys_value.all_equal()) {
+      return ClientsSharedValue(ShareValueId(std::move(sequences[0])));
+    }
+    return ExecutorValue::CreateClientsPlaced(
+        ShareValueIds(std::move(sequences)));
+  }
+
+  // Materializes the keys of a single client.
+  absl::StatusOr<std::vector<int32_t>> MaterializeKeys(ValueId keys_child_id) {
+    v0::Value keys_for_client_pb = TFF_TRY(child_->Materialize(keys_child_id));
+    tensorflow::Tensor keys_for_client_tensor =
+        TFF_TRY(DeserializeTensorValue(keys_for_client_pb));
+    if (keys_for_client_tensor.dtype() != tensorflow::DT_INT32) {
+      return absl::InvalidArgumentError(
+          absl::StrCat("Expected int32_t key, found key of tensor dtype ",
+                       keys_for_client_tensor.dtype()));
     }
-    return keys;
+    if (keys_for_client_tensor.dims() != 1) {
+      return absl::InvalidArgumentError(absl::StrCat(
+          "Expected key tensor to be rank one, but found tensor of rank ",
+          keys_for_client_tensor.dims()));
+    }
+    int64_t num_keys = keys_for_client_tensor.NumElements();
+    std::vector<int32_t> keys_for_client;
+    keys_for_client.reserve(num_keys);
+    auto keys_for_client_eigen = keys_for_client_tensor.flat<int32_t>();
+    for (int64_t i = 0; i < num_keys; i++) {
+      keys_for_client.push_back(keys_for_client_eigen(i));
+    }
+    return keys_for_client;
+  }
+
+  // Returns the slices of the server value for `keys`, in the same order.
+  absl::StatusOr<std::vector<OwnedValueId>> SelectSlicesForKeys(
+      absl::Span<const int32_t> keys, ValueId server_val_child_id,
+      ValueId select_fn_child_id) {
+    std::vector<v0::Value> keys_pb(keys.size());
+    std::vector<const v0::Value*> key_pb_ptrs;
+    key_pb_ptrs.reserve(keys.size());
+    for (size_t i = 0; i < keys.size(); i++) {
+      TFF_TRY(SerializeTensorValue(tensorflow::Tensor(keys[i]), &keys_pb[i]));
+      key_pb_ptrs.push_back(&keys_pb[i]);
+    }
+    std::vector<OwnedValueId> key_ids =
+        TFF_TRY(child_->CreateValues(key_pb_ptrs));
+    std::vector<OwnedValueId> arg_ids;
+    std::vector<ValueId> arg_refs;
+    arg_ids.reserve(key_ids.size());
+    arg_refs.reserve(key_ids.size());
+    for (const OwnedValueId& key_id : key_ids) {
+      arg_ids.push_back(
+          TFF_TRY(child_->CreateStruct({server_val_child_id, key_id})));
+      arg_refs.push_back(arg_ids.back().ref());
+    }
+    return child_->CreateCalls(select_fn_child_id, arg_refs);
   }
 
-  absl::StatusOr<OwnedValueId> SelectSliceForKey(int32_t key,
-                                                 ValueId server_val_child_id,
-                                                 ValueId select_fn_child_id) {
-    v0::Value key_pb;
-    TFF_TRY(SerializeTensorValue(tensorflow::Tensor(key), &key_pb));
-    OwnedValueId key_id = TFF_TRY(child_->CreateValue(key_pb));
-    OwnedValueId arg_id =
-        TFF_TRY(child_->CreateStruct({server_val_child_id, key_id}));
-    return TFF_TRY(child_->CreateCall(select_fn_child_id, arg_id));
+  absl::StatusOr<ValueFuture> CreateStruct(
+      std::vector<ValueFuture> members) final {
+    return Map(
+        std::move(members),
+        [](std::vector<ExecutorValue>&& members)
+            -> absl::StatusOr<ExecutorValue> {
+          return ExecutorValue::CreateStructure(
+              std::make_shared<std::vector<ExecutorValue>>(std::move(members)));
+        });
   }
 
-  absl::StatusOr<ExecutorValue> CreateStruct(
-      std::vector<ExecutorValue> members) final {
-    return ExecutorValue::CreateStructure(
-        std::make_shared<std::vector<ExecutorValue>>(std::move(members)));
+  absl::StatusOr<ValueFuture> CreateSelection(ValueFuture value,
+                                              const uint32_t index) final {
+    return Map(std::vector<ValueFuture>({std::move(value)}),
+               [this, this_keepalive = shared_from_this(),
+                index](std::vector<ExecutorValue>&& values) {
+                 return SelectFromValue(values[0], index);
+               });
   }
 
-  absl::StatusOr<ExecutorValue> CreateSelection(ExecutorValue value,
-                                                const uint32_t index) final {
+  absl::StatusOr<ExecutorValue> SelectFromValue(const ExecutorValue& value,
+                                                const uint32_t index) {
     switch (value.type()) {
       case ExecutorValue::ValueType::CLIENTS:
       case ExecutorValue::ValueType::SERVER: {
@@ -592,6 +1024,25 @@ class FederatingExecutor : public ExecutorBase<ExecutorValue> {
     }
   }
 
+  absl::StatusOr<std::vector<ValueFuture>> CreateSelections(
+      ValueFuture value, absl::Span<const uint32_t> indices) final {
+    if (!IsReady(value) || !value.get().ok() ||
+        value.get()->type() != ExecutorValue::ValueType::UNPLACED) {
+      return ExecutorBase::CreateSelections(std::move(value), indices);
+    }
+    // Unplaced values live in the child executor: select all of the elements
+    // with a single batched call.
+    std::vector<OwnedValueId> child_ids = TFF_TRY(
+        child_->CreateSelections(value.get()->unplaced()->ref(), indices));
+    std::vector<ValueFuture> results;
+    results.reserve(child_ids.size());
+    for (OwnedValueId& child_id : child_ids) {
+      results.push_back(ReadyFuture(
+          ExecutorValue::CreateUnplaced(ShareValueId(std::move(child_id)))));
+    }
+    return results;
+  }
+
   void CreateChildMaterializeTask(ValueId id, v0::Value* value_pb,
                                   ParallelTasks& tasks) {
     tasks.add_task([child = child_, id, value_pb]() {
@@ -606,12 +1057,30 @@ class FederatingExecutor : public ExecutorBase<ExecutorValue> {
       case ExecutorValue::ValueType::CLIENTS: {
         v0::Value_Federated* federated_pb = value_pb->mutable_federated();
         v0::FederatedType* type_pb = federated_pb->mutable_type();
-        // All-equal-ness is not stored, so must be assumed to be false.
-        // If the Python type system expects the value to be all-equal, it can
-        // simply extract the first element in the list.
-        type_pb->set_all_equal(false);
+        // A value of all-equal type materializes as its single value.
+        type_pb->set_all_equal(value.all_equal_type());
         type_pb->mutable_placement()->mutable_value()->mutable_uri()->assign(
             kClientsUri.data(), kClientsUri.size());
+        if (value.all_equal() && !value.all_equal_type()) {
+          // The value shared by the clients is materialized once, and copied
+          // to every client.
+          std::vector<v0::Value*> client_pbs;
+          client_pbs.reserve(num_clients_);
+          for (uint32_t i = 0; i < num_clients_; i++) {
+            client_pbs.push_back(federated_pb->add_value());
+          }
+          if (!client_pbs.empty()) {
+            tasks.add_task([child = child_, id = value.client(0)->ref(),
+                            client_pbs]() -> absl::Status {
+              TFF_TRY(child->Materialize(id, client_pbs[0]));
+              for (size_t i = 1; i < client_pbs.size(); i++) {
+                *client_pbs[i] = *client_pbs[0];
+              }
+              return absl::OkStatus();
+            });
+          }
+          return absl::OkStatus();
+        }
         for (const auto& client_value : *value.clients()) {
           CreateChildMaterializeTask(client_value->ref(),
                                      federated_pb->add_value(), tasks);
@@ -651,7 +1120,8 @@ class FederatingExecutor : public ExecutorBase<ExecutorValue> {
     }
   }
 
-  absl::Status Materialize(ExecutorValue value, v0::Value* value_pb) {
+  absl::Status Materialize(ValueFuture value_fut, v0::Value* value_pb) final {
+    ExecutorValue value = TFF_TRY(Wait(std::move(value_fut)));
     ParallelTasks tasks;
     TFF_TRY(CreateMaterializeTasks(value, value_pb, tasks));
     TFF_TRY(tasks.WaitAll());
@@ -662,9 +1132,16 @@ class FederatingExecutor : public ExecutorBase<ExecutorValue> {
 }  // namespace
 
 absl::StatusOr<std::shared_ptr<Executor>> CreateFederatingExecutor(
-    std::shared_ptr<Executor> child, const CardinalityMap& cardinalities) {
+    std::shared_ptr<Executor> child, const CardinalityMap& cardinalities,
+    int32_t num_aggregation_groups, size_t select_slice_cache_size) {
   int num_clients = TFF_TRY(NumClientsFromCardinalities(cardinalities));
-  return std::make_shared<FederatingExecutor>(std::move(child), num_clients);
+  if (num_aggregation_groups <= 0) {
+    num_aggregation_groups =
+        std::max<int32_t>(1, std::thread::hardware_concurrency());
+  }
+  return std::make_shared<FederatingExecutor>(std::move(child), num_clients,
+                                              num_aggregation_groups,
+                                              select_slice_cache_size);
 }
 
 }  // namespace tensorflow_federated
@@ -16,6 +16,8 @@ limitations under the License
 #ifndef THIRD_PARTY_TENSORFLOW_FEDERATED_CC_CORE_IMPL_EXECUTORS_FEDERATING_EXECUTOR_H_
 #define THIRD_PARTY_TENSORFLOW_FEDERATED_CC_CORE_IMPL_EXECUTORS_FEDERATING_EXECUTOR_H_
 
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 
 #include "absl/status/statusor.h"
@@ -25,8 +27,24 @@ limitations under the License
 namespace tensorflow_federated {
 
 // Returns an executor that can resolve federated values and intrinsics.
+//
+// `federated_aggregate` splits the clients into `num_aggregation_groups`
+// groups of adjacent clients, accumulates the values of each group from `zero`
+// independently of the others, and combines the partial aggregates with
+// `merge` as a balanced binary tree, so that the `child` executor can run the
+// accumulations of different groups concurrently. A non-positive
+// `num_aggregation_groups` uses one group per core. With a single group, the
+// values of all clients are accumulated in sequence and `merge` is unused.
+//
+// If `select_slice_cache_size` is positive, up to that many of the slices
+// computed by `federated_select` are kept and reused by later calls, including
+// in later rounds, whose `server_val` and `select_fn` are the same values or
+// were created from equal protos. Only the slices for keys which are not
+// cached are computed. Enabling the cache fingerprints every server-placed
+// value and every computation created by the executor.
 absl::StatusOr<std::shared_ptr<Executor>> CreateFederatingExecutor(
-    std::shared_ptr<Executor> child, const CardinalityMap& cardinalities);
+    std::shared_ptr<Executor> child, const CardinalityMap& cardinalities,
+    int32_t num_aggregation_groups = 1, size_t select_slice_cache_size = 0);
 
 }  // namespace tensorflow_federated
 
@@ -0,0 +1,181 @@
+/* Copyright 2022, The TensorFlow Federated Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+// Compares summing float tensors across clients with the native
+// `federated_sum` of a `FederatingExecutor` against the same sum computed by
+// `federated_aggregate` with TensorFlow `accumulate` and `merge` functions.
+// Both run over a `TensorFlowExecutor`; the first argument of each benchmark is
+// the number of clients and the second the number of elements of each client's
+// tensor.
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "benchmark/benchmark.h"
+#include "absl/strings/string_view.h"
+#include "tensorflow/cc/framework/ops.h"
+#include "tensorflow/cc/framework/scope.h"
+#include "tensorflow/cc/ops/array_ops.h"
+#include "tensorflow/cc/ops/math_ops.h"
+#include "tensorflow/core/framework/graph.pb.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.pb.h"
+#include "tensorflow_federated/cc/core/impl/executors/cardinalities.h"
+#include "tensorflow_federated/cc/core/impl/executors/executor.h"
+#include "tensorflow_federated/cc/core/impl/executors/federated_intrinsics.h"
+#include "tensorflow_federated/cc/core/impl/executors/federating_executor.h"
+#include "tensorflow_federated/cc/core/impl/executors/tensor_serialization.h"
+#include "tensorflow_federated/cc/core/impl/executors/tensorflow_executor.h"
+#include "tensorflow_federated/proto/v0/computation.pb.h"
+#include "tensorflow_federated/proto/v0/executor.pb.h"
+
+namespace tensorflow_federated {
+
+namespace {
+
+v0::Value FloatTensor(int64_t num_elements, float fill) {
+  tensorflow::Tensor tensor(tensorflow::DT_FLOAT,
+                            tensorflow::TensorShape({num_elements}));
+  tensor.flat<float>().setConstant(fill);
+  v0::Value value_pb;
+  CHECK(SerializeTensorValue(tensor, &value_pb).ok());
+  return value_pb;
+}
+
+v0::Value AtClients(int64_t num_clients, const v0::Value& member) {
+  v0::Value value_pb;
+  v0::FederatedType* type_pb = value_pb.mutable_federated()->mutable_type();
+  type_pb->set_all_equal(false);
+  *type_pb->mutable_placement()->mutable_value()->mutable_uri() =
+      std::string(kClientsUri);
+  for (int64_t i = 0; i < num_clients; i++) {
+    *value_pb.mutable_federated()->add_value() = member;
+  }
+  return value_pb;
+}
+
+v0::Value Intrinsic(absl::string_view uri) {
+  v0::Value value_pb;
+  value_pb.mutable_computation()->mutable_intrinsic()->mutable_uri()->assign(
+      uri.data(), uri.size());
+  return value_pb;
+}
+
+v0::TensorFlow::Binding TensorBinding(const tensorflow::Output& output) {
+  v0::TensorFlow::Binding binding;
+  *binding.mutable_tensor()->mutable_tensor_name() = output.node()->name();
+  return binding;
+}
+
+v0::Value TensorFlowComputation(v0::TensorFlow::Binding parameter,
+                                v0::TensorFlow::Binding result,
+                                const tensorflow::Scope& scope) {
+  v0::Value value_pb;
+  v0::TensorFlow* tensorflow_pb =
+      value_pb.mutable_computation()->mutable_tensorflow();
+  tensorflow::GraphDef graphdef_pb;
+  CHECK(scope.ToGraphDef(&graphdef_pb).ok());
+  tensorflow_pb->mutable_graph_def()->PackFrom(graphdef_pb);
+  *tensorflow_pb->mutable_parameter() = std::move(parameter);
+  *tensorflow_pb->mutable_result() = std::move(result);
+  return value_pb;
+}
+
+// `(x, y) -> x + y` over float tensors, used both to accumulate and to merge.
+v0::Value AddComputation() {
+  tensorflow::Scope root = tensorflow::Scope::NewRootScope();
+  tensorflow::ops::Placeholder x(root, tensorflow::DT_FLOAT);
+  tensorflow::ops::Placeholder y(root, tensorflow::DT_FLOAT);
+  tensorflow::ops::AddV2 sum(root, x, y);
+  v0::TensorFlow::Binding parameter;
+  *parameter.mutable_struct_()->add_element() = TensorBinding(x);
+  *parameter.mutable_struct_()->add_element() = TensorBinding(y);
+  return TensorFlowComputation(std::move(parameter), TensorBinding(sum), root);
+}
+
+v0::Value IdentityComputation() {
+  tensorflow::Scope root = tensorflow::Scope::NewRootScope();
+  tensorflow::ops::Placeholder x(root, tensorflow::DT_FLOAT);
+  tensorflow::ops::Identity identity(root, x);
+  return TensorFlowComputation(TensorBinding(x), TensorBinding(identity),
+                               root);
+}
+
+std::shared_ptr<Executor> CreateExecutor(int num_clients) {
+  return CreateFederatingExecutor(CreateTensorFlowExecutor(),
+                                  {{"clients", num_clients}})
+      .value();
+}
+
+void BM_FederatedSumNative(benchmark::State& state) {
+  std::shared_ptr<Executor> executor = CreateExecutor(state.range(0));
+  OwnedValueId value =
+      executor
+          ->CreateValue(
+              AtClients(state.range(0), FloatTensor(state.range(1), 1)))
+          .value();
+  OwnedValueId sum =
+      executor->CreateValue(Intrinsic(kFederatedSumUri)).value();
+  for (auto _ : state) {
+    OwnedValueId result = executor->CreateCall(sum, value).value();
+    benchmark::DoNotOptimize(executor->Materialize(result).value());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0) *
+                          state.range(1));
+}
+BENCHMARK(BM_FederatedSumNative)
+    ->ArgPair(10, 1 << 10)
+    ->ArgPair(10, 1 << 20)
+    ->ArgPair(100, 1 << 10)
+    ->ArgPair(100, 1 << 16)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+void BM_FederatedSumViaAggregate(benchmark::State& state) {
+  std::shared_ptr<Executor> executor = CreateExecutor(state.range(0));
+  OwnedValueId value =
+      executor
+          ->CreateValue(
+              AtClients(state.range(0), FloatTensor(state.range(1), 1)))
+          .value();
+  OwnedValueId zero =
+      executor->CreateValue(FloatTensor(state.range(1), 0)).value();
+  OwnedValueId add = executor->CreateValue(AddComputation()).value();
+  OwnedValueId report = executor->CreateValue(IdentityComputation()).value();
+  OwnedValueId aggregate =
+      executor->CreateValue(Intrinsic(kFederatedAggregateUri)).value();
+  OwnedValueId arg =
+      executor->CreateStruct({value, zero, add, add, report}).value();
+  for (auto _ : state) {
+    OwnedValueId result = executor->CreateCall(aggregate, arg).value();
+    benchmark::DoNotOptimize(executor->Materialize(result).value());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0) *
+                          state.range(1));
+}
+BENCHMARK(BM_FederatedSumViaAggregate)
+    ->ArgPair(10, 1 << 10)
+    ->ArgPair(10, 1 << 20)
+    ->ArgPair(100, 1 << 10)
+    ->ArgPair(100, 1 << 16)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+}  // namespace
+
+}  // namespace tensorflow_federated
@@ -23,12 +23,14 @@ limitations under the License
 #include "googlemock/include/gmock/gmock.h"
 #include "googletest/include/gtest/gtest.h"
 #include "absl/status/status.h"
+#include "absl/synchronization/notification.h"
 #include "absl/types/optional.h"
 #include "absl/types/span.h"
 #include "tensorflow_federated/cc/core/impl/executors/executor.h"
 #include "tensorflow_federated/cc/core/impl/executors/executor_test_base.h"
 #include "tensorflow_federated/cc/core/impl/executors/mock_executor.h"
 #include "tensorflow_federated/cc/core/impl/executors/status_matchers.h"
+#include "tensorflow_federated/cc/core/impl/executors/thread_pool.h"
 #include "tensorflow_federated/cc/core/impl/executors/value_test_utils.h"
 #include "tensorflow_federated/proto/v0/executor.pb.h"
 
@@ -51,9 +53,12 @@ using ::tensorflow_federated::testing::intrinsic::FederatedEvalAtClientsV;
 using ::tensorflow_federated::testing::intrinsic::FederatedEvalAtServerV;
 using ::tensorflow_federated::testing::intrinsic::FederatedMapAllEqualV;
 using ::tensorflow_federated::testing::intrinsic::FederatedMapV;
+using ::tensorflow_federated::testing::intrinsic::FederatedMeanV;
 using ::tensorflow_federated::testing::intrinsic::FederatedSelectV;
+using ::tensorflow_federated::testing::intrinsic::FederatedSumV;
 using ::tensorflow_federated::testing::intrinsic::FederatedValueAtClientsV;
 using ::tensorflow_federated::testing::intrinsic::FederatedValueAtServerV;
+using ::tensorflow_federated::testing::intrinsic::FederatedWeightedMeanV;
 using ::tensorflow_federated::testing::intrinsic::FederatedZipAtClientsV;
 using ::tensorflow_federated::testing::intrinsic::FederatedZipAtServerV;
 using ::testing::Cardinality;
@@ -76,7 +81,15 @@ class FederatingExecutorTest : public ExecutorTestBase {
     Initialize();
   }
 
-  ~FederatingExecutorTest() override {}
+  void TearDown() override {
+    // Calls run asynchronously, so a task of the pool may keep the executor
+    // (and so the mock's values) alive after the test's last materialization.
+    // Let the mock verify its disposals only once those tasks have finished.
+    test_executor_.reset();
+    ThreadPool::Global().WaitUntilIdle();
+    EXPECT_EQ(mock_executor_.use_count(), 1)
+        << "The mock executor is still referenced after the test.";
+  }
 
   void Initialize() {
     TFF_ASSERT_OK_AND_ASSIGN(test_executor_,
@@ -189,10 +202,8 @@ TEST_F(FederatingExecutorTest, CreateMaterializeAtClientsAllEqual) {
   TFF_ASSERT_OK_AND_ASSIGN(
       auto id, test_executor_->CreateValue(ClientsV({tensor_in}, true)));
   v0::Value tensor_out = TensorV(2.0);
-  ExpectMaterializeInChild(child_id, tensor_out, ONCE_PER_CLIENT);
-  v0::Value clients_out =
-      ClientsV(std::vector<v0::Value>(NUM_CLIENTS, tensor_out), false);
-  ExpectMaterialize(id, clients_out);
+  ExpectMaterializeInChild(child_id, tensor_out);
+  ExpectMaterialize(id, ClientsV({tensor_out}, true));
 }
 
 TEST_F(FederatingExecutorTest, CreateValueFailsMultipleAllEqualValues) {
@@ -258,6 +269,90 @@ TEST_F(FederatingExecutorTest, CreateSelectionFromEmbeddedValue) {
   ExpectMaterialize(id, selected_tensor);
 }
 
+TEST_F(FederatingExecutorTest, CreateValuesCreatesEachValue) {
+  v0::Value tensor_v1 = TensorV(1);
+  v0::Value tensor_v2 = TensorV(2);
+  ExpectCreateMaterializeInChild(tensor_v1);
+  ExpectCreateMaterializeInChild(tensor_v2);
+  TFF_ASSERT_OK_AND_ASSIGN(std::vector<OwnedValueId> ids,
+                           test_executor_->CreateValues({&tensor_v1,
+                                                         &tensor_v2}));
+  ASSERT_EQ(ids.size(), 2);
+  ExpectMaterialize(ids[0], tensor_v1);
+  ExpectMaterialize(ids[1], tensor_v2);
+}
+
+TEST_F(FederatingExecutorTest, CreateCallsCallsFunctionOnEachArgument) {
+  v0::Value fn = TensorV(1);
+  v0::Value arg_1 = TensorV(2);
+  v0::Value arg_2 = TensorV(3);
+  v0::Value result = TensorV(4);
+  TFF_ASSERT_OK_AND_ASSIGN(auto fn_pair, CreatePassthroughValue(fn));
+  TFF_ASSERT_OK_AND_ASSIGN(auto arg_1_pair, CreatePassthroughValue(arg_1));
+  TFF_ASSERT_OK_AND_ASSIGN(auto arg_2_pair, CreatePassthroughValue(arg_2));
+  ValueId child_result_1 =
+      ExpectCreateCallInChild(fn_pair.child_id, arg_1_pair.child_id);
+  ValueId child_result_2 =
+      ExpectCreateCallInChild(fn_pair.child_id, arg_2_pair.child_id);
+  ExpectMaterializeInChild(child_result_1, result);
+  ExpectMaterializeInChild(child_result_2, result);
+  TFF_ASSERT_OK_AND_ASSIGN(
+      std::vector<OwnedValueId> ids,
+      test_executor_->CreateCalls(fn_pair.id, {arg_1_pair.id, arg_2_pair.id}));
+  ASSERT_EQ(ids.size(), 2);
+  ExpectMaterialize(ids[0], result);
+  ExpectMaterialize(ids[1], result);
+}
+
+TEST_F(FederatingExecutorTest, CreateSelectionsFromStructure) {
+  v0::Value tensor_v1 = TensorV(1);
+  v0::Value tensor_v2 = TensorV(2);
+  ExpectCreateMaterializeInChild(tensor_v1);
+  ExpectCreateMaterializeInChild(tensor_v2);
+  TFF_ASSERT_OK_AND_ASSIGN(
+      auto s, test_executor_->CreateValue(StructV({tensor_v1, tensor_v2})));
+  TFF_ASSERT_OK_AND_ASSIGN(std::vector<OwnedValueId> ids,
+                           test_executor_->CreateSelections(s, {1, 0}));
+  ASSERT_EQ(ids.size(), 2);
+  ExpectMaterialize(ids[0], tensor_v2);
+  ExpectMaterialize(ids[1], tensor_v1);
+}
+
+TEST_F(FederatingExecutorTest, CreateSelectionsFromEmbeddedValue) {
+  v0::Value pretend_struct = TensorV(5);
+  v0::Value selected_tensor_0 = TensorV(24);
+  v0::Value selected_tensor_1 = TensorV(25);
+  ValueId child_id = ExpectCreateInChild(pretend_struct);
+  ValueId child_selected_id_0 =
+      mock_executor_->ExpectCreateSelection(child_id, 0);
+  ValueId child_selected_id_1 =
+      mock_executor_->ExpectCreateSelection(child_id, 1);
+  ExpectMaterializeInChild(child_selected_id_0, selected_tensor_0);
+  ExpectMaterializeInChild(child_selected_id_1, selected_tensor_1);
+  TFF_ASSERT_OK_AND_ASSIGN(auto s, test_executor_->CreateValue(pretend_struct));
+  TFF_ASSERT_OK_AND_ASSIGN(std::vector<OwnedValueId> ids,
+                           test_executor_->CreateSelections(s, {0, 1}));
+  ASSERT_EQ(ids.size(), 2);
+  ExpectMaterialize(ids[0], selected_tensor_0);
+  ExpectMaterialize(ids[1], selected_tensor_1);
+}
+
+TEST_F(FederatingExecutorTest, DisposeManyDisposesEachValue) {
+  TFF_ASSERT_OK_AND_ASSIGN(auto id_1,
+                           test_executor_->CreateValue(StructV({})));
+  TFF_ASSERT_OK_AND_ASSIGN(auto id_2,
+                           test_executor_->CreateValue(StructV({})));
+  ValueId unowned_id_1 = id_1.ref();
+  ValueId unowned_id_2 = id_2.ref();
+  id_1.forget();
+  id_2.forget();
+  TFF_EXPECT_OK(test_executor_->DisposeMany({unowned_id_1, unowned_id_2}));
+  EXPECT_THAT(test_executor_->Materialize(unowned_id_1),
+              StatusIs(StatusCode::kNotFound));
+  EXPECT_THAT(test_executor_->DisposeMany({unowned_id_2}),
+              StatusIs(StatusCode::kNotFound));
+}
+
 TEST_F(FederatingExecutorTest, CreateSelectionFromFederatedValueFails) {
   v0::Value struct_pb = StructV({TensorV(6)});
   v0::Value fed = ServerV(struct_pb);
@@ -376,6 +471,62 @@ TEST_F(FederatingExecutorTest, CreateCallFederatedAggregate) {
   ExpectMaterialize(result_id, ServerV(child_result));
 }
 
+TEST_F(FederatingExecutorTest, CreateCallFederatedAggregateInGroups) {
+  TFF_ASSERT_OK_AND_ASSIGN(
+      test_executor_,
+      tensorflow_federated::CreateFederatingExecutor(
+          mock_executor_, {{"clients", NUM_CLIENTS}},
+          /*num_aggregation_groups=*/3));
+  std::vector<v0::Value> client_vals;
+  std::vector<ValueId> client_vals_child_ids;
+  for (int i = 0; i < NUM_CLIENTS; i++) {
+    client_vals.emplace_back(TensorV(i));
+    client_vals_child_ids.emplace_back(ExpectCreateInChild(TensorV(i)));
+  }
+  v0::Value value = ClientsV(client_vals);
+  v0::Value zero = TensorV("zero");
+  ValueId zero_child_id = ExpectCreateInChild(zero);
+  v0::Value accumulate = TensorV("accumulate");
+  ValueId accumulate_child_id = ExpectCreateInChild(accumulate);
+  v0::Value merge = TensorV("merge");
+  ValueId merge_child_id = ExpectCreateInChild(merge);
+  v0::Value report = TensorV("report");
+  ValueId report_child_id = ExpectCreateInChild(report);
+  v0::Value arg = StructV({value, zero, accumulate, merge, report});
+  TFF_ASSERT_OK_AND_ASSIGN(auto arg_id, test_executor_->CreateValue(arg));
+  TFF_ASSERT_OK_AND_ASSIGN(auto intrinsic_id,
+                           test_executor_->CreateValue(FederatedAggregateV()));
+  // The ten clients are accumulated in groups of three, three and four.
+  std::vector<ValueId> partial_child_ids;
+  const std::vector<std::pair<int, int>> groups = {
+      {0, 3}, {3, 6}, {6, NUM_CLIENTS}};
+  for (const auto& group : groups) {
+    ValueId current_child_id = zero_child_id;
+    for (int i = group.first; i < group.second; i++) {
+      ValueId call_arg_child_id = ExpectCreateStructInChild(
+          {current_child_id, client_vals_child_ids[i]});
+      current_child_id =
+          ExpectCreateCallInChild(accumulate_child_id, call_arg_child_id);
+    }
+    partial_child_ids.push_back(current_child_id);
+  }
+  ValueId first_merge_arg_child_id =
+      ExpectCreateStructInChild({partial_child_ids[0], partial_child_ids[1]});
+  ValueId first_merge_child_id =
+      ExpectCreateCallInChild(merge_child_id, first_merge_arg_child_id);
+  ValueId second_merge_arg_child_id =
+      ExpectCreateStructInChild({first_merge_child_id, partial_child_ids[2]});
+  ValueId second_merge_child_id =
+      ExpectCreateCallInChild(merge_child_id, second_merge_arg_child_id);
+  ValueId result_child_id =
+      ExpectCreateCallInChild(report_child_id, second_merge_child_id);
+  TFF_ASSERT_OK_AND_ASSIGN(auto result_id,
+                           test_executor_->CreateCall(intrinsic_id, arg_id));
+  v0::Value child_result = TensorV("result");
+  ExpectMaterializeInChild(result_child_id, child_result);
+  ExpectMaterialize(result_id, ServerV(child_result));
+}
+
 TEST_F(FederatingExecutorTest, CreateCallFederatedBroadcast) {
   v0::Value tensor = TensorV(1);
   ValueId tensor_id = ExpectCreateInChild(tensor);
@@ -386,9 +537,8 @@ TEST_F(FederatingExecutorTest, CreateCallFederatedBroadcast) {
   TFF_ASSERT_OK_AND_ASSIGN(auto clients_id,
                            test_executor_->CreateCall(broadcast_id, server_id));
   v0::Value tensor_out = TensorV(4);
-  ExpectMaterializeInChild(tensor_id, tensor_out, ONCE_PER_CLIENT);
-  ExpectMaterialize(clients_id,
-                    ClientsV(std::vector<v0::Value>(NUM_CLIENTS, tensor_out)));
+  ExpectMaterializeInChild(tensor_id, tensor_out);
+  ExpectMaterialize(clients_id, ClientsV({tensor_out}, true));
 }
 
 TEST_F(FederatingExecutorTest, CreateCallFederatedMapAtClients) {
@@ -441,6 +591,49 @@ TEST_F(FederatingExecutorTest, CreateCallFederatedMapAllEqualAtClients) {
   ExpectMaterialize(result_id, value);
 }
 
+TEST_F(FederatingExecutorTest,
+       CreateCallFederatedMapAllEqualOfAllEqualValueCallsOnce) {
+  v0::Value tensor = TensorV(1);
+  ValueId tensor_child_id = ExpectCreateInChild(tensor);
+  TFF_ASSERT_OK_AND_ASSIGN(
+      auto input_id, test_executor_->CreateValue(ClientsV({tensor}, true)));
+  IdPair fn = TFF_ASSERT_OK(CreatePassthroughValue(TensorV(2)));
+  ValueId result_child_id =
+      ExpectCreateCallInChild(fn.child_id, tensor_child_id);
+  TFF_ASSERT_OK_AND_ASSIGN(
+      auto map_id, test_executor_->CreateValue(FederatedMapAllEqualV()));
+  TFF_ASSERT_OK_AND_ASSIGN(auto arg_id,
+                           test_executor_->CreateStruct({fn.id, input_id}));
+  TFF_ASSERT_OK_AND_ASSIGN(auto result_id,
+                           test_executor_->CreateCall(map_id, arg_id));
+  v0::Value output_tensor = TensorV(3);
+  ExpectMaterializeInChild(result_child_id, output_tensor);
+  ExpectMaterialize(result_id, ClientsV({output_tensor}, true));
+}
+
+TEST_F(FederatingExecutorTest,
+       CreateCallFederatedMapOfAllEqualValueCallsPerClient) {
+  // `federated_map` makes no promise that its result is all-equal, so the
+  // function is applied for every client.
+  v0::Value tensor = TensorV(1);
+  ValueId tensor_child_id = ExpectCreateInChild(tensor);
+  TFF_ASSERT_OK_AND_ASSIGN(
+      auto input_id, test_executor_->CreateValue(ClientsV({tensor}, true)));
+  IdPair fn = TFF_ASSERT_OK(CreatePassthroughValue(TensorV(2)));
+  ValueId result_child_id =
+      ExpectCreateCallInChild(fn.child_id, tensor_child_id, ONCE_PER_CLIENT);
+  TFF_ASSERT_OK_AND_ASSIGN(auto map_id,
+                           test_executor_->CreateValue(FederatedMapV()));
+  TFF_ASSERT_OK_AND_ASSIGN(auto arg_id,
+                           test_executor_->CreateStruct({fn.id, input_id}));
+  TFF_ASSERT_OK_AND_ASSIGN(auto result_id,
+                           test_executor_->CreateCall(map_id, arg_id));
+  v0::Value output_tensor = TensorV(3);
+  ExpectMaterializeInChild(result_child_id, output_tensor, ONCE_PER_CLIENT);
+  ExpectMaterialize(
+      result_id, ClientsV(std::vector<v0::Value>(NUM_CLIENTS, output_tensor)));
+}
+
 TEST_F(FederatingExecutorTest, CreateCallFederatedMapAtServer) {
   v0::Value tensor = TensorV(23);
   ValueId tensor_child_id = ExpectCreateInChild(tensor);
@@ -488,6 +681,75 @@ TEST_F(FederatingExecutorTest, CreateCallFederatedEvalAtServer) {
   ExpectMaterialize(result_id, ServerV(result_tensor));
 }
 
+TEST_F(FederatingExecutorTest, CreateCallFederatedSum) {
+  std::vector<v0::Value> client_values;
+  for (int32_t i = 0; i < NUM_CLIENTS; i++) {
+    client_values.push_back(TensorV(static_cast<float>(i)));
+    ExpectCreateMaterializeInChild(client_values.back());
+  }
+  // The clients' values are summed natively and the sum created in the child.
+  v0::Value sum = TensorV(45.0f);
+  ExpectCreateMaterializeInChild(sum);
+  OwnedValueId value_id =
+      TFF_ASSERT_OK(test_executor_->CreateValue(ClientsV(client_values)));
+  OwnedValueId sum_id =
+      TFF_ASSERT_OK(test_executor_->CreateValue(FederatedSumV()));
+  OwnedValueId result_id =
+      TFF_ASSERT_OK(test_executor_->CreateCall(sum_id, value_id));
+  ExpectMaterialize(result_id, ServerV(sum));
+}
+
+TEST_F(FederatingExecutorTest, CreateCallFederatedMeanOfAllEqualValue) {
+  v0::Value value = TensorV(2.0);
+  // An all-equal value is only materialized once.
+  ExpectCreateMaterializeInChild(value, ::testing::Exactly(2));
+  OwnedValueId value_id =
+      TFF_ASSERT_OK(test_executor_->CreateValue(ClientsV({value}, true)));
+  OwnedValueId mean_id =
+      TFF_ASSERT_OK(test_executor_->CreateValue(FederatedMeanV()));
+  OwnedValueId result_id =
+      TFF_ASSERT_OK(test_executor_->CreateCall(mean_id, value_id));
+  ExpectMaterialize(result_id, ServerV(value));
+}
+
+TEST_F(FederatingExecutorTest, CreateCallFederatedWeightedMean) {
+  std::vector<v0::Value> client_values;
+  std::vector<v0::Value> client_weights;
+  for (int32_t i = 0; i < NUM_CLIENTS; i++) {
+    client_values.push_back(TensorV(static_cast<float>(i * i)));
+    ExpectCreateMaterializeInChild(client_values.back());
+    client_weights.push_back(TensorV(i + 1));
+    ExpectCreateMaterializeInChild(client_weights.back());
+  }
+  // The sum of `i * i * (i + 1)` over the sum of `i + 1`, or 2310 / 55.
+  v0::Value mean = TensorV(42.0f);
+  ExpectCreateMaterializeInChild(mean);
+  OwnedValueId value_id =
+      TFF_ASSERT_OK(test_executor_->CreateValue(ClientsV(client_values)));
+  OwnedValueId weight_id =
+      TFF_ASSERT_OK(test_executor_->CreateValue(ClientsV(client_weights)));
+  OwnedValueId arg_id =
+      TFF_ASSERT_OK(test_executor_->CreateStruct({value_id, weight_id}));
+  OwnedValueId weighted_mean_id =
+      TFF_ASSERT_OK(test_executor_->CreateValue(FederatedWeightedMeanV()));
+  OwnedValueId result_id =
+      TFF_ASSERT_OK(test_executor_->CreateCall(weighted_mean_id, arg_id));
+  ExpectMaterialize(result_id, ServerV(mean));
+}
+
+TEST_F(FederatingExecutorTest, CreateCallFederatedMeanOfIntegersFails) {
+  v0::Value value = TensorV(2);
+  ExpectCreateMaterializeInChild(value);
+  OwnedValueId value_id =
+      TFF_ASSERT_OK(test_executor_->CreateValue(ClientsV({value}, true)));
+  OwnedValueId mean_id =
+      TFF_ASSERT_OK(test_executor_->CreateValue(FederatedMeanV()));
+  OwnedValueId result_id =
+      TFF_ASSERT_OK(test_executor_->CreateCall(mean_id, value_id));
+  EXPECT_THAT(test_executor_->Materialize(result_id),
+              StatusIs(StatusCode::kInvalidArgument));
+}
+
 TEST_F(FederatingExecutorTest, CreateCallFederatedSelectUniqueKeyPerClient) {
   OwnedValueId select_id =
       TFF_ASSERT_OK(test_executor_->CreateValue(FederatedSelectV()));
@@ -595,7 +857,10 @@ TEST_F(FederatingExecutorTest, CreateCallFederatedSelectNonInt32KeysFails) {
       TFF_ASSERT_OK(test_executor_->CreateValue(ClientsV({keys_pb}, true)));
   OwnedValueId select_args_id = TFF_ASSERT_OK(test_executor_->CreateStruct(
       {keys_id, max_key.id, server_value_id, select_fn.id}));
-  ASSERT_THAT(test_executor_->CreateCall(select_id, select_args_id),
+  OwnedValueId result_id =
+      TFF_ASSERT_OK(test_executor_->CreateCall(select_id, select_args_id));
+  // We don't see the error until materializing due to asynchrony.
+  ASSERT_THAT(test_executor_->Materialize(result_id),
               StatusIs(StatusCode::kInvalidArgument,
                        HasSubstr("Expected int32_t key")));
 }
@@ -626,11 +891,127 @@ TEST_F(FederatingExecutorTest, CreateCallFederatedSelectNonRankOneKeysFails) {
       TFF_ASSERT_OK(test_executor_->CreateValue(ClientsV({keys_pb}, true)));
   OwnedValueId select_args_id = TFF_ASSERT_OK(test_executor_->CreateStruct(
       {keys_id, max_key.id, server_value_id, select_fn.id}));
-  ASSERT_THAT(test_executor_->CreateCall(select_id, select_args_id),
+  OwnedValueId result_id =
+      TFF_ASSERT_OK(test_executor_->CreateCall(select_id, select_args_id));
+  // We don't see the error until materializing due to asynchrony.
+  ASSERT_THAT(test_executor_->Materialize(result_id),
               StatusIs(StatusCode::kInvalidArgument,
                        HasSubstr("Expected key tensor to be rank one")));
 }
 
+TEST_F(FederatingExecutorTest,
+       CreateCallFederatedSelectReturnsBeforeKeysAreMaterialized) {
+  OwnedValueId select_id =
+      TFF_ASSERT_OK(test_executor_->CreateValue(FederatedSelectV()));
+  IdPair select_fn =
+      TFF_ASSERT_OK(CreatePassthroughValue(TensorV("select_fn")));
+  IdPair max_key = TFF_ASSERT_OK(CreatePassthroughValue(TensorV("max_key")));
+  v0::Value server_value = TensorV("server_value");
+  ValueId server_value_child_id = ExpectCreateInChild(server_value);
+  OwnedValueId server_value_id =
+      TFF_ASSERT_OK(test_executor_->CreateValue(ServerV(server_value)));
+  ValueId args_into_sequence_id = ExpectCreateInChild(ArgsIntoSequenceV());
+  v0::Value keys_pb = TensorVFromIntList({0});
+  ValueId keys_child_id = ExpectCreateInChild(keys_pb);
+  absl::Notification keys_released;
+  EXPECT_CALL(*mock_executor_, Materialize(keys_child_id, ::testing::_))
+      .WillOnce([&keys_released, keys_pb](ValueId id, v0::Value* value_pb) {
+        ThreadPool::ScopedBlockingCall blocking_call;
+        keys_released.WaitForNotification();
+        *value_pb = keys_pb;
+        return absl::OkStatus();
+      });
+  ValueId key_id = ExpectCreateInChild(TensorV(0));
+  ValueId select_fn_args_id =
+      ExpectCreateStructInChild({server_value_child_id, key_id});
+  ValueId slice_id =
+      ExpectCreateCallInChild(select_fn.child_id, select_fn_args_id);
+  ValueId slices_id = ExpectCreateStructInChild({slice_id});
+  ValueId dataset_id =
+      ExpectCreateCallInChild(args_into_sequence_id, slices_id);
+  v0::Value dataset_pb = SequenceV(0, 1, 1);
+  ExpectMaterializeInChild(dataset_id, dataset_pb);
+  OwnedValueId keys_id =
+      TFF_ASSERT_OK(test_executor_->CreateValue(ClientsV({keys_pb}, true)));
+  OwnedValueId select_args_id = TFF_ASSERT_OK(test_executor_->CreateStruct(
+      {keys_id, max_key.id, server_value_id, select_fn.id}));
+  // The call must not wait for the keys, which are only released afterwards.
+  OwnedValueId result_id =
+      TFF_ASSERT_OK(test_executor_->CreateCall(select_id, select_args_id));
+  keys_released.Notify();
+  // The result is shared by the clients, but is not of all-equal type.
+  ExpectMaterialize(result_id,
+                    ClientsV(std::vector<v0::Value>(NUM_CLIENTS, dataset_pb)));
+}
+
+TEST_F(FederatingExecutorTest, CreateCallFederatedSelectReusesCachedSlices) {
+  TFF_ASSERT_OK_AND_ASSIGN(
+      test_executor_,
+      tensorflow_federated::CreateFederatingExecutor(
+          mock_executor_, {{"clients", NUM_CLIENTS}},
+          /*num_aggregation_groups=*/1, /*select_slice_cache_size=*/16));
+  OwnedValueId select_id =
+      TFF_ASSERT_OK(test_executor_->CreateValue(FederatedSelectV()));
+  IdPair select_fn =
+      TFF_ASSERT_OK(CreatePassthroughValue(TensorV("select_fn")));
+  IdPair max_key = TFF_ASSERT_OK(CreatePassthroughValue(TensorV("max_key")));
+  ValueId args_into_sequence_id =
+      ExpectCreateInChild(ArgsIntoSequenceV(), ::testing::Exactly(2));
+  v0::Value server_value = TensorV("server_value");
+
+  // The first round computes the slice for key 1.
+  ValueId first_server_value_child_id = ExpectCreateInChild(server_value);
+  OwnedValueId first_server_value_id =
+      TFF_ASSERT_OK(test_executor_->CreateValue(ServerV(server_value)));
+  v0::Value first_keys_pb = TensorVFromIntList({1});
+  ExpectCreateMaterializeInChild(first_keys_pb);
+  ValueId first_key_id = ExpectCreateInChild(TensorV(1));
+  ValueId first_select_fn_args_id =
+      ExpectCreateStructInChild({first_server_value_child_id, first_key_id});
+  ValueId first_slice_id =
+      ExpectCreateCallInChild(select_fn.child_id, first_select_fn_args_id);
+  ValueId first_slices_id = ExpectCreateStructInChild({first_slice_id});
+  ValueId first_dataset_id =
+      ExpectCreateCallInChild(args_into_sequence_id, first_slices_id);
+  v0::Value first_dataset_pb = SequenceV(1, 2, 1);
+  ExpectMaterializeInChild(first_dataset_id, first_dataset_pb);
+  OwnedValueId first_keys_id = TFF_ASSERT_OK(
+      test_executor_->CreateValue(ClientsV({first_keys_pb}, true)));
+  OwnedValueId first_args_id = TFF_ASSERT_OK(test_executor_->CreateStruct(
+      {first_keys_id, max_key.id, first_server_value_id, select_fn.id}));
+  OwnedValueId first_result_id =
+      TFF_ASSERT_OK(test_executor_->CreateCall(select_id, first_args_id));
+  ExpectMaterialize(first_result_id, ClientsV(std::vector<v0::Value>(
+                                         NUM_CLIENTS, first_dataset_pb)));
+
+  // The second round recreates an equal server value, so only the slice for
+  // the new key 2 is computed.
+  ValueId second_server_value_child_id = ExpectCreateInChild(server_value);
+  OwnedValueId second_server_value_id =
+      TFF_ASSERT_OK(test_executor_->CreateValue(ServerV(server_value)));
+  v0::Value second_keys_pb = TensorVFromIntList({1, 2});
+  ExpectCreateMaterializeInChild(second_keys_pb);
+  ValueId second_key_id = ExpectCreateInChild(TensorV(2));
+  ValueId second_select_fn_args_id =
+      ExpectCreateStructInChild({second_server_value_child_id, second_key_id});
+  ValueId second_slice_id =
+      ExpectCreateCallInChild(select_fn.child_id, second_select_fn_args_id);
+  ValueId second_slices_id =
+      ExpectCreateStructInChild({first_slice_id, second_slice_id});
+  ValueId second_dataset_id =
+      ExpectCreateCallInChild(args_into_sequence_id, second_slices_id);
+  v0::Value second_dataset_pb = SequenceV(1, 3, 1);
+  ExpectMaterializeInChild(second_dataset_id, second_dataset_pb);
+  OwnedValueId second_keys_id = TFF_ASSERT_OK(
+      test_executor_->CreateValue(ClientsV({second_keys_pb}, true)));
+  OwnedValueId second_args_id = TFF_ASSERT_OK(test_executor_->CreateStruct(
+      {second_keys_id, max_key.id, second_server_value_id, select_fn.id}));
+  OwnedValueId second_result_id =
+      TFF_ASSERT_OK(test_executor_->CreateCall(select_id, second_args_id));
+  ExpectMaterialize(second_result_id, ClientsV(std::vector<v0::Value>(
+                                          NUM_CLIENTS, second_dataset_pb)));
+}
+
 TEST_F(FederatingExecutorTest, CreateCallFederatedValueAtClients) {
   v0::Value tensor_pb = TensorV(1);
   IdPair tensor = TFF_ASSERT_OK(CreatePassthroughValue(tensor_pb));
@@ -638,9 +1019,8 @@ TEST_F(FederatingExecutorTest, CreateCallFederatedValueAtClients) {
       auto fed_val_id, test_executor_->CreateValue(FederatedValueAtClientsV()));
   TFF_ASSERT_OK_AND_ASSIGN(auto result_id,
                            test_executor_->CreateCall(fed_val_id, tensor.id));
-  ExpectMaterializeInChild(tensor.child_id, tensor_pb, ONCE_PER_CLIENT);
-  ExpectMaterialize(result_id,
-                    ClientsV(std::vector<v0::Value>(NUM_CLIENTS, tensor_pb)));
+  ExpectMaterializeInChild(tensor.child_id, tensor_pb);
+  ExpectMaterialize(result_id, ClientsV({tensor_pb}, true));
 }
 
 TEST_F(FederatingExecutorTest, CreateCallFederatedValueAtServer) {
@@ -665,11 +1045,13 @@ TEST_F(FederatingExecutorTest, CreateCallFederatedZipAtClientsFlat) {
                      StructV({ClientsV({v1}, true), ClientsV({v2}, true)})));
   TFF_ASSERT_OK_AND_ASSIGN(
       auto zip_id, test_executor_->CreateValue(FederatedZipAtClientsV()));
+  // All-equal values are zipped once for all clients, but the result is not of
+  // all-equal type, and so materializes once per client.
   ValueId struct_child_id =
-      ExpectCreateStructInChild({v1_child_id, v2_child_id}, ONCE_PER_CLIENT);
+      ExpectCreateStructInChild({v1_child_id, v2_child_id});
   TFF_ASSERT_OK_AND_ASSIGN(auto result_id,
                            test_executor_->CreateCall(zip_id, v_id));
-  ExpectMaterializeInChild(struct_child_id, StructV({v1, v2}), ONCE_PER_CLIENT);
+  ExpectMaterializeInChild(struct_child_id, StructV({v1, v2}));
   ExpectMaterialize(result_id, ClientsV(std::vector<v0::Value>(
                                    NUM_CLIENTS, StructV({v1, v2}))));
 }
@@ -684,14 +1066,12 @@ TEST_F(FederatingExecutorTest, CreateCallFederatedZipAtClientsNested) {
                      {ClientsV({v1}, true), StructV({ClientsV({v2}, true)})})));
   TFF_ASSERT_OK_AND_ASSIGN(
       auto zip_id, test_executor_->CreateValue(FederatedZipAtClientsV()));
-  ValueId v2_struct_child_id =
-      ExpectCreateStructInChild({v2_child_id}, ONCE_PER_CLIENT);
-  ValueId struct_child_id = ExpectCreateStructInChild(
-      {v1_child_id, v2_struct_child_id}, ONCE_PER_CLIENT);
+  ValueId v2_struct_child_id = ExpectCreateStructInChild({v2_child_id});
+  ValueId struct_child_id =
+      ExpectCreateStructInChild({v1_child_id, v2_struct_child_id});
   TFF_ASSERT_OK_AND_ASSIGN(auto result_id,
                            test_executor_->CreateCall(zip_id, v_id));
-  ExpectMaterializeInChild(struct_child_id, StructV({v1, StructV({v2})}),
-                           ONCE_PER_CLIENT);
+  ExpectMaterializeInChild(struct_child_id, StructV({v1, StructV({v2})}));
   ExpectMaterialize(result_id, ClientsV(std::vector<v0::Value>(
                                    NUM_CLIENTS, StructV({v1, StructV({v2})}))));
 }
@@ -34,6 +34,10 @@ class MockGrpcExecutorService : public v0::ExecutorGroup::Service {
   MOCK_METHOD(grpc::Status, CreateValue,
               (grpc::ServerContext*, const v0::CreateValueRequest*,
                v0::CreateValueResponse*));
+  MOCK_METHOD(grpc::Status, CreateValueStream,
+              (grpc::ServerContext*,
+               grpc::ServerReader<v0::CreateValueStreamRequest>*,
+               v0::CreateValueResponse*));
   MOCK_METHOD(grpc::Status, CreateCall,
               (grpc::ServerContext*, const v0::CreateCallRequest*,
                v0::CreateCallResponse*));
@@ -43,9 +47,15 @@ class MockGrpcExecutorService : public v0::ExecutorGroup::Service {
   MOCK_METHOD(grpc::Status, CreateSelection,
               (grpc::ServerContext*, const v0::CreateSelectionRequest*,
                v0::CreateSelectionResponse*));
+  MOCK_METHOD(grpc::Status, ExecuteBatch,
+              (grpc::ServerContext*, const v0::ExecuteBatchRequest*,
+               v0::ExecuteBatchResponse*));
   MOCK_METHOD(grpc::Status, Compute,
               (grpc::ServerContext*, const v0::ComputeRequest*,
                v0::ComputeResponse*));
+  MOCK_METHOD(grpc::Status, ComputeStream,
+              (grpc::ServerContext*, const v0::ComputeRequest*,
+               grpc::ServerWriter<v0::ComputeStreamResponse>*));
   MOCK_METHOD(grpc::Status, Dispose,
               (grpc::ServerContext*, const v0::DisposeRequest*,
                v0::DisposeResponse*));
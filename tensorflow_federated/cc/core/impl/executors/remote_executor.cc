@@ -15,35 +15,47 @@ limitations under the License
 
 #include "tensorflow_federated/cc/core/impl/executors/remote_executor.h"
 
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
-#include <future>  // NOLINT
+#include <deque>
+#include <iterator>
+#include <limits>
 #include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
 #include "absl/meta/type_traits.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
 #include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "absl/types/optional.h"
+#include "absl/types/span.h"
 #include "grpcpp/grpcpp.h"
+#include "tensorflow_federated/cc/core/impl/executors/async_grpc.h"
+#include "tensorflow_federated/cc/core/impl/executors/cancellation.h"
 #include "tensorflow_federated/cc/core/impl/executors/cardinalities.h"
 #include "tensorflow_federated/cc/core/impl/executors/executor.h"
 #include "tensorflow_federated/cc/core/impl/executors/status_conversion.h"
 #include "tensorflow_federated/cc/core/impl/executors/status_macros.h"
+#include "tensorflow_federated/cc/core/impl/executors/thread_pool.h"
 #include "tensorflow_federated/cc/core/impl/executors/threading.h"
+#include "tensorflow_federated/cc/core/impl/executors/value_cache.h"
+#include "tensorflow_federated/cc/core/impl/executors/value_streaming.h"
 #include "tensorflow_federated/proto/v0/computation.pb.h"
 #include "tensorflow_federated/proto/v0/executor.grpc.pb.h"
 #include "tensorflow_federated/proto/v0/executor.pb.h"
 
 namespace tensorflow_federated {
 
-class ExecutorValue;
-
-using ValueFuture =
-    std::shared_future<absl::StatusOr<std::shared_ptr<ExecutorValue>>>;
+namespace {
 
 // A custom deleter for the `std::shared_ptr<v0::ExecutorGroup::StubInterface>`
 // which will call `DisposeExecutor` for the provided `executor_pb`, if any.
@@ -61,11 +73,13 @@ class StubDeleter {
   }
   void operator()(v0::ExecutorGroup::StubInterface* stub) {
     if (executor_pb_.has_value()) {
-      ThreadRun([stub, executor_pb = std::move(*executor_pb_)]() {
+      ThreadPool::Global().Schedule([stub,
+                                     executor_pb = std::move(*executor_pb_)]() {
         v0::DisposeExecutorRequest request;
         v0::DisposeExecutorResponse response;
         grpc::ClientContext context;
         *request.mutable_executor() = std::move(executor_pb);
+        ThreadPool::ScopedBlockingCall blocking_call;
         grpc::Status dispose_status =
             stub->DisposeExecutor(&context, request, &response);
         if (!dispose_status.ok()) {
@@ -84,72 +98,967 @@ class StubDeleter {
   absl::optional<v0::ExecutorId> executor_pb_;
 };
 
-class RemoteExecutor : public ExecutorBase<ValueFuture> {
+// The maximum number of values disposed of by a single `Dispose` RPC.
+constexpr size_t kMaxDisposeBatchSize = 1024;
+// The maximum time a value waits to be included in a `Dispose` RPC.
+constexpr absl::Duration kMaxDisposeBatchDelay = absl::Milliseconds(20);
+
+// Coalesces the disposal of values belonging to a single remote executor into
+// batched `Dispose` RPCs.
+//
+// A batch is sent once it holds `kMaxDisposeBatchSize` values, or once its
+// oldest value has waited for `kMaxDisposeBatchDelay`, as checked by an alarm
+// on the global `CompletionQueuePoller`. Any values still waiting are sent
+// when the batcher is destroyed; since every `ExecutorValue` holds a
+// reference to the batcher, this happens only after the `RemoteExecutor` and
+// all of its values are gone, and before the stub (and so the
+// `DisposeExecutor` call in `StubDeleter`) is released.
+class DisposeBatcher : public std::enable_shared_from_this<DisposeBatcher> {
+ public:
+  DisposeBatcher(std::shared_ptr<v0::ExecutorGroup::StubInterface> stub,
+                 v0::ExecutorId executor_pb)
+      : stub_(std::move(stub)), executor_pb_(std::move(executor_pb)) {}
+
+  ~DisposeBatcher() {
+    absl::MutexLock lock(&mutex_);
+    SendBatchLocked();
+  }
+
+  DisposeBatcher(const DisposeBatcher&) = delete;
+  DisposeBatcher& operator=(const DisposeBatcher&) = delete;
+
+  // Queues `value_ref` to be disposed of in an upcoming batch.
+  void Dispose(v0::ValueRef value_ref) {
+    absl::MutexLock lock(&mutex_);
+    if (pending_.empty()) {
+      oldest_pending_time_ = absl::Now();
+    }
+    pending_.push_back(std::move(value_ref));
+    if (pending_.size() >= kMaxDisposeBatchSize) {
+      SendBatchLocked();
+    } else if (!alarm_set_) {
+      SetAlarmLocked();
+    }
+  }
+
+ private:
+  // Sets an alarm for the deadline of the oldest pending value.
+  void SetAlarmLocked() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    alarm_set_ = true;
+    RunAtDeadline(CompletionQueuePoller::Global(),
+                  oldest_pending_time_ + kMaxDisposeBatchDelay,
+                  [weak_this = weak_from_this()]() {
+                    if (std::shared_ptr<DisposeBatcher> self =
+                            weak_this.lock()) {
+                      self->OnAlarm();
+                    }
+                  });
+  }
+
+  // Sends the pending values once their deadline has passed. Values queued
+  // after a batch was sent get an alarm of their own.
+  void OnAlarm() {
+    absl::MutexLock lock(&mutex_);
+    alarm_set_ = false;
+    if (pending_.empty()) {
+      return;
+    }
+    if (absl::Now() >= oldest_pending_time_ + kMaxDisposeBatchDelay) {
+      SendBatchLocked();
+    } else {
+      SetAlarmLocked();
+    }
+  }
+
+  // Sends all pending values in a single `Dispose` RPC, run on the thread
+  // pool.
+  void SendBatchLocked() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    if (pending_.empty()) {
+      return;
+    }
+    v0::DisposeRequest request;
+    *request.mutable_executor() = executor_pb_;
+    request.mutable_value_ref()->Reserve(pending_.size());
+    for (v0::ValueRef& value_ref : pending_) {
+      *request.add_value_ref() = std::move(value_ref);
+    }
+    pending_.clear();
+    ThreadPool::Global().Schedule([stub = stub_,
+                                   request = std::move(request)]() {
+      v0::DisposeResponse response;
+      grpc::ClientContext context;
+      ThreadPool::ScopedBlockingCall blocking_call;
+      grpc::Status dispose_status = stub->Dispose(&context, request, &response);
+      if (!dispose_status.ok()) {
+        LOG(ERROR) << "Error disposing of " << request.value_ref_size()
+                   << " ExecutorValues: " << grpc_to_absl(dispose_status);
+      }
+    });
+  }
+
+  const std::shared_ptr<v0::ExecutorGroup::StubInterface> stub_;
+  const v0::ExecutorId executor_pb_;
+  absl::Mutex mutex_;
+  std::vector<v0::ValueRef> pending_ ABSL_GUARDED_BY(mutex_);
+  absl::Time oldest_pending_time_ ABSL_GUARDED_BY(mutex_);
+  bool alarm_set_ ABSL_GUARDED_BY(mutex_) = false;
+};
+
+class ExecutorValue;
+
+// The maximum number of operations sent in a single `ExecuteBatch` RPC.
+constexpr size_t kMaxOperationBatchSize = 1024;
+// The maximum total size of the operations sent in a single `ExecuteBatch`
+// RPC. Services are assumed to keep gRPC's default maximum received message
+// size of 4 MiB; the remainder is left for the rest of the request.
+constexpr size_t kMaxOperationBatchBytes = 4 * 1024 * 1024 - 64 * 1024;
+// The maximum time an operation waits to be sent if no value it creates is
+// being materialized.
+constexpr absl::Duration kMaxOperationBatchDelay = absl::Milliseconds(2);
+// Values whose serialized size exceeds this are sent in chunks by
+// `CreateValueStream` rather than in a batch, so that every operation fits in
+// a batch on its own.
+constexpr size_t kMaxUnstreamedValueBytes = kMaxOperationBatchBytes;
+// The batch index of values which are not created by a batched operation.
+constexpr uint64_t kNoBatch = std::numeric_limits<uint64_t>::max();
+// Values likely to be sent again (see `IsLikelyResent`) whose serialized size
+// is at least this are sent with their fingerprints, and by their fingerprints
+// alone once they have been sent before (see
+// `CreateValueRequest.value_fingerprint`).
+constexpr size_t kMinFingerprintedValueBytes = 1024;
+// The maximum number of fingerprints of sent values remembered per executor.
+constexpr size_t kMaxSentFingerprints = 4096;
+
+// Whether `value_pb` is of a kind which is typically sent to an executor
+// repeatedly: a computation, or a value placed at the server or equal at all
+// clients (such as broadcast model weights), or a struct of these. Other
+// values, such as per-client data, are seldom repeated, and are not worth
+// fingerprinting nor holding in the service's cache.
+bool IsLikelyResent(const v0::Value& value_pb) {
+  switch (value_pb.value_case()) {
+    case v0::Value::kComputation:
+      return true;
+    case v0::Value::kFederated: {
+      const v0::FederatedType& type_pb = value_pb.federated().type();
+      return type_pb.all_equal() ||
+             type_pb.placement().value().uri() == kServerUri;
+    }
+    case v0::Value::kStruct:
+      for (const v0::Value::Struct::Element& element :
+           value_pb.struct_().element()) {
+        if (!IsLikelyResent(element.value())) {
+          return false;
+        }
+      }
+      return value_pb.struct_().element_size() > 0;
+    default:
+      return false;
+  }
+}
+
+// Tracks whether the service implements one of the RPCs which stand in for
+// unary ones (`ExecuteBatch`, `CreateValueStream` and `ComputeStream`). Not
+// every service does: the Python `ExecutorService` implements only the unary
+// RPCs. An RPC is assumed to be implemented until it fails with
+// `UNIMPLEMENTED` without ever having succeeded, after which the unary RPCs
+// are used instead.
+class OptionalRpc {
+ public:
+  // Whether the RPC is known to be unimplemented.
+  bool unimplemented() const { return unimplemented_.load(); }
+  // Whether the RPC has succeeded at least once.
+  bool implemented() const { return implemented_.load(); }
+
+  // Records the result of a call of the RPC. Returns whether it shows that the
+  // RPC is unimplemented, in which case the call should be repeated with the
+  // unary RPCs.
+  bool FailedAsUnimplemented(const absl::Status& status) {
+    if (status.ok()) {
+      implemented_.store(true);
+      return false;
+    }
+    if (status.code() != absl::StatusCode::kUnimplemented ||
+        implemented_.load()) {
+      return false;
+    }
+    unimplemented_.store(true);
+    return true;
+  }
+
+ private:
+  std::atomic<bool> implemented_{false};
+  std::atomic<bool> unimplemented_{false};
+};
+
+// Creates `value_pb` on the remote executor by streaming it in a
+// `CreateValueStream` RPC, to be cached under `value_fingerprint` if it is
+// non-empty. Blocking.
+absl::StatusOr<v0::ValueRef> StreamValue(
+    v0::ExecutorGroup::StubInterface& stub, const v0::ExecutorId& executor_pb,
+    const v0::Value& value_pb, const std::string& value_fingerprint) {
+  ThreadPool::ScopedBlockingCall blocking_call;
+  v0::CreateValueResponse response;
+  grpc::ClientContext client_context;
+  ScopedCancellationCallback cancel_rpc(
+      CancellationToken::Current(),
+      [&client_context]() { client_context.TryCancel(); });
+  std::unique_ptr<grpc::ClientWriterInterface<v0::CreateValueStreamRequest>>
+      stream = stub.CreateValueStream(&client_context, &response);
+  ValueChunkWriter writer(value_pb);
+  v0::CreateValueStreamRequest request;
+  *request.mutable_executor() = executor_pb;
+  request.set_value_fingerprint(value_fingerprint);
+  while (writer.Next(request.mutable_chunk())) {
+    // A failed write means that the RPC has ended, with the status returned
+    // by `Finish`.
+    if (!stream->Write(request)) {
+      break;
+    }
+    request.clear_executor();
+    request.clear_value_fingerprint();
+  }
+  stream->WritesDone();
+  TFF_TRY(grpc_to_absl(stream->Finish()));
+  return std::move(*response.mutable_value_ref());
+}
+
+// Creates `value_pb`, which is too large to be sent in a batch, on the remote
+// executor, to be cached under `value_fingerprint` if it is non-empty. The
+// value is streamed, unless `create_value_stream` is known to be unimplemented,
+// in which case it is sent in a unary `CreateValue` RPC instead. Blocking.
+absl::StatusOr<v0::ValueRef> CreateLargeValue(
+    v0::ExecutorGroup::StubInterface& stub, const v0::ExecutorId& executor_pb,
+    const v0::Value& value_pb, const std::string& value_fingerprint,
+    OptionalRpc& create_value_stream) {
+  if (!create_value_stream.unimplemented()) {
+    absl::StatusOr<v0::ValueRef> ref =
+        StreamValue(stub, executor_pb, value_pb, value_fingerprint);
+    if (!create_value_stream.FailedAsUnimplemented(ref.status())) {
+      return ref;
+    }
+  }
+  ThreadPool::ScopedBlockingCall blocking_call;
+  v0::CreateValueRequest request;
+  *request.mutable_executor() = executor_pb;
+  *request.mutable_value() = value_pb;
+  v0::CreateValueResponse response;
+  grpc::ClientContext client_context;
+  ScopedCancellationCallback cancel_rpc(
+      CancellationToken::Current(),
+      [&client_context]() { client_context.TryCancel(); });
+  TFF_TRY(grpc_to_absl(stub.CreateValue(&client_context, request, &response)));
+  return std::move(*response.mutable_value_ref());
+}
+
+// A value created by an operation on the remote executor.
+//
+// The value is created as soon as its operation is queued, with a
+// client-assigned ID by which later operations in the same batch may refer to
+// it. Its service-assigned `ValueRef` is only known once the batch has been
+// executed.
+class ExecutorValue {
+ public:
+  ExecutorValue(std::string id, uint64_t batch,
+                std::shared_ptr<DisposeBatcher> dispose_batcher)
+      : id_(std::move(id)),
+        batch_(batch),
+        dispose_batcher_(std::move(dispose_batcher)) {}
+
+  ~ExecutorValue() {
+    if (ref_.has_value() && ref_->ok()) {
+      dispose_batcher_->Dispose(std::move(ref_->value()));
+    }
+  }
+
+  ExecutorValue(const ExecutorValue&) = delete;
+  ExecutorValue& operator=(const ExecutorValue&) = delete;
+
+  // The client-assigned ID of this value.
+  const std::string& id() const { return id_; }
+  // The index of the batch which creates this value.
+  uint64_t batch() const { return batch_; }
+
+  // Sets the result of the operation creating this value. Called once.
+  void Resolve(absl::StatusOr<v0::ValueRef> ref) {
+    absl::MutexLock lock(&mutex_);
+    ref_.emplace(std::move(ref));
+  }
+
+  // Returns the result of the operation creating this value. Values created by
+  // earlier batches have been resolved by the time a batch is sent, but values
+  // streamed outside of batches may still be pending, and are waited for.
+  absl::StatusOr<v0::ValueRef> Ref() const {
+    absl::MutexLock lock(&mutex_);
+    if (!ref_.has_value()) {
+      ThreadPool::ScopedBlockingCall blocking_call;
+      mutex_.Await(absl::Condition(this, &ExecutorValue::IsResolved));
+    }
+    return *ref_;
+  }
+
+  // Returns the failure of the operation creating this value, if it has
+  // already failed.
+  absl::Status FailureIfResolved() const {
+    absl::MutexLock lock(&mutex_);
+    return ref_.has_value() ? ref_->status() : absl::OkStatus();
+  }
+
+  // Blocks until the operation creating this value has been executed, and
+  // returns its result.
+  absl::StatusOr<v0::ValueRef> WaitForRef() const {
+    absl::MutexLock lock(&mutex_);
+    mutex_.Await(absl::Condition(this, &ExecutorValue::IsResolved));
+    return *ref_;
+  }
+
+ private:
+  bool IsResolved() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    return ref_.has_value();
+  }
+
+  const std::string id_;
+  const uint64_t batch_;
+  const std::shared_ptr<DisposeBatcher> dispose_batcher_;
+  mutable absl::Mutex mutex_;
+  absl::optional<absl::StatusOr<v0::ValueRef>> ref_ ABSL_GUARDED_BY(mutex_);
+};
+
+// Returns the `ValueRef`s through which `operation` refers to its inputs, in
+// the order in which the inputs are passed to `OperationBatcher::Add`.
+std::vector<v0::ValueRef*> InputRefs(
+    v0::ExecuteBatchRequest::Operation& operation) {
+  std::vector<v0::ValueRef*> refs;
+  switch (operation.operation_case()) {
+    case v0::ExecuteBatchRequest::Operation::kCreateCall: {
+      v0::CreateCallRequest* create_call = operation.mutable_create_call();
+      refs.push_back(create_call->mutable_function_ref());
+      if (create_call->has_argument_ref()) {
+        refs.push_back(create_call->mutable_argument_ref());
+      }
+      break;
+    }
+    case v0::ExecuteBatchRequest::Operation::kCreateStruct: {
+      for (v0::CreateStructRequest::Element& element :
+           *operation.mutable_create_struct()->mutable_element()) {
+        refs.push_back(element.mutable_value_ref());
+      }
+      break;
+    }
+    case v0::ExecuteBatchRequest::Operation::kCreateSelection: {
+      refs.push_back(
+          operation.mutable_create_selection()->mutable_source_ref());
+      break;
+    }
+    default:
+      break;
+  }
+  return refs;
+}
+
+// Pipelines the operations creating values on a single remote executor into
+// batched `ExecuteBatch` RPCs.
+//
+// Operations are queued in an open batch, referring to their inputs by the
+// inputs' client-assigned IDs, and so may be queued before the operations
+// creating their inputs have been executed. At most one batch is in flight at
+// a time: the open batch is sent once the previous batch has completed, and
+// then once it is full, a value it creates is being materialized (see
+// `Flush`), or its oldest operation has waited for `kMaxOperationBatchDelay`
+// (checked by an alarm on the global `CompletionQueuePoller`).
+// When a batch is sent, inputs created by earlier batches (which have all
+// completed by then) are referred to by their service-assigned `ValueRef`s
+// instead. A chain of dependent operations thus takes a single round trip.
+//
+// Values may be created by fingerprint alone, with the value itself withheld
+// (see `Add`). Should the service no longer have such a value cached, the
+// operation and those depending on it are sent again, with the value, before
+// the next batch is sent.
+//
+// If the service does not implement `ExecuteBatch`, each operation is sent in
+// the unary RPC it stands for instead, one at a time.
+class OperationBatcher
+    : public std::enable_shared_from_this<OperationBatcher> {
+ public:
+  OperationBatcher(std::shared_ptr<v0::ExecutorGroup::StubInterface> stub,
+                   v0::ExecutorId executor_pb,
+                   std::shared_ptr<DisposeBatcher> dispose_batcher)
+      : stub_(std::move(stub)),
+        executor_pb_(std::move(executor_pb)),
+        dispose_batcher_(std::move(dispose_batcher)) {}
+
+  ~OperationBatcher() { Shutdown(); }
+
+  OperationBatcher(const OperationBatcher&) = delete;
+  OperationBatcher& operator=(const OperationBatcher&) = delete;
+
+  // Queues `operation`, whose input `ValueRef`s are filled in with the IDs of
+  // `inputs`, and returns the value it creates. If `withheld_value` is set,
+  // `operation` creates that value by its fingerprint alone.
+  std::shared_ptr<ExecutorValue> Add(
+      v0::ExecuteBatchRequest::Operation operation,
+      std::vector<std::shared_ptr<ExecutorValue>> inputs,
+      std::shared_ptr<const v0::Value> withheld_value = nullptr) {
+    std::vector<v0::ValueRef*> input_refs = InputRefs(operation);
+    for (size_t i = 0; i < inputs.size(); i++) {
+      input_refs[i]->set_id(inputs[i]->id());
+    }
+    absl::MutexLock lock(&mutex_);
+    auto value = std::make_shared<ExecutorValue>(
+        absl::StrCat("v", next_id_++), open_batch_, dispose_batcher_);
+    for (const std::shared_ptr<ExecutorValue>& input : inputs) {
+      absl::Status input_status = input->FailureIfResolved();
+      if (!input_status.ok()) {
+        value->Resolve(std::move(input_status));
+        return value;
+      }
+    }
+    if (shutting_down_) {
+      value->Resolve(absl::CancelledError("RemoteExecutor was destroyed."));
+      return value;
+    }
+    if (open_operations_.empty()) {
+      oldest_open_time_ = absl::Now();
+    }
+    operation.set_id(value->id());
+    open_bytes_ += operation.ByteSizeLong();
+    open_operations_.push_back({std::move(operation), std::move(inputs), value,
+                                std::move(withheld_value),
+                                CancellationToken::Current()});
+    MaybeSendLocked();
+    return value;
+  }
+
+  // Returns a value which is created by other means than a batched operation,
+  // and which the caller resolves once it has been.
+  std::shared_ptr<ExecutorValue> AddUnbatched() {
+    absl::MutexLock lock(&mutex_);
+    return std::make_shared<ExecutorValue>(absl::StrCat("v", next_id_++),
+                                           kNoBatch, dispose_batcher_);
+  }
+
+  // Requests that the batch creating `value` be sent without further delay.
+  void Flush(const ExecutorValue& value) {
+    absl::MutexLock lock(&mutex_);
+    if (value.batch() != kNoBatch && value.batch() >= first_open_batch_) {
+      flush_requested_ = true;
+      MaybeSendLocked();
+    }
+  }
+
+  // Whether operations are sent in unary RPCs, as the service does not
+  // implement `ExecuteBatch`.
+  bool sends_unary_rpcs() const { return execute_batch_.unimplemented(); }
+
+  // Stops sending batches, and fails the values created by operations which
+  // have not yet been sent. Batches in flight complete as usual.
+  void Shutdown() {
+    std::vector<PendingOperation> unsent;
+    {
+      absl::MutexLock lock(&mutex_);
+      if (shutting_down_) {
+        return;
+      }
+      shutting_down_ = true;
+      unsent.swap(open_operations_);
+    }
+    for (PendingOperation& operation : unsent) {
+      if (std::shared_ptr<ExecutorValue> value = operation.value.lock()) {
+        value->Resolve(absl::CancelledError("RemoteExecutor was destroyed."));
+      }
+    }
+  }
+
+ private:
+  struct PendingOperation {
+    v0::ExecuteBatchRequest::Operation operation;
+    // Kept alive until the batch has completed, so that their disposal cannot
+    // overtake it.
+    std::vector<std::shared_ptr<ExecutorValue>> inputs;
+    std::weak_ptr<ExecutorValue> value;
+    // The value created by a `create_value` operation which only carries the
+    // value's fingerprint, if any.
+    std::shared_ptr<const v0::Value> withheld_value;
+    // The token current when the operation was added, if any.
+    std::shared_ptr<CancellationToken> token;
+  };
+
+  // Sends the open batch if it is ready, or otherwise sets an alarm for its
+  // deadline. Called whenever the batch may have become ready: an operation
+  // was added, a flush was requested, the previous batch completed or the
+  // alarm went off. The batch is sent on the thread pool, since building the
+  // request copies its operations.
+  void MaybeSendLocked() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    if (shutting_down_ || !Sendable()) {
+      return;
+    }
+    if (!ReadyToSend()) {
+      if (!alarm_set_) {
+        SetAlarmLocked();
+      }
+      return;
+    }
+    std::vector<PendingOperation> batch = TakeBatchLocked();
+    open_batch_++;
+    if (open_operations_.empty()) {
+      first_open_batch_ = open_batch_;
+      flush_requested_ = false;
+    }
+    in_flight_ = true;
+    ThreadPool::Global().Schedule(
+        [self = shared_from_this(), batch = std::move(batch)]() mutable {
+          self->Send(std::move(batch));
+        });
+  }
+
+  // Removes and returns the longest prefix of the open operations which fits
+  // the limits of a batch, and at least one operation. Operations added while a
+  // batch was in flight may exceed them together.
+  std::vector<PendingOperation> TakeBatchLocked()
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    size_t num_taken = 0;
+    size_t batch_bytes = 0;
+    for (const PendingOperation& pending : open_operations_) {
+      size_t bytes = pending.operation.ByteSizeLong();
+      if (num_taken > 0 && (num_taken == kMaxOperationBatchSize ||
+                            batch_bytes + bytes > kMaxOperationBatchBytes)) {
+        break;
+      }
+      num_taken++;
+      batch_bytes += bytes;
+    }
+    std::vector<PendingOperation> batch;
+    if (num_taken == open_operations_.size()) {
+      batch.swap(open_operations_);
+    } else {
+      auto taken_end = open_operations_.begin() + num_taken;
+      batch.assign(std::make_move_iterator(open_operations_.begin()),
+                   std::make_move_iterator(taken_end));
+      open_operations_.erase(open_operations_.begin(), taken_end);
+    }
+    open_bytes_ -= batch_bytes;
+    return batch;
+  }
+
+  // Sets an alarm for the deadline of the oldest open operation.
+  void SetAlarmLocked() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    alarm_set_ = true;
+    RunAtDeadline(CompletionQueuePoller::Global(),
+                  oldest_open_time_ + kMaxOperationBatchDelay,
+                  [weak_this = weak_from_this()]() {
+                    if (std::shared_ptr<OperationBatcher> self =
+                            weak_this.lock()) {
+                      absl::MutexLock lock(&self->mutex_);
+                      self->alarm_set_ = false;
+                      self->MaybeSendLocked();
+                    }
+                  });
+  }
+
+  bool Sendable() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    return !in_flight_ && !open_operations_.empty();
+  }
+
+  bool FullOrFlushRequested() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    return flush_requested_ ||
+           open_operations_.size() >= kMaxOperationBatchSize ||
+           open_bytes_ >= kMaxOperationBatchBytes;
+  }
+
+  bool ReadyToSend() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    return Sendable() &&
+           (FullOrFlushRequested() ||
+            absl::Now() >= oldest_open_time_ + kMaxOperationBatchDelay);
+  }
+
+  // Sends `batch` in an `ExecuteBatch` RPC.
+  void Send(std::vector<PendingOperation> batch) {
+    if (execute_batch_.unimplemented()) {
+      SendUnary(std::move(batch));
+      return;
+    }
+    v0::ExecuteBatchRequest request;
+    *request.mutable_executor() = executor_pb_;
+    // The failures of operations in this batch which are not sent because one
+    // of their inputs has failed, keyed by the operations' IDs.
+    absl::flat_hash_map<std::string, absl::Status> failed;
+    absl::flat_hash_set<std::string> sent_ids;
+    std::vector<PendingOperation> sent;
+    sent.reserve(batch.size());
+    for (PendingOperation& pending : batch) {
+      absl::Status input_status = ResolveInputRefs(pending, sent_ids, failed);
+      if (!input_status.ok()) {
+        failed.emplace(pending.operation.id(), input_status);
+        Resolve(pending, std::move(input_status));
+        continue;
+      }
+      sent_ids.insert(pending.operation.id());
+      // Operations which may have to be sent again (see `OnBatchDone`) are
+      // kept. Until the service is known to implement `ExecuteBatch`, that is
+      // all of them.
+      if (MayBeRetried(pending)) {
+        *request.add_operation() = pending.operation;
+      } else {
+        *request.add_operation() = std::move(pending.operation);
+      }
+      sent.push_back(std::move(pending));
+    }
+    if (sent.empty()) {
+      BatchDone();
+      return;
+    }
+    auto cancel_callbacks = std::make_shared<
+        std::vector<std::unique_ptr<ScopedCancellationCallback>>>();
+    SharedFuture<absl::StatusOr<v0::ExecuteBatchResponse>> response;
+    {
+      ScopedCancellationToken batch_token(
+          BatchCancellationToken(sent, *cancel_callbacks));
+      response = AsyncUnaryCall<v0::ExecuteBatchResponse>(
+          CompletionQueuePoller::Global(),
+          [this, &request](grpc::ClientContext* context,
+                           grpc::CompletionQueue* queue) {
+            return stub_->AsyncExecuteBatch(context, request, queue);
+          },
+          [](v0::ExecuteBatchResponse&& response)
+              -> absl::StatusOr<v0::ExecuteBatchResponse> {
+            return std::move(response);
+          });
+    }
+    // The callback holds `response`, so that the RPC is not abandoned, until
+    // it has run.
+    response.OnReady(
+        [response, self = shared_from_this(), sent = std::move(sent),
+         cancel_callbacks = std::move(cancel_callbacks)](
+            const SharedFuture<absl::StatusOr<v0::ExecuteBatchResponse>>&
+                done) mutable {
+          cancel_callbacks->clear();
+          self->OnBatchDone(done.get(), std::move(sent));
+        });
+  }
+
+  // Returns a token which is cancelled once the token of every operation in
+  // `batch` has been, since the batch is shared by the callers which added
+  // them. Returns null if an operation was added without a token, and so can
+  // never be cancelled. The callbacks registered with the operations' tokens
+  // are added to `callbacks`.
+  static std::shared_ptr<CancellationToken> BatchCancellationToken(
+      const std::vector<PendingOperation>& batch,
+      std::vector<std::unique_ptr<ScopedCancellationCallback>>& callbacks) {
+    for (const PendingOperation& pending : batch) {
+      if (pending.token == nullptr) {
+        return nullptr;
+      }
+    }
+    auto batch_token = std::make_shared<CancellationToken>();
+    auto num_uncancelled = std::make_shared<std::atomic<size_t>>(batch.size());
+    callbacks.reserve(batch.size());
+    for (const PendingOperation& pending : batch) {
+      callbacks.push_back(std::make_unique<ScopedCancellationCallback>(
+          pending.token, [batch_token, num_uncancelled]() {
+            if (num_uncancelled->fetch_sub(1) == 1) {
+              batch_token->Cancel();
+            }
+          }));
+    }
+    return batch_token;
+  }
+
+  // Replaces the IDs of `pending`'s inputs which are not created by the
+  // operations in `sent_ids` (and so have already been created) with their
+  // `ValueRef`s. Returns the failure of any of its inputs.
+  absl::Status ResolveInputRefs(
+      PendingOperation& pending,
+      const absl::flat_hash_set<std::string>& sent_ids,
+      const absl::flat_hash_map<std::string, absl::Status>& failed) {
+    std::vector<v0::ValueRef*> input_refs = InputRefs(pending.operation);
+    for (size_t i = 0; i < pending.inputs.size(); i++) {
+      const ExecutorValue& input = *pending.inputs[i];
+      if (sent_ids.contains(input.id())) {
+        continue;
+      }
+      auto it = failed.find(input.id());
+      if (it != failed.end()) {
+        return it->second;
+      }
+      *input_refs[i] = TFF_TRY(input.Ref());
+    }
+    return absl::OkStatus();
+  }
+
+  bool MayBeRetried(const PendingOperation& pending) const {
+    return pending.withheld_value != nullptr ||
+           !pending.operation.has_create_value() ||
+           !execute_batch_.implemented();
+  }
+
+  // Whether `pending`, which failed with `status`, should be sent again: it
+  // created a value by fingerprint which the service no longer had cached, or
+  // one of its inputs did.
+  static bool ShouldRetry(const PendingOperation& pending,
+                          const absl::Status& status,
+                          const absl::flat_hash_set<std::string>& retried) {
+    if (pending.withheld_value != nullptr) {
+      return status.code() == absl::StatusCode::kNotFound;
+    }
+    for (const std::shared_ptr<ExecutorValue>& input : pending.inputs) {
+      if (retried.contains(input->id())) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void OnBatchDone(const absl::StatusOr<v0::ExecuteBatchResponse>& response,
+                   std::vector<PendingOperation> sent) {
+    if (execute_batch_.FailedAsUnimplemented(response.status())) {
+      ThreadPool::Global().Schedule(
+          [self = shared_from_this(), sent = std::move(sent)]() mutable {
+            self->SendUnary(std::move(sent));
+          });
+      return;
+    }
+    std::vector<PendingOperation> retried;
+    absl::flat_hash_set<std::string> retried_ids;
+    for (size_t i = 0; i < sent.size(); i++) {
+      absl::StatusOr<v0::ValueRef> ref = ResultRef(response, i);
+      if (response.ok() && !ref.ok() &&
+          ShouldRetry(sent[i], ref.status(), retried_ids)) {
+        retried_ids.insert(sent[i].operation.id());
+        retried.push_back(std::move(sent[i]));
+        continue;
+      }
+      Resolve(sent[i], std::move(ref));
+    }
+    if (!retried.empty()) {
+      // The batch stays in flight until the retried operations complete.
+      ThreadPool::Global().Schedule(
+          [self = shared_from_this(), retried = std::move(retried)]() mutable {
+            self->Retry(std::move(retried));
+          });
+      return;
+    }
+    BatchDone();
+  }
+
+  // Marks the batch in flight as completed, and sends the open batch if it is
+  // ready.
+  void BatchDone() {
+    absl::MutexLock lock(&mutex_);
+    in_flight_ = false;
+    MaybeSendLocked();
+  }
+
+  // Sends the operations of `batch` one at a time, each in the unary RPC it
+  // stands for. Run on the thread pool, as the RPCs block.
+  void SendUnary(std::vector<PendingOperation> batch) {
+    for (PendingOperation& pending : batch) {
+      ScopedCancellationToken token(pending.token);
+      Resolve(pending, SendUnary(pending));
+    }
+    BatchDone();
+  }
+
+  absl::StatusOr<v0::ValueRef> SendUnary(PendingOperation& pending) {
+    // Inputs created earlier in the batch have been resolved by now.
+    std::vector<v0::ValueRef*> input_refs = InputRefs(pending.operation);
+    for (size_t i = 0; i < pending.inputs.size(); i++) {
+      *input_refs[i] = TFF_TRY(pending.inputs[i]->Ref());
+    }
+    v0::ExecuteBatchRequest::Operation& operation = pending.operation;
+    switch (operation.operation_case()) {
+      case v0::ExecuteBatchRequest::Operation::kCreateValue: {
+        v0::CreateValueRequest* create_value = operation.mutable_create_value();
+        if (pending.withheld_value != nullptr) {
+          *create_value->mutable_value() = *pending.withheld_value;
+        }
+        return UnaryCall(&v0::ExecutorGroup::StubInterface::CreateValue,
+                         *create_value);
+      }
+      case v0::ExecuteBatchRequest::Operation::kCreateCall:
+        return UnaryCall(&v0::ExecutorGroup::StubInterface::CreateCall,
+                         *operation.mutable_create_call());
+      case v0::ExecuteBatchRequest::Operation::kCreateStruct:
+        return UnaryCall(&v0::ExecutorGroup::StubInterface::CreateStruct,
+                         *operation.mutable_create_struct());
+      case v0::ExecuteBatchRequest::Operation::kCreateSelection:
+        return UnaryCall(&v0::ExecutorGroup::StubInterface::CreateSelection,
+                         *operation.mutable_create_selection());
+      default:
+        return absl::InternalError("No operation set.");
+    }
+  }
+
+  // Calls the unary `method` of the stub with `request`, and returns the
+  // `ValueRef` of the value it creates.
+  template <typename Request, typename Response>
+  absl::StatusOr<v0::ValueRef> UnaryCall(
+      grpc::Status (v0::ExecutorGroup::StubInterface::*method)(
+          grpc::ClientContext*, const Request&, Response*),
+      Request& request) {
+    *request.mutable_executor() = executor_pb_;
+    Response response;
+    grpc::ClientContext client_context;
+    ScopedCancellationCallback cancel_rpc(
+        CancellationToken::Current(),
+        [&client_context]() { client_context.TryCancel(); });
+    ThreadPool::ScopedBlockingCall blocking_call;
+    TFF_TRY(grpc_to_absl(
+        ((*stub_).*method)(&client_context, request, &response)));
+    return std::move(*response.mutable_value_ref());
+  }
+
+  // Sends `batch` again, with the values withheld from its operations. Run on
+  // the thread pool, as withheld values too large to be batched are streamed
+  // instead, which blocks.
+  void Retry(std::vector<PendingOperation> batch) {
+    std::vector<PendingOperation> resent;
+    resent.reserve(batch.size());
+    for (PendingOperation& pending : batch) {
+      std::shared_ptr<const v0::Value> withheld_value =
+          std::move(pending.withheld_value);
+      if (withheld_value == nullptr) {
+        resent.push_back(std::move(pending));
+        continue;
+      }
+      v0::CreateValueRequest* create_value =
+          pending.operation.mutable_create_value();
+      if (withheld_value->ByteSizeLong() > kMaxUnstreamedValueBytes) {
+        ScopedCancellationToken token(pending.token);
+        Resolve(pending, StreamValue(*stub_, executor_pb_, *withheld_value,
+                                     create_value->value_fingerprint()));
+        continue;
+      }
+      *create_value->mutable_value() = *withheld_value;
+      resent.push_back(std::move(pending));
+    }
+    Send(std::move(resent));
+  }
+
+  // Sets the result of `pending`.
+  void Resolve(const PendingOperation& pending,
+               absl::StatusOr<v0::ValueRef> ref) {
+    if (std::shared_ptr<ExecutorValue> value = pending.value.lock()) {
+      value->Resolve(std::move(ref));
+    } else if (ref.ok()) {
+      // The value was released before its operation completed.
+      dispose_batcher_->Dispose(std::move(ref).value());
+    }
+  }
+
+  static absl::StatusOr<v0::ValueRef> ResultRef(
+      const absl::StatusOr<v0::ExecuteBatchResponse>& response, size_t index) {
+    if (!response.ok()) {
+      return response.status();
+    }
+    if (index >= static_cast<size_t>(response->result_size())) {
+      return absl::InternalError(
+          "ExecuteBatch returned fewer results than operations.");
+    }
+    const v0::ExecuteBatchResponse::Result& result = response->result(index);
+    if (result.error_code() != 0) {
+      return absl::Status(static_cast<absl::StatusCode>(result.error_code()),
+                          result.error_message());
+    }
+    return result.value_ref();
+  }
+
+  const std::shared_ptr<v0::ExecutorGroup::StubInterface> stub_;
+  const v0::ExecutorId executor_pb_;
+  const std::shared_ptr<DisposeBatcher> dispose_batcher_;
+  OptionalRpc execute_batch_;
+  absl::Mutex mutex_;
+  std::vector<PendingOperation> open_operations_ ABSL_GUARDED_BY(mutex_);
+  size_t open_bytes_ ABSL_GUARDED_BY(mutex_) = 0;
+  absl::Time oldest_open_time_ ABSL_GUARDED_BY(mutex_);
+  // The index of the open batch, incremented each time a batch is sent.
+  uint64_t open_batch_ ABSL_GUARDED_BY(mutex_) = 0;
+  // A lower bound on the batch indices of the open operations, which may
+  // include operations left over from a batch too large to send at once.
+  uint64_t first_open_batch_ ABSL_GUARDED_BY(mutex_) = 0;
+  uint64_t next_id_ ABSL_GUARDED_BY(mutex_) = 0;
+  bool flush_requested_ ABSL_GUARDED_BY(mutex_) = false;
+  bool in_flight_ ABSL_GUARDED_BY(mutex_) = false;
+  bool alarm_set_ ABSL_GUARDED_BY(mutex_) = false;
+  bool shutting_down_ ABSL_GUARDED_BY(mutex_) = false;
+};
+
+using ValuePtr = std::shared_ptr<ExecutorValue>;
+
+class RemoteExecutor : public ExecutorBase<ValuePtr> {
  public:
   RemoteExecutor(std::unique_ptr<v0::ExecutorGroup::StubInterface> stub,
                  const CardinalityMap& cardinalities)
       : stub_(stub.release(), StubDeleter()), cardinalities_(cardinalities) {}
 
-  ~RemoteExecutor() override {}
+  ~RemoteExecutor() override {
+    if (operation_batcher_ != nullptr) {
+      operation_batcher_->Shutdown();
+    }
+  }
 
   absl::string_view ExecutorName() final {
     static constexpr absl::string_view kExecutorName = "RemoteExecutor";
     return kExecutorName;
   }
 
-  absl::StatusOr<ValueFuture> CreateExecutorValue(
+  absl::StatusOr<ValuePtr> CreateExecutorValue(
       const v0::Value& value_pb) final;
 
-  absl::StatusOr<ValueFuture> CreateCall(
-      ValueFuture function, absl::optional<ValueFuture> argument) final;
+  absl::StatusOr<ValuePtr> CreateCall(
+      ValuePtr function, absl::optional<ValuePtr> argument) final;
+
+  absl::StatusOr<ValuePtr> CreateStruct(std::vector<ValuePtr> members) final;
 
-  absl::StatusOr<ValueFuture> CreateStruct(
-      std::vector<ValueFuture> members) final;
+  absl::StatusOr<ValuePtr> CreateSelection(ValuePtr value,
+                                           const uint32_t index) final;
 
-  absl::StatusOr<ValueFuture> CreateSelection(ValueFuture value,
-                                              const uint32_t index) final;
+  absl::Status Materialize(ValuePtr value, v0::Value* value_pb) final;
 
-  absl::Status Materialize(ValueFuture value, v0::Value* value_pb) final;
+  // The batched operations share a single `EnsureInitialized` check, and so a
+  // single acquisition of `mutex_`, across the whole batch.
+  absl::StatusOr<std::vector<ValuePtr>> CreateExecutorValues(
+      absl::Span<const v0::Value* const> values_pb) final;
+
+  absl::StatusOr<std::vector<ValuePtr>> CreateCalls(
+      ValuePtr function, std::vector<ValuePtr> arguments) final;
+
+  absl::StatusOr<std::vector<ValuePtr>> CreateSelections(
+      ValuePtr value, absl::Span<const uint32_t> indices) final;
 
  private:
   absl::Status EnsureInitialized();
+
+  // Queue the corresponding operation on `operation_batcher_`.
+  // `EnsureInitialized` must have returned `ok` before these are called.
+  ValuePtr AddCreateValue(const v0::Value& value_pb);
+  ValuePtr AddCreateCall(ValuePtr function, absl::optional<ValuePtr> argument);
+  ValuePtr AddCreateSelection(ValuePtr value, uint32_t index);
+
+  // Records that the value with `fingerprint` has been sent to the remote
+  // executor. Returns whether it had been sent already.
+  bool MarkFingerprintSent(const std::string& fingerprint);
+
+  // Computes the value referred to by `request` with a `ComputeStream` RPC.
+  absl::Status ComputeStream(const v0::ComputeRequest& request,
+                             v0::Value* value_pb);
+
   std::shared_ptr<v0::ExecutorGroup::StubInterface> stub_;
   CardinalityMap cardinalities_;
   absl::Mutex mutex_;
   bool executor_pb_set_ ABSL_GUARDED_BY(mutex_) = false;
+  // All set once by `EnsureInitialized`.
   v0::ExecutorId executor_pb_;
-};
-
-class ExecutorValue {
- public:
-  ExecutorValue(v0::ValueRef value_ref, v0::ExecutorId executor_pb,
-                std::shared_ptr<v0::ExecutorGroup::StubInterface> stub)
-      : value_ref_(std::move(value_ref)),
-        executor_pb_(std::move(executor_pb)),
-        stub_(stub) {}
-  // Dispose implemented for now just on destructors, and stub is copied in.
-  ~ExecutorValue() {
-    ThreadRun([value_ref = value_ref_, executor_pb = executor_pb_,
-               stub = stub_] {
-      v0::DisposeRequest request;
-      v0::DisposeResponse response;
-      grpc::ClientContext context;
-      *request.mutable_executor() = std::move(executor_pb);
-      *request.add_value_ref() = value_ref;
-      grpc::Status dispose_status = stub->Dispose(&context, request, &response);
-      if (!dispose_status.ok()) {
-        LOG(ERROR) << "Error disposing of ExecutorValue [" << value_ref.id()
-                   << "]: " << grpc_to_absl(dispose_status);
-      }
-    });
-  }
-
-  v0::ValueRef Get() const { return value_ref_; }
-
- private:
-  v0::ValueRef value_ref_;
-  v0::ExecutorId executor_pb_;
-  std::shared_ptr<v0::ExecutorGroup::StubInterface> stub_;
+  std::shared_ptr<DisposeBatcher> dispose_batcher_;
+  std::shared_ptr<OperationBatcher> operation_batcher_;
+  // Shared with the tasks uploading large values.
+  const std::shared_ptr<OptionalRpc> create_value_stream_ =
+      std::make_shared<OptionalRpc>();
+  OptionalRpc compute_stream_;
+  absl::Mutex fingerprints_mutex_;
+  // The fingerprints of the last `kMaxSentFingerprints` values sent.
+  absl::flat_hash_set<std::string> sent_fingerprints_
+      ABSL_GUARDED_BY(fingerprints_mutex_);
+  std::deque<std::string> sent_fingerprint_order_
+      ABSL_GUARDED_BY(fingerprints_mutex_);
 };
 
 absl::Status RemoteExecutor::EnsureInitialized() {
@@ -172,6 +1081,9 @@ absl::Status RemoteExecutor::EnsureInitialized() {
   auto result = stub_->GetExecutor(&client_context, request, &response);
   if (result.ok()) {
     executor_pb_ = response.executor();
+    dispose_batcher_ = std::make_shared<DisposeBatcher>(stub_, executor_pb_);
+    operation_batcher_ = std::make_shared<OperationBatcher>(
+        stub_, executor_pb_, dispose_batcher_);
     executor_pb_set_ = true;
     // Tell the `StubDeleter` which executor it should delete when the stub is
     // no longer referenced.
@@ -180,113 +1092,191 @@ absl::Status RemoteExecutor::EnsureInitialized() {
   return grpc_to_absl(result);
 }
 
-absl::StatusOr<ValueFuture> RemoteExecutor::CreateExecutorValue(
+absl::StatusOr<ValuePtr> RemoteExecutor::CreateExecutorValue(
     const v0::Value& value_pb) {
   TFF_TRY(EnsureInitialized());
-  v0::CreateValueRequest request;
-  *request.mutable_executor() = executor_pb_;
-  *request.mutable_value() = value_pb;
+  return AddCreateValue(value_pb);
+}
 
-  return ThreadRun(
-      [request = std::move(request), executor_pb = executor_pb_,
-       stub = this->stub_]() -> absl::StatusOr<std::shared_ptr<ExecutorValue>> {
-        v0::CreateValueResponse response;
-        grpc::ClientContext client_context;
-        grpc::Status status =
-            stub->CreateValue(&client_context, request, &response);
-        TFF_TRY(grpc_to_absl(status));
-        return std::make_shared<ExecutorValue>(std::move(response.value_ref()),
-                                               executor_pb, stub);
-      });
+absl::StatusOr<std::vector<ValuePtr>> RemoteExecutor::CreateExecutorValues(
+    absl::Span<const v0::Value* const> values_pb) {
+  TFF_TRY(EnsureInitialized());
+  std::vector<ValuePtr> values;
+  values.reserve(values_pb.size());
+  for (const v0::Value* value_pb : values_pb) {
+    values.push_back(AddCreateValue(*value_pb));
+  }
+  return values;
+}
+
+ValuePtr RemoteExecutor::AddCreateValue(const v0::Value& value_pb) {
+  size_t value_bytes = value_pb.ByteSizeLong();
+  v0::ExecuteBatchRequest::Operation operation;
+  v0::CreateValueRequest* create_value = operation.mutable_create_value();
+  // Values are only withheld from batches, so without `ExecuteBatch` there is
+  // nothing to gain from fingerprinting them.
+  if (value_bytes >= kMinFingerprintedValueBytes &&
+      !operation_batcher_->sends_unary_rpcs() && IsLikelyResent(value_pb)) {
+    create_value->set_value_fingerprint(ValueFingerprint(value_pb));
+    if (MarkFingerprintSent(create_value->value_fingerprint())) {
+      // The value is most likely still cached by the service; it is only sent
+      // again if not.
+      return operation_batcher_->Add(
+          std::move(operation), {},
+          std::make_shared<const v0::Value>(value_pb));
+    }
+  }
+  if (value_bytes > kMaxUnstreamedValueBytes) {
+    // Uploading the value takes a while, so it is done on the thread pool
+    // rather than blocking the caller. Operations using the value wait for it
+    // when their batch is sent.
+    ValuePtr value = operation_batcher_->AddUnbatched();
+    ThreadPool::Global().Schedule(
+        [stub = stub_, executor_pb = executor_pb_,
+         create_value_stream = create_value_stream_, value,
+         value_pb = std::make_shared<const v0::Value>(value_pb),
+         value_fingerprint = create_value->value_fingerprint(),
+         token = CancellationToken::Current()]() {
+          ScopedCancellationToken scoped_token(token);
+          value->Resolve(CreateLargeValue(*stub, executor_pb, *value_pb,
+                                          value_fingerprint,
+                                          *create_value_stream));
+        });
+    return value;
+  }
+  *create_value->mutable_value() = value_pb;
+  return operation_batcher_->Add(std::move(operation), {});
+}
+
+bool RemoteExecutor::MarkFingerprintSent(const std::string& fingerprint) {
+  absl::MutexLock lock(&fingerprints_mutex_);
+  if (!sent_fingerprints_.insert(fingerprint).second) {
+    return true;
+  }
+  sent_fingerprint_order_.push_back(fingerprint);
+  if (sent_fingerprint_order_.size() > kMaxSentFingerprints) {
+    sent_fingerprints_.erase(sent_fingerprint_order_.front());
+    sent_fingerprint_order_.pop_front();
+  }
+  return false;
 }
 
-absl::StatusOr<ValueFuture> RemoteExecutor::CreateCall(
-    ValueFuture function, absl::optional<ValueFuture> argument) {
+absl::StatusOr<ValuePtr> RemoteExecutor::CreateCall(
+    ValuePtr function, absl::optional<ValuePtr> argument) {
   TFF_TRY(EnsureInitialized());
-  return ThreadRun(
-      [function = std::move(function), argument = std::move(argument),
-       executor_pb = executor_pb_,
-       stub = this->stub_]() -> absl::StatusOr<std::shared_ptr<ExecutorValue>> {
-        v0::CreateCallRequest request;
-        v0::CreateCallResponse response;
-        grpc::ClientContext context;
-        std::shared_ptr<ExecutorValue> fn = TFF_TRY(Wait(function));
-
-        *request.mutable_executor() = executor_pb;
-        *request.mutable_function_ref() = fn->Get();
-        if (argument.has_value()) {
-          std::shared_ptr<ExecutorValue> arg_value =
-              TFF_TRY(Wait(argument.value()));
-          *request.mutable_argument_ref() = arg_value->Get();
-        }
+  return AddCreateCall(std::move(function), std::move(argument));
+}
 
-        grpc::Status status = stub->CreateCall(&context, request, &response);
-        TFF_TRY(grpc_to_absl(status));
-        return std::make_shared<ExecutorValue>(std::move(response.value_ref()),
-                                               executor_pb, stub);
-      });
+absl::StatusOr<std::vector<ValuePtr>> RemoteExecutor::CreateCalls(
+    ValuePtr function, std::vector<ValuePtr> arguments) {
+  TFF_TRY(EnsureInitialized());
+  std::vector<ValuePtr> results;
+  results.reserve(arguments.size());
+  for (ValuePtr& argument : arguments) {
+    results.push_back(AddCreateCall(function, std::move(argument)));
+  }
+  return results;
+}
+
+ValuePtr RemoteExecutor::AddCreateCall(ValuePtr function,
+                                       absl::optional<ValuePtr> argument) {
+  v0::ExecuteBatchRequest::Operation operation;
+  v0::CreateCallRequest* create_call = operation.mutable_create_call();
+  create_call->mutable_function_ref();
+  std::vector<ValuePtr> inputs = {std::move(function)};
+  if (argument.has_value()) {
+    create_call->mutable_argument_ref();
+    inputs.push_back(std::move(argument.value()));
+  }
+  return operation_batcher_->Add(std::move(operation), std::move(inputs));
 }
 
-absl::StatusOr<ValueFuture> RemoteExecutor::CreateStruct(
-    std::vector<ValueFuture> members) {
+absl::StatusOr<ValuePtr> RemoteExecutor::CreateStruct(
+    std::vector<ValuePtr> members) {
   TFF_TRY(EnsureInitialized());
-  return ThreadRun(
-      [futures = std::move(members), executor_pb = executor_pb_,
-       stub = this->stub_]() -> absl::StatusOr<std::shared_ptr<ExecutorValue>> {
-        v0::CreateStructRequest request;
-        *request.mutable_executor() = executor_pb;
-        v0::CreateStructResponse response;
-        grpc::ClientContext context;
-        std::vector<std::shared_ptr<ExecutorValue>> values =
-            TFF_TRY(WaitAll(futures));
-        for (const std::shared_ptr<ExecutorValue>& element : values) {
-          v0::CreateStructRequest_Element struct_elem;
-          *struct_elem.mutable_value_ref() = element->Get();
-          request.mutable_element()->Add(std::move(struct_elem));
-        }
-        grpc::Status status = stub->CreateStruct(&context, request, &response);
-        TFF_TRY(grpc_to_absl(status));
-        return std::make_shared<ExecutorValue>(std::move(response.value_ref()),
-                                               executor_pb, stub);
-      });
+  v0::ExecuteBatchRequest::Operation operation;
+  v0::CreateStructRequest* create_struct = operation.mutable_create_struct();
+  for (size_t i = 0; i < members.size(); i++) {
+    create_struct->add_element();
+  }
+  return operation_batcher_->Add(std::move(operation), std::move(members));
 }
 
-absl::StatusOr<ValueFuture> RemoteExecutor::CreateSelection(
-    ValueFuture value, const uint32_t index) {
+absl::StatusOr<ValuePtr> RemoteExecutor::CreateSelection(
+    ValuePtr value, const uint32_t index) {
   TFF_TRY(EnsureInitialized());
-  return ThreadRun(
-      [source = std::move(value), index = index, executor_pb = executor_pb_,
-       stub = this->stub_]() -> absl::StatusOr<std::shared_ptr<ExecutorValue>> {
-        v0::CreateSelectionRequest request;
-        v0::CreateSelectionResponse response;
-        grpc::ClientContext context;
-        std::shared_ptr<ExecutorValue> source_value = TFF_TRY(Wait(source));
-        *request.mutable_executor() = executor_pb;
-        *request.mutable_source_ref() = source_value->Get();
-        request.set_index(index);
-        grpc::Status status =
-            stub->CreateSelection(&context, request, &response);
-        TFF_TRY(grpc_to_absl(status));
-        return std::make_shared<ExecutorValue>(std::move(response.value_ref()),
-                                               executor_pb, stub);
-      });
+  return AddCreateSelection(std::move(value), index);
 }
 
-absl::Status RemoteExecutor::Materialize(ValueFuture value,
-                                         v0::Value* value_pb) {
+absl::StatusOr<std::vector<ValuePtr>> RemoteExecutor::CreateSelections(
+    ValuePtr value, absl::Span<const uint32_t> indices) {
+  TFF_TRY(EnsureInitialized());
+  std::vector<ValuePtr> results;
+  results.reserve(indices.size());
+  for (uint32_t index : indices) {
+    results.push_back(AddCreateSelection(value, index));
+  }
+  return results;
+}
+
+ValuePtr RemoteExecutor::AddCreateSelection(ValuePtr value, uint32_t index) {
+  v0::ExecuteBatchRequest::Operation operation;
+  operation.mutable_create_selection()->set_index(index);
+  return operation_batcher_->Add(std::move(operation), {std::move(value)});
+}
+
+absl::Status RemoteExecutor::Materialize(ValuePtr value, v0::Value* value_pb) {
+  operation_batcher_->Flush(*value);
+  ThreadPool::ScopedBlockingCall blocking_call;
   v0::ComputeRequest request;
-  std::shared_ptr<ExecutorValue> value_ref = TFF_TRY(Wait(value));
   *request.mutable_executor() = executor_pb_;
-  *request.mutable_value_ref() = value_ref->Get();
+  *request.mutable_value_ref() = TFF_TRY(value->WaitForRef());
+  if (!compute_stream_.unimplemented()) {
+    absl::Status status = ComputeStream(request, value_pb);
+    if (!compute_stream_.FailedAsUnimplemented(status)) {
+      return status;
+    }
+  }
+  v0::ComputeResponse response;
+  grpc::ClientContext client_context;
+  ScopedCancellationCallback cancel_rpc(
+      CancellationToken::Current(),
+      [&client_context]() { client_context.TryCancel(); });
+  TFF_TRY(grpc_to_absl(stub_->Compute(&client_context, request, &response)));
+  *value_pb = std::move(*response.mutable_value());
+  return absl::OkStatus();
+}
 
-  v0::ComputeResponse compute_response;
+absl::Status RemoteExecutor::ComputeStream(const v0::ComputeRequest& request,
+                                           v0::Value* value_pb) {
   grpc::ClientContext client_context;
-  grpc::Status status =
-      stub_->Compute(&client_context, request, &compute_response);
-  *value_pb = std::move(*compute_response.mutable_value());
-  return grpc_to_absl(status);
+  ScopedCancellationCallback cancel_rpc(
+      CancellationToken::Current(),
+      [&client_context]() { client_context.TryCancel(); });
+  // The value is streamed back in chunks, so that its size is not limited by
+  // the maximum message size.
+  std::unique_ptr<grpc::ClientReaderInterface<v0::ComputeStreamResponse>>
+      stream = stub_->ComputeStream(&client_context, request);
+  ValueChunkReader reader;
+  absl::Status read_status;
+  v0::ComputeStreamResponse response;
+  while (stream->Read(&response)) {
+    if (read_status.ok()) {
+      read_status = reader.Add(std::move(*response.mutable_chunk()));
+      if (!read_status.ok()) {
+        client_context.TryCancel();
+      }
+    }
+  }
+  grpc::Status status = stream->Finish();
+  TFF_TRY(read_status);
+  TFF_TRY(grpc_to_absl(status));
+  *value_pb = TFF_TRY(reader.Finish());
+  return absl::OkStatus();
 }
 
+}  // namespace
+
 std::shared_ptr<Executor> CreateRemoteExecutor(
     std::unique_ptr<v0::ExecutorGroup::StubInterface> stub,
     const CardinalityMap& cardinalities) {
@@ -300,4 +1290,5 @@ std::shared_ptr<Executor> CreateRemoteExecutor(
       v0::ExecutorGroup::NewStub(channel));
   return std::make_shared<RemoteExecutor>(std::move(stub), cardinalities);
 }
+
 }  // namespace tensorflow_federated
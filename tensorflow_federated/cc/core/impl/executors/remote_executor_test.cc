@@ -28,14 +28,20 @@ limitations under the License
 #include "absl/container/flat_hash_map.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 #include "absl/synchronization/notification.h"
 #include "absl/time/time.h"
 #include "absl/types/optional.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow_federated/cc/core/impl/executors/cancellation.h"
 #include "tensorflow_federated/cc/core/impl/executors/executor.h"
 #include "tensorflow_federated/cc/core/impl/executors/mock_grpc.h"
 #include "tensorflow_federated/cc/core/impl/executors/protobuf_matchers.h"
+#include "tensorflow_federated/cc/core/impl/executors/status_conversion.h"
 #include "tensorflow_federated/cc/core/impl/executors/status_matchers.h"
+#include "tensorflow_federated/cc/core/impl/executors/value_streaming.h"
 #include "tensorflow_federated/cc/core/impl/executors/value_test_utils.h"
 #include "tensorflow_federated/proto/v0/executor.grpc.pb.h"
 #include "tensorflow_federated/proto/v0/executor.pb.h"
@@ -122,9 +128,176 @@ class RemoteExecutorTest : public ::testing::Test {
     std::unique_ptr<v0::ExecutorGroup::Stub> stub_ptr(mock_executor_.NewStub());
     CardinalityMap cardinalities = {{"server", 1}, {"clients", 1}};
     test_executor_ = CreateRemoteExecutor(std::move(stub_ptr), cardinalities);
+    EXPECT_CALL(*mock_executor_service_,
+                ExecuteBatch(::testing::_, ::testing::_, ::testing::_))
+        .WillRepeatedly([this](grpc::ServerContext* context,
+                               const v0::ExecuteBatchRequest* request,
+                               v0::ExecuteBatchResponse* response) {
+          return ExecuteBatchViaUnaryMethods(context, request, response);
+        });
+    EXPECT_CALL(*mock_executor_service_,
+                CreateValueStream(::testing::_, ::testing::_, ::testing::_))
+        .WillRepeatedly(
+            [this](grpc::ServerContext* context,
+                   grpc::ServerReader<v0::CreateValueStreamRequest>* reader,
+                   v0::CreateValueResponse* response) {
+              return CreateValueStreamViaCreateValue(context, reader,
+                                                     response);
+            });
+    EXPECT_CALL(*mock_executor_service_,
+                ComputeStream(::testing::_, ::testing::_, ::testing::_))
+        .WillRepeatedly(
+            [this](grpc::ServerContext* context,
+                   const v0::ComputeRequest* request,
+                   grpc::ServerWriter<v0::ComputeStreamResponse>* writer) {
+              return ComputeStreamViaCompute(context, request, writer);
+            });
   }
   ~RemoteExecutorTest() override { test_executor_ = nullptr; }
 
+  // Runs each operation of an `ExecuteBatch` request through the mock's
+  // corresponding unary method, with references to earlier operations in the
+  // batch replaced by the references those returned. This lets tests set
+  // expectations on the unary methods regardless of how operations end up
+  // being batched.
+  grpc::Status ExecuteBatchViaUnaryMethods(
+      grpc::ServerContext* context, const v0::ExecuteBatchRequest* request,
+      v0::ExecuteBatchResponse* response) {
+    absl::flat_hash_map<std::string, v0::ExecuteBatchResponse::Result>
+        batch_results;
+    for (const v0::ExecuteBatchRequest::Operation& operation :
+         request->operation()) {
+      v0::ExecuteBatchResponse::Result* result = response->add_result();
+      grpc::Status status = grpc::Status::OK;
+      // Replaces a reference to an earlier operation in the batch, failing if
+      // that operation failed.
+      auto resolve = [&batch_results, &status, result](v0::ValueRef* ref) {
+        auto it = batch_results.find(ref->id());
+        if (it == batch_results.end()) {
+          return;
+        }
+        if (it->second.error_code() != 0) {
+          *result = it->second;
+          status = grpc::Status(grpc::StatusCode::CANCELLED, "");
+          return;
+        }
+        *ref = it->second.value_ref();
+      };
+      switch (operation.operation_case()) {
+        case v0::ExecuteBatchRequest::Operation::kCreateValue: {
+          v0::CreateValueRequest unary_request = operation.create_value();
+          *unary_request.mutable_executor() = request->executor();
+          v0::CreateValueResponse unary_response;
+          status = mock_executor_service_->CreateValue(context, &unary_request,
+                                                       &unary_response);
+          *result->mutable_value_ref() = unary_response.value_ref();
+          break;
+        }
+        case v0::ExecuteBatchRequest::Operation::kCreateCall: {
+          v0::CreateCallRequest unary_request = operation.create_call();
+          *unary_request.mutable_executor() = request->executor();
+          resolve(unary_request.mutable_function_ref());
+          if (unary_request.has_argument_ref()) {
+            resolve(unary_request.mutable_argument_ref());
+          }
+          if (!status.ok()) {
+            break;
+          }
+          v0::CreateCallResponse unary_response;
+          status = mock_executor_service_->CreateCall(context, &unary_request,
+                                                      &unary_response);
+          *result->mutable_value_ref() = unary_response.value_ref();
+          break;
+        }
+        case v0::ExecuteBatchRequest::Operation::kCreateStruct: {
+          v0::CreateStructRequest unary_request = operation.create_struct();
+          *unary_request.mutable_executor() = request->executor();
+          for (v0::CreateStructRequest::Element& element :
+               *unary_request.mutable_element()) {
+            resolve(element.mutable_value_ref());
+          }
+          if (!status.ok()) {
+            break;
+          }
+          v0::CreateStructResponse unary_response;
+          status = mock_executor_service_->CreateStruct(
+              context, &unary_request, &unary_response);
+          *result->mutable_value_ref() = unary_response.value_ref();
+          break;
+        }
+        case v0::ExecuteBatchRequest::Operation::kCreateSelection: {
+          v0::CreateSelectionRequest unary_request =
+              operation.create_selection();
+          *unary_request.mutable_executor() = request->executor();
+          resolve(unary_request.mutable_source_ref());
+          if (!status.ok()) {
+            break;
+          }
+          v0::CreateSelectionResponse unary_response;
+          status = mock_executor_service_->CreateSelection(
+              context, &unary_request, &unary_response);
+          *result->mutable_value_ref() = unary_response.value_ref();
+          break;
+        }
+        default:
+          return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT,
+                              "No operation set.");
+      }
+      if (!status.ok() && result->error_code() == 0) {
+        result->Clear();
+        result->set_error_code(status.error_code());
+        result->set_error_message(status.error_message());
+      }
+      batch_results.emplace(operation.id(), *result);
+    }
+    return grpc::Status::OK;
+  }
+
+  // Reassembles the value streamed to `CreateValueStream` and passes it to
+  // the mock's `CreateValue`.
+  grpc::Status CreateValueStreamViaCreateValue(
+      grpc::ServerContext* context,
+      grpc::ServerReader<v0::CreateValueStreamRequest>* reader,
+      v0::CreateValueResponse* response) {
+    v0::CreateValueRequest unary_request;
+    ValueChunkReader value_reader;
+    v0::CreateValueStreamRequest request;
+    while (reader->Read(&request)) {
+      if (request.has_executor()) {
+        *unary_request.mutable_executor() = request.executor();
+      }
+      absl::Status status = value_reader.Add(request.chunk());
+      if (!status.ok()) {
+        return absl_to_grpc(status);
+      }
+    }
+    absl::StatusOr<v0::Value> value = value_reader.Finish();
+    if (!value.ok()) {
+      return absl_to_grpc(value.status());
+    }
+    *unary_request.mutable_value() = std::move(value).value();
+    return mock_executor_service_->CreateValue(context, &unary_request,
+                                               response);
+  }
+
+  // Streams the value returned by the mock's `Compute` back in chunks.
+  grpc::Status ComputeStreamViaCompute(
+      grpc::ServerContext* context, const v0::ComputeRequest* request,
+      grpc::ServerWriter<v0::ComputeStreamResponse>* writer) {
+    v0::ComputeResponse unary_response;
+    grpc::Status status =
+        mock_executor_service_->Compute(context, request, &unary_response);
+    if (!status.ok()) {
+      return status;
+    }
+    ValueChunkWriter value_writer(unary_response.value());
+    v0::ComputeStreamResponse response;
+    while (value_writer.Next(response.mutable_chunk())) {
+      writer->Write(response);
+    }
+    return grpc::Status::OK;
+  }
+
   // Adds expectations of calls to `GetExecutor` and `DisposeExecutor` and
   // returns a notification which notifies when `DisposeExecutor` is called.
   //
@@ -231,6 +404,588 @@ TEST_F(RemoteExecutorTest, CreateValueTensor) {
   WaitForDisposeExecutor(dispose_notification);
 }
 
+TEST_F(RemoteExecutorTest, LargeValuesAreStreamed) {
+  absl::Notification dispose_notification;
+  ExpectGetAndDisposeExecutor(dispose_notification);
+
+  // Larger than the maximum size of a gRPC message by default.
+  constexpr int64_t kNumElements = 2 * 1024 * 1024;
+  tensorflow::Tensor tensor(tensorflow::DT_FLOAT,
+                            tensorflow::TensorShape({kNumElements}));
+  auto flat = tensor.flat<float>();
+  for (int64_t i = 0; i < kNumElements; i++) {
+    flat(i) = static_cast<float>(i);
+  }
+  v0::Value large_value = testing::TensorV(tensor);
+  v0::Value materialized_value;
+  absl::Status materialize_status;
+  {
+    EXPECT_CALL(
+        *mock_executor_service_,
+        CreateValue(::testing::_,
+                    EqualsProto(CreateValueRequestForValue(large_value)),
+                    ::testing::_))
+        .WillOnce(ReturnOkWithResponseId<v0::CreateValueResponse>("value_ref"));
+    EXPECT_CALL(*mock_executor_service_,
+                CreateValueStream(::testing::_, ::testing::_, ::testing::_))
+        .WillOnce([this](
+                      grpc::ServerContext* context,
+                      grpc::ServerReader<v0::CreateValueStreamRequest>* reader,
+                      v0::CreateValueResponse* response) {
+          return CreateValueStreamViaCreateValue(context, reader, response);
+        });
+    EXPECT_CALL(*mock_executor_service_,
+                Dispose(::testing::_, ::testing::_, ::testing::_))
+        .WillOnce(::testing::Return(grpc::Status::OK));
+
+    OwnedValueId value_ref =
+        TFF_ASSERT_OK(test_executor_->CreateValue(large_value));
+
+    EXPECT_CALL(*mock_executor_service_,
+                Compute(::testing::_,
+                        EqualsProto(ComputeRequestForId("value_ref")),
+                        ::testing::_))
+        .WillOnce(ReturnOkWithComputeResponse(large_value));
+    materialize_status =
+        test_executor_->Materialize(value_ref, &materialized_value);
+  }
+
+  TFF_EXPECT_OK(materialize_status);
+  EXPECT_THAT(materialized_value, EqualsProto(large_value));
+  WaitForDisposeExecutor(dispose_notification);
+}
+
+TEST_F(RemoteExecutorTest, LargeValuesAreStreamedWithoutBlockingTheCaller) {
+  absl::Notification dispose_notification;
+  ExpectGetAndDisposeExecutor(dispose_notification);
+  constexpr int64_t kNumElements = 2 * 1024 * 1024;
+  tensorflow::Tensor tensor(tensorflow::DT_FLOAT,
+                            tensorflow::TensorShape({kNumElements}));
+  tensor.flat<float>().setZero();
+  v0::Value large_value = testing::TensorV(tensor);
+  absl::Notification release_stream;
+  v0::Value materialized_value;
+  absl::Status materialize_status;
+  {
+    EXPECT_CALL(*mock_executor_service_,
+                CreateValueStream(::testing::_, ::testing::_, ::testing::_))
+        .WillOnce([&release_stream](
+                      grpc::ServerContext*,
+                      grpc::ServerReader<v0::CreateValueStreamRequest>* reader,
+                      v0::CreateValueResponse* response) {
+          v0::CreateValueStreamRequest request;
+          while (reader->Read(&request)) {
+          }
+          release_stream.WaitForNotification();
+          response->mutable_value_ref()->set_id("value_ref");
+          return grpc::Status::OK;
+        });
+    v0::CreateCallRequest expected_call_request;
+    expected_call_request.mutable_executor()->set_id(kExecutorId);
+    expected_call_request.mutable_function_ref()->set_id("value_ref");
+    EXPECT_CALL(*mock_executor_service_,
+                CreateCall(::testing::_, EqualsProto(expected_call_request),
+                           ::testing::_))
+        .WillOnce(ReturnOkWithResponseId<v0::CreateCallResponse>("call_ref"));
+    EXPECT_CALL(
+        *mock_executor_service_,
+        Compute(::testing::_, EqualsProto(ComputeRequestForId("call_ref")),
+                ::testing::_))
+        .WillOnce(ReturnOkWithComputeResponse(testing::TensorV(2.0f)));
+    EXPECT_CALL(*mock_executor_service_,
+                Dispose(::testing::_, ::testing::_, ::testing::_))
+        .WillRepeatedly(::testing::Return(grpc::Status::OK));
+
+    // Neither call waits for the value to be uploaded.
+    OwnedValueId value =
+        TFF_ASSERT_OK(test_executor_->CreateValue(large_value));
+    OwnedValueId call =
+        TFF_ASSERT_OK(test_executor_->CreateCall(value, absl::nullopt));
+    release_stream.Notify();
+    materialize_status = test_executor_->Materialize(call, &materialized_value);
+  }
+
+  TFF_EXPECT_OK(materialize_status);
+  EXPECT_THAT(materialized_value, EqualsProto(testing::TensorV(2.0f)));
+  WaitForDisposeExecutor(dispose_notification);
+}
+
+TEST_F(RemoteExecutorTest, BatchesFitDefaultMaximumMessageSize) {
+  absl::Notification dispose_notification;
+  ExpectGetAndDisposeExecutor(dispose_notification);
+  // Three values which together, but not on their own, exceed gRPC's default
+  // maximum message size.
+  constexpr int64_t kNumElements = 384 * 1024;
+  tensorflow::Tensor tensor(tensorflow::DT_FLOAT,
+                            tensorflow::TensorShape({kNumElements}));
+  tensor.flat<float>().setZero();
+  v0::Value value = testing::TensorV(tensor);
+  std::vector<v0::ExecuteBatchRequest> batch_requests;
+  EXPECT_CALL(*mock_executor_service_,
+              ExecuteBatch(::testing::_, ::testing::_, ::testing::_))
+      .WillRepeatedly([this, &batch_requests](
+                          grpc::ServerContext* context,
+                          const v0::ExecuteBatchRequest* request,
+                          v0::ExecuteBatchResponse* response) {
+        batch_requests.push_back(*request);
+        return ExecuteBatchViaUnaryMethods(context, request, response);
+      });
+  EXPECT_CALL(*mock_executor_service_,
+              CreateValue(::testing::_, ::testing::_, ::testing::_))
+      .WillRepeatedly(
+          ReturnOkWithResponseId<v0::CreateValueResponse>("value_ref"));
+  EXPECT_CALL(*mock_executor_service_,
+              Compute(::testing::_, ::testing::_, ::testing::_))
+      .WillRepeatedly(ReturnOkWithComputeResponse(value));
+  EXPECT_CALL(*mock_executor_service_,
+              Dispose(::testing::_, ::testing::_, ::testing::_))
+      .WillRepeatedly(::testing::Return(grpc::Status::OK));
+  {
+    std::vector<OwnedValueId> values;
+    for (int i = 0; i < 3; i++) {
+      values.push_back(TFF_ASSERT_OK(test_executor_->CreateValue(value)));
+    }
+    for (const OwnedValueId& created : values) {
+      TFF_EXPECT_OK(test_executor_->Materialize(created));
+    }
+  }
+
+  int num_operations = 0;
+  for (const v0::ExecuteBatchRequest& batch_request : batch_requests) {
+    EXPECT_LE(batch_request.ByteSizeLong(), 4 * 1024 * 1024);
+    num_operations += batch_request.operation_size();
+  }
+  EXPECT_EQ(num_operations, 3);
+  WaitForDisposeExecutor(dispose_notification);
+}
+
+// Returns a tensor large enough to be fingerprinted.
+v0::Value LargeTensor() {
+  std::vector<int32_t> elements(1024);
+  for (size_t i = 0; i < elements.size(); i++) {
+    elements[i] = static_cast<int32_t>(i);
+  }
+  return testing::TensorVFromIntList(elements);
+}
+
+// Returns a value sent by fingerprint once it has been sent before.
+v0::Value FingerprintedValue() { return testing::ServerV(LargeTensor()); }
+
+TEST_F(RemoteExecutorTest, RepeatedValuesAreSentByFingerprint) {
+  absl::Notification dispose_notification;
+  ExpectGetAndDisposeExecutor(dispose_notification);
+  v0::Value value = FingerprintedValue();
+  std::vector<v0::ExecuteBatchRequest> batch_requests;
+  EXPECT_CALL(*mock_executor_service_,
+              ExecuteBatch(::testing::_, ::testing::_, ::testing::_))
+      .WillRepeatedly([this, &batch_requests](
+                          grpc::ServerContext* context,
+                          const v0::ExecuteBatchRequest* request,
+                          v0::ExecuteBatchResponse* response) {
+        batch_requests.push_back(*request);
+        return ExecuteBatchViaUnaryMethods(context, request, response);
+      });
+  EXPECT_CALL(*mock_executor_service_,
+              CreateValue(::testing::_, ::testing::_, ::testing::_))
+      .WillRepeatedly(
+          ReturnOkWithResponseId<v0::CreateValueResponse>("value_ref"));
+  EXPECT_CALL(*mock_executor_service_,
+              Compute(::testing::_, ::testing::_, ::testing::_))
+      .WillRepeatedly(ReturnOkWithComputeResponse(value));
+  EXPECT_CALL(*mock_executor_service_,
+              Dispose(::testing::_, ::testing::_, ::testing::_))
+      .WillRepeatedly(::testing::Return(grpc::Status::OK));
+  {
+    OwnedValueId first = TFF_ASSERT_OK(test_executor_->CreateValue(value));
+    TFF_EXPECT_OK(test_executor_->Materialize(first));
+    OwnedValueId second = TFF_ASSERT_OK(test_executor_->CreateValue(value));
+    TFF_EXPECT_OK(test_executor_->Materialize(second));
+  }
+
+  ASSERT_EQ(batch_requests.size(), 2);
+  ASSERT_EQ(batch_requests[0].operation_size(), 1);
+  ASSERT_EQ(batch_requests[1].operation_size(), 1);
+  const v0::CreateValueRequest& first_request =
+      batch_requests[0].operation(0).create_value();
+  const v0::CreateValueRequest& second_request =
+      batch_requests[1].operation(0).create_value();
+  EXPECT_THAT(first_request.value(), EqualsProto(value));
+  EXPECT_FALSE(first_request.value_fingerprint().empty());
+  EXPECT_FALSE(second_request.has_value());
+  EXPECT_EQ(second_request.value_fingerprint(),
+            first_request.value_fingerprint());
+  WaitForDisposeExecutor(dispose_notification);
+}
+
+TEST_F(RemoteExecutorTest, ValuesUnlikelyToBeRepeatedAreNotFingerprinted) {
+  absl::Notification dispose_notification;
+  ExpectGetAndDisposeExecutor(dispose_notification);
+  v0::Value value = testing::ClientsV({LargeTensor()});
+  std::vector<v0::ExecuteBatchRequest> batch_requests;
+  EXPECT_CALL(*mock_executor_service_,
+              ExecuteBatch(::testing::_, ::testing::_, ::testing::_))
+      .WillRepeatedly([this, &batch_requests](
+                          grpc::ServerContext* context,
+                          const v0::ExecuteBatchRequest* request,
+                          v0::ExecuteBatchResponse* response) {
+        batch_requests.push_back(*request);
+        return ExecuteBatchViaUnaryMethods(context, request, response);
+      });
+  EXPECT_CALL(*mock_executor_service_,
+              CreateValue(::testing::_, ::testing::_, ::testing::_))
+      .WillRepeatedly(
+          ReturnOkWithResponseId<v0::CreateValueResponse>("value_ref"));
+  EXPECT_CALL(*mock_executor_service_,
+              Compute(::testing::_, ::testing::_, ::testing::_))
+      .WillRepeatedly(ReturnOkWithComputeResponse(value));
+  EXPECT_CALL(*mock_executor_service_,
+              Dispose(::testing::_, ::testing::_, ::testing::_))
+      .WillRepeatedly(::testing::Return(grpc::Status::OK));
+  {
+    OwnedValueId first = TFF_ASSERT_OK(test_executor_->CreateValue(value));
+    TFF_EXPECT_OK(test_executor_->Materialize(first));
+    OwnedValueId second = TFF_ASSERT_OK(test_executor_->CreateValue(value));
+    TFF_EXPECT_OK(test_executor_->Materialize(second));
+  }
+
+  ASSERT_EQ(batch_requests.size(), 2);
+  for (const v0::ExecuteBatchRequest& batch_request : batch_requests) {
+    ASSERT_EQ(batch_request.operation_size(), 1);
+    const v0::CreateValueRequest& request =
+        batch_request.operation(0).create_value();
+    EXPECT_THAT(request.value(), EqualsProto(value));
+    EXPECT_TRUE(request.value_fingerprint().empty());
+  }
+  WaitForDisposeExecutor(dispose_notification);
+}
+
+TEST_F(RemoteExecutorTest, ValuesNoLongerCachedByServiceAreResent) {
+  absl::Notification dispose_notification;
+  ExpectGetAndDisposeExecutor(dispose_notification);
+  v0::Value value = FingerprintedValue();
+  std::vector<v0::ExecuteBatchRequest> batch_requests;
+  EXPECT_CALL(*mock_executor_service_,
+              ExecuteBatch(::testing::_, ::testing::_, ::testing::_))
+      .WillRepeatedly([&batch_requests](grpc::ServerContext*,
+                                        const v0::ExecuteBatchRequest* request,
+                                        v0::ExecuteBatchResponse* response) {
+        batch_requests.push_back(*request);
+        for (const v0::ExecuteBatchRequest::Operation& operation :
+             request->operation()) {
+          v0::ExecuteBatchResponse::Result* result = response->add_result();
+          // The service has evicted every value, and fails the operations
+          // which create values by fingerprint, along with their dependents.
+          if (batch_requests.size() == 2) {
+            result->set_error_code(static_cast<int32_t>(grpc::NOT_FOUND));
+            result->set_error_message("Not cached");
+            continue;
+          }
+          result->mutable_value_ref()->set_id(
+              absl::StrCat(batch_requests.size(), "_", operation.id()));
+        }
+        return grpc::Status::OK;
+      });
+  EXPECT_CALL(*mock_executor_service_,
+              Compute(::testing::_, ::testing::_, ::testing::_))
+      .WillRepeatedly(ReturnOkWithComputeResponse(value));
+  EXPECT_CALL(*mock_executor_service_,
+              Dispose(::testing::_, ::testing::_, ::testing::_))
+      .WillRepeatedly(::testing::Return(grpc::Status::OK));
+  {
+    OwnedValueId first = TFF_ASSERT_OK(test_executor_->CreateValue(value));
+    TFF_EXPECT_OK(test_executor_->Materialize(first));
+    OwnedValueId second = TFF_ASSERT_OK(test_executor_->CreateValue(value));
+    OwnedValueId call =
+        TFF_ASSERT_OK(test_executor_->CreateCall(second, absl::nullopt));
+    TFF_EXPECT_OK(test_executor_->Materialize(call));
+  }
+
+  ASSERT_EQ(batch_requests.size(), 3);
+  ASSERT_EQ(batch_requests[1].operation_size(), 2);
+  EXPECT_FALSE(batch_requests[1].operation(0).create_value().has_value());
+  // Both operations are sent again, with the value.
+  ASSERT_EQ(batch_requests[2].operation_size(), 2);
+  const v0::ExecuteBatchRequest::Operation& create_value =
+      batch_requests[2].operation(0);
+  EXPECT_THAT(create_value.create_value().value(), EqualsProto(value));
+  EXPECT_EQ(batch_requests[2].operation(1).create_call().function_ref().id(),
+            create_value.id());
+  WaitForDisposeExecutor(dispose_notification);
+}
+
+TEST_F(RemoteExecutorTest, DisposesValuesInBatches) {
+  absl::Notification dispose_notification;
+  ExpectGetAndDisposeExecutor(dispose_notification);
+  v0::Value tensor_two = testing::TensorV(2.0f);
+  v0::Value tensor_three = testing::TensorV(3.0f);
+
+  EXPECT_CALL(*mock_executor_service_,
+              CreateValue(::testing::_,
+                          EqualsProto(CreateValueRequestForValue(tensor_two)),
+                          ::testing::_))
+      .WillOnce(ReturnOkWithResponseId<v0::CreateValueResponse>("two_ref"));
+  EXPECT_CALL(*mock_executor_service_,
+              CreateValue(::testing::_,
+                          EqualsProto(CreateValueRequestForValue(tensor_three)),
+                          ::testing::_))
+      .WillOnce(ReturnOkWithResponseId<v0::CreateValueResponse>("three_ref"));
+  EXPECT_CALL(*mock_executor_service_,
+              CreateStruct(::testing::_, ::testing::_, ::testing::_))
+      .WillOnce(ReturnOkWithResponseId<v0::CreateStructResponse>("struct_ref"));
+  EXPECT_CALL(*mock_executor_service_,
+              Compute(::testing::_,
+                      EqualsProto(ComputeRequestForId("struct_ref")),
+                      ::testing::_))
+      .WillOnce(ReturnOkWithComputeResponse(tensor_two));
+
+  // All three values are disposed of at once when the executor is destroyed,
+  // and so should be coalesced into a single request.
+  v0::DisposeRequest expected_dispose_request;
+  expected_dispose_request.mutable_executor()->set_id(kExecutorId);
+  expected_dispose_request.add_value_ref()->set_id("two_ref");
+  expected_dispose_request.add_value_ref()->set_id("three_ref");
+  expected_dispose_request.add_value_ref()->set_id("struct_ref");
+  EXPECT_CALL(*mock_executor_service_,
+              Dispose(::testing::_,
+                      IgnoringRepeatedFieldOrdering(
+                          EqualsProto(expected_dispose_request)),
+                      ::testing::_))
+      .WillOnce(::testing::Return(grpc::Status::OK));
+
+  OwnedValueId two = TFF_ASSERT_OK(test_executor_->CreateValue(tensor_two));
+  OwnedValueId three = TFF_ASSERT_OK(test_executor_->CreateValue(tensor_three));
+  OwnedValueId structure =
+      TFF_ASSERT_OK(test_executor_->CreateStruct({two, three}));
+  // Forces all of the values above to be created before they are disposed of.
+  TFF_EXPECT_OK(test_executor_->Materialize(structure));
+  WaitForDisposeExecutor(dispose_notification);
+}
+
+TEST_F(RemoteExecutorTest, PipelinesDependentOperationsInOneBatch) {
+  absl::Notification dispose_notification;
+  ExpectGetAndDisposeExecutor(dispose_notification);
+  v0::Value tensor_two = testing::TensorV(2.0f);
+
+  // Each operation refers to the previous one by its client-assigned ID, and
+  // the whole chain is sent at once when the final value is materialized.
+  v0::ExecuteBatchRequest batch_request;
+  EXPECT_CALL(*mock_executor_service_,
+              ExecuteBatch(::testing::_, ::testing::_, ::testing::_))
+      .WillOnce([&batch_request](grpc::ServerContext*,
+                                 const v0::ExecuteBatchRequest* request,
+                                 v0::ExecuteBatchResponse* response) {
+        batch_request = *request;
+        for (const v0::ExecuteBatchRequest::Operation& operation :
+             request->operation()) {
+          response->add_result()->mutable_value_ref()->set_id(
+              absl::StrCat("ref_", operation.id()));
+        }
+        return grpc::Status::OK;
+      });
+  EXPECT_CALL(*mock_executor_service_,
+              Compute(::testing::_, ::testing::_, ::testing::_))
+      .WillOnce(ReturnOkWithComputeResponse(tensor_two));
+  EXPECT_CALL(*mock_executor_service_,
+              Dispose(::testing::_, ::testing::_, ::testing::_))
+      .WillRepeatedly(::testing::Return(grpc::Status::OK));
+
+  {
+    OwnedValueId fn = TFF_ASSERT_OK(test_executor_->CreateValue(tensor_two));
+    OwnedValueId call =
+        TFF_ASSERT_OK(test_executor_->CreateCall(fn, absl::nullopt));
+    OwnedValueId selection =
+        TFF_ASSERT_OK(test_executor_->CreateSelection(call, 0));
+    TFF_EXPECT_OK(test_executor_->Materialize(selection));
+  }
+
+  ASSERT_EQ(batch_request.operation_size(), 3);
+  EXPECT_EQ(batch_request.executor().id(), kExecutorId);
+  const std::string& value_id = batch_request.operation(0).id();
+  const std::string& call_id = batch_request.operation(1).id();
+  EXPECT_THAT(batch_request.operation(0).create_value().value(),
+              EqualsProto(tensor_two));
+  EXPECT_EQ(batch_request.operation(1).create_call().function_ref().id(),
+            value_id);
+  EXPECT_FALSE(batch_request.operation(1).create_call().has_argument_ref());
+  EXPECT_EQ(batch_request.operation(2).create_selection().source_ref().id(),
+            call_id);
+  WaitForDisposeExecutor(dispose_notification);
+}
+
+TEST_F(RemoteExecutorTest, LaterBatchesReferToEarlierValuesByServiceRef) {
+  absl::Notification dispose_notification;
+  ExpectGetAndDisposeExecutor(dispose_notification);
+  v0::Value tensor_two = testing::TensorV(2.0f);
+  EXPECT_CALL(*mock_executor_service_,
+              CreateValue(::testing::_, ::testing::_, ::testing::_))
+      .WillOnce(ReturnOkWithResponseId<v0::CreateValueResponse>("value_ref"));
+  EXPECT_CALL(*mock_executor_service_,
+              Compute(::testing::_, ::testing::_, ::testing::_))
+      .WillRepeatedly(ReturnOkWithComputeResponse(tensor_two));
+  EXPECT_CALL(*mock_executor_service_,
+              Dispose(::testing::_, ::testing::_, ::testing::_))
+      .WillRepeatedly(::testing::Return(grpc::Status::OK));
+  {
+    OwnedValueId value = TFF_ASSERT_OK(test_executor_->CreateValue(tensor_two));
+    // Forces the first batch to complete.
+    TFF_EXPECT_OK(test_executor_->Materialize(value));
+
+    v0::CreateSelectionRequest expected_request;
+    expected_request.mutable_executor()->set_id(kExecutorId);
+    expected_request.mutable_source_ref()->set_id("value_ref");
+    expected_request.set_index(0);
+    EXPECT_CALL(*mock_executor_service_,
+                CreateSelection(::testing::_, EqualsProto(expected_request),
+                                ::testing::_))
+        .WillOnce(ReturnOkWithResponseId<v0::CreateSelectionResponse>(
+            "selection_ref"));
+    OwnedValueId selection =
+        TFF_ASSERT_OK(test_executor_->CreateSelection(value, 0));
+    TFF_EXPECT_OK(test_executor_->Materialize(selection));
+  }
+  WaitForDisposeExecutor(dispose_notification);
+}
+
+TEST_F(RemoteExecutorTest, ExecuteBatchErrorFailsAllValues) {
+  absl::Notification dispose_notification;
+  ExpectGetAndDisposeExecutor(dispose_notification);
+  EXPECT_CALL(*mock_executor_service_,
+              ExecuteBatch(::testing::_, ::testing::_, ::testing::_))
+      .WillOnce(
+          ::testing::Return(grpc::Status(grpc::StatusCode::INTERNAL, "Test")));
+  {
+    OwnedValueId value =
+        TFF_ASSERT_OK(test_executor_->CreateValue(testing::TensorV(2.0f)));
+    OwnedValueId call =
+        TFF_ASSERT_OK(test_executor_->CreateCall(value, absl::nullopt));
+    v0::Value materialized_value;
+    EXPECT_THAT(test_executor_->Materialize(call, &materialized_value),
+                StatusIs(absl::StatusCode::kInternal, "Test"));
+    EXPECT_THAT(test_executor_->Materialize(value, &materialized_value),
+                StatusIs(absl::StatusCode::kInternal, "Test"));
+  }
+  WaitForDisposeExecutor(dispose_notification);
+}
+
+TEST_F(RemoteExecutorTest, UnaryRpcsAreUsedWhenServiceLacksBatchingAndStreams) {
+  absl::Notification dispose_notification;
+  ExpectGetAndDisposeExecutor(dispose_notification);
+  // Like the Python `ExecutorService`, which implements only the unary RPCs.
+  // Each is tried once, and not again once found unimplemented.
+  EXPECT_CALL(*mock_executor_service_,
+              ExecuteBatch(::testing::_, ::testing::_, ::testing::_))
+      .WillOnce(::testing::Return(
+          grpc::Status(grpc::StatusCode::UNIMPLEMENTED, "")));
+  EXPECT_CALL(*mock_executor_service_,
+              ComputeStream(::testing::_, ::testing::_, ::testing::_))
+      .WillOnce(::testing::Return(
+          grpc::Status(grpc::StatusCode::UNIMPLEMENTED, "")));
+  v0::Value tensor_two = testing::TensorV(2.0f);
+  v0::Value tensor_three = testing::TensorV(3.0f);
+  v0::Value materialized_value;
+  absl::Status materialize_status;
+  {
+    EXPECT_CALL(*mock_executor_service_,
+                CreateValue(::testing::_,
+                            EqualsProto(CreateValueRequestForValue(tensor_two)),
+                            ::testing::_))
+        .WillOnce(
+            ReturnOkWithResponseId<v0::CreateValueResponse>("function_ref"));
+    EXPECT_CALL(
+        *mock_executor_service_,
+        CreateValue(::testing::_,
+                    EqualsProto(CreateValueRequestForValue(tensor_three)),
+                    ::testing::_))
+        .WillOnce(
+            ReturnOkWithResponseId<v0::CreateValueResponse>("argument_ref"));
+    v0::CreateCallRequest expected_call_request;
+    expected_call_request.mutable_executor()->set_id(kExecutorId);
+    expected_call_request.mutable_function_ref()->set_id("function_ref");
+    expected_call_request.mutable_argument_ref()->set_id("argument_ref");
+    EXPECT_CALL(*mock_executor_service_,
+                CreateCall(::testing::_, EqualsProto(expected_call_request),
+                           ::testing::_))
+        .WillOnce(ReturnOkWithResponseId<v0::CreateCallResponse>("call_ref"));
+    EXPECT_CALL(
+        *mock_executor_service_,
+        Compute(::testing::_, EqualsProto(ComputeRequestForId("call_ref")),
+                ::testing::_))
+        .Times(2)
+        .WillRepeatedly(ReturnOkWithComputeResponse(tensor_two));
+    EXPECT_CALL(*mock_executor_service_,
+                Dispose(::testing::_, ::testing::_, ::testing::_))
+        .WillRepeatedly(::testing::Return(grpc::Status::OK));
+
+    OwnedValueId fn = TFF_ASSERT_OK(test_executor_->CreateValue(tensor_two));
+    OwnedValueId arg = TFF_ASSERT_OK(test_executor_->CreateValue(tensor_three));
+    OwnedValueId call = TFF_ASSERT_OK(test_executor_->CreateCall(fn, arg));
+    TFF_EXPECT_OK(test_executor_->Materialize(call, &materialized_value));
+    materialize_status = test_executor_->Materialize(call, &materialized_value);
+  }
+  TFF_EXPECT_OK(materialize_status);
+  EXPECT_THAT(materialized_value, EqualsProto(tensor_two));
+  WaitForDisposeExecutor(dispose_notification);
+}
+
+TEST_F(RemoteExecutorTest, BatchIsCancelledOnceAllCallersCancel) {
+  absl::Notification dispose_notification;
+  ExpectGetAndDisposeExecutor(dispose_notification);
+  absl::Notification first_batch_started;
+  absl::Notification release_first_batch;
+  absl::Notification second_batch_started;
+  absl::Notification second_batch_cancelled;
+  // The first batch is held in flight, so that the two values created under
+  // different tokens below are queued in the same (second) batch.
+  EXPECT_CALL(*mock_executor_service_,
+              ExecuteBatch(::testing::_, ::testing::_, ::testing::_))
+      .WillOnce([&](grpc::ServerContext*, const v0::ExecuteBatchRequest*,
+                    v0::ExecuteBatchResponse* response) {
+        first_batch_started.Notify();
+        release_first_batch.WaitForNotification();
+        response->add_result()->mutable_value_ref()->set_id("first_ref");
+        return grpc::Status::OK;
+      })
+      .WillOnce([&](grpc::ServerContext* context,
+                    const v0::ExecuteBatchRequest*,
+                    v0::ExecuteBatchResponse*) {
+        second_batch_started.Notify();
+        while (!context->IsCancelled()) {
+          absl::SleepFor(absl::Milliseconds(1));
+        }
+        second_batch_cancelled.Notify();
+        return grpc::Status::CANCELLED;
+      });
+  auto first_token = std::make_shared<CancellationToken>();
+  auto second_token = std::make_shared<CancellationToken>();
+  {
+    OwnedValueId first_batch_value =
+        TFF_ASSERT_OK(test_executor_->CreateValue(testing::TensorV(0)));
+    first_batch_started.WaitForNotification();
+    absl::optional<OwnedValueId> first;
+    absl::optional<OwnedValueId> second;
+    {
+      ScopedCancellationToken scoped_token(first_token);
+      first = TFF_ASSERT_OK(test_executor_->CreateValue(testing::TensorV(1)));
+    }
+    {
+      ScopedCancellationToken scoped_token(second_token);
+      second = TFF_ASSERT_OK(test_executor_->CreateValue(testing::TensorV(2)));
+    }
+    release_first_batch.Notify();
+    second_batch_started.WaitForNotification();
+    first_token->Cancel();
+    EXPECT_FALSE(second_batch_cancelled.WaitForNotificationWithTimeout(
+        absl::Milliseconds(50)));
+    second_token->Cancel();
+    EXPECT_TRUE(second_batch_cancelled.WaitForNotificationWithTimeout(
+        absl::Seconds(10)));
+    v0::Value materialized_value;
+    EXPECT_THAT(test_executor_->Materialize(*first, &materialized_value),
+                StatusIs(absl::StatusCode::kCancelled));
+  }
+  WaitForDisposeExecutor(dispose_notification);
+}
+
 TEST_F(RemoteExecutorTest, CreateValueWithError) {
   absl::Notification dispose_notification;
   ExpectGetAndDisposeExecutor(dispose_notification);
@@ -271,11 +1026,12 @@ TEST_F(RemoteExecutorTest, MaterializeWithError) {
 
     EXPECT_CALL(*mock_executor_service_,
                 Compute(::testing::_, ::testing::_, ::testing::_))
-        .WillOnce(::testing::Return(UnimplementedPlaceholder()));
+        .WillOnce(::testing::Return(
+            grpc::Status(grpc::StatusCode::INTERNAL, "Test")));
     materialize_status =
         test_executor_->Materialize(value_ref, &materialized_value);
     EXPECT_THAT(materialize_status,
-                StatusIs(absl::StatusCode::kUnimplemented, "Test"));
+                StatusIs(absl::StatusCode::kInternal, "Test"));
   }
   WaitForDisposeExecutor(dispose_notification);
 }
@@ -18,7 +18,6 @@ limitations under the License
 #include <algorithm>
 #include <cstdint>
 #include <functional>
-#include <future>  // NOLINT
 #include <memory>
 #include <numeric>
 #include <string>
@@ -371,7 +370,7 @@ absl::Status CheckLenForUseAsArgument(const SequenceExecutorValue& value,
 
 // We return futures since pulling elements from a sequence may be slow, and
 // otherwise would block.
-using ValueFuture = std::shared_future<absl::StatusOr<SequenceExecutorValue>>;
+using ValueFuture = SharedFuture<absl::StatusOr<SequenceExecutorValue>>;
 
 class SequenceExecutor : public ExecutorBase<ValueFuture> {
  public:
@@ -415,16 +414,15 @@ class SequenceExecutor : public ExecutorBase<ValueFuture> {
 
   absl::StatusOr<ValueFuture> CreateCall(
       ValueFuture function, absl::optional<ValueFuture> argument) final {
-    std::function<absl::StatusOr<SequenceExecutorValue>()> thread_fn =
-        [function = std::move(function), argument = std::move(argument), this,
-         this_keepalive =
-             shared_from_this()]() -> absl::StatusOr<SequenceExecutorValue> {
-      auto fn = TFF_TRY(Wait(function));
+    auto call_fn = [this, this_keepalive = shared_from_this()](
+                       SequenceExecutorValue fn,
+                       absl::optional<SequenceExecutorValue> maybe_arg)
+        -> absl::StatusOr<SequenceExecutorValue> {
       if (fn.type() != SequenceExecutorValue::ValueType::INTRINSIC) {
         Embedded arg_owner;
         absl::optional<ValueId> embedded_arg = absl::nullopt;
-        if (argument.has_value()) {
-          arg_owner = TFF_TRY(Embed(TFF_TRY(Wait(argument.value()))));
+        if (maybe_arg.has_value()) {
+          arg_owner = TFF_TRY(Embed(*maybe_arg));
           embedded_arg = arg_owner->ref();
         }
         return SequenceExecutorValue::CreateEmbedded(ShareValueId(TFF_TRY(
@@ -432,13 +430,13 @@ class SequenceExecutor : public ExecutorBase<ValueFuture> {
       }
       // We know we are executing a sequence intrinsic; check the argument
       // has a value.
-      if (!argument.has_value()) {
+      if (!maybe_arg.has_value()) {
         return absl::InvalidArgumentError(absl::StrCat(
             "Must supply an argument when calling a sequence intrinsic; "
             "called intrinsic ",
             SequenceIntrinsicToUri(fn.intrinsic()), " without an argument."));
       }
-      auto arg = TFF_TRY(Wait(argument.value()));
+      SequenceExecutorValue& arg = *maybe_arg;
       SequenceIntrinsic intrinsic = fn.intrinsic();
       switch (intrinsic) {
         case SequenceIntrinsic::REDUCE: {
@@ -455,7 +453,8 @@ class SequenceExecutor : public ExecutorBase<ValueFuture> {
                            SequenceIntrinsicToUri(intrinsic)));
       }
     };
-    return ThreadRun(thread_fn);
+    return MapCallAsync(std::move(function), std::move(argument),
+                        std::move(call_fn));
   }
 
   absl::StatusOr<ValueFuture> CreateStruct(
@@ -15,10 +15,18 @@ limitations under the License
 
 #include "tensorflow_federated/cc/core/impl/executors/session_provider.h"
 
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <utility>
+#include <vector>
+
 #include "absl/container/flat_hash_set.h"
 #include "absl/strings/str_join.h"
 #include "absl/strings/str_split.h"
 #include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "tensorflow/core/common_runtime/device_mgr.h"
 #include "tensorflow/core/framework/attr_value.pb.h"
 #include "tensorflow/core/framework/device_factory.h"
@@ -28,6 +36,8 @@ limitations under the License
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/graph/default_device.h"
 #include "tensorflow/core/public/session_options.h"
+#include "tensorflow_federated/cc/core/impl/executors/cancellation.h"
+#include "tensorflow_federated/cc/core/impl/executors/thread_pool.h"
 
 namespace tensorflow_federated {
 
@@ -200,9 +210,143 @@ tensorflow::GraphDef ReplaceContainers(
   return graph;
 }
 
+// Tracks the sessions opened by every `SessionProvider` in the process, and
+// closes idle ones to stay within the limits of `SessionBudgetOptions`.
+//
+// Locking: the budget's mutex is taken before a provider's `lock_`, and
+// providers never call into the budget while holding their own lock.
+class SessionBudget {
+ public:
+  static SessionBudget& Get() {
+    static SessionBudget* budget = new SessionBudget();
+    return *budget;
+  }
+
+  void SetOptions(const SessionBudgetOptions& options) {
+    {
+      absl::MutexLock lock(&mutex_);
+      options_ = options;
+      max_sessions_.store(options.max_sessions, std::memory_order_relaxed);
+      ttl_enabled_.store(options.idle_session_ttl != absl::InfiniteDuration(),
+                         std::memory_order_relaxed);
+    }
+    Reclaim();
+  }
+
+  void Register(SessionProvider* provider) {
+    absl::MutexLock lock(&mutex_);
+    providers_.insert(provider);
+  }
+
+  void Unregister(SessionProvider* provider) {
+    absl::MutexLock lock(&mutex_);
+    providers_.erase(provider);
+    absl::MutexLock provider_lock(&provider->lock_);
+    open_sessions_ -= provider->open_sessions_;
+  }
+
+  // Called after a provider creates a new session.
+  void SessionOpened() {
+    open_sessions_++;
+    MaybeReclaim();
+  }
+
+  // Called after a session is returned to its provider.
+  void SessionIdle() { MaybeReclaim(); }
+
+ private:
+  SessionBudget() = default;
+
+  bool OverBudget() {
+    int32_t max_sessions = max_sessions_.load(std::memory_order_relaxed);
+    return max_sessions > 0 && open_sessions_ > max_sessions;
+  }
+
+  bool SweepDue() {
+    return ttl_enabled_.load(std::memory_order_relaxed) &&
+           absl::ToUnixNanos(absl::Now()) >=
+               next_sweep_nanos_.load(std::memory_order_relaxed);
+  }
+
+  void MaybeReclaim() {
+    if (OverBudget() || SweepDue()) {
+      Reclaim();
+    }
+  }
+
+  void Reclaim() {
+    // Sessions are closed after releasing the locks, as tearing down a session
+    // may block on its running kernels.
+    std::vector<SessionProvider::SessionWithResourceContainer> reclaimed;
+    {
+      absl::MutexLock lock(&mutex_);
+      const absl::Time now = absl::Now();
+      if (options_.idle_session_ttl != absl::InfiniteDuration()) {
+        for (SessionProvider* provider : providers_) {
+          provider->ReclaimIdleSessions(now - options_.idle_session_ttl,
+                                        std::numeric_limits<int32_t>::max(),
+                                        reclaimed);
+        }
+        // Sweeping every half TTL closes idle sessions at most one and a half
+        // TTLs after they were returned.
+        next_sweep_nanos_.store(
+            absl::ToUnixNanos(now + options_.idle_session_ttl / 2),
+            std::memory_order_relaxed);
+      }
+      if (options_.max_sessions > 0) {
+        while (open_sessions_ - static_cast<int64_t>(reclaimed.size()) >
+               options_.max_sessions) {
+          SessionProvider* least_recently_used = nullptr;
+          absl::Time oldest = absl::InfiniteFuture();
+          for (SessionProvider* provider : providers_) {
+            absl::optional<absl::Time> idle_since =
+                provider->OldestReclaimableIdleTime();
+            if (idle_since.has_value() && idle_since.value() < oldest) {
+              oldest = idle_since.value();
+              least_recently_used = provider;
+            }
+          }
+          if (least_recently_used == nullptr ||
+              least_recently_used->ReclaimIdleSessions(
+                  absl::InfiniteFuture(), 1, reclaimed) == 0) {
+            break;
+          }
+        }
+      }
+      open_sessions_ -= reclaimed.size();
+      if (!reclaimed.empty()) {
+        VLOG(2) << "Closed " << reclaimed.size()
+                << " idle TensorFlow sessions, " << open_sessions_
+                << " remain open";
+      }
+    }
+  }
+
+  absl::Mutex mutex_;
+  SessionBudgetOptions options_ ABSL_GUARDED_BY(mutex_);
+  absl::flat_hash_set<SessionProvider*> providers_ ABSL_GUARDED_BY(mutex_);
+  // The number of sessions created by all registered providers and not yet
+  // closed.
+  std::atomic<int64_t> open_sessions_{0};
+  // Copies of `options_`, read without taking `mutex_` on every session
+  // returned.
+  std::atomic<int32_t> max_sessions_{-1};
+  std::atomic<bool> ttl_enabled_{false};
+  std::atomic<int64_t> next_sweep_nanos_{0};
+};
+
+void SetSessionBudget(const SessionBudgetOptions& options) {
+  SessionBudget::Get().SetOptions(options);
+}
+
 SessionProvider::SessionProvider(tensorflow::GraphDef&& graph,
-                                 int32_t max_active_sessions)
-    : active_sessions_(0), graph_(graph), function_id_(GetNextFunctionId()) {
+                                 int32_t max_active_sessions,
+                                 int32_t min_warm_sessions)
+    : min_warm_sessions_(std::max(min_warm_sessions, 0)),
+      active_sessions_(0),
+      graph_(graph),
+      graph_bytes_(graph_.ByteSizeLong()),
+      function_id_(GetNextFunctionId()) {
   if (max_active_sessions > 0) {
     max_active_sessions_ = max_active_sessions;
   } else {
@@ -212,10 +356,37 @@ SessionProvider::SessionProvider(tensorflow::GraphDef&& graph,
   }
 
   maybe_open_cpus_ = std::thread::hardware_concurrency();
+  SessionBudget::Get().Register(this);
+}
+
+SessionProvider::~SessionProvider() { SessionBudget::Get().Unregister(this); }
+
+absl::optional<absl::Time> SessionProvider::OldestReclaimableIdleTime() {
+  absl::MutexLock lock(&lock_);
+  if (sessions_.size() <= static_cast<size_t>(min_warm_sessions_)) {
+    return absl::nullopt;
+  }
+  return sessions_.front().idle_since;
+}
+
+int32_t SessionProvider::ReclaimIdleSessions(
+    absl::Time idle_before, int32_t max_sessions,
+    std::vector<SessionWithResourceContainer>& reclaimed) {
+  absl::MutexLock lock(&lock_);
+  int32_t num_reclaimed = 0;
+  while (num_reclaimed < max_sessions &&
+         sessions_.size() > static_cast<size_t>(min_warm_sessions_) &&
+         sessions_.front().idle_since < idle_before) {
+    reclaimed.emplace_back(std::move(sessions_.front().session));
+    sessions_.pop_front();
+    num_reclaimed++;
+  }
+  open_sessions_ -= num_reclaimed;
+  return num_reclaimed;
 }
 
 absl::StatusOr<std::unique_ptr<tensorflow::Session>>
-SessionProvider::CreateSession(const int16_t session_id) {
+SessionProvider::CreateSession(const uint64_t session_id) {
   const std::string container = absl::StrCat(function_id_, "/", session_id);
   std::unique_ptr<tensorflow::Session> session;
   {
@@ -240,7 +411,8 @@ SessionProvider::CreateSession(const int16_t session_id) {
   if (devices.num_gpus > 0) {
     // If we have GPUs, round robin the session by explicitly setting the
     // `device` attr of the GPU-capable kernels.
-    const int16_t device_id = session_id % devices.num_gpus;
+    const int16_t device_id =
+        static_cast<int16_t>(session_id % devices.num_gpus);
     const std::string& device =
         absl::StrCat("/device:", tensorflow::DEVICE_GPU, ":", device_id);
     VLOG(2) << "Pinning function [" << function_id_ << "] session ["
@@ -250,7 +422,8 @@ SessionProvider::CreateSession(const int16_t session_id) {
   if (devices.num_tpus > 0) {
     // If we have TPUs, round robin the session by explicitly setting the
     // `device` attr of the TPU-capable kernels.
-    const int16_t device_id = session_id % devices.num_tpus;
+    const int16_t device_id =
+        static_cast<int16_t>(session_id % devices.num_tpus);
     const std::string& device =
         absl::StrCat("/device:", tensorflow::DEVICE_TPU, ":", device_id);
     VLOG(2) << "Pinning function [" << function_id_ << "] session ["
@@ -272,12 +445,31 @@ SessionProvider::CreateSession(const int16_t session_id) {
 
 absl::StatusOr<SessionProvider::SessionWithResourceContainer>
 SessionProvider::TakeSession() {
-  lock_.LockWhen(
-      absl::Condition(this, &SessionProvider::SessionOrCpuAvailable));
+  // Wake up the wait below if the work requesting a session is cancelled.
+  // NOTE: this is declared first so that it is destroyed only after `lock_`
+  // has been released, as deregistering waits for a running callback.
+  const std::shared_ptr<CancellationToken>& token =
+      CancellationToken::Current();
+  ScopedCancellationCallback wake_on_cancel(
+      token, [this]() { absl::MutexLock lock(&lock_); });
+  auto available_or_cancelled = [this, &token]() {
+    return (token != nullptr && token->IsCancelled()) ||
+           SessionOrCpuAvailable();
+  };
+  {
+    // Waiting for a session may take a long time under contention; let the
+    // thread pool know so that it can keep other work running.
+    ThreadPool::ScopedBlockingCall blocking_call;
+    lock_.LockWhen(absl::Condition(&available_or_cancelled));
+  }
+  if (token != nullptr && token->IsCancelled()) {
+    lock_.Unlock();
+    return token->CheckNotCancelled();
+  }
   active_sessions_++;
   if (!sessions_.empty()) {
     SessionProvider::SessionWithResourceContainer session(
-        std::move(sessions_.back()));
+        std::move(sessions_.back().session));
     sessions_.pop_back();
     lock_.Unlock();
     return std::move(session);
@@ -285,13 +477,17 @@ SessionProvider::TakeSession() {
   maybe_open_cpus_--;
   // Build a container name based on the number of sessions created so that
   // each session gets its own container.
-  const int16_t session_id = session_creation_counter_++;
+  const uint64_t session_id = session_creation_counter_++;
   lock_.Unlock();
   auto session = CreateSession(session_id);
   lock_.Lock();
   maybe_open_cpus_++;
+  if (session.ok()) {
+    open_sessions_++;
+  }
   lock_.Unlock();
   if (session.ok()) {
+    SessionBudget::Get().SessionOpened();
     return SessionProvider::SessionWithResourceContainer{
         TFF_TRY(std::move(session)), function_id_, session_id};
   } else {
@@ -304,8 +500,9 @@ void SessionProvider::ReturnSession(
   session.ClearResourceContainers();
   lock_.Lock();
   active_sessions_--;
-  sessions_.emplace_back(std::move(session));
+  sessions_.push_back(IdleSession{std::move(session), absl::Now()});
   lock_.Unlock();
+  SessionBudget::Get().SessionIdle();
 }
 
 }  // namespace tensorflow_federated
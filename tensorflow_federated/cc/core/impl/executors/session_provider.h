@@ -16,6 +16,9 @@ limitations under the License
 #ifndef THIRD_PARTY_TENSORFLOW_FEDERATED_CC_CORE_IMPL_EXECUTORS_SESSION_PROVIDER_H_
 #define THIRD_PARTY_TENSORFLOW_FEDERATED_CC_CORE_IMPL_EXECUTORS_SESSION_PROVIDER_H_
 
+#include <cstddef>
+#include <cstdint>
+#include <deque>
 #include <string>
 #include <vector>
 
@@ -23,6 +26,7 @@ limitations under the License
 #include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
 #include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
 #include "absl/types/optional.h"
 #include "tensorflow/core/common_runtime/device_mgr.h"
 #include "tensorflow/core/framework/graph.pb.h"
@@ -33,6 +37,25 @@ limitations under the License
 
 namespace tensorflow_federated {
 
+// Process-wide limits on the TensorFlow sessions kept open by all
+// `SessionProvider`s.
+struct SessionBudgetOptions {
+  // The maximum number of sessions open across all providers; non-positive
+  // values indicate no max. When it is exceeded, idle sessions are closed in
+  // least recently used order. Rented sessions are never closed, so the budget
+  // may be exceeded while more sessions than that are in use.
+  int32_t max_sessions = -1;
+  // Sessions idle for longer than this are closed. Expired sessions are
+  // reclaimed whenever any provider opens or returns a session.
+  absl::Duration idle_session_ttl = absl::InfiniteDuration();
+};
+
+// Sets the session budget shared by every `SessionProvider` in the process,
+// closing any idle sessions outside of it.
+void SetSessionBudget(const SessionBudgetOptions& options);
+
+class SessionBudget;
+
 // This class acts as a function from graph -> session, caching previously-
 // created sessions for later use.
 //
@@ -50,16 +73,22 @@ namespace tensorflow_federated {
 // functions and would run into issues (e.g. re-initialize lookup tables)
 // otherwise.
 //
+// Idle sessions count against the process-wide budget set by
+// `SetSessionBudget`, which may close them; a provider never closes its last
+// `min_warm_sessions` idle sessions, keeping hot computations fast.
+//
 // This class is intended only to serve as a dependency of the
 // TensorFlowExecutor.
 class SessionProvider {
  public:
-  SessionProvider(tensorflow::GraphDef&& graph, int32_t max_active_sessions);
+  SessionProvider(tensorflow::GraphDef&& graph, int32_t max_active_sessions,
+                  int32_t min_warm_sessions = 0);
+  ~SessionProvider();
 
   class SessionWithResourceContainer {
    public:
     SessionWithResourceContainer(std::unique_ptr<tensorflow::Session> session,
-                                 uint32_t function_id, int16_t session_id)
+                                 uint32_t function_id, uint64_t session_id)
         : session_(std::move(session)),
           container_name_(absl::StrCat(function_id, "/", session_id)) {
       tensorflow::Status status = session_->LocalDeviceManager(&device_mgr_);
@@ -83,10 +112,17 @@ class SessionProvider {
 
     tensorflow::Session* session_ptr() { return session_.get(); }
 
+    // Callables made with `Session::MakeCallable` by the user of this session.
+    // They are kept with the session, and released when it is closed.
+    std::vector<tensorflow::Session::CallableHandle>& callable_handles() {
+      return callable_handles_;
+    }
+
    private:
     std::unique_ptr<tensorflow::Session> session_;
     const std::string container_name_;
     const tensorflow::DeviceMgr* device_mgr_;
+    std::vector<tensorflow::Session::CallableHandle> callable_handles_;
   };
 
   // An RAII container which returns the session to the provider on destruction.
@@ -109,6 +145,10 @@ class SessionProvider {
 
     tensorflow::Session* operator->() { return session_.session_ptr(); }
 
+    std::vector<tensorflow::Session::CallableHandle>& callable_handles() {
+      return session_.callable_handles();
+    }
+
    private:
     SessionWithResourceContainer session_;
     SessionProvider& provider_;
@@ -127,22 +167,66 @@ class SessionProvider {
   absl::StatusOr<SessionWithResourceContainer> TakeSession();
   void ReturnSession(SessionWithResourceContainer&& session);
 
+  // The number of sessions currently borrowed from this provider.
+  int32_t num_rented_sessions() {
+    absl::MutexLock lock(&lock_);
+    return active_sessions_;
+  }
+
+  // The number of sessions created by this provider which are not in use.
+  int32_t num_idle_sessions() {
+    absl::MutexLock lock(&lock_);
+    return sessions_.size();
+  }
+
+  // An estimate of the memory held by this provider: its graph plus one copy
+  // of the graph for every session it has created, whether rented or pooled.
+  // Sessions also hold kernels and buffers, so this is a lower bound.
+  size_t ApproximateBytes() {
+    absl::MutexLock lock(&lock_);
+    return graph_bytes_ * (1 + sessions_.size() + active_sessions_);
+  }
+
  private:
+  friend class SessionBudget;
+
+  struct IdleSession {
+    SessionWithResourceContainer session;
+    absl::Time idle_since;
+  };
+
   absl::StatusOr<std::unique_ptr<tensorflow::Session>> CreateSession(
-      const int16_t session_id);
+      const uint64_t session_id);
+
+  // The time the least recently used idle session which may be closed was
+  // returned, if any.
+  absl::optional<absl::Time> OldestReclaimableIdleTime();
+
+  // Moves up to `max_sessions` idle sessions returned before `idle_before`
+  // into `reclaimed`, least recently used first, keeping at least
+  // `min_warm_sessions_` idle sessions. Returns the number of sessions moved.
+  int32_t ReclaimIdleSessions(
+      absl::Time idle_before, int32_t max_sessions,
+      std::vector<SessionWithResourceContainer>& reclaimed);
 
-  // Move-only.
-  SessionProvider(SessionProvider&& other) = default;
-  SessionProvider& operator=(SessionProvider&& other) = default;
+  // The budget tracks providers by address, so they cannot be moved.
   SessionProvider(const SessionProvider&) = delete;
   SessionProvider& operator=(const SessionProvider&) = delete;
 
   absl::Mutex lock_;
-  std::vector<SessionWithResourceContainer> sessions_;
+  // Idle sessions, least recently returned first. Sessions are rented from
+  // the back so that the front ones are those closed by the budget.
+  std::deque<IdleSession> sessions_;
+  const int32_t min_warm_sessions_;
+  // The number of sessions created by this provider and not yet closed by
+  // the budget.
+  int32_t open_sessions_ ABSL_GUARDED_BY(lock_) = 0;
   int16_t maybe_open_cpus_;
   int32_t max_active_sessions_;
   int32_t active_sessions_;
   const tensorflow::GraphDef graph_;
+  // The serialized size of `graph_`.
+  const size_t graph_bytes_;
   // A prefix for all containers used by sessions created by this provider.
   const uint32_t function_id_;
   // A running count of the number of sessions created by this provider. This is
@@ -152,7 +236,7 @@ class SessionProvider {
   // - The accelerator device to pin this computation on. If a machine has
   //   multiple accelerators, sessions will be pinned to the
   //   `session_creation_counter_ % num_accelerators` device.
-  int16_t session_creation_counter_ ABSL_GUARDED_BY(lock_) = 0;
+  uint64_t session_creation_counter_ ABSL_GUARDED_BY(lock_) = 0;
 };
 
 }  // namespace tensorflow_federated
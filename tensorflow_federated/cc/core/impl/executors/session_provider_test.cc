@@ -19,6 +19,8 @@ limitations under the License
 
 #include "googlemock/include/gmock/gmock.h"
 #include "googletest/include/gtest/gtest.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "tensorflow_federated/cc/core/impl/executors/status_matchers.h"
 
 namespace tensorflow_federated {
@@ -57,5 +59,67 @@ TEST(SessionProviderTest, TestReturningSessionFreesUpAvailability) {
   EXPECT_EQ(session_provider.SessionOrCpuAvailable(), true);
 }
 
+class SessionBudgetTest : public ::testing::Test {
+ protected:
+  ~SessionBudgetTest() override { SetSessionBudget(SessionBudgetOptions()); }
+
+  // Rents a session from `provider` and returns it, leaving it idle.
+  void UseSession(SessionProvider& provider) {
+    auto session = provider.TakeSession();
+    TFF_ASSERT_OK(session.status());
+    provider.ReturnSession(std::move(session.value()));
+    // Keep the idle times of sessions returned one after another distinct.
+    absl::SleepFor(absl::Milliseconds(1));
+  }
+};
+
+TEST_F(SessionBudgetTest, ClosesLeastRecentlyUsedIdleSessions) {
+  SessionBudgetOptions options;
+  options.max_sessions = 2;
+  SetSessionBudget(options);
+  SessionProvider first(tensorflow::GraphDef(), -1);
+  SessionProvider second(tensorflow::GraphDef(), -1);
+  SessionProvider third(tensorflow::GraphDef(), -1);
+  UseSession(first);
+  UseSession(second);
+  UseSession(first);
+  UseSession(third);
+  EXPECT_EQ(first.num_idle_sessions(), 1);
+  EXPECT_EQ(second.num_idle_sessions(), 0);
+  EXPECT_EQ(third.num_idle_sessions(), 1);
+}
+
+TEST_F(SessionBudgetTest, NeverClosesRentedSessions) {
+  SessionBudgetOptions options;
+  options.max_sessions = 1;
+  SetSessionBudget(options);
+  SessionProvider first(tensorflow::GraphDef(), -1);
+  SessionProvider second(tensorflow::GraphDef(), -1);
+  auto rented = first.TakeSession();
+  TFF_ASSERT_OK(rented.status());
+  UseSession(second);
+  EXPECT_EQ(second.num_idle_sessions(), 0);
+  first.ReturnSession(std::move(rented.value()));
+  EXPECT_EQ(first.num_idle_sessions(), 1);
+}
+
+TEST_F(SessionBudgetTest, ClosesExpiredSessionsExceptWarmOnes) {
+  SessionProvider warm(tensorflow::GraphDef(), -1, /*min_warm_sessions=*/1);
+  SessionProvider cold(tensorflow::GraphDef(), -1);
+  auto first = warm.TakeSession();
+  auto second = warm.TakeSession();
+  TFF_ASSERT_OK(first.status());
+  TFF_ASSERT_OK(second.status());
+  warm.ReturnSession(std::move(first.value()));
+  warm.ReturnSession(std::move(second.value()));
+  UseSession(cold);
+  absl::SleepFor(absl::Milliseconds(50));
+  SessionBudgetOptions options;
+  options.idle_session_ttl = absl::Milliseconds(10);
+  SetSessionBudget(options);
+  EXPECT_EQ(warm.num_idle_sessions(), 1);
+  EXPECT_EQ(cold.num_idle_sessions(), 0);
+}
+
 }  // namespace
 }  // namespace tensorflow_federated
@@ -0,0 +1,246 @@
+/* Copyright 2022, The TensorFlow Federated Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+#include "tensorflow_federated/cc/core/impl/executors/tensor_accumulator.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/framework/types.pb.h"
+#include "tensorflow_federated/cc/core/impl/executors/status_macros.h"
+#include "tensorflow_federated/cc/core/impl/executors/tensor_serialization.h"
+#include "tensorflow_federated/proto/v0/executor.pb.h"
+
+namespace tensorflow_federated {
+
+namespace {
+
+// Calls `fn` with a value of the C++ type of `dtype`, or fails if tensors of
+// `dtype` cannot be accumulated.
+template <typename Fn>
+absl::Status ForSupportedDtype(tensorflow::DataType dtype, Fn fn) {
+  switch (dtype) {
+    case tensorflow::DT_FLOAT: {
+      fn(float());
+      return absl::OkStatus();
+    }
+    case tensorflow::DT_DOUBLE: {
+      fn(double());
+      return absl::OkStatus();
+    }
+    case tensorflow::DT_INT32: {
+      fn(int32_t());
+      return absl::OkStatus();
+    }
+    case tensorflow::DT_INT64: {
+      fn(int64_t());
+      return absl::OkStatus();
+    }
+    default: {
+      return absl::InvalidArgumentError(
+          absl::StrCat("Cannot natively aggregate tensors of dtype ",
+                       tensorflow::DataTypeString(dtype)));
+    }
+  }
+}
+
+// Copies the structure of `value` into `structure`, leaving its tensors empty.
+absl::Status CopyStructure(const v0::Value& value, v0::Value* structure) {
+  switch (value.value_case()) {
+    case v0::Value::kTensor: {
+      structure->mutable_tensor();
+      return absl::OkStatus();
+    }
+    case v0::Value::kStruct: {
+      v0::Value_Struct* struct_pb = structure->mutable_struct_();
+      for (const auto& element : value.struct_().element()) {
+        v0::Value_Struct_Element* element_pb = struct_pb->add_element();
+        element_pb->set_name(element.name());
+        TFF_TRY(CopyStructure(element.value(), element_pb->mutable_value()));
+      }
+      return absl::OkStatus();
+    }
+    default: {
+      return absl::InvalidArgumentError(absl::StrCat(
+          "Can only natively aggregate tensors and structures of tensors, "
+          "found a value of case ",
+          value.value_case()));
+    }
+  }
+}
+
+// Deserializes the tensors of `value`, which must have the given `structure`,
+// in depth-first order.
+absl::Status FlattenTensors(const v0::Value& value,
+                            const v0::Value& structure,
+                            std::vector<tensorflow::Tensor>& tensors) {
+  if (value.value_case() != structure.value_case()) {
+    return absl::InvalidArgumentError(
+        "Cannot aggregate values of different structures");
+  }
+  if (value.has_tensor()) {
+    tensors.push_back(TFF_TRY(DeserializeTensorValue(value)));
+    return absl::OkStatus();
+  }
+  if (value.struct_().element_size() != structure.struct_().element_size()) {
+    return absl::InvalidArgumentError(absl::StrCat(
+        "Cannot aggregate structures of different lengths ",
+        value.struct_().element_size(), " and ",
+        structure.struct_().element_size()));
+  }
+  for (int i = 0; i < value.struct_().element_size(); i++) {
+    TFF_TRY(FlattenTensors(value.struct_().element(i).value(),
+                           structure.struct_().element(i).value(), tensors));
+  }
+  return absl::OkStatus();
+}
+
+bool IsFloatingPoint(tensorflow::DataType dtype) {
+  return dtype == tensorflow::DT_FLOAT || dtype == tensorflow::DT_DOUBLE;
+}
+
+}  // namespace
+
+absl::StatusOr<double> DeserializeScalarWeight(const v0::Value& value) {
+  tensorflow::Tensor tensor = TFF_TRY(DeserializeTensorValue(value));
+  if (tensor.NumElements() != 1) {
+    return absl::InvalidArgumentError(absl::StrCat(
+        "Expected a scalar weight, found a tensor of shape ",
+        tensor.shape().DebugString()));
+  }
+  double weight = 0;
+  TFF_TRY(ForSupportedDtype(tensor.dtype(), [&](auto zero) {
+    using T = decltype(zero);
+    weight = static_cast<double>(tensor.flat<T>()(0));
+  }));
+  return weight;
+}
+
+absl::Status TensorAccumulator::Add(const v0::Value& value, double weight) {
+  v0::Value structure;
+  if (empty_) {
+    TFF_TRY(CopyStructure(value, &structure));
+  }
+  const v0::Value& expected_structure = empty_ ? structure : structure_;
+  std::vector<tensorflow::Tensor> tensors;
+  TFF_TRY(FlattenTensors(value, expected_structure, tensors));
+  // Check every tensor before accumulating any of them, so that a failed
+  // `Add` leaves the sums unchanged.
+  for (size_t i = 0; i < tensors.size(); i++) {
+    const tensorflow::Tensor& tensor = tensors[i];
+    TFF_TRY(ForSupportedDtype(tensor.dtype(), [](auto) {}));
+    if (empty_) {
+      continue;
+    }
+    if (tensor.dtype() != sums_[i].dtype() ||
+        tensor.shape() != sums_[i].shape()) {
+      return absl::InvalidArgumentError(absl::StrCat(
+          "Cannot aggregate a tensor of dtype ",
+          tensorflow::DataTypeString(tensor.dtype()), " and shape ",
+          tensor.shape().DebugString(), " into one of dtype ",
+          tensorflow::DataTypeString(sums_[i].dtype()), " and shape ",
+          sums_[i].shape().DebugString()));
+    }
+  }
+  for (size_t i = 0; i < tensors.size(); i++) {
+    tensorflow::Tensor& tensor = tensors[i];
+    TFF_TRY(ForSupportedDtype(tensor.dtype(), [&](auto zero) {
+      using T = decltype(zero);
+      if (empty_) {
+        if (weight != 1.0) {
+          tensor.flat<T>() = tensor.flat<T>() * static_cast<T>(weight);
+        }
+        return;
+      }
+      if (weight == 1.0) {
+        sums_[i].flat<T>() += tensor.flat<T>();
+      } else {
+        sums_[i].flat<T>() += tensor.flat<T>() * static_cast<T>(weight);
+      }
+    }));
+  }
+  if (empty_) {
+    structure_ = std::move(structure);
+    sums_ = std::move(tensors);
+    empty_ = false;
+  }
+  total_weight_ += weight;
+  return absl::OkStatus();
+}
+
+absl::StatusOr<v0::Value> TensorAccumulator::Sum() const {
+  if (empty_) {
+    return absl::FailedPreconditionError("No values have been accumulated");
+  }
+  v0::Value result;
+  size_t next_sum = 0;
+  TFF_TRY(BuildResult(structure_, /*scale=*/1.0, next_sum, &result));
+  return result;
+}
+
+absl::StatusOr<v0::Value> TensorAccumulator::Mean() const {
+  if (empty_) {
+    return absl::FailedPreconditionError("No values have been accumulated");
+  }
+  if (total_weight_ == 0) {
+    return absl::InvalidArgumentError(
+        "Cannot compute the mean of values with a total weight of zero");
+  }
+  for (const tensorflow::Tensor& sum : sums_) {
+    if (!IsFloatingPoint(sum.dtype())) {
+      return absl::InvalidArgumentError(
+          absl::StrCat("Cannot compute the mean of tensors of dtype ",
+                       tensorflow::DataTypeString(sum.dtype())));
+    }
+  }
+  v0::Value result;
+  size_t next_sum = 0;
+  TFF_TRY(BuildResult(structure_, 1.0 / total_weight_, next_sum, &result));
+  return result;
+}
+
+absl::Status TensorAccumulator::BuildResult(const v0::Value& structure,
+                                            double scale, size_t& next_sum,
+                                            v0::Value* result) const {
+  if (structure.has_tensor()) {
+    const tensorflow::Tensor& sum = sums_[next_sum++];
+    if (scale == 1.0) {
+      return SerializeTensorValue(sum, result);
+    }
+    tensorflow::Tensor scaled(sum.dtype(), sum.shape());
+    TFF_TRY(ForSupportedDtype(sum.dtype(), [&](auto zero) {
+      using T = decltype(zero);
+      scaled.flat<T>() = sum.flat<T>() * static_cast<T>(scale);
+    }));
+    return SerializeTensorValue(scaled, result);
+  }
+  v0::Value_Struct* struct_pb = result->mutable_struct_();
+  for (const auto& element : structure.struct_().element()) {
+    v0::Value_Struct_Element* element_pb = struct_pb->add_element();
+    element_pb->set_name(element.name());
+    TFF_TRY(BuildResult(element.value(), scale, next_sum,
+                        element_pb->mutable_value()));
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace tensorflow_federated
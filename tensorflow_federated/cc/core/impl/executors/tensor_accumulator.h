@@ -0,0 +1,74 @@
+/* Copyright 2022, The TensorFlow Federated Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+#ifndef THIRD_PARTY_TENSORFLOW_FEDERATED_CC_CORE_IMPL_EXECUTORS_TENSOR_ACCUMULATOR_H_
+#define THIRD_PARTY_TENSORFLOW_FEDERATED_CC_CORE_IMPL_EXECUTORS_TENSOR_ACCUMULATOR_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow_federated/proto/v0/executor.pb.h"
+
+namespace tensorflow_federated {
+
+// Deserializes a weight for `TensorAccumulator::Add` from a scalar tensor of
+// dtype float, double, int32 or int64.
+absl::StatusOr<double> DeserializeScalarWeight(const v0::Value& value);
+
+// Accumulates a weighted sum of values in C++, without running TensorFlow.
+// Every value must be a tensor or a (possibly nested) structure of tensors,
+// with the same structure, dtypes and shapes as the first value added. Tensors
+// of dtype float, double, int32 and int64 are supported, and are summed
+// elementwise with Eigen's vectorized kernels.
+//
+// This class is not thread-safe.
+class TensorAccumulator {
+ public:
+  TensorAccumulator() = default;
+
+  // Adds `weight * value` to the sum. `weight` is rounded towards zero for
+  // integer tensors.
+  absl::Status Add(const v0::Value& value, double weight = 1.0);
+
+  // The sum of the weights of the values added so far.
+  double total_weight() const { return total_weight_; }
+
+  // Returns the weighted sum of the values added so far.
+  absl::StatusOr<v0::Value> Sum() const;
+
+  // Returns the weighted sum of the values added so far divided by their total
+  // weight. Only supports floating point tensors.
+  absl::StatusOr<v0::Value> Mean() const;
+
+ private:
+  // Serializes `sums_` scaled by `scale` into `result`, in the given
+  // `structure`.
+  absl::Status BuildResult(const v0::Value& structure, double scale,
+                           size_t& next_sum, v0::Value* result) const;
+
+  bool empty_ = true;
+  // The structure of the values with their tensors left empty.
+  v0::Value structure_;
+  // The running sums of the tensors of the values, in depth-first order.
+  std::vector<tensorflow::Tensor> sums_;
+  double total_weight_ = 0;
+};
+
+}  // namespace tensorflow_federated
+
+#endif  // THIRD_PARTY_TENSORFLOW_FEDERATED_CC_CORE_IMPL_EXECUTORS_TENSOR_ACCUMULATOR_H_
@@ -0,0 +1,97 @@
+/* Copyright 2022, The TensorFlow Federated Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+#include "tensorflow_federated/cc/core/impl/executors/tensor_accumulator.h"
+
+#include <cstdint>
+
+#include "googlemock/include/gmock/gmock.h"
+#include "googletest/include/gtest/gtest.h"
+#include "absl/status/status.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.pb.h"
+#include "tensorflow_federated/cc/core/impl/executors/protobuf_matchers.h"
+#include "tensorflow_federated/cc/core/impl/executors/status_matchers.h"
+#include "tensorflow_federated/cc/core/impl/executors/value_test_utils.h"
+#include "tensorflow_federated/proto/v0/executor.pb.h"
+
+namespace tensorflow_federated {
+
+namespace {
+
+using ::tensorflow_federated::testing::EqualsProto;
+using ::tensorflow_federated::testing::StructV;
+using ::tensorflow_federated::testing::TensorV;
+using ::tensorflow_federated::testing::TensorVFromIntList;
+
+TEST(TensorAccumulatorTest, SumsTensors) {
+  TensorAccumulator accumulator;
+  TFF_ASSERT_OK(accumulator.Add(TensorVFromIntList({1, 2, 3})));
+  TFF_ASSERT_OK(accumulator.Add(TensorVFromIntList({4, 5, 6})));
+  TFF_ASSERT_OK(accumulator.Add(TensorVFromIntList({1, 1, 1}), 2));
+  EXPECT_THAT(accumulator.Sum(),
+              IsOkAndHolds(EqualsProto(TensorVFromIntList({7, 9, 11}))));
+  EXPECT_EQ(accumulator.total_weight(), 4);
+}
+
+TEST(TensorAccumulatorTest, SumsStructures) {
+  TensorAccumulator accumulator;
+  TFF_ASSERT_OK(accumulator.Add(StructV({TensorV(1.0f), TensorV(int64_t{2})})));
+  TFF_ASSERT_OK(accumulator.Add(StructV({TensorV(3.0f), TensorV(int64_t{4})})));
+  EXPECT_THAT(accumulator.Sum(), IsOkAndHolds(EqualsProto(StructV(
+                                     {TensorV(4.0f), TensorV(int64_t{6})}))));
+}
+
+TEST(TensorAccumulatorTest, ComputesWeightedMean) {
+  TensorAccumulator accumulator;
+  TFF_ASSERT_OK(accumulator.Add(StructV({TensorV(1.0), TensorV(2.0f)}), 1));
+  TFF_ASSERT_OK(accumulator.Add(StructV({TensorV(4.0), TensorV(8.0f)}), 3));
+  EXPECT_THAT(accumulator.Mean(), IsOkAndHolds(EqualsProto(StructV(
+                                      {TensorV(3.25), TensorV(6.5f)}))));
+}
+
+TEST(TensorAccumulatorTest, MeanOfIntegersFails) {
+  TensorAccumulator accumulator;
+  TFF_ASSERT_OK(accumulator.Add(TensorV(1)));
+  EXPECT_THAT(accumulator.Mean(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       ::testing::HasSubstr("Cannot compute the mean")));
+}
+
+TEST(TensorAccumulatorTest, MismatchedValueFailsWithoutChangingSum) {
+  TensorAccumulator accumulator;
+  TFF_ASSERT_OK(accumulator.Add(StructV({TensorV(1.0f), TensorV(2.0f)})));
+  EXPECT_THAT(accumulator.Add(StructV({TensorV(1.0f), TensorV(2.0)})),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_THAT(accumulator.Add(StructV({TensorV(1.0f)})),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_THAT(accumulator.Sum(), IsOkAndHolds(EqualsProto(StructV(
+                                     {TensorV(1.0f), TensorV(2.0f)}))));
+  EXPECT_EQ(accumulator.total_weight(), 1);
+}
+
+TEST(TensorAccumulatorTest, UnsupportedDtypeFails) {
+  tensorflow::Tensor tensor(tensorflow::DT_UINT8, tensorflow::TensorShape({1}));
+  tensor.flat<uint8_t>()(0) = 0;
+  TensorAccumulator accumulator;
+  EXPECT_THAT(accumulator.Add(TensorV(tensor)),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       ::testing::HasSubstr("Cannot natively aggregate")));
+}
+
+}  // namespace
+
+}  // namespace tensorflow_federated
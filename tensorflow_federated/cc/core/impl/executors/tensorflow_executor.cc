@@ -16,8 +16,10 @@ limitations under the License
 #include "tensorflow_federated/cc/core/impl/executors/tensorflow_executor.h"
 
 #include <algorithm>
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
-#include <future>  // NOLINT
+#include <functional>
 #include <memory>
 #include <string>
 #include <thread>  // NOLINT
@@ -29,9 +31,12 @@ limitations under the License
 #include "absl/meta/type_traits.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/match.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 #include "absl/synchronization/mutex.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/time.h"
 #include "absl/types/optional.h"
 #include "absl/types/span.h"
 #include "absl/types/variant.h"
@@ -47,11 +52,13 @@ limitations under the License
 #include "tensorflow/core/platform/macros.h"
 #include "tensorflow/core/platform/status.h"
 #include "tensorflow/core/platform/tstring.h"
+#include "tensorflow/core/protobuf/config.pb.h"
 #include "tensorflow/core/public/session.h"
 #include "tensorflow_federated/cc/core/impl/executors/executor.h"
 #include "tensorflow_federated/cc/core/impl/executors/session_provider.h"
 #include "tensorflow_federated/cc/core/impl/executors/status_macros.h"
 #include "tensorflow_federated/cc/core/impl/executors/tensor_serialization.h"
+#include "tensorflow_federated/cc/core/impl/executors/thread_pool.h"
 #include "tensorflow_federated/cc/core/impl/executors/threading.h"
 #include "tensorflow_federated/proto/v0/computation.pb.h"
 #include "tensorflow_federated/proto/v0/executor.pb.h"
@@ -73,6 +80,7 @@ constexpr char kPlaceholderOp[] = "Placeholder";
 constexpr char kDatasetToGraphOp[] = "DatasetToGraphV2";
 constexpr char kDatasetFromGraphOp[] = "DatasetFromGraph";
 constexpr char kArgsIntoSequenceUri[] = "args_into_sequence";
+constexpr char kBatchReplicaPrefix[] = "batch_replica_";
 
 std::string GetNodeName(absl::string_view tensor_name) {
   absl::string_view::size_type pos = tensor_name.find(':');
@@ -351,12 +359,170 @@ absl::Status AddDatasetSerializationToSequenceBindings(
   return absl::OkStatus();
 }
 
+bool HasSequenceBinding(const v0::TensorFlow::Binding& binding) {
+  switch (binding.binding_case()) {
+    case v0::TensorFlow::Binding::kSequence: {
+      return true;
+    }
+    case v0::TensorFlow::Binding::kStruct: {
+      for (const auto& member : binding.struct_().element()) {
+        if (HasSequenceBinding(member)) {
+          return true;
+        }
+      }
+      return false;
+    }
+    default: {
+      return false;
+    }
+  }
+}
+
+// Returns the name of `name`, a node or tensor name, in the `replica`th copy
+// of a graph built by `ReplicateGraph`.
+std::string ReplicaName(int32_t replica, absl::string_view name) {
+  return absl::StrCat(kBatchReplicaPrefix, replica, "/", name);
+}
+
+// Returns a graph holding `num_replicas` independent copies of `graph`, the
+// `i`th of which has all of its nodes renamed by `ReplicaName(i, ...)`. The
+// function library is shared by the copies.
+tensorflow::GraphDef ReplicateGraph(const tensorflow::GraphDef& graph,
+                                    int32_t num_replicas) {
+  constexpr absl::string_view kColocationPrefix = "loc:@";
+  tensorflow::GraphDef replicated;
+  *replicated.mutable_versions() = graph.versions();
+  *replicated.mutable_library() = graph.library();
+  for (int32_t replica = 0; replica < num_replicas; replica++) {
+    for (const tensorflow::NodeDef& node_pb : graph.node()) {
+      tensorflow::NodeDef* copy = replicated.add_node();
+      *copy = node_pb;
+      copy->set_name(ReplicaName(replica, node_pb.name()));
+      for (std::string& input : *copy->mutable_input()) {
+        if (absl::StartsWith(input, "^")) {
+          input = absl::StrCat("^", ReplicaName(replica, input.substr(1)));
+        } else {
+          input = ReplicaName(replica, input);
+        }
+      }
+      auto colocation = copy->mutable_attr()->find("_class");
+      if (colocation != copy->mutable_attr()->end()) {
+        for (std::string& location :
+             *colocation->second.mutable_list()->mutable_s()) {
+          if (absl::StartsWith(location, kColocationPrefix)) {
+            location = absl::StrCat(
+                kColocationPrefix,
+                ReplicaName(replica,
+                            location.substr(kColocationPrefix.size())));
+          }
+        }
+      }
+    }
+  }
+  return replicated;
+}
+
+// A `v0::TensorFlow::Binding` compiled into a flat list of nodes in depth-first
+// order, so that calls bind arguments to it and build results from it by index
+// rather than by walking the proto and copying its tensor names.
+class BindingPlan {
+ public:
+  enum class Kind { kTensor, kSequence, kStruct };
+
+  struct Node {
+    Kind kind;
+    // For tensors and sequences, the index of the bound tensor in
+    // `tensor_names()`. For structs, the number of elements, the first of
+    // which is the next node.
+    int32_t index_or_size;
+    // The index of the node following this one and all of its elements.
+    int32_t end;
+  };
+
+  BindingPlan() = default;
+
+  // Compiles `binding`. If `deduplicate` is set, a tensor bound more than once
+  // appears once in `tensor_names()` and all of its nodes share its index.
+  static absl::StatusOr<BindingPlan> Compile(
+      const v0::TensorFlow::Binding& binding, bool deduplicate) {
+    BindingPlan plan;
+    absl::flat_hash_map<std::string, int32_t> indices;
+    TFF_TRY(plan.AddNode(binding, deduplicate ? &indices : nullptr));
+    return plan;
+  }
+
+  static absl::string_view KindName(Kind kind) {
+    switch (kind) {
+      case Kind::kTensor:
+        return "tensor";
+      case Kind::kSequence:
+        return "sequence";
+      case Kind::kStruct:
+        return "struct";
+    }
+    return "unknown";
+  }
+
+  // The nodes of the binding; the first is its root.
+  const std::vector<Node>& nodes() const { return nodes_; }
+  // The names of the tensors bound, in the order of their indices.
+  const std::vector<std::string>& tensor_names() const {
+    return tensor_names_;
+  }
+
+ private:
+  absl::Status AddNode(const v0::TensorFlow::Binding& binding,
+                       absl::flat_hash_map<std::string, int32_t>* indices) {
+    switch (binding.binding_case()) {
+      case v0::TensorFlow::Binding::kTensor: {
+        AddTensor(Kind::kTensor, binding.tensor().tensor_name(), indices);
+        return absl::OkStatus();
+      }
+      case v0::TensorFlow::Binding::kSequence: {
+        AddTensor(Kind::kSequence, binding.sequence().graph_def_tensor_name(),
+                  indices);
+        return absl::OkStatus();
+      }
+      case v0::TensorFlow::Binding::kStruct: {
+        const size_t node = nodes_.size();
+        nodes_.push_back(
+            Node{Kind::kStruct, binding.struct_().element_size(), 0});
+        for (const auto& element : binding.struct_().element()) {
+          TFF_TRY(AddNode(element, indices));
+        }
+        nodes_[node].end = nodes_.size();
+        return absl::OkStatus();
+      }
+      default: {
+        return absl::UnimplementedError(
+            absl::StrCat("Cannot parse binding type ", binding.binding_case()));
+      }
+    }
+  }
+
+  void AddTensor(Kind kind, const std::string& name,
+                 absl::flat_hash_map<std::string, int32_t>* indices) {
+    int32_t index = tensor_names_.size();
+    if (indices != nullptr) {
+      index = indices->try_emplace(name, index).first->second;
+    }
+    if (index == static_cast<int32_t>(tensor_names_.size())) {
+      tensor_names_.push_back(name);
+    }
+    const int32_t end = nodes_.size() + 1;
+    nodes_.push_back(Node{kind, index, end});
+  }
+
+  std::vector<Node> nodes_;
+  std::vector<std::string> tensor_names_;
+};
+
 // A `Computation` is a TensorFlow function consisting of a graph to execute
 // as well as a set of labeled tensor inputs and outputs.
 class Computation {
  public:
   static absl::StatusOr<std::shared_ptr<Computation>> FromProto(
-      const v0::TensorFlow& comp_pb, int32_t max_active_sessions) {
+      const v0::TensorFlow& comp_pb, const TensorFlowExecutorOptions& options) {
     tensorflow::GraphDef graphdef_pb;
     if (!comp_pb.graph_def().UnpackTo(&graphdef_pb)) {
       return absl::InternalError(ERR_LOG("Could not unpack graphdef proto"));
@@ -368,12 +534,30 @@ class Computation {
     v0::TensorFlow::Binding result_shape = comp_pb.result();
     TFF_TRY(AddDatasetSerializationToSequenceBindings(
         graphdef_pb, parameter_shape, result_shape));
-    std::vector<std::string> output_tensor_names;
-    TFF_TRY(TensorNamesFromBinding(result_shape, &output_tensor_names));
+    BindingPlan parameter_plan;
+    if (parameter_shape.has_value()) {
+      parameter_plan = TFF_TRY(
+          BindingPlan::Compile(parameter_shape.value(), /*deduplicate=*/false));
+    }
+    // Fetch each tensor once, even if the result binds it several times.
+    BindingPlan result_plan =
+        TFF_TRY(BindingPlan::Compile(result_shape, /*deduplicate=*/true));
+    // Only stateless computations over tensors are batched: each replica of a
+    // batched graph would otherwise need its own initialization, and dataset
+    // ops cannot be fed and fetched by the renamed replicas.
+    bool batchable = options.max_call_batch_size > 1 &&
+                     comp_pb.initialize_op().empty() &&
+                     parameter_shape.has_value() &&
+                     !HasSequenceBinding(parameter_shape.value()) &&
+                     !HasSequenceBinding(result_shape) &&
+                     !result_plan.tensor_names().empty();
     return std::make_shared<Computation>(
         std::move(graphdef_pb), comp_pb.initialize_op(),
         std::move(parameter_shape), comp_pb.result(),
-        std::move(output_tensor_names), max_active_sessions);
+        std::move(parameter_plan), std::move(result_plan),
+        options.max_concurrent_computation_calls,
+        batchable ? options.max_call_batch_size : 1,
+        options.call_batch_window, options.min_warm_sessions_per_function);
   }
 
   absl::StatusOr<ExecutorValue> Call(absl::optional<ExecutorValue> arg);
@@ -381,13 +565,48 @@ class Computation {
   Computation(tensorflow::GraphDef graph, std::string init_op,
               absl::optional<v0::TensorFlow::Binding> parameter_shape,
               v0::TensorFlow::Binding output_shape,
-              std::vector<std::string> output_tensor_names,
-              int32_t max_active_sessions = -1)
-      : session_provider_(std::move(graph), max_active_sessions),
+              BindingPlan parameter_plan, BindingPlan result_plan,
+              int32_t max_active_sessions = -1, int32_t max_batch_size = 1,
+              absl::Duration batch_window = absl::ZeroDuration(),
+              int32_t min_warm_sessions = 0)
+      : batchable_graph_(max_batch_size > 1
+                             ? absl::make_optional(graph)
+                             : absl::nullopt),
+        batchable_graph_bytes_(
+            batchable_graph_.has_value() ? batchable_graph_->ByteSizeLong()
+                                         : 0),
+        session_provider_(std::move(graph), max_active_sessions,
+                          min_warm_sessions),
         init_op_(std::move(init_op)),
         parameter_shape_(std::move(parameter_shape)),
         output_shape_(std::move(output_shape)),
-        output_tensor_names_(std::move(output_tensor_names)) {}
+        parameter_plan_(std::move(parameter_plan)),
+        result_plan_(std::move(result_plan)),
+        max_active_sessions_(max_active_sessions),
+        max_batch_size_(max_batch_size),
+        batch_window_(batch_window),
+        min_warm_sessions_(min_warm_sessions) {}
+
+  // An estimate of the memory held by this computation and its sessions.
+  size_t ApproximateBytes() {
+    size_t bytes =
+        session_provider_.ApproximateBytes() + batchable_graph_bytes_;
+    absl::MutexLock lock(&replicated_session_provider_mutex_);
+    if (replicated_session_provider_ != nullptr) {
+      bytes += replicated_session_provider_->ApproximateBytes();
+    }
+    return bytes;
+  }
+
+  // Whether any session of this computation is currently running a call.
+  bool HasRentedSessions() {
+    if (session_provider_.num_rented_sessions() > 0) {
+      return true;
+    }
+    absl::MutexLock lock(&replicated_session_provider_mutex_);
+    return replicated_session_provider_ != nullptr &&
+           replicated_session_provider_->num_rented_sessions() > 0;
+  }
 
   std::string DebugString() const {
     return absl::StrCat("(",
@@ -398,30 +617,47 @@ class Computation {
   }
 
  private:
-  static absl::Status TensorNamesFromBinding(
-      const v0::TensorFlow::Binding& binding,
-      std::vector<std::string>* tensor_names) {
-    switch (binding.binding_case()) {
-      case v0::TensorFlow::Binding::kTensor: {
-        tensor_names->push_back(binding.tensor().tensor_name());
-        return absl::OkStatus();
-      }
-      case v0::TensorFlow::Binding::kStruct: {
-        for (const auto& member : binding.struct_().element()) {
-          TFF_TRY(TensorNamesFromBinding(member, tensor_names));
-        }
-        return absl::OkStatus();
-      }
-      case v0::TensorFlow::Binding::kSequence: {
-        tensor_names->push_back(binding.sequence().graph_def_tensor_name());
-        return absl::OkStatus();
-      }
-      default: {
-        return absl::UnimplementedError(
-            absl::StrCat("Cannot parse binding type ", binding.binding_case()));
-      }
-    }
-  }
+  // Calls which are run together in a single `Session::Run`. The first call
+  // to join a batch runs it once the batch is full or its window has passed.
+  struct PendingBatch {
+    explicit PendingBatch(int32_t max_size) : max_size(max_size) {}
+
+    bool full() const { return inputs.size() >= max_size; }
+
+    const size_t max_size;
+    // The inputs of each call in the batch, in the order they joined it.
+    std::vector<std::vector<tensorflow::Tensor>> inputs;
+    // Notified once `results` are set.
+    absl::Notification done;
+    // The output tensors of each call, in the order of `inputs`.
+    std::vector<absl::StatusOr<std::vector<tensorflow::Tensor>>> results;
+  };
+
+  // Runs the computation once in a session borrowed from `session_provider_`,
+  // feeding `inputs` to the tensors of `parameter_plan_` and returning the
+  // tensors of `result_plan_`. Runs callables made once per session, which
+  // avoids TensorFlow looking up the executors of the graph by feed and fetch
+  // names on every call.
+  absl::StatusOr<std::vector<tensorflow::Tensor>> RunCallable(
+      const std::vector<tensorflow::Tensor>& inputs);
+
+  // Makes the callables used by `RunCallable` in `session`: one running
+  // `init_op_`, if any, followed by one fetching the tensors of
+  // `result_plan_`.
+  absl::Status MakeCallables(SessionProvider::SessionRental& session);
+
+  // Adds a call with `inputs` to the open batch and waits for the batch to
+  // run. Returns the outputs of this call.
+  absl::StatusOr<std::vector<tensorflow::Tensor>> RunBatched(
+      std::vector<tensorflow::Tensor>&& inputs);
+
+  // Runs every call of `batch` in a single session of the replicated graph,
+  // setting its `results`.
+  void RunBatch(PendingBatch& batch);
+
+  // Makes the callable used by `RunBatch` in `session` of the replicated graph,
+  // feeding and fetching the tensors of every replica.
+  absl::Status MakeBatchCallable(SessionProvider::SessionRental& session);
 
   // Move-only.
   Computation(Computation&& other) = default;
@@ -429,11 +665,176 @@ class Computation {
   Computation(const Computation&) = delete;
   Computation& operator=(const Computation&) = delete;
 
+  // A copy of the graph, kept to build `replicated_session_provider_` the
+  // first time calls are batched. Only set if calls may be batched.
+  const absl::optional<tensorflow::GraphDef> batchable_graph_;
+  const size_t batchable_graph_bytes_;
   SessionProvider session_provider_;
   std::string init_op_;
   absl::optional<v0::TensorFlow::Binding> parameter_shape_;
   v0::TensorFlow::Binding output_shape_;
-  std::vector<std::string> output_tensor_names_;
+  // The parameter and result bindings, compiled. Their tensor names are the
+  // feeds and fetches of every call.
+  BindingPlan parameter_plan_;
+  BindingPlan result_plan_;
+  const int32_t max_active_sessions_;
+  const int32_t max_batch_size_;
+  const absl::Duration batch_window_;
+  const int32_t min_warm_sessions_;
+
+  absl::Mutex batch_mutex_;
+  // The batch which new calls join, or null if the last batch has closed.
+  std::shared_ptr<PendingBatch> open_batch_ ABSL_GUARDED_BY(batch_mutex_);
+  absl::Mutex replicated_session_provider_mutex_;
+  // Sessions of a graph holding `max_batch_size_` replicas of this one. Every
+  // batch feeds and fetches all of the replicas, whatever its number of calls,
+  // so each session runs a single callable.
+  std::unique_ptr<SessionProvider> replicated_session_provider_
+      ABSL_GUARDED_BY(replicated_session_provider_mutex_);
+};
+
+// A cache of TensorFlow computations keyed by their `cache_key` id, evicting
+// the least recently used computations when it grows past its limits.
+//
+// Lookups only take a reader lock, so recency is tracked with a counter
+// stamped on each entry rather than by reordering a list; eviction sorts the
+// entries by their stamps. Statistics are reported on insertion, the only time
+// the cache's contents change, rather than on every lookup.
+class FunctionCache {
+ public:
+  explicit FunctionCache(const TensorFlowExecutorOptions& options)
+      : max_functions_(options.function_cache_max_functions),
+        max_bytes_(options.function_cache_max_bytes),
+        stats_callback_(options.function_cache_stats_callback) {}
+
+  // Returns the computation cached under `id`, or null if there is none.
+  std::shared_ptr<Computation> Lookup(uint64_t id) {
+    std::shared_ptr<Computation> computation;
+    {
+      absl::ReaderMutexLock reader_lock(&mutex_);
+      auto cache_iter = entries_.find(id);
+      if (cache_iter != entries_.end()) {
+        cache_iter->second->last_use = next_use_++;
+        computation = cache_iter->second->computation;
+      }
+    }
+    if (computation != nullptr) {
+      hits_++;
+    } else {
+      misses_++;
+    }
+    return computation;
+  }
+
+  // Caches `computation` under `id` and evicts computations until the cache
+  // fits its limits. If another computation was cached under `id` in the
+  // meantime, returns that one instead.
+  std::shared_ptr<Computation> Insert(
+      uint64_t id, std::shared_ptr<Computation> computation) {
+    // Evicted computations are destroyed, closing their sessions, only once
+    // the lock is released.
+    std::vector<std::unique_ptr<Entry>> evicted;
+    {
+      absl::WriterMutexLock writer_lock(&mutex_);
+      auto result = entries_.try_emplace(id, nullptr);
+      if (result.second) {
+        result.first->second = std::make_unique<Entry>(computation);
+        result.first->second->last_use = next_use_++;
+        EvictLocked(id, evicted);
+      } else {
+        // Another thread beat us to creating the cache value. We end up
+        // throwing away our value here, but this is fine because its cheap.
+        computation = result.first->second->computation;
+      }
+    }
+    ReportStats();
+    return computation;
+  }
+
+ private:
+  struct Entry {
+    explicit Entry(std::shared_ptr<Computation> computation)
+        : computation(std::move(computation)) {}
+
+    const std::shared_ptr<Computation> computation;
+    // The value of `next_use_` when the computation was last looked up.
+    std::atomic<uint64_t> last_use{0};
+  };
+
+  bool OverLimits(int64_t num_functions, int64_t bytes) const {
+    return (max_functions_ > 0 && num_functions > max_functions_) ||
+           (max_bytes_ > 0 && bytes > max_bytes_);
+  }
+
+  // Evicts least recently used computations, other than `keep_id` and those
+  // with rented sessions, until the cache fits its limits. The evicted entries
+  // are moved to `evicted`.
+  void EvictLocked(uint64_t keep_id,
+                   std::vector<std::unique_ptr<Entry>>& evicted)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    struct Candidate {
+      uint64_t last_use;
+      uint64_t id;
+      size_t bytes;
+    };
+    std::vector<Candidate> candidates;
+    candidates.reserve(entries_.size());
+    int64_t bytes = 0;
+    for (const auto& [id, entry] : entries_) {
+      size_t entry_bytes = entry->computation->ApproximateBytes();
+      bytes += entry_bytes;
+      candidates.push_back({entry->last_use.load(), id, entry_bytes});
+    }
+    std::sort(candidates.begin(), candidates.end(),
+              [](const Candidate& a, const Candidate& b) {
+                return a.last_use < b.last_use;
+              });
+    for (const Candidate& candidate : candidates) {
+      if (!OverLimits(entries_.size(), bytes)) {
+        break;
+      }
+      if (candidate.id == keep_id) {
+        continue;
+      }
+      auto entry = entries_.find(candidate.id);
+      if (entry->second->computation->HasRentedSessions()) {
+        continue;
+      }
+      VLOG(2) << "Evicting function id: " << candidate.id;
+      evicted.push_back(std::move(entry->second));
+      entries_.erase(entry);
+      bytes -= candidate.bytes;
+      evictions_++;
+    }
+    num_functions_ = entries_.size();
+    approximate_bytes_ = bytes;
+  }
+
+  void ReportStats() {
+    if (!stats_callback_) {
+      return;
+    }
+    FunctionCacheStats stats;
+    stats.hits = hits_;
+    stats.misses = misses_;
+    stats.evictions = evictions_;
+    stats.num_functions = num_functions_;
+    stats.approximate_bytes = approximate_bytes_;
+    stats_callback_(stats);
+  }
+
+  const int32_t max_functions_;
+  const int64_t max_bytes_;
+  const std::function<void(const FunctionCacheStats&)> stats_callback_;
+  absl::Mutex mutex_;
+  absl::flat_hash_map<uint64_t, std::unique_ptr<Entry>> entries_
+      ABSL_GUARDED_BY(mutex_);
+  std::atomic<uint64_t> next_use_{0};
+  std::atomic<int64_t> hits_{0};
+  std::atomic<int64_t> misses_{0};
+  std::atomic<int64_t> evictions_{0};
+  std::atomic<int64_t> num_functions_{0};
+  std::atomic<int64_t> approximate_bytes_{0};
 };
 
 // A tensor that holds sequence data.
@@ -546,29 +947,35 @@ class ExecutorValue {
 
   const Intrinsic intrinsic() const { return absl::get<Intrinsic>(value_); }
 
-  const absl::Status Bind(
-      const v0::TensorFlow::Binding& shape,
-      std::vector<std::pair<std::string, tensorflow::Tensor>>* bindings) const {
+  // Binds this value to the node `node` of `plan`, setting the element of
+  // `bindings` at the index of each of its tensor and sequence nodes.
+  // `bindings` must have an element for every tensor name of `plan`.
+  const absl::Status Bind(const BindingPlan& plan, int32_t node,
+                          std::vector<tensorflow::Tensor>* bindings) const {
+    const BindingPlan::Node& node_plan = plan.nodes()[node];
     switch (type()) {
       case ValueType::TENSOR: {
-        if (!shape.has_tensor()) {
-          return BindKindMismatch("tensor", shape);
+        if (node_plan.kind != BindingPlan::Kind::kTensor) {
+          return BindKindMismatch("tensor", node_plan.kind);
         }
-        bindings->emplace_back(shape.tensor().tensor_name(), tensor());
+        (*bindings)[node_plan.index_or_size] = tensor();
         return absl::OkStatus();
       }
       case ValueType::STRUCT: {
-        if (!shape.has_struct_()) {
-          return BindKindMismatch("struct", shape);
+        if (node_plan.kind != BindingPlan::Kind::kStruct) {
+          return BindKindMismatch("struct", node_plan.kind);
         }
-        if (shape.struct_().element_size() != elements().size()) {
+        const int32_t num_elements = elements().size();
+        if (node_plan.index_or_size != num_elements) {
           return absl::InvalidArgumentError(
-              absl::StrCat("Attempted to bind struct with ", elements().size(),
+              absl::StrCat("Attempted to bind struct with ", num_elements,
                            " fields to an argument struct with ",
-                           shape.struct_().element_size(), " fields."));
+                           node_plan.index_or_size, " fields."));
         }
-        for (int i = 0; i < elements().size(); i++) {
-          TFF_TRY(elements()[i].Bind(shape.struct_().element(i), bindings));
+        int32_t element_node = node + 1;
+        for (const ExecutorValue& element : elements()) {
+          TFF_TRY(element.Bind(plan, element_node, bindings));
+          element_node = plan.nodes()[element_node].end;
         }
         return absl::OkStatus();
       }
@@ -578,11 +985,10 @@ class ExecutorValue {
             "computation. This is not supported.");
       }
       case ValueType::SEQUENCE: {
-        if (!shape.has_sequence()) {
-          return BindKindMismatch("sequence", shape);
+        if (node_plan.kind != BindingPlan::Kind::kSequence) {
+          return BindKindMismatch("sequence", node_plan.kind);
         }
-        bindings->emplace_back(shape.sequence().graph_def_tensor_name(),
-                               sequence());
+        (*bindings)[node_plan.index_or_size] = sequence();
         return absl::OkStatus();
       }
       case ValueType::INTRINSIC: {
@@ -625,42 +1031,26 @@ class ExecutorValue {
     return out;
   }
 
-  static absl::StatusOr<ExecutorValue> FromTensorsAndBindingStructure(
-      const v0::TensorFlow::Binding& binding_structure,
-      absl::Span<tensorflow::Tensor>* tensors) {
-    bool is_sequence = false;
-    switch (binding_structure.binding_case()) {
-      case v0::TensorFlow::Binding::kSequence: {
-        is_sequence = true;
-      }
-        TF_FALLTHROUGH_INTENDED;
-      case v0::TensorFlow::Binding::kTensor: {
-        if (tensors->empty()) {
-          return absl::InternalError(
-              "TensorFlow computation had fewer output tensors than expected.");
-        }
-        tensorflow::Tensor& tensor = tensors->front();
-        tensors->remove_prefix(1);
-        if (is_sequence) {
-          return ExecutorValue(SequenceTensor(std::move(tensor)));
-        } else {
-          return ExecutorValue(std::move(tensor));
-        }
-      }
-      case v0::TensorFlow::Binding::kStruct: {
-        auto elements = std::make_shared<std::vector<ExecutorValue>>();
-        elements->reserve(binding_structure.struct_().element_size());
-        for (const auto& e_structure : binding_structure.struct_().element()) {
-          elements->push_back(
-              TFF_TRY(FromTensorsAndBindingStructure(e_structure, tensors)));
-        }
-        return ExecutorValue(elements);
-      }
-      default: {
-        return absl::UnimplementedError(absl::StrCat(
-            "Unknown output binding kind: ", binding_structure.binding_case()));
-      }
+  // Builds the value bound to the node `node` of `plan`, taking the tensor of
+  // each of its tensor and sequence nodes from `tensors` by index.
+  static ExecutorValue FromTensorsAndBindingPlan(
+      const BindingPlan& plan, int32_t node,
+      const std::vector<tensorflow::Tensor>& tensors) {
+    const BindingPlan::Node& node_plan = plan.nodes()[node];
+    if (node_plan.kind == BindingPlan::Kind::kTensor) {
+      return ExecutorValue(tensors[node_plan.index_or_size]);
+    }
+    if (node_plan.kind == BindingPlan::Kind::kSequence) {
+      return ExecutorValue(SequenceTensor(
+          tensorflow::Tensor(tensors[node_plan.index_or_size])));
     }
+    auto elements = std::make_shared<std::vector<ExecutorValue>>();
+    elements->reserve(node_plan.index_or_size);
+    for (int32_t element = node + 1; element < node_plan.end;
+         element = plan.nodes()[element].end) {
+      elements->push_back(FromTensorsAndBindingPlan(plan, element, tensors));
+    }
+    return ExecutorValue(elements);
   }
 
   std::string DebugString() const {
@@ -692,22 +1082,22 @@ class ExecutorValue {
       value_;
 
   static absl::Status BindKindMismatch(const absl::string_view value_kind,
-                                       const v0::TensorFlow::Binding& shape) {
+                                       BindingPlan::Kind kind) {
     return absl::InvalidArgumentError(
         absl::StrCat("Attempted to bind ", value_kind,
-                     " value to argument of kind ", shape.SerializeAsString()));
+                     " value to argument of kind ",
+                     BindingPlan::KindName(kind)));
   }
 };
 
 absl::StatusOr<ExecutorValue> Computation::Call(
     absl::optional<ExecutorValue> arg) {
   // Skip everything if there are no outputs.
-  // If `output_tensor_names` is empty, TF raises an error, so we must bypass it
+  // If there are no tensors to fetch, TF raises an error, so we must bypass it
   // entirely.
-  if (output_tensor_names_.empty()) {
-    return ExecutorValue::FromTensorsAndBindingStructure(output_shape_, {});
+  if (result_plan_.tensor_names().empty()) {
+    return ExecutorValue::FromTensorsAndBindingPlan(result_plan_, 0, {});
   }
-  auto session = TFF_TRY(this->session_provider_.BorrowSession());
   if (arg.has_value() != parameter_shape_.has_value()) {
     auto actual = arg.has_value()
                       ? absl::StrCat("of type '", arg->DebugString(), "' was")
@@ -722,15 +1112,69 @@ absl::StatusOr<ExecutorValue> Computation::Call(
                      " provided to tensorflow computation, but an argument ",
                      expected, " expected."));
   }
-  std::vector<std::pair<std::string, tensorflow::Tensor>> inputs;
+  std::vector<tensorflow::Tensor> inputs(
+      parameter_plan_.tensor_names().size());
   if (arg.has_value()) {
-    TFF_TRY(arg.value().Bind(parameter_shape_.value(), &inputs));
+    TFF_TRY(arg.value().Bind(parameter_plan_, 0, &inputs));
+  }
+  std::vector<tensorflow::Tensor> outputs;
+  if (max_batch_size_ > 1) {
+    outputs = TFF_TRY(RunBatched(std::move(inputs)));
+  } else {
+    outputs = TFF_TRY(RunCallable(inputs));
+  }
+  if (outputs.size() != result_plan_.tensor_names().size()) {
+    return absl::InternalError(absl::StrCat(
+        "TensorFlow computation returned ", outputs.size(),
+        " output tensors, expected ", result_plan_.tensor_names().size()));
   }
+  return ExecutorValue::FromTensorsAndBindingPlan(result_plan_, 0, outputs);
+}
+
+absl::Status Computation::MakeCallables(
+    SessionProvider::SessionRental& session) {
+  std::vector<tensorflow::Session::CallableHandle> handles;
+  auto make_callable =
+      [&](const tensorflow::CallableOptions& options) -> absl::Status {
+    tensorflow::Session::CallableHandle handle;
+    tensorflow::Status status = session->MakeCallable(options, &handle);
+    if (!status.ok()) {
+      return absl::InternalError(ERR_LOG(absl::StrCat(
+          "Failed to prepare computation: ", status.error_message())));
+    }
+    handles.push_back(handle);
+    return absl::OkStatus();
+  };
+  tensorflow::CallableOptions options;
+  for (const std::string& name : parameter_plan_.tensor_names()) {
+    options.add_feed(name);
+  }
+  if (!init_op_.empty()) {
+    tensorflow::CallableOptions init_options = options;
+    init_options.add_target(init_op_);
+    TFF_TRY(make_callable(init_options));
+  }
+  for (const std::string& name : result_plan_.tensor_names()) {
+    options.add_fetch(name);
+  }
+  TFF_TRY(make_callable(options));
+  session.callable_handles() = std::move(handles);
+  return absl::OkStatus();
+}
+
+absl::StatusOr<std::vector<tensorflow::Tensor>> Computation::RunCallable(
+    const std::vector<tensorflow::Tensor>& inputs) {
+  auto session = TFF_TRY(this->session_provider_.BorrowSession());
+  if (session.callable_handles().empty()) {
+    TFF_TRY(MakeCallables(session));
+  }
+  const std::vector<tensorflow::Session::CallableHandle>& handles =
+      session.callable_handles();
   if (!init_op_.empty()) {
-    tensorflow::Status status = session->Run(inputs,
-                                             /*output_tensor_names=*/{},
-                                             /*target_tensor_names=*/{init_op_},
-                                             /*outputs=*/nullptr);
+    std::vector<tensorflow::Tensor> unused_outputs;
+    tensorflow::Status status =
+        session->RunCallable(handles.front(), inputs, &unused_outputs,
+                             /*run_metadata=*/nullptr);
     if (!status.ok()) {
       return absl::InternalError(ERR_LOG(absl::StrCat(
           "Failed to initialize the computation: ", status.error_message())));
@@ -738,16 +1182,141 @@ absl::StatusOr<ExecutorValue> Computation::Call(
   }
   std::vector<tensorflow::Tensor> outputs;
   tensorflow::Status status =
-      session->Run(inputs, output_tensor_names_,
-                   /*target_tensor_names=*/{}, &outputs);
+      session->RunCallable(handles.back(), inputs, &outputs,
+                           /*run_metadata=*/nullptr);
   if (!status.ok()) {
     return absl::InternalError(ERR_LOG(
         absl::StrCat("Failed to run computation: ", status.error_message())));
   }
-  // Return the session rental before computing the final ExecutorValue.
-  session.ReturnRental();
-  absl::Span<tensorflow::Tensor> slice(outputs);
-  return ExecutorValue::FromTensorsAndBindingStructure(output_shape_, &slice);
+  return outputs;
+}
+
+absl::StatusOr<std::vector<tensorflow::Tensor>> Computation::RunBatched(
+    std::vector<tensorflow::Tensor>&& inputs) {
+  std::shared_ptr<PendingBatch> batch;
+  size_t index;
+  bool runs_batch = false;
+  {
+    absl::MutexLock lock(&batch_mutex_);
+    if (open_batch_ == nullptr) {
+      open_batch_ = std::make_shared<PendingBatch>(max_batch_size_);
+      runs_batch = true;
+    }
+    batch = open_batch_;
+    index = batch->inputs.size();
+    batch->inputs.push_back(std::move(inputs));
+    if (batch->full()) {
+      open_batch_ = nullptr;
+    }
+  }
+  // Waiting for the batch to fill or to finish blocks this thread, so the
+  // waits are marked as blocking for the pool to compensate. Running the batch
+  // is not, as with an unbatched call.
+  if (runs_batch) {
+    {
+      absl::MutexLock lock(&batch_mutex_);
+      ThreadPool::ScopedBlockingCall blocking_call;
+      batch_mutex_.AwaitWithTimeout(
+          absl::Condition(batch.get(), &PendingBatch::full), batch_window_);
+      if (open_batch_ == batch) {
+        open_batch_ = nullptr;
+      }
+    }
+    // The batch is closed, so its inputs no longer change.
+    RunBatch(*batch);
+    batch->done.Notify();
+  } else {
+    ThreadPool::ScopedBlockingCall blocking_call;
+    batch->done.WaitForNotification();
+  }
+  return std::move(batch->results[index]);
+}
+
+void Computation::RunBatch(PendingBatch& batch) {
+  const int32_t num_calls = batch.inputs.size();
+  // Runs the calls one at a time, so that the failure of one call (e.g. on an
+  // argument of the wrong shape) does not fail the others.
+  auto run_unbatched = [this, &batch]() {
+    batch.results.clear();
+    for (const std::vector<tensorflow::Tensor>& inputs : batch.inputs) {
+      batch.results.push_back(RunCallable(inputs));
+    }
+  };
+  if (num_calls == 1) {
+    run_unbatched();
+    return;
+  }
+  SessionProvider* provider;
+  {
+    absl::MutexLock lock(&replicated_session_provider_mutex_);
+    if (replicated_session_provider_ == nullptr) {
+      replicated_session_provider_ = std::make_unique<SessionProvider>(
+          ReplicateGraph(batchable_graph_.value(), max_batch_size_),
+          max_active_sessions_, min_warm_sessions_);
+    }
+    provider = replicated_session_provider_.get();
+  }
+  absl::StatusOr<SessionProvider::SessionRental> session =
+      provider->BorrowSession();
+  if (!session.ok()) {
+    run_unbatched();
+    return;
+  }
+  if (session->callable_handles().empty()) {
+    absl::Status status = MakeBatchCallable(*session);
+    if (!status.ok()) {
+      run_unbatched();
+      return;
+    }
+  }
+  // Replicas without a call of their own are fed the inputs of the first call,
+  // which share its buffers, and their outputs are dropped.
+  std::vector<tensorflow::Tensor> inputs;
+  inputs.reserve(max_batch_size_ * parameter_plan_.tensor_names().size());
+  for (int32_t replica = 0; replica < max_batch_size_; replica++) {
+    const std::vector<tensorflow::Tensor>& replica_inputs =
+        batch.inputs[replica < num_calls ? replica : 0];
+    inputs.insert(inputs.end(), replica_inputs.begin(), replica_inputs.end());
+  }
+  std::vector<tensorflow::Tensor> outputs;
+  tensorflow::Status status =
+      (*session)->RunCallable(session->callable_handles().front(), inputs,
+                              &outputs, /*run_metadata=*/nullptr);
+  session->ReturnRental();
+  if (!status.ok()) {
+    VLOG(1) << "Failed to run batch of " << num_calls
+            << " computation calls, running them one at a time: "
+            << status.error_message();
+    run_unbatched();
+    return;
+  }
+  const size_t num_outputs = result_plan_.tensor_names().size();
+  for (int32_t call = 0; call < num_calls; call++) {
+    auto first = outputs.begin() + call * num_outputs;
+    batch.results.emplace_back(
+        std::vector<tensorflow::Tensor>(first, first + num_outputs));
+  }
+}
+
+absl::Status Computation::MakeBatchCallable(
+    SessionProvider::SessionRental& session) {
+  tensorflow::CallableOptions options;
+  for (int32_t replica = 0; replica < max_batch_size_; replica++) {
+    for (const std::string& name : parameter_plan_.tensor_names()) {
+      options.add_feed(ReplicaName(replica, name));
+    }
+    for (const std::string& name : result_plan_.tensor_names()) {
+      options.add_fetch(ReplicaName(replica, name));
+    }
+  }
+  tensorflow::Session::CallableHandle handle;
+  tensorflow::Status status = session->MakeCallable(options, &handle);
+  if (!status.ok()) {
+    return absl::InternalError(ERR_LOG(absl::StrCat(
+        "Failed to prepare batched computation: ", status.error_message())));
+  }
+  session.callable_handles().push_back(handle);
+  return absl::OkStatus();
 }
 
 absl::StatusOr<ExecutorValue> CallIntrinsic(Intrinsic intrinsic,
@@ -767,7 +1336,7 @@ absl::StatusOr<ExecutorValue> CallIntrinsic(Intrinsic intrinsic,
   }
 }
 
-using ValueFuture = std::shared_future<absl::StatusOr<ExecutorValue>>;
+using ValueFuture = SharedFuture<absl::StatusOr<ExecutorValue>>;
 
 absl::Status MaterializeSequence(const tensorflow::Tensor& graph_def_tensor,
                                  v0::Value::Sequence* sequence_value_pb) {
@@ -787,19 +1356,18 @@ absl::Status MaterializeSequence(const tensorflow::Tensor& graph_def_tensor,
 
 class TensorFlowExecutor : public ExecutorBase<ValueFuture> {
  public:
-  // Setting max_concurrent_computation_calls to a positive value limits the
+  // Setting `max_concurrent_computation_calls` to a positive value limits the
   // concurrent invocations of session.run to that number. Zero or negative
-  // provides effectively unlimited concurrency.
-  explicit TensorFlowExecutor(int32_t max_concurrent_computation_calls)
-      : max_concurrent_computation_calls_(max_concurrent_computation_calls) {}
+  // provides effectively unlimited concurrency. A `max_call_batch_size` of
+  // more than one runs concurrent calls of the same computation together.
+  explicit TensorFlowExecutor(const TensorFlowExecutorOptions& options)
+      : options_(options), function_cache_(options) {}
 
  private:
-  // A hash map of compiler generated TensorFlow function ids to already
-  // construction Computation objects.
-  absl::flat_hash_map<uint64_t, std::shared_ptr<Computation>> function_cache_
-      ABSL_GUARDED_BY(function_cache_mutex_);
-  absl::Mutex function_cache_mutex_;
-  int32_t max_concurrent_computation_calls_;
+  const TensorFlowExecutorOptions options_;
+  // Already constructed Computation objects, keyed by their compiler generated
+  // TensorFlow function ids.
+  FunctionCache function_cache_;
 
   absl::StatusOr<ExecutorValue> CreateValueAny(const v0::Value& value_pb) {
     VLOG(2) << "Creating value: " << value_pb.Utf8DebugString();
@@ -841,32 +1409,21 @@ class TensorFlowExecutor : public ExecutorBase<ValueFuture> {
       // logic.
       LOG_FIRST_N(WARNING, 10) << "Skipped caching computation, no cache_key:\n"
                                << comp_pb.type().Utf8DebugString();
-      return ExecutorValue(TFF_TRY(Computation::FromProto(
-          comp_pb.tensorflow(), max_concurrent_computation_calls_)));
+      return ExecutorValue(
+          TFF_TRY(Computation::FromProto(comp_pb.tensorflow(), options_)));
     }
     const uint64_t function_id = comp_pb.tensorflow().cache_key().id();
-    // Try the fast path first, reader locks are much cheaper.
-    {
-      absl::ReaderMutexLock reader_lock(&function_cache_mutex_);
-      auto cache_iter = function_cache_.find(function_id);
-      if (cache_iter != function_cache_.end()) {
-        VLOG(2) << "Cache hit for function id: " << function_id;
-        return ExecutorValue(cache_iter->second);
-      }
+    std::shared_ptr<Computation> computation =
+        function_cache_.Lookup(function_id);
+    if (computation != nullptr) {
+      VLOG(2) << "Cache hit for function id: " << function_id;
+      return ExecutorValue(computation);
     }
     // Otherwise build the cached value and insert it into the cache.
     VLOG(2) << "Cache MISS for function id: " << function_id;
-    std::shared_ptr<Computation> computation = TFF_TRY(Computation::FromProto(
-        comp_pb.tensorflow(), max_concurrent_computation_calls_));
-    {
-      absl::WriterMutexLock writer_lock(&function_cache_mutex_);
-      auto result = function_cache_.try_emplace(function_id, computation);
-      if (!result.second) {
-        // Another thread beat us to creating the cache value. We end up
-        // throwing away our value here, but this is fine because its cheap.
-        computation = result.first->second;
-      }
-    }
+    computation = function_cache_.Insert(
+        function_id,
+        TFF_TRY(Computation::FromProto(comp_pb.tensorflow(), options_)));
     return ExecutorValue(computation);
   }
 
@@ -895,9 +1452,11 @@ class TensorFlowExecutor : public ExecutorBase<ValueFuture> {
                                 ParallelTasks& tasks) {
     switch (value.type()) {
       case ExecutorValue::ValueType::TENSOR: {
-        tasks.add_task([&value, value_pb]() {
-          return SerializeTensorValue(value.tensor(), value_pb);
-        });
+        tasks.add_task(
+            [&value, value_pb]() {
+              return SerializeTensorValue(value.tensor(), value_pb);
+            },
+            /*cost_hint=*/value.tensor().TotalBytes());
         return absl::OkStatus();
       }
       case ExecutorValue::ValueType::SEQUENCE: {
@@ -938,25 +1497,22 @@ class TensorFlowExecutor : public ExecutorBase<ValueFuture> {
   }
   absl::StatusOr<ValueFuture> CreateCall(
       ValueFuture function, absl::optional<ValueFuture> argument) final {
-    return ThreadRun([function = std::move(function),
-                      argument = std::move(
-                          argument)]() -> absl::StatusOr<ExecutorValue> {
-      ExecutorValue fn = TFF_TRY(Wait(function));
-      absl::optional<ExecutorValue> arg = absl::nullopt;
-      if (argument.has_value()) {
-        arg = TFF_TRY(Wait(argument.value()));
-      }
-      if (fn.type() == ExecutorValue::ValueType::COMPUTATION) {
-        return fn.computation()->Call(std::move(arg));
-      } else if (fn.type() == ExecutorValue::ValueType::INTRINSIC) {
-        return CallIntrinsic(fn.intrinsic(), std::move(arg));
-      } else {
-        return absl::InvalidArgumentError(absl::StrCat(
-            "Expected `function` argument to `TensorFlowExecutor::CreateCall` "
-            "to be a computation or intrinsic, but found type ",
-            fn.type()));
-      }
-    });
+    return MapCallAsync(
+        std::move(function), std::move(argument),
+        [](ExecutorValue fn, absl::optional<ExecutorValue> arg)
+            -> absl::StatusOr<ExecutorValue> {
+          if (fn.type() == ExecutorValue::ValueType::COMPUTATION) {
+            return fn.computation()->Call(std::move(arg));
+          } else if (fn.type() == ExecutorValue::ValueType::INTRINSIC) {
+            return CallIntrinsic(fn.intrinsic(), std::move(arg));
+          } else {
+            return absl::InvalidArgumentError(absl::StrCat(
+                "Expected `function` argument to "
+                "`TensorFlowExecutor::CreateCall` to be a computation or "
+                "intrinsic, but found type ",
+                fn.type()));
+          }
+        });
   }
   absl::StatusOr<ValueFuture> CreateStruct(
       std::vector<ValueFuture> elements) final {
@@ -999,7 +1555,14 @@ class TensorFlowExecutor : public ExecutorBase<ValueFuture> {
 
 std::shared_ptr<Executor> CreateTensorFlowExecutor(
     int32_t max_concurrent_computation_calls) {
-  return std::make_shared<TensorFlowExecutor>(max_concurrent_computation_calls);
+  TensorFlowExecutorOptions options;
+  options.max_concurrent_computation_calls = max_concurrent_computation_calls;
+  return CreateTensorFlowExecutor(options);
+}
+
+std::shared_ptr<Executor> CreateTensorFlowExecutor(
+    const TensorFlowExecutorOptions& options) {
+  return std::make_shared<TensorFlowExecutor>(options);
 }
 
 }  // namespace tensorflow_federated
@@ -16,13 +16,61 @@ limitations under the License
 #ifndef THIRD_PARTY_TENSORFLOW_FEDERATED_CC_CORE_IMPL_EXECUTORS_TENSORFLOW_EXECUTOR_H_
 #define THIRD_PARTY_TENSORFLOW_FEDERATED_CC_CORE_IMPL_EXECUTORS_TENSORFLOW_EXECUTOR_H_
 
+#include <cstdint>
+#include <functional>
 #include <memory>
 
+#include "absl/time/time.h"
 #include "absl/types/optional.h"
 #include "tensorflow_federated/cc/core/impl/executors/executor.h"
 
 namespace tensorflow_federated {
 
+// Statistics about the cache of TensorFlow computations of a
+// `TensorFlowExecutor`, keyed by the computations' `cache_key`.
+struct FunctionCacheStats {
+  // The number of lookups which found a cached computation.
+  int64_t hits = 0;
+  // The number of lookups which had to build a new computation.
+  int64_t misses = 0;
+  // The number of computations evicted to stay within the cache's limits.
+  int64_t evictions = 0;
+  // The number of computations currently cached.
+  int64_t num_functions = 0;
+  // The estimated memory held by the cached computations, as of the last
+  // insertion: their graphs plus one copy of the graph per live session.
+  int64_t approximate_bytes = 0;
+};
+
+struct TensorFlowExecutorOptions {
+  // The maximum number of TensorFlow sessions executing in parallel for each
+  // computation; non-positive values indicate no max.
+  int32_t max_concurrent_computation_calls = -1;
+  // The maximum number of concurrent calls of the same computation which are
+  // run together in a single `Session::Run`. Values of one or less disable
+  // batching. A batched computation's graph holds `max_call_batch_size`
+  // replicas of the computation, so its memory, and that of every session
+  // running it, is about `max_call_batch_size` times that of the unbatched
+  // graph (see `function_cache_max_bytes`).
+  int32_t max_call_batch_size = 1;
+  // How long the first call of a batch waits for other calls of the same
+  // computation to join it. Only used if `max_call_batch_size` is more than
+  // one.
+  absl::Duration call_batch_window = absl::Milliseconds(1);
+  // The maximum number of computations kept in the function cache;
+  // non-positive values indicate no max.
+  int32_t function_cache_max_functions = -1;
+  // The maximum estimated memory, in bytes, held by the computations in the
+  // function cache; non-positive values indicate no max.
+  int64_t function_cache_max_bytes = -1;
+  // Called with the statistics of the function cache after every insertion,
+  // which is also when computations are evicted.
+  std::function<void(const FunctionCacheStats&)> function_cache_stats_callback;
+  // The number of idle sessions each computation keeps open even when the
+  // process-wide session budget (see `SetSessionBudget`) would close them.
+  int32_t min_warm_sessions_per_function = 0;
+};
+
 // Returns an executor that can resolve TensorFlow computations and structures
 // of tensors. `max_concurrent_computation_calls` can be used to limit the
 // maximum number of TensorFlow sessions executing in parallel; non-positive
@@ -30,6 +78,27 @@ namespace tensorflow_federated {
 std::shared_ptr<Executor> CreateTensorFlowExecutor(
     int32_t max_concurrent_computation_calls = -1);
 
+// Returns a TensorFlow executor configured by `options`.
+//
+// If `max_call_batch_size` is more than one, calls of the same computation
+// which arrive within `call_batch_window` of each other are run together: the
+// computation's graph is replicated once per call under distinct name scopes,
+// and a single `Session::Run` feeds and fetches every replica. This amortizes
+// the per-run overhead of small graphs, such as a `federated_map` of a small
+// model over many clients, at the cost of up to `call_batch_window` of added
+// latency for each batch. Computations with an initialization op or sequence
+// parameters or results are never batched.
+//
+// Computations with a `cache_key` are cached by the executor, together with
+// the TensorFlow sessions created to run them. When the cache holds more than
+// `function_cache_max_functions` computations or more than
+// `function_cache_max_bytes`, the least recently used computations are evicted
+// until it fits. A computation whose sessions are currently running is never
+// evicted, nor is the computation just inserted. Values which refer to an
+// evicted computation remain callable.
+std::shared_ptr<Executor> CreateTensorFlowExecutor(
+    const TensorFlowExecutorOptions& options);
+
 }  // namespace tensorflow_federated
 
 #endif  // THIRD_PARTY_TENSORFLOW_FEDERATED_CC_CORE_IMPL_EXECUTORS_TENSORFLOW_EXECUTOR_H_
@@ -0,0 +1,148 @@
+/* Copyright 2022, The TensorFlow Federated Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+// Measures the per-call overhead of running small graphs. A graph summing
+// `state.range(0)` scalar placeholders is run with `Session::Run`, which looks
+// up its executors by feed and fetch names on every call, and with
+// `Session::RunCallable` on a callable made once, which `TensorFlowExecutor`
+// uses. `BM_TensorFlowExecutorCall` measures a whole call of the same graph
+// through a `TensorFlowExecutor`.
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "tensorflow/cc/framework/ops.h"
+#include "tensorflow/cc/framework/scope.h"
+#include "tensorflow/cc/ops/array_ops.h"
+#include "tensorflow/cc/ops/math_ops.h"
+#include "tensorflow/core/framework/graph.pb.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/types.pb.h"
+#include "tensorflow/core/protobuf/config.pb.h"
+#include "tensorflow/core/public/session.h"
+#include "tensorflow/core/public/session_options.h"
+#include "tensorflow_federated/cc/core/impl/executors/executor.h"
+#include "tensorflow_federated/cc/core/impl/executors/tensor_serialization.h"
+#include "tensorflow_federated/cc/core/impl/executors/tensorflow_executor.h"
+#include "tensorflow_federated/proto/v0/computation.pb.h"
+#include "tensorflow_federated/proto/v0/executor.pb.h"
+
+namespace tensorflow_federated {
+
+namespace {
+
+// A graph summing `num_inputs` float scalars.
+struct SumGraph {
+  explicit SumGraph(int64_t num_inputs) {
+    tensorflow::Scope root = tensorflow::Scope::NewRootScope();
+    std::vector<tensorflow::Output> inputs;
+    for (int64_t i = 0; i < num_inputs; i++) {
+      tensorflow::ops::Placeholder input(root, tensorflow::DT_FLOAT);
+      inputs.push_back(input);
+      input_names.push_back(input.node()->name() + ":0");
+    }
+    tensorflow::ops::AddN sum(root, inputs);
+    output_name = sum.node()->name() + ":0";
+    CHECK(root.ToGraphDef(&graph_def).ok());
+  }
+
+  tensorflow::GraphDef graph_def;
+  std::vector<std::string> input_names;
+  std::string output_name;
+};
+
+std::unique_ptr<tensorflow::Session> CreateSession(
+    const tensorflow::GraphDef& graph_def) {
+  std::unique_ptr<tensorflow::Session> session(
+      tensorflow::NewSession(tensorflow::SessionOptions()));
+  CHECK(session->Create(graph_def).ok());
+  return session;
+}
+
+void BM_SessionRun(benchmark::State& state) {
+  SumGraph graph(state.range(0));
+  std::unique_ptr<tensorflow::Session> session = CreateSession(graph.graph_def);
+  for (auto _ : state) {
+    std::vector<std::pair<std::string, tensorflow::Tensor>> inputs;
+    for (const std::string& name : graph.input_names) {
+      inputs.emplace_back(name, tensorflow::Tensor(1.0f));
+    }
+    std::vector<tensorflow::Tensor> outputs;
+    CHECK(session->Run(inputs, {graph.output_name}, {}, &outputs).ok());
+    benchmark::DoNotOptimize(outputs);
+  }
+}
+BENCHMARK(BM_SessionRun)->Arg(1)->Arg(16)->Arg(128);
+
+void BM_SessionRunCallable(benchmark::State& state) {
+  SumGraph graph(state.range(0));
+  std::unique_ptr<tensorflow::Session> session = CreateSession(graph.graph_def);
+  tensorflow::CallableOptions options;
+  for (const std::string& name : graph.input_names) {
+    options.add_feed(name);
+  }
+  options.add_fetch(graph.output_name);
+  tensorflow::Session::CallableHandle handle;
+  CHECK(session->MakeCallable(options, &handle).ok());
+  for (auto _ : state) {
+    std::vector<tensorflow::Tensor> inputs(graph.input_names.size(),
+                                           tensorflow::Tensor(1.0f));
+    std::vector<tensorflow::Tensor> outputs;
+    CHECK(session->RunCallable(handle, inputs, &outputs,
+                               /*run_metadata=*/nullptr)
+              .ok());
+    benchmark::DoNotOptimize(outputs);
+  }
+  CHECK(session->ReleaseCallable(handle).ok());
+}
+BENCHMARK(BM_SessionRunCallable)->Arg(1)->Arg(16)->Arg(128);
+
+void BM_TensorFlowExecutorCall(benchmark::State& state) {
+  SumGraph graph(state.range(0));
+  v0::Value computation_pb;
+  v0::TensorFlow* tensorflow_pb =
+      computation_pb.mutable_computation()->mutable_tensorflow();
+  tensorflow_pb->mutable_graph_def()->PackFrom(graph.graph_def);
+  for (const std::string& name : graph.input_names) {
+    *tensorflow_pb->mutable_parameter()
+         ->mutable_struct_()
+         ->add_element()
+         ->mutable_tensor()
+         ->mutable_tensor_name() = name;
+  }
+  *tensorflow_pb->mutable_result()->mutable_tensor()->mutable_tensor_name() =
+      graph.output_name;
+  v0::Value input_pb;
+  CHECK(SerializeTensorValue(tensorflow::Tensor(1.0f), &input_pb).ok());
+
+  std::shared_ptr<Executor> executor = CreateTensorFlowExecutor();
+  OwnedValueId computation = executor->CreateValue(computation_pb).value();
+  OwnedValueId input = executor->CreateValue(input_pb).value();
+  std::vector<ValueId> inputs(graph.input_names.size(), input.ref());
+  OwnedValueId arg = executor->CreateStruct(inputs).value();
+  for (auto _ : state) {
+    OwnedValueId result = executor->CreateCall(computation, arg).value();
+    benchmark::DoNotOptimize(executor->Materialize(result).value());
+  }
+}
+BENCHMARK(BM_TensorFlowExecutorCall)->Arg(1)->Arg(16)->Arg(128);
+
+}  // namespace
+
+}  // namespace tensorflow_federated
@@ -28,6 +28,7 @@ limitations under the License
 #include "absl/flags/flag.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/time/time.h"
 #include "absl/types/optional.h"
 #include "absl/types/span.h"
 #include "tensorflow/cc/framework/ops.h"
@@ -452,6 +453,49 @@ TEST_F(TensorFlowExecutorTest, CallAdd) {
   CheckCallEqualsProto(fn, arg, expected);
 }
 
+TEST_F(TensorFlowExecutorTest, CallWithRepeatedOutputTensor) {
+  tensorflow::Scope root = tensorflow::Scope::NewRootScope();
+  tensorflow::ops::Placeholder x(root, tensorflow::DT_INT32);
+  tensorflow::ops::Placeholder y(root, tensorflow::DT_INT32);
+  tensorflow::ops::AddV2 out(root, x, y);
+  v0::Value fn =
+      ComputationV(StructB({TensorB(x), TensorB(y)}),
+                   StructB({TensorB(out), TensorB(x), TensorB(out)}), root);
+  v0::Value arg = StructV({TensorV(1), TensorV(2)});
+  v0::Value expected = StructV({TensorV(3), TensorV(1), TensorV(3)});
+  CheckCallEqualsProto(fn, arg, expected);
+  CheckCallRepeatedlyEqualsProto(fn, arg, expected);
+}
+
+TEST_F(TensorFlowExecutorTest, CallWithMismatchedArgumentStructureFails) {
+  tensorflow::Scope root = tensorflow::Scope::NewRootScope();
+  tensorflow::ops::Placeholder x(root, tensorflow::DT_INT32);
+  tensorflow::ops::Placeholder y(root, tensorflow::DT_INT32);
+  tensorflow::ops::AddV2 out(root, x, y);
+  TFF_ASSERT_OK_AND_ASSIGN(
+      OwnedValueId fn,
+      test_executor_->CreateValue(ComputationV(
+          StructB({TensorB(x), TensorB(y)}), TensorB(out), root)));
+  TFF_ASSERT_OK_AND_ASSIGN(
+      OwnedValueId short_arg,
+      test_executor_->CreateValue(StructV({TensorV(1)})));
+  TFF_ASSERT_OK_AND_ASSIGN(
+      OwnedValueId nested_arg,
+      test_executor_->CreateValue(StructV({StructV({TensorV(1)}),
+                                           TensorV(2)})));
+  TFF_ASSERT_OK_AND_ASSIGN(OwnedValueId short_result,
+                           test_executor_->CreateCall(fn, short_arg));
+  TFF_ASSERT_OK_AND_ASSIGN(OwnedValueId nested_result,
+                           test_executor_->CreateCall(fn, nested_arg));
+  EXPECT_THAT(test_executor_->Materialize(short_result),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("with 1 fields")));
+  EXPECT_THAT(test_executor_->Materialize(nested_result),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       "Attempted to bind struct value to argument of kind "
+                       "tensor"));
+}
+
 TEST_F(TensorFlowExecutorTest, StatefulCallGetsReinitialized) {
   tensorflow::Scope root = tensorflow::Scope::NewRootScope();
   tensorflow::TensorShape shape({});
@@ -488,5 +532,170 @@ TEST_F(TensorFlowExecutorTest, CallWithComputationId) {
   CheckCallEqualsProto(fn, arg, expected);
 }
 
+// Returns an int32 identity computation with the given `cache_key` id.
+v0::Value IdentityWithCacheKey(uint64_t id) {
+  tensorflow::Scope root = tensorflow::Scope::NewRootScope();
+  tensorflow::ops::Placeholder in(root, tensorflow::DT_INT32);
+  tensorflow::ops::Identity out(root, in);
+  v0::Value fn = ComputationV(TensorB(in), TensorB(out), root);
+  fn.mutable_computation()->mutable_tensorflow()->mutable_cache_key()->set_id(
+      id);
+  return fn;
+}
+
+TEST(TensorFlowExecutorFunctionCacheTest, EvictsLeastRecentlyUsedFunction) {
+  FunctionCacheStats stats;
+  TensorFlowExecutorOptions options;
+  options.function_cache_max_functions = 2;
+  options.function_cache_stats_callback =
+      [&stats](const FunctionCacheStats& new_stats) { stats = new_stats; };
+  std::shared_ptr<Executor> executor = CreateTensorFlowExecutor(options);
+  for (uint64_t id : {1, 2, 1, 3}) {
+    TFF_ASSERT_OK(executor->CreateValue(IdentityWithCacheKey(id)));
+  }
+  // Function 2 was the least recently used when function 3 was inserted.
+  EXPECT_EQ(stats.hits, 1);
+  EXPECT_EQ(stats.misses, 3);
+  EXPECT_EQ(stats.evictions, 1);
+  EXPECT_EQ(stats.num_functions, 2);
+  EXPECT_GT(stats.approximate_bytes, 0);
+  // Lookups alone are not reported.
+  TFF_ASSERT_OK(executor->CreateValue(IdentityWithCacheKey(1)));
+  EXPECT_EQ(stats.hits, 1);
+  TFF_ASSERT_OK(executor->CreateValue(IdentityWithCacheKey(2)));
+  EXPECT_EQ(stats.hits, 2);
+  EXPECT_EQ(stats.misses, 4);
+  EXPECT_EQ(stats.evictions, 2);
+  // Function 3 was evicted rather than function 1.
+  TFF_ASSERT_OK(executor->CreateValue(IdentityWithCacheKey(1)));
+  TFF_ASSERT_OK(executor->CreateValue(IdentityWithCacheKey(3)));
+  EXPECT_EQ(stats.hits, 3);
+  EXPECT_EQ(stats.misses, 5);
+  EXPECT_EQ(stats.num_functions, 2);
+}
+
+TEST(TensorFlowExecutorFunctionCacheTest, EvictedFunctionRemainsCallable) {
+  TensorFlowExecutorOptions options;
+  options.function_cache_max_functions = 1;
+  std::shared_ptr<Executor> executor = CreateTensorFlowExecutor(options);
+  TFF_ASSERT_OK_AND_ASSIGN(OwnedValueId fn,
+                           executor->CreateValue(IdentityWithCacheKey(1)));
+  TFF_ASSERT_OK(executor->CreateValue(IdentityWithCacheKey(2)));
+  TFF_ASSERT_OK_AND_ASSIGN(OwnedValueId arg,
+                           executor->CreateValue(TensorV(5)));
+  TFF_ASSERT_OK_AND_ASSIGN(OwnedValueId result,
+                           executor->CreateCall(fn, arg));
+  EXPECT_THAT(executor->Materialize(result),
+              IsOkAndHolds(EqualsProto(TensorV(5))));
+}
+
+class TensorFlowExecutorBatchingTest : public ::testing::Test {
+ public:
+  TensorFlowExecutorBatchingTest() {
+    TensorFlowExecutorOptions options;
+    options.max_call_batch_size = 4;
+    // A long window, so that the calls below are batched.
+    options.call_batch_window = absl::Milliseconds(100);
+    test_executor_ = CreateTensorFlowExecutor(options);
+  }
+
+  // Returns the id of a computation adding its two int32 arguments.
+  absl::StatusOr<OwnedValueId> CreateAdd() {
+    tensorflow::Scope root = tensorflow::Scope::NewRootScope();
+    tensorflow::ops::Placeholder x(root, tensorflow::DT_INT32);
+    tensorflow::ops::Placeholder y(root, tensorflow::DT_INT32);
+    tensorflow::ops::AddV2 out(root, x, y);
+    return test_executor_->CreateValue(
+        ComputationV(StructB({TensorB(x), TensorB(y)}), TensorB(out), root));
+  }
+
+  std::shared_ptr<Executor> test_executor_;
+};
+
+TEST_F(TensorFlowExecutorBatchingTest, ConcurrentCallsReturnTheirOwnResults) {
+  TFF_ASSERT_OK_AND_ASSIGN(OwnedValueId fn, CreateAdd());
+  // More calls than fit in one batch, and not a multiple of the batch size.
+  const int32_t kNumCalls = 10;
+  std::vector<OwnedValueId> results;
+  for (int32_t i = 0; i < kNumCalls; i++) {
+    TFF_ASSERT_OK_AND_ASSIGN(
+        OwnedValueId arg,
+        test_executor_->CreateValue(StructV({TensorV(i), TensorV(100)})));
+    TFF_ASSERT_OK_AND_ASSIGN(OwnedValueId result,
+                             test_executor_->CreateCall(fn, arg));
+    results.push_back(std::move(result));
+  }
+  for (int32_t i = 0; i < kNumCalls; i++) {
+    EXPECT_THAT(test_executor_->Materialize(results[i]),
+                IsOkAndHolds(EqualsProto(TensorV(i + 100))));
+  }
+}
+
+TEST_F(TensorFlowExecutorBatchingTest, PartialBatchReturnsItsOwnResults) {
+  TFF_ASSERT_OK_AND_ASSIGN(OwnedValueId fn, CreateAdd());
+  // Fewer calls than the batch size: the remaining replicas are padded with the
+  // first call's inputs, and their outputs must not leak into the results.
+  TFF_ASSERT_OK_AND_ASSIGN(
+      OwnedValueId first_arg,
+      test_executor_->CreateValue(StructV({TensorV(1), TensorV(2)})));
+  TFF_ASSERT_OK_AND_ASSIGN(
+      OwnedValueId second_arg,
+      test_executor_->CreateValue(StructV({TensorV(10), TensorV(20)})));
+  TFF_ASSERT_OK_AND_ASSIGN(OwnedValueId first_result,
+                           test_executor_->CreateCall(fn, first_arg));
+  TFF_ASSERT_OK_AND_ASSIGN(OwnedValueId second_result,
+                           test_executor_->CreateCall(fn, second_arg));
+  EXPECT_THAT(test_executor_->Materialize(first_result),
+              IsOkAndHolds(EqualsProto(TensorV(3))));
+  EXPECT_THAT(test_executor_->Materialize(second_result),
+              IsOkAndHolds(EqualsProto(TensorV(30))));
+}
+
+TEST_F(TensorFlowExecutorBatchingTest, FailedCallDoesNotFailItsBatch) {
+  TFF_ASSERT_OK_AND_ASSIGN(OwnedValueId fn, CreateAdd());
+  TFF_ASSERT_OK_AND_ASSIGN(
+      OwnedValueId good_arg,
+      test_executor_->CreateValue(StructV({TensorV(1), TensorV(2)})));
+  // A double cannot be fed to the int32 placeholders.
+  TFF_ASSERT_OK_AND_ASSIGN(
+      OwnedValueId bad_arg,
+      test_executor_->CreateValue(StructV({TensorV(1.0), TensorV(2.0)})));
+  TFF_ASSERT_OK_AND_ASSIGN(OwnedValueId good_result,
+                           test_executor_->CreateCall(fn, good_arg));
+  TFF_ASSERT_OK_AND_ASSIGN(OwnedValueId bad_result,
+                           test_executor_->CreateCall(fn, bad_arg));
+  EXPECT_THAT(test_executor_->Materialize(good_result),
+              IsOkAndHolds(EqualsProto(TensorV(3))));
+  EXPECT_THAT(test_executor_->Materialize(bad_result),
+              StatusIs(absl::StatusCode::kInternal));
+}
+
+TEST_F(TensorFlowExecutorBatchingTest, StatefulCallsAreNotBatched) {
+  tensorflow::Scope root = tensorflow::Scope::NewRootScope();
+  tensorflow::TensorShape shape({});
+  tensorflow::ops::VarHandleOp var(root, tensorflow::DT_INT32, shape);
+  tensorflow::ops::AssignVariableOp var_init(
+      root, var, tensorflow::ops::Const(root, {0}, shape));
+  tensorflow::ops::AssignAddVariableOp var_add_assign(
+      root, var, tensorflow::ops::Const(root, {1}, shape));
+  tensorflow::ops::ReadVariableOp read_var(
+      root.WithControlDependencies({var_add_assign}), var,
+      tensorflow::DT_INT32);
+  TFF_ASSERT_OK_AND_ASSIGN(
+      OwnedValueId fn,
+      test_executor_->CreateValue(
+          ComputationV(absl::nullopt, TensorB(read_var), root, var_init)));
+  std::vector<OwnedValueId> results;
+  for (int32_t i = 0; i < 4; i++) {
+    TFF_ASSERT_OK_AND_ASSIGN(OwnedValueId result,
+                             test_executor_->CreateCall(fn, absl::nullopt));
+    results.push_back(std::move(result));
+  }
+  for (const OwnedValueId& result : results) {
+    EXPECT_THAT(test_executor_->Materialize(result),
+                IsOkAndHolds(EqualsProto(TensorV(1))));
+  }
+}
+
 }  // namespace
 }  // namespace tensorflow_federated
@@ -0,0 +1,276 @@
+/* Copyright 2022, The TensorFlow Federated Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+#include "tensorflow_federated/cc/core/impl/executors/thread_pool.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT
+#include <utility>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+
+namespace tensorflow_federated {
+
+namespace {
+
+// The pool (if any) of which the current thread is a worker.
+thread_local ThreadPool* current_pool = nullptr;
+// The index of the queue owned by the current thread in `current_pool`, or -1
+// if the current thread is a compensating thread.
+thread_local int32_t current_worker_index = -1;
+
+// How long a compensating thread lingers without work before exiting.
+constexpr absl::Duration kCompensatingThreadIdleTimeout = absl::Milliseconds(50);
+
+ABSL_CONST_INIT absl::Mutex global_pool_mutex(absl::kConstInit);
+int32_t global_pool_size ABSL_GUARDED_BY(global_pool_mutex) = 0;
+bool global_pool_created ABSL_GUARDED_BY(global_pool_mutex) = false;
+
+int32_t ResolveNumThreads(int32_t num_threads) {
+  if (num_threads > 0) {
+    return num_threads;
+  }
+  return std::max<int32_t>(1, std::thread::hardware_concurrency());
+}
+
+}  // namespace
+
+std::string ThreadPool::Stats::DebugString() const {
+  return absl::StrCat("num_threads=", num_threads, " queue_depth=", queue_depth,
+                      " tasks_executed=", tasks_executed, " steals=", steals,
+                      " blocked_workers=", blocked_workers,
+                      " compensating_threads=", compensating_threads,
+                      " compensating_threads_started=",
+                      compensating_threads_started);
+}
+
+ThreadPool::ScopedBlockingCall::ScopedBlockingCall() : pool_(current_pool) {
+  if (pool_ != nullptr) {
+    pool_->blocked_workers_.fetch_add(1);
+    pool_->MaybeStartCompensatingThread();
+  }
+}
+
+ThreadPool::ScopedBlockingCall::~ScopedBlockingCall() {
+  if (pool_ != nullptr) {
+    pool_->blocked_workers_.fetch_sub(1);
+  }
+}
+
+ThreadPool::ThreadPool(int32_t num_threads)
+    : num_threads_(ResolveNumThreads(num_threads)) {
+  queues_.reserve(num_threads_);
+  for (int32_t i = 0; i < num_threads_; i++) {
+    queues_.push_back(std::make_unique<WorkerQueue>());
+  }
+  workers_.reserve(num_threads_);
+  for (int32_t i = 0; i < num_threads_; i++) {
+    workers_.emplace_back([this, i]() { WorkerLoop(i); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    absl::MutexLock lock(&mutex_);
+    shutdown_.store(true);
+  }
+  for (std::thread& worker : workers_) {
+    worker.join();
+  }
+  absl::MutexLock lock(&mutex_);
+  mutex_.Await(absl::Condition(this, &ThreadPool::CompensatingThreadsExited));
+}
+
+void ThreadPool::Schedule(std::function<void()> task) {
+  // Increment before publishing the task so that `queue_depth_` never goes
+  // negative when a worker pops the task immediately.
+  unfinished_tasks_.fetch_add(1);
+  queue_depth_.fetch_add(1);
+  int32_t index;
+  if (current_pool == this && current_worker_index >= 0) {
+    index = current_worker_index;
+  } else {
+    index = static_cast<int32_t>(next_queue_.fetch_add(1) % num_threads_);
+  }
+  {
+    WorkerQueue& queue = *queues_[index];
+    absl::MutexLock lock(&queue.mutex);
+    queue.tasks.push_back(std::move(task));
+  }
+  if (idle_workers_.load() > 0) {
+    // Releasing `mutex_` causes sleeping workers to re-evaluate their
+    // `WorkAvailableOrShutdown` condition.
+    absl::MutexLock lock(&mutex_);
+  } else {
+    MaybeStartCompensatingThread();
+  }
+}
+
+ThreadPool::Stats ThreadPool::GetStats() const {
+  Stats stats;
+  stats.num_threads = num_threads_;
+  stats.queue_depth = queue_depth_.load();
+  stats.tasks_executed = tasks_executed_.load();
+  stats.steals = steals_.load();
+  stats.blocked_workers = blocked_workers_.load();
+  stats.compensating_threads = compensating_threads_.load();
+  stats.compensating_threads_started = compensating_threads_started_.load();
+  return stats;
+}
+
+void ThreadPool::WaitUntilIdle() {
+  absl::MutexLock lock(&mutex_);
+  mutex_.Await(absl::Condition(this, &ThreadPool::Idle));
+}
+
+bool ThreadPool::IsCurrentThreadWorker() const { return current_pool == this; }
+
+ThreadPool& ThreadPool::Global() {
+  static ThreadPool* pool = []() {
+    absl::MutexLock lock(&global_pool_mutex);
+    global_pool_created = true;
+    return new ThreadPool(global_pool_size);
+  }();
+  return *pool;
+}
+
+absl::Status ThreadPool::ConfigureGlobal(int32_t num_threads) {
+  absl::MutexLock lock(&global_pool_mutex);
+  if (global_pool_created) {
+    return absl::FailedPreconditionError(
+        "The global thread pool must be configured before its first use.");
+  }
+  global_pool_size = num_threads;
+  return absl::OkStatus();
+}
+
+void ThreadPool::WorkerLoop(int32_t worker_index) {
+  current_pool = this;
+  current_worker_index = worker_index;
+  std::function<void()> task;
+  while (true) {
+    if (FindTask(worker_index, task)) {
+      task();
+      task = nullptr;
+      tasks_executed_.fetch_add(1);
+      if (unfinished_tasks_.fetch_sub(1) == 1) {
+        // Releasing `mutex_` causes `WaitUntilIdle` to re-evaluate `Idle`.
+        absl::MutexLock lock(&mutex_);
+      }
+      if (worker_index < 0 &&
+          compensating_threads_.load() > blocked_workers_.load()) {
+        // The blocked workers this thread compensated for have resumed.
+        break;
+      }
+      continue;
+    }
+    if (!WaitForWork(worker_index)) {
+      break;
+    }
+  }
+  if (worker_index < 0) {
+    absl::MutexLock lock(&mutex_);
+    compensating_threads_.fetch_sub(1);
+  }
+  current_pool = nullptr;
+  current_worker_index = -1;
+}
+
+bool ThreadPool::FindTask(int32_t worker_index,
+                          std::function<void()>& task_out) {
+  if (worker_index >= 0) {
+    WorkerQueue& own = *queues_[worker_index];
+    absl::MutexLock lock(&own.mutex);
+    if (!own.tasks.empty()) {
+      task_out = std::move(own.tasks.back());
+      own.tasks.pop_back();
+      queue_depth_.fetch_sub(1);
+      return true;
+    }
+  }
+  // Start stealing from a different victim on each attempt so that thieves
+  // spread out across the queues.
+  uint32_t start = static_cast<uint32_t>(next_queue_.fetch_add(1));
+  for (int32_t i = 0; i < num_threads_; i++) {
+    int32_t victim = static_cast<int32_t>((start + i) % num_threads_);
+    if (victim == worker_index) {
+      continue;
+    }
+    WorkerQueue& queue = *queues_[victim];
+    absl::MutexLock lock(&queue.mutex);
+    if (!queue.tasks.empty()) {
+      task_out = std::move(queue.tasks.front());
+      queue.tasks.pop_front();
+      queue_depth_.fetch_sub(1);
+      steals_.fetch_add(1);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ThreadPool::WaitForWork(int32_t worker_index) {
+  absl::MutexLock lock(&mutex_);
+  idle_workers_.fetch_add(1);
+  absl::Condition work_available(this, &ThreadPool::WorkAvailableOrShutdown);
+  if (worker_index >= 0) {
+    mutex_.Await(work_available);
+  } else {
+    mutex_.AwaitWithTimeout(work_available, kCompensatingThreadIdleTimeout);
+  }
+  idle_workers_.fetch_sub(1);
+  if (queue_depth_.load() > 0) {
+    // Always drain queued work, even during shutdown.
+    return true;
+  }
+  // Compensating threads exit as soon as they run out of work.
+  return worker_index >= 0 && !shutdown_.load();
+}
+
+void ThreadPool::MaybeStartCompensatingThread() {
+  if (shutdown_.load() || queue_depth_.load() == 0 ||
+      idle_workers_.load() > 0) {
+    return;
+  }
+  int32_t compensating = compensating_threads_.load();
+  do {
+    if (compensating >= blocked_workers_.load()) {
+      return;
+    }
+  } while (!compensating_threads_.compare_exchange_weak(compensating,
+                                                        compensating + 1));
+  compensating_threads_started_.fetch_add(1);
+  std::thread([this]() { WorkerLoop(-1); }).detach();
+}
+
+bool ThreadPool::WorkAvailableOrShutdown() const {
+  return queue_depth_.load() > 0 || shutdown_.load();
+}
+
+bool ThreadPool::Idle() const { return unfinished_tasks_.load() == 0; }
+
+bool ThreadPool::CompensatingThreadsExited() const {
+  return compensating_threads_.load() == 0;
+}
+
+}  // namespace tensorflow_federated
@@ -0,0 +1,174 @@
+/* Copyright 2022, The TensorFlow Federated Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+#ifndef THIRD_PARTY_TENSORFLOW_FEDERATED_CC_CORE_IMPL_EXECUTORS_THREAD_POOL_H_
+#define THIRD_PARTY_TENSORFLOW_FEDERATED_CC_CORE_IMPL_EXECUTORS_THREAD_POOL_H_
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/status/status.h"
+#include "absl/synchronization/mutex.h"
+
+namespace tensorflow_federated {
+
+// A work-stealing thread pool used to run the asynchronous portions of
+// executor calls (`ThreadRun`, `Map`, `ParallelTasks`).
+//
+// Each of the pool's `num_threads` workers owns a deque of tasks. Tasks
+// scheduled from a worker are pushed onto the back of that worker's deque and
+// popped LIFO by the same worker, which keeps dependent work on warm caches.
+// Tasks scheduled from outside of the pool are distributed round-robin across
+// the worker deques. Idle workers steal from the front of other workers'
+// deques.
+//
+// Executor code frequently blocks a worker while waiting for the result of
+// another task (see `Wait` in `threading.h`). To prevent such waits from
+// exhausting the pool and deadlocking, code which is about to block should
+// construct a `ScopedBlockingCall`. While any workers are blocked the pool
+// starts temporary "compensating" threads so that up to `num_threads` workers
+// remain runnable at all times. Compensating threads exit once they run out of
+// work.
+class ThreadPool {
+ public:
+  // A snapshot of the pool's counters.
+  struct Stats {
+    // The number of workers the pool attempts to keep runnable.
+    int32_t num_threads = 0;
+    // The number of tasks scheduled but not yet started.
+    int64_t queue_depth = 0;
+    // The total number of tasks which have been run.
+    int64_t tasks_executed = 0;
+    // The number of tasks taken from another worker's deque.
+    int64_t steals = 0;
+    // The number of workers currently inside of a `ScopedBlockingCall`.
+    int32_t blocked_workers = 0;
+    // The number of compensating threads currently alive.
+    int32_t compensating_threads = 0;
+    // The total number of compensating threads ever started.
+    int64_t compensating_threads_started = 0;
+
+    std::string DebugString() const;
+  };
+
+  // Marks the current thread as blocked for the lifetime of this object.
+  //
+  // Has no effect when constructed on a thread which is not a pool worker.
+  class ScopedBlockingCall {
+   public:
+    ScopedBlockingCall();
+    ~ScopedBlockingCall();
+
+    ScopedBlockingCall(const ScopedBlockingCall&) = delete;
+    ScopedBlockingCall& operator=(const ScopedBlockingCall&) = delete;
+
+   private:
+    ThreadPool* pool_;
+  };
+
+  // Creates a pool with `num_threads` workers. Non-positive values use the
+  // number of hardware threads.
+  explicit ThreadPool(int32_t num_threads);
+
+  // Runs all previously-scheduled tasks and joins the workers.
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  // Schedules `task` to be run on the pool.
+  void Schedule(std::function<void()> task);
+
+  // Returns a snapshot of the pool's counters.
+  Stats GetStats() const;
+
+  // Blocks until every task scheduled so far, including the tasks they
+  // schedule in turn, has run and been destroyed. Must not be called from a
+  // worker of this pool.
+  void WaitUntilIdle();
+
+  int32_t num_threads() const { return num_threads_; }
+
+  // Returns whether the calling thread is a worker of this pool.
+  bool IsCurrentThreadWorker() const;
+
+  // Returns the process-wide pool used by the executor runtime.
+  //
+  // The pool is created on first use, sized according to the last call to
+  // `ConfigureGlobal` (or the number of hardware threads if none occurred).
+  // It is never destroyed.
+  static ThreadPool& Global();
+
+  // Sets the number of workers used by the process-wide pool. This must be
+  // called before the first call to `Global`, typically from `main`.
+  static absl::Status ConfigureGlobal(int32_t num_threads);
+
+ private:
+  struct WorkerQueue {
+    absl::Mutex mutex;
+    std::deque<std::function<void()>> tasks ABSL_GUARDED_BY(mutex);
+  };
+
+  // Runs tasks until shutdown. `worker_index` is the index of the owned queue,
+  // or -1 for compensating threads which own no queue.
+  void WorkerLoop(int32_t worker_index);
+
+  // Pops a task from `worker_index`'s own queue (if any), or steals one from
+  // another worker. Returns false if no task could be found.
+  bool FindTask(int32_t worker_index, std::function<void()>& task_out);
+
+  // Blocks until a task may be available, shutdown, or (for compensating
+  // threads) the pool no longer needs this thread. Returns false if the
+  // calling thread should exit.
+  bool WaitForWork(int32_t worker_index);
+
+  // Starts a compensating thread if fewer than `num_threads_` workers are
+  // runnable, no worker is idle, and there is queued work.
+  void MaybeStartCompensatingThread();
+
+  bool WorkAvailableOrShutdown() const;
+  bool CompensatingThreadsExited() const ABSL_SHARED_LOCKS_REQUIRED(mutex_);
+  bool Idle() const;
+
+  const int32_t num_threads_;
+  std::vector<std::unique_ptr<WorkerQueue>> queues_;
+  std::vector<std::thread> workers_;
+
+  std::atomic<int64_t> queue_depth_{0};
+  // The number of tasks scheduled but not yet finished.
+  std::atomic<int64_t> unfinished_tasks_{0};
+  std::atomic<int64_t> tasks_executed_{0};
+  std::atomic<int64_t> steals_{0};
+  std::atomic<uint64_t> next_queue_{0};
+  std::atomic<int32_t> idle_workers_{0};
+  std::atomic<int32_t> blocked_workers_{0};
+  std::atomic<int32_t> compensating_threads_{0};
+  std::atomic<int64_t> compensating_threads_started_{0};
+  std::atomic<bool> shutdown_{false};
+
+  // Guards sleeping and waking of idle workers.
+  mutable absl::Mutex mutex_;
+};
+
+}  // namespace tensorflow_federated
+
+#endif  // THIRD_PARTY_TENSORFLOW_FEDERATED_CC_CORE_IMPL_EXECUTORS_THREAD_POOL_H_
@@ -0,0 +1,139 @@
+/* Copyright 2022, The TensorFlow Federated Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+#include "tensorflow_federated/cc/core/impl/executors/thread_pool.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include "googlemock/include/gmock/gmock.h"
+#include "googletest/include/gtest/gtest.h"
+#include "absl/synchronization/blocking_counter.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/time.h"
+#include "tensorflow_federated/cc/core/impl/executors/status_matchers.h"
+
+namespace tensorflow_federated {
+
+namespace {
+
+class ThreadPoolTest : public ::testing::Test {};
+
+TEST_F(ThreadPoolTest, RunsAllTasks) {
+  const uint32_t NUM_TASKS = 5000;
+  std::atomic<uint32_t> counter(0);
+  absl::BlockingCounter done(NUM_TASKS);
+  ThreadPool pool(4);
+  for (uint32_t i = 0; i < NUM_TASKS; i++) {
+    pool.Schedule([&counter, &done]() {
+      counter.fetch_add(1);
+      done.DecrementCount();
+    });
+  }
+  done.Wait();
+  EXPECT_EQ(counter.load(), NUM_TASKS);
+  EXPECT_EQ(pool.GetStats().queue_depth, 0);
+}
+
+TEST_F(ThreadPoolTest, DestructorDrainsQueuedTasks) {
+  const uint32_t NUM_TASKS = 1000;
+  std::atomic<uint32_t> counter(0);
+  {
+    ThreadPool pool(2);
+    for (uint32_t i = 0; i < NUM_TASKS; i++) {
+      pool.Schedule([&counter]() { counter.fetch_add(1); });
+    }
+  }
+  EXPECT_EQ(counter.load(), NUM_TASKS);
+}
+
+TEST_F(ThreadPoolTest, TasksScheduledFromWorkersAreStolen) {
+  const uint32_t NUM_TASKS = 1000;
+  absl::BlockingCounter done(NUM_TASKS);
+  ThreadPool pool(4);
+  // All of the inner tasks land on a single worker's deque, so the remaining
+  // workers can only find work by stealing.
+  pool.Schedule([&pool, &done]() {
+    for (uint32_t i = 0; i < NUM_TASKS; i++) {
+      pool.Schedule([&done]() {
+        absl::SleepFor(absl::Microseconds(10));
+        done.DecrementCount();
+      });
+    }
+  });
+  done.Wait();
+  EXPECT_GT(pool.GetStats().steals, 0);
+}
+
+TEST_F(ThreadPoolTest, WaitUntilIdleWaitsForNestedTasks) {
+  const uint32_t NUM_TASKS = 100;
+  std::atomic<uint32_t> counter(0);
+  ThreadPool pool(4);
+  pool.Schedule([&pool, &counter]() {
+    for (uint32_t i = 0; i < NUM_TASKS; i++) {
+      pool.Schedule([&counter]() {
+        absl::SleepFor(absl::Microseconds(10));
+        counter.fetch_add(1);
+      });
+    }
+  });
+  pool.WaitUntilIdle();
+  EXPECT_EQ(counter.load(), NUM_TASKS);
+  EXPECT_EQ(pool.GetStats().queue_depth, 0);
+}
+
+TEST_F(ThreadPoolTest, BlockedWorkersAreCompensated) {
+  // A single-worker pool in which the only worker blocks on a task scheduled
+  // after it. Without compensation this would deadlock.
+  ThreadPool pool(1);
+  absl::Notification inner_done;
+  absl::Notification outer_done;
+  pool.Schedule([&pool, &inner_done, &outer_done]() {
+    EXPECT_TRUE(pool.IsCurrentThreadWorker());
+    pool.Schedule([&inner_done]() { inner_done.Notify(); });
+    {
+      ThreadPool::ScopedBlockingCall blocking_call;
+      inner_done.WaitForNotification();
+    }
+    outer_done.Notify();
+  });
+  outer_done.WaitForNotification();
+  EXPECT_GE(pool.GetStats().compensating_threads_started, 1);
+}
+
+TEST_F(ThreadPoolTest, ScopedBlockingCallOutsidePoolIsNoOp) {
+  ThreadPool pool(1);
+  EXPECT_FALSE(pool.IsCurrentThreadWorker());
+  {
+    ThreadPool::ScopedBlockingCall blocking_call;
+    EXPECT_EQ(pool.GetStats().blocked_workers, 0);
+  }
+}
+
+TEST_F(ThreadPoolTest, NonPositiveSizeUsesHardwareThreads) {
+  ThreadPool pool(0);
+  EXPECT_GE(pool.num_threads(), 1);
+}
+
+TEST_F(ThreadPoolTest, ConfigureGlobalAfterUseFails) {
+  ThreadPool::Global();
+  EXPECT_THAT(ThreadPool::ConfigureGlobal(2),
+              StatusIs(absl::StatusCode::kFailedPrecondition));
+}
+
+}  // namespace
+
+}  // namespace tensorflow_federated
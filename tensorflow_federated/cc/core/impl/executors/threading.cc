@@ -15,13 +15,16 @@ limitations under the License
 
 #include "tensorflow_federated/cc/core/impl/executors/threading.h"
 
+#include <cstdint>
 #include <functional>
-#include <thread>  // NOLINT
 #include <utility>
 
 #include "absl/base/thread_annotations.h"
 #include "absl/status/status.h"
 #include "absl/synchronization/mutex.h"
+#include "tensorflow_federated/cc/core/impl/executors/cancellation.h"
+#include "tensorflow_federated/cc/core/impl/executors/status_macros.h"
+#include "tensorflow_federated/cc/core/impl/executors/thread_pool.h"
 
 namespace tensorflow_federated {
 
@@ -29,24 +32,72 @@ bool ParallelTasksInner_::AllDone_() ABSL_SHARED_LOCKS_REQUIRED(mutex_) {
   return remaining_tasks_ == 0;
 }
 
-void ParallelTasks::add_task(std::function<absl::Status()> task) {
+bool ParallelTasksInner_::RunPendingTask_(bool from_front) {
+  std::function<absl::Status()> task;
+  {
+    absl::WriterMutexLock lock(&mutex_);
+    if (pending_tasks_.empty()) {
+      return false;
+    }
+    if (from_front) {
+      task = std::move(pending_tasks_.front());
+      pending_tasks_.pop_front();
+    } else {
+      task = std::move(pending_tasks_.back());
+      pending_tasks_.pop_back();
+    }
+  }
+  absl::Status result = RunTask_(task);
+  absl::WriterMutexLock lock(&mutex_);
+  status_.Update(std::move(result));
+  remaining_tasks_ -= 1;
+  return true;
+}
+
+absl::Status ParallelTasksInner_::RunTask_(
+    const std::function<absl::Status()>& task) {
+  TFF_TRY(token_->CheckNotCancelled());
+  absl::Status result;
+  {
+    ScopedCancellationToken scoped_token(token_);
+    result = task();
+  }
+  if (!result.ok()) {
+    token_->Cancel();
+  }
+  return result;
+}
+
+void ParallelTasks::add_task(std::function<absl::Status()> task,
+                             int64_t cost_hint) {
+  if (cost_hint < inline_cost_threshold_) {
+    absl::Status result = shared_inner_->RunTask_(task);
+    absl::WriterMutexLock lock(&shared_inner_->mutex_);
+    shared_inner_->status_.Update(std::move(result));
+    return;
+  }
   {
     absl::WriterMutexLock lock(&shared_inner_->mutex_);
     shared_inner_->remaining_tasks_ += 1;
+    shared_inner_->pending_tasks_.push_back(std::move(task));
   }
-  std::thread task_thread([inner = shared_inner_, task = std::move(task)]() {
-    absl::Status result = task();
-    absl::WriterMutexLock lock(&inner->mutex_);
-    inner->status_.Update(std::move(result));
-    inner->remaining_tasks_ -= 1;
+  // The scheduled closure runs whichever task is oldest by the time it is
+  // picked up, which may be none at all if `WaitAll` has run them already.
+  ThreadPool::Global().Schedule([inner = shared_inner_]() {
+    inner->RunPendingTask_(/*from_front=*/true);
   });
-  task_thread.detach();
 }
 
 absl::Status ParallelTasks::WaitAll() {
+  // Help out with tasks that no worker has started yet, newest first so as to
+  // contend as little as possible with the workers taking the oldest.
+  while (shared_inner_->RunPendingTask_(/*from_front=*/false)) {
+  }
   // NOTE: we must not short-circuit on errors, as the threaded tasks must not
   // be allowed to outlive any temporary variables they reference from the
-  // scope that called `WaitAll`.
+  // scope that called `WaitAll`. Once a task has failed, those which have not
+  // yet started are skipped rather than run, so this wait remains short.
+  ThreadPool::ScopedBlockingCall blocking_call;
   shared_inner_->mutex_.ReaderLockWhen(
       absl::Condition(&*shared_inner_, &ParallelTasksInner_::AllDone_));
   absl::Status status = shared_inner_->status_;
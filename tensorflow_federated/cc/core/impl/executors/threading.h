@@ -16,12 +16,12 @@ limitations under the License
 #ifndef THIRD_PARTY_TENSORFLOW_FEDERATED_CC_CORE_IMPL_EXECUTORS_THREADING_H_
 #define THIRD_PARTY_TENSORFLOW_FEDERATED_CC_CORE_IMPL_EXECUTORS_THREADING_H_
 
-#include <chrono>  // NOLINT
+#include <atomic>
 #include <cstdint>
+#include <deque>
 #include <functional>
-#include <future>  // NOLINT
+#include <limits>
 #include <memory>
-#include <thread>  // NOLINT
 #include <type_traits>
 #include <utility>
 #include <vector>
@@ -30,21 +30,303 @@ limitations under the License
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/synchronization/mutex.h"
+#include "absl/types/optional.h"
 #include "absl/types/span.h"
+#include "tensorflow_federated/cc/core/impl/executors/cancellation.h"
 #include "tensorflow_federated/cc/core/impl/executors/status_macros.h"
+#include "tensorflow_federated/cc/core/impl/executors/thread_pool.h"
 
 namespace tensorflow_federated {
 
-// Runs the provided provided no-arg function on
-// another thread, returning a future to the result.
+template <typename T>
+class SharedFuture;
+
+// The state shared between a `Promise` and the `SharedFuture`s created from
+// it.
+template <typename T>
+class FutureState_ : public std::enable_shared_from_this<FutureState_<T>> {
+ public:
+  using Callback = std::function<void(const SharedFuture<T>&)>;
+
+  bool IsReady() const { return ready_.load(std::memory_order_acquire); }
+
+  void Wait() const {
+    mutex_.LockWhen(absl::Condition(this, &FutureState_::IsReady));
+    mutex_.Unlock();
+  }
+
+  const T& Get() const {
+    Wait();
+    return *value_;
+  }
+
+  void SetValue(T value) {
+    std::vector<Callback> callbacks;
+    {
+      absl::MutexLock lock(&mutex_);
+      value_.emplace(std::move(value));
+      ready_.store(true, std::memory_order_release);
+      callbacks.swap(callbacks_);
+    }
+    SharedFuture<T> future(this->shared_from_this());
+    for (const Callback& callback : callbacks) {
+      callback(future);
+    }
+  }
+
+  void OnReady(Callback callback) {
+    {
+      absl::MutexLock lock(&mutex_);
+      if (!IsReady()) {
+        callbacks_.push_back(std::move(callback));
+        return;
+      }
+    }
+    callback(SharedFuture<T>(this->shared_from_this()));
+  }
+
+  void AddConsumer() { consumers_.fetch_add(1); }
+
+  // Cancels the token returned by `GetCancellationToken` if the last consumer
+  // went away before the value was set.
+  void RemoveConsumer() {
+    if (consumers_.fetch_sub(1) != 1 || IsReady()) {
+      return;
+    }
+    std::shared_ptr<CancellationToken> token;
+    {
+      absl::MutexLock lock(&mutex_);
+      abandoned_ = true;
+      token = token_;
+    }
+    if (token != nullptr) {
+      token->Cancel();
+    }
+  }
+
+  std::shared_ptr<CancellationToken> GetCancellationToken() {
+    std::shared_ptr<CancellationToken> token;
+    bool abandoned;
+    {
+      absl::MutexLock lock(&mutex_);
+      if (token_ == nullptr) {
+        token_ =
+            CancellationToken::CreateChildOf(CancellationToken::Current());
+      }
+      token = token_;
+      abandoned = abandoned_;
+    }
+    if (abandoned) {
+      token->Cancel();
+    }
+    return token;
+  }
+
+ private:
+  mutable absl::Mutex mutex_;
+  std::atomic<bool> ready_{false};
+  // Written once under `mutex_` before `ready_` is set, immutable afterwards.
+  absl::optional<T> value_;
+  std::vector<Callback> callbacks_ ABSL_GUARDED_BY(mutex_);
+  // The number of live `SharedFuture`s (not counting copies) for this state.
+  std::atomic<int32_t> consumers_{0};
+  bool abandoned_ ABSL_GUARDED_BY(mutex_) = false;
+  // Created lazily, as most values are produced without checking for
+  // cancellation.
+  std::shared_ptr<CancellationToken> token_ ABSL_GUARDED_BY(mutex_);
+};
+
+// A copyable handle to a value which will be produced asynchronously.
+//
+// In addition to blocking accessors compatible with `std::shared_future`,
+// `SharedFuture` supports registering continuations via `Then`, which run on
+// the `ThreadPool` once the value is available rather than parking a thread
+// until then.
+//
+// If every `SharedFuture` for a value is destroyed before the value has been
+// produced, the producer's cancellation token is cancelled (see
+// `Promise::cancellation_token`), allowing it to skip or abort the work.
+template <typename T>
+class SharedFuture {
+ public:
+  SharedFuture() = default;
+  explicit SharedFuture(std::shared_ptr<FutureState_<T>> state)
+      : consumer_(std::make_shared<const Consumer>(std::move(state))) {}
+
+  bool valid() const { return consumer_ != nullptr; }
+
+  // Returns whether the value is available without blocking.
+  bool is_ready() const { return state().IsReady(); }
+
+  // Blocks until the value is available.
+  void wait() const { state().Wait(); }
+
+  // Blocks until the value is available and returns it.
+  const T& get() const { return state().Get(); }
+
+  // Runs `callback` with this future once its value is available: immediately
+  // on the calling thread if it already is, otherwise on the thread which sets
+  // the value. `callback` must therefore be cheap and must not block.
+  void OnReady(typename FutureState_<T>::Callback callback) const {
+    state().OnReady(std::move(callback));
+  }
+
+  // Returns a future for the result of `fn(value)`, where `fn` is run on the
+  // `ThreadPool` once this future's value is available.
+  //
+  // If the returned future is abandoned before `fn` starts, and `fn`'s result
+  // can hold an `absl::Status`, `fn` is skipped in favor of a `CancelledError`.
+  template <typename Func,
+            typename Result = std::result_of_t<Func(const T&)>>
+  SharedFuture<Result> Then(Func fn) const;
+
+ private:
+  // Registers a consumer of `state` for as long as any copy of the
+  // `SharedFuture` holding it exists.
+  class Consumer {
+   public:
+    explicit Consumer(std::shared_ptr<FutureState_<T>> state)
+        : state_(std::move(state)) {
+      state_->AddConsumer();
+    }
+    ~Consumer() { state_->RemoveConsumer(); }
+    FutureState_<T>& state() const { return *state_; }
+
+   private:
+    std::shared_ptr<FutureState_<T>> state_;
+  };
+
+  FutureState_<T>& state() const { return consumer_->state(); }
+
+  std::shared_ptr<const Consumer> consumer_;
+};
+
+// The producing side of a `SharedFuture`.
+template <typename T>
+class Promise {
+ public:
+  Promise() : state_(std::make_shared<FutureState_<T>>()) {}
+
+  // Returns a future for the promised value. Should be called before the
+  // promise is handed off to the producer.
+  SharedFuture<T> get_future() const { return SharedFuture<T>(state_); }
+
+  // Sets the value of the associated futures and runs their `OnReady`
+  // callbacks. Must be called exactly once.
+  void set_value(T value) const { state_->SetValue(std::move(value)); }
+
+  // Returns a token which is cancelled once all of the futures for this
+  // promise have been destroyed without the value having been set, or when
+  // the `CancellationToken::Current()` of the first caller of this method is
+  // cancelled.
+  std::shared_ptr<CancellationToken> cancellation_token() const {
+    return state_->GetCancellationToken();
+  }
+
+ private:
+  std::shared_ptr<FutureState_<T>> state_;
+};
+
+// Sets `promise` to the result of `fn()`, run with `token` as the current
+// `CancellationToken`. If `token` has already been cancelled and the result is
+// able to hold an error, `fn` is skipped and a `CancelledError` is set instead.
+template <typename Result, typename Func>
+void FulfillPromise_(const Promise<Result>& promise,
+                     const std::shared_ptr<CancellationToken>& token,
+                     Func& fn) {
+  if constexpr (std::is_constructible<Result, absl::Status>::value) {
+    if (token->IsCancelled()) {
+      promise.set_value(Result(token->CheckNotCancelled()));
+      return;
+    }
+  }
+  ScopedCancellationToken scoped_token(token);
+  promise.set_value(fn());
+}
+
+// Holds a `SharedFuture` until `Reset`, after which it is released.
+template <typename T>
+class FutureHolder_ {
+ public:
+  explicit FutureHolder_(SharedFuture<T> future) : future_(std::move(future)) {}
+
+  void Reset() {
+    absl::optional<SharedFuture<T>> released;
+    {
+      absl::MutexLock lock(&mutex_);
+      released.swap(future_);
+    }
+    // `released` is destroyed outside of `mutex_`, as abandoning it may run
+    // cancellation callbacks.
+  }
+
+ private:
+  absl::Mutex mutex_;
+  absl::optional<SharedFuture<T>> future_ ABSL_GUARDED_BY(mutex_);
+};
+
+template <typename T>
+template <typename Func, typename Result>
+SharedFuture<Result> SharedFuture<T>::Then(Func fn) const {
+  Promise<Result> promise;
+  SharedFuture<Result> result = promise.get_future();
+  std::shared_ptr<CancellationToken> token = promise.cancellation_token();
+  // This future must stay alive for as long as `result` may be needed, but no
+  // longer: abandoning `result` should in turn abandon this future.
+  auto source = std::make_shared<FutureHolder_<T>>(*this);
+  token->AddCallback([source]() { source->Reset(); });
+  // `std::function` requires copyable callables, so `fn` is shared.
+  auto shared_fn = std::make_shared<Func>(std::move(fn));
+  OnReady([promise = std::move(promise), shared_fn = std::move(shared_fn),
+           token = std::move(token),
+           source = std::move(source)](const SharedFuture<T>& ready) {
+    source->Reset();
+    ThreadPool::Global().Schedule([promise, shared_fn, token, ready]() {
+      auto run = [&shared_fn, &ready]() { return (*shared_fn)(ready.get()); };
+      FulfillPromise_(promise, token, run);
+    });
+  });
+  return result;
+}
+
+// Runs the provided provided no-arg function on the process-wide
+// `ThreadPool`, returning a future to the result.
+//
+// The function runs with a `CancellationToken::Current()` which is cancelled if
+// the returned future is abandoned or if the caller's current token is
+// cancelled. If that has already happened by the time the function would
+// start and its result can hold an `absl::Status`, the function is skipped in
+// favor of a `CancelledError`.
 template <typename Func,
           typename ReturnValue = typename std::result_of_t<Func()>>
-std::shared_future<ReturnValue> ThreadRun(Func lambda) {
-  std::packaged_task<ReturnValue()> task(lambda);
-  auto future_ptr = std::shared_future<ReturnValue>(task.get_future());
-  std::thread th(std::move(task));
-  th.detach();
-  return future_ptr;
+SharedFuture<ReturnValue> ThreadRun(Func lambda) {
+  Promise<ReturnValue> promise;
+  SharedFuture<ReturnValue> future = promise.get_future();
+  std::shared_ptr<CancellationToken> token = promise.cancellation_token();
+  // `std::function` requires copyable callables, so `lambda` is shared.
+  auto shared_lambda = std::make_shared<Func>(std::move(lambda));
+  ThreadPool::Global().Schedule(
+      [promise = std::move(promise), token = std::move(token),
+       shared_lambda = std::move(shared_lambda)]() {
+        FulfillPromise_(promise, token, *shared_lambda);
+      });
+  return future;
+}
+
+// Returns whether `future` has completed without blocking.
+template <typename ValueFuture>
+bool IsReady(const ValueFuture& future) {
+  return future.is_ready();
+}
+
+// Blocks until `future` has completed, informing the `ThreadPool` that the
+// current thread is blocked if it has not.
+template <typename ValueFuture>
+void BlockUntilReady(const ValueFuture& future) {
+  if (!IsReady(future)) {
+    ThreadPool::ScopedBlockingCall blocking_call;
+    future.wait();
+  }
 }
 
 // Awaits the result of a ValueFuture, usually a future returning a
@@ -52,7 +334,7 @@ std::shared_future<ReturnValue> ThreadRun(Func lambda) {
 // as a StatusOr.
 template <typename ValueFuture>
 auto Wait(const ValueFuture& future) {
-  future.wait();
+  BlockUntilReady(future);
   const auto& result = future.get();
   using StatusOrValue = typename std::remove_reference<decltype(result)>::type;
   if (!result.ok()) {
@@ -64,7 +346,7 @@ auto Wait(const ValueFuture& future) {
 // Extracts the `ExecutorValue`s from `successfully_completed_futures`.
 template <typename ExecutorValue>
 auto GetAll(
-    const absl::Span<const std::shared_future<absl::StatusOr<ExecutorValue>>>
+    const absl::Span<const SharedFuture<absl::StatusOr<ExecutorValue>>>
         successfully_completed_futures) {
   std::vector<ExecutorValue> out;
   out.reserve(successfully_completed_futures.size());
@@ -84,10 +366,10 @@ auto GetAll(const std::vector<ValueFuture>& futures) {
 // any of them fail.
 template <typename ExecutorValue>
 absl::StatusOr<std::vector<ExecutorValue>> WaitAll(
-    const absl::Span<const std::shared_future<absl::StatusOr<ExecutorValue>>>
+    const absl::Span<const SharedFuture<absl::StatusOr<ExecutorValue>>>
         futures) {
   for (const auto& future : futures) {
-    future.wait();
+    BlockUntilReady(future);
     if (!future.get().ok()) {
       return future.get().status();
     }
@@ -103,22 +385,101 @@ auto WaitAll(const std::vector<ValueFuture>& futures) {
 
 // Converts an already-ready result into a future.
 template <typename ExecutorValue>
-std::shared_future<absl::StatusOr<ExecutorValue>> ReadyFuture(
+SharedFuture<absl::StatusOr<ExecutorValue>> ReadyFuture(
     ExecutorValue&& value) {
-  std::promise<absl::StatusOr<ExecutorValue>> promise;
+  Promise<absl::StatusOr<ExecutorValue>> promise;
   promise.set_value(absl::StatusOr<ExecutorValue>(
       absl::in_place_t(), std::forward<ExecutorValue>(value)));
   return promise.get_future();
 }
 
+// Returns a future which completes once all of `futures` have completed
+// successfully, or as soon as any of them fails, without blocking a thread in
+// the meantime.
+//
+// `futures` are released as soon as the result is known, or once the returned
+// future is abandoned.
+template <typename ExecutorValue>
+SharedFuture<absl::StatusOr<std::vector<ExecutorValue>>> WhenAll(
+    std::vector<SharedFuture<absl::StatusOr<ExecutorValue>>> futures) {
+  using Result = absl::StatusOr<std::vector<ExecutorValue>>;
+  using InputFutures = std::vector<SharedFuture<absl::StatusOr<ExecutorValue>>>;
+  struct State {
+    absl::Mutex mutex;
+    InputFutures futures ABSL_GUARDED_BY(mutex);
+    size_t remaining ABSL_GUARDED_BY(mutex);
+    bool done ABSL_GUARDED_BY(mutex) = false;
+    Promise<Result> promise;
+
+    // Sets the result (computed from the inputs by `result_fn`) unless it has
+    // already been set. Inputs are released outside of `mutex`, as this may
+    // run cancellation callbacks.
+    void Finish(const std::function<Result(const InputFutures&)>& result_fn) {
+      InputFutures released;
+      absl::optional<Result> result;
+      {
+        absl::MutexLock lock(&mutex);
+        if (done) {
+          return;
+        }
+        done = true;
+        result.emplace(result_fn(futures));
+        released.swap(futures);
+      }
+      promise.set_value(std::move(*result));
+    }
+  };
+  auto state = std::make_shared<State>();
+  SharedFuture<Result> result = state->promise.get_future();
+  if (futures.empty()) {
+    state->promise.set_value(std::vector<ExecutorValue>());
+    return result;
+  }
+  {
+    absl::MutexLock lock(&state->mutex);
+    state->remaining = futures.size();
+    state->futures = futures;
+  }
+  std::shared_ptr<CancellationToken> token =
+      state->promise.cancellation_token();
+  token->AddCallback([state = std::weak_ptr<State>(state)]() {
+    std::shared_ptr<State> locked_state = state.lock();
+    if (locked_state != nullptr) {
+      locked_state->Finish([](const InputFutures&) -> Result {
+        return absl::CancelledError("The operation was cancelled.");
+      });
+    }
+  });
+  for (const auto& future : futures) {
+    future.OnReady(
+        [state](const SharedFuture<absl::StatusOr<ExecutorValue>>& ready) {
+          if (!ready.get().ok()) {
+            state->Finish([&ready](const InputFutures&) -> Result {
+              return ready.get().status();
+            });
+            return;
+          }
+          {
+            absl::MutexLock lock(&state->mutex);
+            if (--state->remaining > 0) {
+              return;
+            }
+          }
+          state->Finish([](const InputFutures& inputs) -> Result {
+            return GetAll(inputs);
+          });
+        });
+  }
+  return result;
+}
+
 // Returns whether or not all of the futures in `futures` have completed, or
 // an error if any of them has completed with an error.
 template <typename ValueFuture>
 absl::StatusOr<bool> AllReady(const absl::Span<const ValueFuture> futures) {
   bool all_ready = true;
   for (const ValueFuture& future : futures) {
-    if (future.wait_for(std::chrono::duration<uint8_t>::zero()) ==
-        std::future_status::ready) {
+    if (IsReady(future)) {
       if (!future.get().ok()) {
         return future.get().status();
       }
@@ -135,6 +496,20 @@ auto AllReady(const std::vector<ValueFuture>& futures) {
   return AllReady(absl::Span<const ValueFuture>(futures));
 }
 
+// Like `Map` (below), but always runs `lambda` on the `ThreadPool`, even if
+// all of `futures` have completed already. Suitable for expensive or blocking
+// `lambda`s which should not run on the calling thread.
+template <typename Func, typename ValueFuture>
+ValueFuture MapAsync(std::vector<ValueFuture>&& futures, Func lambda) {
+  using StatusOrValue =
+      std::remove_const_t<std::remove_reference_t<decltype(futures[0].get())>>;
+  using Value = typename StatusOrValue::value_type;
+  return WhenAll(std::move(futures))
+      .Then([lambda = std::move(lambda)](
+                const absl::StatusOr<std::vector<Value>>& values) mutable
+            -> StatusOrValue { return lambda(TFF_TRY(values)); });
+}
+
 // Runs `lambda` on the successful results of `futures` and returns a future
 // for the result of `lambda`.
 //
@@ -142,9 +517,8 @@ auto AllReady(const std::vector<ValueFuture>& futures) {
 // current thread. If any `futures` have already failed, this function will
 // immediately return the result of their failure.
 //
-// If not all `futures` are completed, a new thread will be spawned to await
-// their results, and `lambda` will be run on that thread if and when `futures`
-// all complete successfully.
+// Otherwise, `lambda` will be scheduled on the `ThreadPool` if and when
+// `futures` all complete successfully. No thread is blocked in the meantime.
 template <typename Func, typename ValueFuture>
 absl::StatusOr<ValueFuture> Map(std::vector<ValueFuture>&& futures,
                                 Func lambda) {
@@ -152,32 +526,114 @@ absl::StatusOr<ValueFuture> Map(std::vector<ValueFuture>&& futures,
   if (all_ready) {
     return ReadyFuture(TFF_TRY(lambda(GetAll(futures))));
   }
-  return ThreadRun(
-      [futures = std::move(futures), lambda = std::move(lambda)]()
-          -> absl::StatusOr<std::remove_const_t<
-              std::remove_reference_t<decltype(futures[0].get().value())>>> {
-        return lambda(TFF_TRY(WaitAll(futures)));
-      });
+  return MapAsync(std::move(futures), std::move(lambda));
+}
+
+// Packs the `function` and optional `argument` of a call into the inputs of
+// `Map` or `MapAsync`.
+template <typename ValueFuture>
+std::vector<ValueFuture> CallFutures_(ValueFuture function,
+                                      absl::optional<ValueFuture> argument) {
+  std::vector<ValueFuture> futures = {std::move(function)};
+  if (argument.has_value()) {
+    futures.push_back(std::move(*argument));
+  }
+  return futures;
+}
+
+// Adapts `lambda(function, argument)` to the resolved `CallFutures_`, which
+// hold either `{function}` or `{function, argument}`.
+template <typename Value, typename Func>
+auto CallLambda_(Func lambda) {
+  return [lambda = std::move(lambda)](std::vector<Value>&& values) mutable {
+    absl::optional<Value> argument = absl::nullopt;
+    if (values.size() == 2) {
+      argument = std::move(values[1]);
+    }
+    return lambda(std::move(values[0]), std::move(argument));
+  };
+}
+
+// Runs `lambda(function, argument)` on the results of `function` and, if
+// present, `argument`, as `Map` does. Executors implement `CreateCall` with
+// this.
+template <typename Func, typename ValueFuture>
+absl::StatusOr<ValueFuture> MapCall(ValueFuture function,
+                                    absl::optional<ValueFuture> argument,
+                                    Func lambda) {
+  using Value = typename std::remove_const_t<
+      std::remove_reference_t<decltype(function.get())>>::value_type;
+  return Map(CallFutures_(std::move(function), std::move(argument)),
+             CallLambda_<Value>(std::move(lambda)));
+}
+
+// Like `MapCall`, but always runs `lambda` on the `ThreadPool`, as `MapAsync`
+// does.
+template <typename Func, typename ValueFuture>
+ValueFuture MapCallAsync(ValueFuture function,
+                         absl::optional<ValueFuture> argument, Func lambda) {
+  using Value = typename std::remove_const_t<
+      std::remove_reference_t<decltype(function.get())>>::value_type;
+  return MapAsync(CallFutures_(std::move(function), std::move(argument)),
+                  CallLambda_<Value>(std::move(lambda)));
 }
 
 class ParallelTasksInner_ {
+ public:
+  ParallelTasksInner_()
+      : token_(CancellationToken::CreateChildOf(CancellationToken::Current())) {
+  }
+
  private:
   bool AllDone_() ABSL_SHARED_LOCKS_REQUIRED(mutex_);
+  // Runs a single not-yet-started task, taken from the front of the queue if
+  // `from_front` and from the back otherwise. Returns false if no tasks were
+  // waiting to be started.
+  bool RunPendingTask_(bool from_front);
+  // Runs `task` (unless the group has been cancelled) and records its result.
+  // The first failing task cancels the group.
+  absl::Status RunTask_(const std::function<absl::Status()>& task);
+  const std::shared_ptr<CancellationToken> token_;
   absl::Mutex mutex_;
   absl::Status status_ ABSL_GUARDED_BY(mutex_) = absl::OkStatus();
   uint32_t remaining_tasks_ ABSL_GUARDED_BY(mutex_) = 0;
+  std::deque<std::function<absl::Status()>> pending_tasks_
+      ABSL_GUARDED_BY(mutex_);
   friend class ParallelTasks;
 };
 
 // A group of `absl::Status`-returning functions to be run in parallel.
+//
+// Tasks are run on the `ThreadPool`, except for those whose `cost_hint` is
+// below the group's inline cost threshold, which are cheaper to run directly
+// on the calling thread than to hand off. Costs are approximate numbers of
+// bytes processed (e.g. the size of a tensor being serialized).
+//
+// The group has a `CancellationToken` which is cancelled by the first task to
+// fail, or when the token current at the group's construction is cancelled.
+// Tasks which have not started by then are skipped; running tasks see the
+// group's token as `CancellationToken::Current()`.
 class ParallelTasks {
  public:
+  // The `cost_hint` of tasks whose cost is not known. Such tasks are never run
+  // inline.
+  static constexpr int64_t kUnknownCost = std::numeric_limits<int64_t>::max();
+  // The inline cost threshold used by default-constructed `ParallelTasks`.
+  static constexpr int64_t kDefaultInlineCostThreshold = 16 * 1024;
+
   // Default constructor.
-  ParallelTasks() : shared_inner_(std::make_shared<ParallelTasksInner_>()) {}
+  ParallelTasks() : ParallelTasks(kDefaultInlineCostThreshold) {}
+
+  // Constructs a group in which tasks with a `cost_hint` lower than
+  // `inline_cost_threshold` are run inline by `add_task`.
+  explicit ParallelTasks(int64_t inline_cost_threshold)
+      : shared_inner_(std::make_shared<ParallelTasksInner_>()),
+        inline_cost_threshold_(inline_cost_threshold) {}
 
   // Move constructor.
   ParallelTasks(ParallelTasks&& other)
-      : shared_inner_(std::move(other.shared_inner_)) {}
+      : shared_inner_(std::move(other.shared_inner_)),
+        inline_cost_threshold_(other.inline_cost_threshold_) {}
 
   // Move assignment not provided.
   // Note: this would need to wait for the previous tasks (if any) to complete
@@ -193,21 +649,33 @@ class ParallelTasks {
     }
   }
 
-  // Spawns a thread to run a function and adds it to the parallel task group.
-  void add_task(std::function<absl::Status()> task);
+  // Adds a function to the parallel task group. If `cost_hint` is below the
+  // group's inline cost threshold the function is run immediately on the
+  // calling thread, otherwise it is scheduled on the `ThreadPool`.
+  void add_task(std::function<absl::Status()> task,
+                int64_t cost_hint = kUnknownCost);
 
   // Waits until all tasks passed to `add_task` have successfully completed.
   //
   // Returns an `absl::Status` containing the first non-`ok` result of a task,
   // or `ok` if all tasks completed successfully.
   //
+  // Tasks which have not yet been picked up by the `ThreadPool` are run on the
+  // calling thread rather than waiting for a worker to become available.
+  //
   // Note: This method does *not* short-circuit on errors, allowing tasks to
   // reference local variables without fear of the task outliving the scope from
   // which `WaitAll` was invoked.
   absl::Status WaitAll();
 
+  // Returns the token cancelled when the group fails or is cancelled.
+  const std::shared_ptr<CancellationToken>& cancellation_token() const {
+    return shared_inner_->token_;
+  }
+
  private:
   std::shared_ptr<ParallelTasksInner_> shared_inner_;
+  int64_t inline_cost_threshold_;
 };
 
 }  // namespace tensorflow_federated
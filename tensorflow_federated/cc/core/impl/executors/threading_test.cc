@@ -17,11 +17,17 @@ limitations under the License
 
 #include <atomic>
 #include <cstdint>
+#include <memory>
+#include <thread>  // NOLINT
+#include <vector>
 
 #include "googlemock/include/gmock/gmock.h"
 #include "googletest/include/gtest/gtest.h"
 #include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "tensorflow_federated/cc/core/impl/executors/cancellation.h"
 #include "tensorflow_federated/cc/core/impl/executors/status_matchers.h"
+#include "tensorflow_federated/cc/core/impl/executors/thread_pool.h"
 
 namespace tensorflow_federated {
 
@@ -69,6 +75,251 @@ TEST_F(ThreadingTest, ParallelTasksWaitsForAll) {
   EXPECT_EQ(counter.load(), NUM_TASKS);
 }
 
+TEST_F(ThreadingTest, ParallelTasksCheapTasksRunInline) {
+  ParallelTasks tasks(/*inline_cost_threshold=*/100);
+  std::thread::id task_thread;
+  tasks.add_task(
+      [&task_thread]() {
+        task_thread = std::this_thread::get_id();
+        return absl::OkStatus();
+      },
+      /*cost_hint=*/10);
+  // The task must have completed before `add_task` returned.
+  EXPECT_EQ(task_thread, std::this_thread::get_id());
+  EXPECT_THAT(tasks.WaitAll(), IsOk());
+}
+
+TEST_F(ThreadingTest, ParallelTasksInlineTaskError) {
+  ParallelTasks tasks(/*inline_cost_threshold=*/100);
+  tasks.add_task([]() { return absl::UnimplementedError(""); },
+                 /*cost_hint=*/0);
+  tasks.add_task([]() { return absl::OkStatus(); });
+  EXPECT_THAT(tasks.WaitAll(), StatusIs(StatusCode::kUnimplemented));
+}
+
+TEST_F(ThreadingTest, ParallelTasksMixedCostsWaitsForAll) {
+  const uint32_t NUM_TASKS = 5000;
+  std::atomic<uint32_t> counter(0);
+  ParallelTasks tasks(/*inline_cost_threshold=*/2);
+  for (uint32_t i = 0; i < NUM_TASKS; i++) {
+    tasks.add_task(
+        [&counter]() {
+          counter.fetch_add(1);
+          return absl::OkStatus();
+        },
+        /*cost_hint=*/i % 4);
+  }
+  EXPECT_THAT(tasks.WaitAll(), IsOk());
+  EXPECT_EQ(counter.load(), NUM_TASKS);
+}
+
+TEST_F(ThreadingTest, ThreadRunReturnsResult) {
+  SharedFuture<int32_t> future = ThreadRun([]() { return 5; });
+  EXPECT_EQ(future.get(), 5);
+  EXPECT_TRUE(future.is_ready());
+}
+
+TEST_F(ThreadingTest, ThenRunsOnceValueIsSet) {
+  Promise<int32_t> promise;
+  SharedFuture<int32_t> plus_one =
+      promise.get_future().Then([](int32_t value) { return value + 1; });
+  EXPECT_FALSE(plus_one.is_ready());
+  promise.set_value(1);
+  EXPECT_EQ(plus_one.get(), 2);
+}
+
+TEST_F(ThreadingTest, ThenOnReadyFutureRuns) {
+  SharedFuture<absl::StatusOr<int32_t>> ready = ReadyFuture(int32_t{3});
+  auto doubled = ready.Then(
+      [](const absl::StatusOr<int32_t>& value) { return value.value() * 2; });
+  EXPECT_EQ(doubled.get(), 6);
+}
+
+TEST_F(ThreadingTest, ChainedContinuationsDoNotBlockThreads) {
+  const uint32_t CHAIN_LENGTH = 1000;
+  Promise<uint32_t> promise;
+  SharedFuture<uint32_t> future = promise.get_future();
+  for (uint32_t i = 0; i < CHAIN_LENGTH; i++) {
+    future = future.Then([](uint32_t value) { return value + 1; });
+  }
+  // None of the pending continuations occupy a thread.
+  EXPECT_EQ(ThreadPool::Global().GetStats().blocked_workers, 0);
+  EXPECT_EQ(ThreadPool::Global().GetStats().queue_depth, 0);
+  promise.set_value(0);
+  EXPECT_EQ(future.get(), CHAIN_LENGTH);
+}
+
+TEST_F(ThreadingTest, WhenAllEmptyIsReady) {
+  auto all = WhenAll(std::vector<SharedFuture<absl::StatusOr<int32_t>>>());
+  EXPECT_TRUE(all.is_ready());
+  EXPECT_THAT(all.get(), IsOk());
+  EXPECT_TRUE(all.get().value().empty());
+}
+
+TEST_F(ThreadingTest, WhenAllPreservesOrder) {
+  Promise<absl::StatusOr<int32_t>> first;
+  Promise<absl::StatusOr<int32_t>> second;
+  auto all = WhenAll(std::vector<SharedFuture<absl::StatusOr<int32_t>>>(
+      {first.get_future(), second.get_future()}));
+  second.set_value(2);
+  EXPECT_FALSE(all.is_ready());
+  first.set_value(1);
+  EXPECT_THAT(all.get(), IsOkAndHolds(std::vector<int32_t>({1, 2})));
+}
+
+TEST_F(ThreadingTest, WhenAllFailsOnFirstError) {
+  Promise<absl::StatusOr<int32_t>> never_set;
+  Promise<absl::StatusOr<int32_t>> failed;
+  auto all = WhenAll(std::vector<SharedFuture<absl::StatusOr<int32_t>>>(
+      {never_set.get_future(), failed.get_future()}));
+  failed.set_value(absl::UnimplementedError(""));
+  EXPECT_THAT(all.get(), StatusIs(StatusCode::kUnimplemented));
+  never_set.set_value(1);
+}
+
+TEST_F(ThreadingTest, MapRunsOnceInputsAreReady) {
+  Promise<absl::StatusOr<int32_t>> input;
+  std::vector<SharedFuture<absl::StatusOr<int32_t>>> futures(
+      {input.get_future(), ReadyFuture(int32_t{2})});
+  auto sum = Map(std::move(futures),
+                 [](std::vector<int32_t>&& values) -> absl::StatusOr<int32_t> {
+                   return values[0] + values[1];
+                 });
+  ASSERT_THAT(sum, IsOk());
+  EXPECT_FALSE(sum.value().is_ready());
+  input.set_value(1);
+  EXPECT_THAT(Wait(sum.value()), IsOkAndHolds(3));
+}
+
+TEST_F(ThreadingTest, MapCallPassesFunctionAndArgument) {
+  auto call = [](int32_t function, absl::optional<int32_t> argument)
+      -> absl::StatusOr<int32_t> {
+    return function * 10 + argument.value_or(0);
+  };
+  auto with_argument = MapCall(ReadyFuture(int32_t{1}),
+                               absl::make_optional(ReadyFuture(int32_t{2})),
+                               call);
+  ASSERT_THAT(with_argument, IsOk());
+  EXPECT_THAT(Wait(with_argument.value()), IsOkAndHolds(12));
+  auto without_argument = MapCallAsync(
+      ReadyFuture(int32_t{1}),
+      absl::optional<SharedFuture<absl::StatusOr<int32_t>>>(), call);
+  EXPECT_THAT(Wait(without_argument), IsOkAndHolds(10));
+}
+
+TEST_F(ThreadingTest, ParallelTasksFirstErrorCancelsGroup) {
+  ParallelTasks tasks(/*inline_cost_threshold=*/100);
+  tasks.add_task([]() { return absl::UnimplementedError(""); },
+                 /*cost_hint=*/0);
+  EXPECT_TRUE(tasks.cancellation_token()->IsCancelled());
+  bool ran = false;
+  tasks.add_task(
+      [&ran]() {
+        ran = true;
+        return absl::OkStatus();
+      },
+      /*cost_hint=*/0);
+  EXPECT_FALSE(ran);
+  EXPECT_THAT(tasks.WaitAll(), StatusIs(StatusCode::kUnimplemented));
+}
+
+TEST_F(ThreadingTest, ParallelTasksRunWithGroupToken) {
+  ParallelTasks tasks;
+  std::shared_ptr<CancellationToken> seen;
+  tasks.add_task([&seen]() {
+    seen = CancellationToken::Current();
+    return absl::OkStatus();
+  });
+  EXPECT_THAT(tasks.WaitAll(), IsOk());
+  EXPECT_EQ(seen, tasks.cancellation_token());
+}
+
+TEST_F(ThreadingTest, ParallelTasksInheritCurrentToken) {
+  auto parent = std::make_shared<CancellationToken>();
+  ScopedCancellationToken scoped_token(parent);
+  ParallelTasks tasks;
+  parent->Cancel();
+  EXPECT_TRUE(tasks.cancellation_token()->IsCancelled());
+}
+
+TEST_F(ThreadingTest, AbandonedPromiseIsCancelled) {
+  Promise<absl::StatusOr<int32_t>> promise;
+  std::shared_ptr<CancellationToken> token = promise.cancellation_token();
+  {
+    SharedFuture<absl::StatusOr<int32_t>> future = promise.get_future();
+    SharedFuture<absl::StatusOr<int32_t>> copy = future;
+  }
+  EXPECT_TRUE(token->IsCancelled());
+}
+
+TEST_F(ThreadingTest, FulfilledPromiseIsNotCancelled) {
+  Promise<absl::StatusOr<int32_t>> promise;
+  std::shared_ptr<CancellationToken> token = promise.cancellation_token();
+  {
+    SharedFuture<absl::StatusOr<int32_t>> future = promise.get_future();
+    promise.set_value(1);
+  }
+  EXPECT_FALSE(token->IsCancelled());
+}
+
+TEST_F(ThreadingTest, AbandoningContinuationAbandonsInput) {
+  Promise<absl::StatusOr<int32_t>> input;
+  std::shared_ptr<CancellationToken> input_token = input.cancellation_token();
+  {
+    auto continuation =
+        input.get_future().Then([](const absl::StatusOr<int32_t>& value) {
+          return value;
+        });
+    EXPECT_FALSE(input_token->IsCancelled());
+  }
+  EXPECT_TRUE(input_token->IsCancelled());
+}
+
+TEST_F(ThreadingTest, AbandoningMapAbandonsInputs) {
+  Promise<absl::StatusOr<int32_t>> first;
+  Promise<absl::StatusOr<int32_t>> second;
+  std::shared_ptr<CancellationToken> first_token = first.cancellation_token();
+  std::shared_ptr<CancellationToken> second_token =
+      second.cancellation_token();
+  {
+    std::vector<SharedFuture<absl::StatusOr<int32_t>>> futures(
+        {first.get_future(), second.get_future()});
+    auto sum = Map(std::move(futures),
+                   [](std::vector<int32_t>&& values) -> absl::StatusOr<int32_t> {
+                     return values[0] + values[1];
+                   });
+    ASSERT_THAT(sum, IsOk());
+  }
+  EXPECT_TRUE(first_token->IsCancelled());
+  EXPECT_TRUE(second_token->IsCancelled());
+}
+
+TEST_F(ThreadingTest, ThreadRunSkipsCancelledWork) {
+  auto parent = std::make_shared<CancellationToken>();
+  parent->Cancel();
+  ScopedCancellationToken scoped_token(parent);
+  bool ran = false;
+  auto future = ThreadRun([&ran]() -> absl::StatusOr<int32_t> {
+    ran = true;
+    return 1;
+  });
+  EXPECT_THAT(Wait(future), StatusIs(StatusCode::kCancelled));
+  EXPECT_FALSE(ran);
+}
+
+TEST_F(ThreadingTest, FailedInputCancelsSiblingInputs) {
+  Promise<absl::StatusOr<int32_t>> pending;
+  Promise<absl::StatusOr<int32_t>> failing;
+  std::shared_ptr<CancellationToken> pending_token =
+      pending.cancellation_token();
+  auto all = WhenAll(std::vector<SharedFuture<absl::StatusOr<int32_t>>>(
+      {pending.get_future(), failing.get_future()}));
+  EXPECT_FALSE(pending_token->IsCancelled());
+  failing.set_value(absl::InternalError(""));
+  EXPECT_THAT(all.get(), StatusIs(StatusCode::kInternal));
+  EXPECT_TRUE(pending_token->IsCancelled());
+}
+
 }  // namespace
 
 }  // namespace tensorflow_federated
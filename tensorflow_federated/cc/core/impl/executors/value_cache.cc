@@ -0,0 +1,89 @@
+/* Copyright 2022, The TensorFlow Federated Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+#include "tensorflow_federated/cc/core/impl/executors/value_cache.h"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/io/zero_copy_stream_impl_lite.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "tensorflow/core/platform/fingerprint.h"
+#include "tensorflow_federated/proto/v0/executor.pb.h"
+
+namespace tensorflow_federated {
+
+std::string ValueFingerprint(const v0::Value& value) {
+  std::string serialized;
+  {
+    google::protobuf::io::StringOutputStream string_stream(&serialized);
+    google::protobuf::io::CodedOutputStream coded_stream(&string_stream);
+    coded_stream.SetSerializationDeterministic(true);
+    value.SerializeToCodedStream(&coded_stream);
+  }
+  tensorflow::Fprint128 fingerprint = tensorflow::Fingerprint128(serialized);
+  return absl::StrCat(absl::Hex(fingerprint.high64, absl::kZeroPad16),
+                      absl::Hex(fingerprint.low64, absl::kZeroPad16));
+}
+
+std::shared_ptr<const v0::Value> ValueCache::Lookup(
+    absl::string_view fingerprint) {
+  absl::MutexLock lock(&mutex_);
+  auto it = index_.find(fingerprint);
+  if (it == index_.end()) {
+    return nullptr;
+  }
+  entries_.splice(entries_.begin(), entries_, it->second);
+  return it->second->value;
+}
+
+void ValueCache::Insert(std::string fingerprint,
+                        std::shared_ptr<const v0::Value> value) {
+  size_t value_bytes = value->ByteSizeLong();
+  if (value_bytes > max_bytes_) {
+    return;
+  }
+  absl::MutexLock lock(&mutex_);
+  auto it = index_.find(fingerprint);
+  if (it != index_.end()) {
+    entries_.splice(entries_.begin(), entries_, it->second);
+    return;
+  }
+  entries_.push_front({std::move(fingerprint), std::move(value), value_bytes});
+  index_.emplace(entries_.front().fingerprint, entries_.begin());
+  bytes_ += value_bytes;
+  EvictLocked();
+}
+
+size_t ValueCache::bytes() const {
+  absl::MutexLock lock(&mutex_);
+  return bytes_;
+}
+
+void ValueCache::EvictLocked() {
+  while (bytes_ > max_bytes_) {
+    const Entry& oldest = entries_.back();
+    bytes_ -= oldest.bytes;
+    index_.erase(oldest.fingerprint);
+    entries_.pop_back();
+  }
+}
+
+}  // namespace tensorflow_federated
@@ -0,0 +1,84 @@
+/* Copyright 2022, The TensorFlow Federated Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+#ifndef THIRD_PARTY_TENSORFLOW_FEDERATED_CC_CORE_IMPL_EXECUTORS_VALUE_CACHE_H_
+#define THIRD_PARTY_TENSORFLOW_FEDERATED_CC_CORE_IMPL_EXECUTORS_VALUE_CACHE_H_
+
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <string>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "tensorflow_federated/proto/v0/executor.pb.h"
+
+namespace tensorflow_federated {
+
+// The default maximum total size of the values held by a `ValueCache`.
+constexpr size_t kDefaultValueCacheBytes = 256 * 1024 * 1024;
+
+// Returns a fingerprint of the content of `value`, computed over its
+// deterministic serialization. Equal values have equal fingerprints.
+std::string ValueFingerprint(const v0::Value& value);
+
+// A bounded cache of `v0::Value`s keyed by their fingerprints (see
+// `ValueFingerprint`), from which the least recently used values are evicted
+// once their total serialized size exceeds the cache's budget.
+//
+// This class is thread-safe.
+class ValueCache {
+ public:
+  explicit ValueCache(size_t max_bytes = kDefaultValueCacheBytes)
+      : max_bytes_(max_bytes) {}
+
+  ValueCache(const ValueCache&) = delete;
+  ValueCache& operator=(const ValueCache&) = delete;
+
+  // Returns the value cached under `fingerprint`, marking it as the most
+  // recently used, or nullptr if there is none.
+  std::shared_ptr<const v0::Value> Lookup(absl::string_view fingerprint);
+
+  // Caches `value` under `fingerprint`, evicting the least recently used
+  // values as needed to stay within budget. Values which exceed the budget on
+  // their own are not cached.
+  void Insert(std::string fingerprint, std::shared_ptr<const v0::Value> value);
+
+  // The total serialized size of the cached values.
+  size_t bytes() const;
+
+ private:
+  struct Entry {
+    std::string fingerprint;
+    std::shared_ptr<const v0::Value> value;
+    size_t bytes;
+  };
+
+  void EvictLocked() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  const size_t max_bytes_;
+  mutable absl::Mutex mutex_;
+  // Ordered from the most to the least recently used.
+  std::list<Entry> entries_ ABSL_GUARDED_BY(mutex_);
+  absl::flat_hash_map<absl::string_view, std::list<Entry>::iterator> index_
+      ABSL_GUARDED_BY(mutex_);
+  size_t bytes_ ABSL_GUARDED_BY(mutex_) = 0;
+};
+
+}  // namespace tensorflow_federated
+
+#endif  // THIRD_PARTY_TENSORFLOW_FEDERATED_CC_CORE_IMPL_EXECUTORS_VALUE_CACHE_H_
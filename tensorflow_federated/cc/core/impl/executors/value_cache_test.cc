@@ -0,0 +1,86 @@
+/* Copyright 2022, The TensorFlow Federated Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+#include "tensorflow_federated/cc/core/impl/executors/value_cache.h"
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+#include "googlemock/include/gmock/gmock.h"
+#include "googletest/include/gtest/gtest.h"
+#include "tensorflow_federated/cc/core/impl/executors/protobuf_matchers.h"
+#include "tensorflow_federated/cc/core/impl/executors/value_test_utils.h"
+#include "tensorflow_federated/proto/v0/executor.pb.h"
+
+namespace tensorflow_federated {
+
+namespace {
+
+using ::tensorflow_federated::testing::EqualsProto;
+using ::tensorflow_federated::testing::StructV;
+using ::tensorflow_federated::testing::TensorV;
+
+std::shared_ptr<const v0::Value> SharedV(v0::Value value) {
+  return std::make_shared<const v0::Value>(std::move(value));
+}
+
+TEST(ValueFingerprintTest, EqualValuesHaveEqualFingerprints) {
+  EXPECT_EQ(ValueFingerprint(StructV({TensorV(1.0f), TensorV(2)})),
+            ValueFingerprint(StructV({TensorV(1.0f), TensorV(2)})));
+  EXPECT_NE(ValueFingerprint(StructV({TensorV(1.0f), TensorV(2)})),
+            ValueFingerprint(StructV({TensorV(2), TensorV(1.0f)})));
+  EXPECT_NE(ValueFingerprint(TensorV(1.0f)), ValueFingerprint(TensorV(2.0f)));
+}
+
+TEST(ValueCacheTest, LookupReturnsInsertedValue) {
+  ValueCache cache;
+  v0::Value value = TensorV(1.0f);
+  cache.Insert(ValueFingerprint(value), SharedV(value));
+  std::shared_ptr<const v0::Value> cached =
+      cache.Lookup(ValueFingerprint(value));
+  ASSERT_NE(cached, nullptr);
+  EXPECT_THAT(*cached, EqualsProto(value));
+  EXPECT_EQ(cache.Lookup(ValueFingerprint(TensorV(2.0f))), nullptr);
+}
+
+TEST(ValueCacheTest, EvictsLeastRecentlyUsedValues) {
+  v0::Value first = TensorV(1.0f);
+  v0::Value second = TensorV(2.0f);
+  v0::Value third = TensorV(3.0f);
+  // Room for exactly two of the (equally sized) values.
+  ValueCache cache(first.ByteSizeLong() * 2);
+  cache.Insert("first", SharedV(first));
+  cache.Insert("second", SharedV(second));
+  // Makes "second" the least recently used value.
+  EXPECT_NE(cache.Lookup("first"), nullptr);
+  cache.Insert("third", SharedV(third));
+  EXPECT_NE(cache.Lookup("first"), nullptr);
+  EXPECT_EQ(cache.Lookup("second"), nullptr);
+  EXPECT_NE(cache.Lookup("third"), nullptr);
+  EXPECT_EQ(cache.bytes(), first.ByteSizeLong() * 2);
+}
+
+TEST(ValueCacheTest, DoesNotCacheValuesLargerThanBudget) {
+  v0::Value value = StructV({TensorV(1.0f), TensorV(2.0f)});
+  ValueCache cache(value.ByteSizeLong() - 1);
+  cache.Insert("value", SharedV(value));
+  EXPECT_EQ(cache.Lookup("value"), nullptr);
+  EXPECT_EQ(cache.bytes(), 0);
+}
+
+}  // namespace
+
+}  // namespace tensorflow_federated
@@ -0,0 +1,359 @@
+/* Copyright 2022, The TensorFlow Federated Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+#include "tensorflow_federated/cc/core/impl/executors/value_streaming.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "google/protobuf/any.pb.h"
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/wire_format_lite.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "tensorflow/core/framework/tensor.pb.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow_federated/cc/core/impl/executors/status_macros.h"
+#include "tensorflow_federated/proto/v0/executor.pb.h"
+
+namespace tensorflow_federated {
+
+namespace tf = ::tensorflow;
+
+namespace {
+
+// Tensors whose content is smaller than this are sent inline in the header of
+// a value's stream rather than in `tensor_content` chunks.
+constexpr size_t kMinStreamedTensorBytes = 16 * 1024;
+
+using ::google::protobuf::internal::WireFormatLite;
+
+constexpr uint32_t kTensorContentTag = WireFormatLite::MakeTag(
+    tf::TensorProto::kTensorContentFieldNumber,
+    WireFormatLite::WIRETYPE_LENGTH_DELIMITED);
+
+void AppendVarint(uint64_t value, std::string* out) {
+  while (value >= 0x80) {
+    out->push_back(static_cast<char>(value | 0x80));
+    value >>= 7;
+  }
+  out->push_back(static_cast<char>(value));
+}
+
+// Splits a serialized `TensorProto` into a view of its `tensor_content` and
+// the serialization of its other fields, without parsing the content. Returns
+// false if the proto is malformed or does not hold exactly one
+// `tensor_content`.
+bool SplitTensorContent(absl::string_view serialized,
+                        absl::string_view* content, std::string* rest) {
+  google::protobuf::io::CodedInputStream input(
+      reinterpret_cast<const uint8_t*>(serialized.data()),
+      static_cast<int>(serialized.size()));
+  bool found = false;
+  size_t field_begin = 0;
+  size_t field_end = 0;
+  while (true) {
+    const size_t tag_begin = input.CurrentPosition();
+    const uint32_t tag = input.ReadTag();
+    if (tag == 0) {
+      break;
+    }
+    if (tag != kTensorContentTag) {
+      if (!WireFormatLite::SkipField(&input, tag)) {
+        return false;
+      }
+      continue;
+    }
+    uint32_t length;
+    if (found || !input.ReadVarint32(&length)) {
+      return false;
+    }
+    const size_t content_begin = input.CurrentPosition();
+    if (!input.Skip(static_cast<int>(length))) {
+      return false;
+    }
+    *content = serialized.substr(content_begin, length);
+    field_begin = tag_begin;
+    field_end = input.CurrentPosition();
+    found = true;
+  }
+  if (!found || !input.ConsumedEntireMessage()) {
+    return false;
+  }
+  rest->reserve(serialized.size() - (field_end - field_begin));
+  rest->append(serialized.data(), field_begin);
+  rest->append(serialized.data() + field_end, serialized.size() - field_end);
+  return true;
+}
+
+// Copies `value` into `header_value`, except for the content of the large
+// tensors, which is left in `value` to be streamed: views of it are added to
+// `contents`, and the indices of the tensors (see `TensorsOfValue`) to
+// `header`. `next_tensor` is the index of the first tensor of `value`.
+void CopyValueForHeader(const v0::Value& value, v0::Value* header_value,
+                        int32_t& next_tensor, v0::ValueChunk::Header& header,
+                        std::deque<absl::string_view>& contents) {
+  switch (value.value_case()) {
+    case v0::Value::kTensor: {
+      const int32_t index = next_tensor++;
+      const google::protobuf::Any& tensor_any = value.tensor();
+      // Only the content of large tensors serialized with `tensor_content` can
+      // be streamed; all other tensors stay in the header.
+      absl::string_view content;
+      std::string rest;
+      tf::TensorProto tensor_proto;
+      if (tensor_any.Is<tf::TensorProto>() &&
+          tensor_any.value().size() >= kMinStreamedTensorBytes &&
+          SplitTensorContent(tensor_any.value(), &content, &rest) &&
+          content.size() >= kMinStreamedTensorBytes &&
+          tensor_proto.ParseFromString(rest) &&
+          tf::DataTypeCanUseMemcpy(tensor_proto.dtype())) {
+        google::protobuf::Any* header_any = header_value->mutable_tensor();
+        header_any->set_type_url(tensor_any.type_url());
+        header_any->set_value(std::move(rest));
+        header.add_streamed_tensor(index);
+        contents.push_back(content);
+      } else {
+        *header_value->mutable_tensor() = tensor_any;
+      }
+      break;
+    }
+    case v0::Value::kStruct: {
+      v0::Value::Struct* header_struct = header_value->mutable_struct_();
+      for (const v0::Value::Struct::Element& element :
+           value.struct_().element()) {
+        v0::Value::Struct::Element* header_element =
+            header_struct->add_element();
+        header_element->set_name(element.name());
+        CopyValueForHeader(element.value(), header_element->mutable_value(),
+                           next_tensor, header, contents);
+      }
+      break;
+    }
+    case v0::Value::kFederated: {
+      v0::Value::Federated* header_federated =
+          header_value->mutable_federated();
+      *header_federated->mutable_type() = value.federated().type();
+      for (const v0::Value& member : value.federated().value()) {
+        CopyValueForHeader(member, header_federated->add_value(), next_tensor,
+                           header, contents);
+      }
+      break;
+    }
+    default:
+      *header_value = value;
+      break;
+  }
+}
+
+void AppendTensorsOfValue(v0::Value* value,
+                          std::vector<google::protobuf::Any*>& tensors) {
+  switch (value->value_case()) {
+    case v0::Value::kTensor: {
+      tensors.push_back(value->mutable_tensor());
+      break;
+    }
+    case v0::Value::kStruct: {
+      for (v0::Value::Struct::Element& element :
+           *value->mutable_struct_()->mutable_element()) {
+        AppendTensorsOfValue(element.mutable_value(), tensors);
+      }
+      break;
+    }
+    case v0::Value::kFederated: {
+      for (v0::Value& member : *value->mutable_federated()->mutable_value()) {
+        AppendTensorsOfValue(&member, tensors);
+      }
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+}  // namespace
+
+std::vector<google::protobuf::Any*> TensorsOfValue(v0::Value* value) {
+  std::vector<google::protobuf::Any*> tensors;
+  AppendTensorsOfValue(value, tensors);
+  return tensors;
+}
+
+ValueChunkWriter::ValueChunkWriter(const v0::Value& value,
+                                   size_t max_chunk_bytes)
+    : max_chunk_bytes_(std::max<size_t>(1, max_chunk_bytes)) {
+  v0::ValueChunk::Header header;
+  int32_t next_tensor = 0;
+  CopyValueForHeader(value, header.mutable_value(), next_tensor, header,
+                     contents_);
+  header_ = std::move(header);
+}
+
+bool ValueChunkWriter::Next(v0::ValueChunk* chunk) {
+  if (header_.has_value()) {
+    *chunk->mutable_header() = std::move(*header_);
+    header_.reset();
+    return true;
+  }
+  if (contents_.empty()) {
+    return false;
+  }
+  std::string* chunk_content = chunk->mutable_tensor_content();
+  chunk_content->clear();
+  while (!contents_.empty() && chunk_content->size() < max_chunk_bytes_) {
+    absl::string_view front = contents_.front();
+    size_t length = std::min(max_chunk_bytes_ - chunk_content->size(),
+                             front.size() - front_offset_);
+    chunk_content->append(front.data() + front_offset_, length);
+    front_offset_ += length;
+    if (front_offset_ == front.size()) {
+      contents_.pop_front();
+      front_offset_ = 0;
+    }
+  }
+  return true;
+}
+
+absl::Status ValueChunkReader::Add(v0::ValueChunk chunk) {
+  switch (chunk.chunk_case()) {
+    case v0::ValueChunk::kHeader: {
+      return ReadHeader(std::move(*chunk.mutable_header()));
+    }
+    case v0::ValueChunk::kTensorContent: {
+      return ReadTensorContent(chunk.tensor_content());
+    }
+    case v0::ValueChunk::CHUNK_NOT_SET: {
+      break;
+    }
+  }
+  return absl::InvalidArgumentError("Received a ValueChunk with no content.");
+}
+
+absl::Status ValueChunkReader::ReadHeader(v0::ValueChunk::Header header) {
+  if (value_.has_value()) {
+    return absl::InvalidArgumentError(
+        "Received a second header in a stream of ValueChunks.");
+  }
+  value_ = std::move(*header.mutable_value());
+  std::vector<google::protobuf::Any*> tensors = TensorsOfValue(&*value_);
+  int32_t previous_index = -1;
+  for (int32_t index : header.streamed_tensor()) {
+    if (index <= previous_index ||
+        index >= static_cast<int32_t>(tensors.size())) {
+      return absl::InvalidArgumentError(absl::StrCat(
+          "Invalid streamed tensor index ", index, " for a value with ",
+          tensors.size(), " tensors."));
+    }
+    streamed_tensors_.push_back(tensors[index]);
+    previous_index = index;
+  }
+  return StartNextTensor();
+}
+
+absl::Status ValueChunkReader::ReadTensorContent(const std::string& content) {
+  size_t offset = 0;
+  while (offset < content.size()) {
+    if (current_any_ == nullptr) {
+      return absl::InvalidArgumentError(
+          value_.has_value()
+              ? "Received more tensor content than the streamed tensors hold."
+              : "Received tensor content before the header of the value.");
+    }
+    size_t length =
+        std::min(content.size() - offset, current_size_ - current_offset_);
+    current_any_->mutable_value()->append(content.data() + offset, length);
+    offset += length;
+    current_offset_ += length;
+    if (current_offset_ == current_size_) {
+      current_any_ = nullptr;
+      TFF_TRY(StartNextTensor());
+    }
+  }
+  return absl::OkStatus();
+}
+
+absl::Status ValueChunkReader::StartNextTensor() {
+  while (next_tensor_ < streamed_tensors_.size()) {
+    google::protobuf::Any* tensor_any = streamed_tensors_[next_tensor_++];
+    tf::TensorProto tensor_proto;
+    if (!tensor_any->UnpackTo(&tensor_proto)) {
+      return absl::InvalidArgumentError(
+          "Streamed tensor is not a serialized tensorflow.TensorProto.");
+    }
+    if (!tf::DataTypeCanUseMemcpy(tensor_proto.dtype()) ||
+        !tensor_proto.tensor_content().empty() ||
+        !tf::TensorShape::IsValid(tensor_proto.tensor_shape())) {
+      return absl::InvalidArgumentError(absl::StrCat(
+          "Streamed tensor has invalid dtype, shape or content: ",
+          tensor_proto.ShortDebugString()));
+    }
+    const uint64_t size =
+        static_cast<uint64_t>(
+            tf::TensorShape(tensor_proto.tensor_shape()).num_elements()) *
+        tf::DataTypeSize(tensor_proto.dtype());
+    if (size == 0) {
+      continue;
+    }
+    // The serialized tensor is completed in place: its `tensor_content` field
+    // is appended to the serialization of its other fields, and the content
+    // is copied into it straight from the chunks as they arrive.
+    std::string* serialized = tensor_any->mutable_value();
+    const uint64_t serialized_size =
+        serialized->size() + WireFormatLite::UInt32Size(kTensorContentTag) +
+        WireFormatLite::UInt64Size(size) + size;
+    if (serialized_size > std::numeric_limits<int32_t>::max()) {
+      return absl::InvalidArgumentError(absl::StrCat(
+          "Streamed tensor of ", size,
+          " bytes exceeds the 2 GiB limit of a serialized TensorProto."));
+    }
+    serialized->reserve(serialized_size);
+    AppendVarint(kTensorContentTag, serialized);
+    AppendVarint(size, serialized);
+    current_any_ = tensor_any;
+    current_size_ = size;
+    current_offset_ = 0;
+    return absl::OkStatus();
+  }
+  return absl::OkStatus();
+}
+
+size_t ValueChunkReader::SpaceUsed() const {
+  return value_.has_value() ? value_->SpaceUsedLong() : 0;
+}
+
+absl::StatusOr<v0::Value> ValueChunkReader::Finish() {
+  if (!value_.has_value()) {
+    return absl::InvalidArgumentError(
+        "Stream of ValueChunks ended before the header of the value.");
+  }
+  if (current_any_ != nullptr || next_tensor_ < streamed_tensors_.size()) {
+    return absl::InvalidArgumentError(
+        "Stream of ValueChunks ended before all tensor content was received.");
+  }
+  v0::Value value = std::move(*value_);
+  value_.reset();
+  return value;
+}
+
+}  // namespace tensorflow_federated
@@ -0,0 +1,117 @@
+/* Copyright 2022, The TensorFlow Federated Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+#ifndef THIRD_PARTY_TENSORFLOW_FEDERATED_CC_CORE_IMPL_EXECUTORS_VALUE_STREAMING_H_
+#define THIRD_PARTY_TENSORFLOW_FEDERATED_CC_CORE_IMPL_EXECUTORS_VALUE_STREAMING_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "google/protobuf/any.pb.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "tensorflow_federated/proto/v0/executor.pb.h"
+
+namespace tensorflow_federated {
+
+// The default maximum number of bytes of tensor content in a `ValueChunk`.
+constexpr size_t kDefaultValueChunkBytes = 1024 * 1024;
+
+// Splits a `v0::Value` into the `v0::ValueChunk`s of a stream (see
+// `ValueChunk` in executor.proto).
+//
+// The content of each large tensor is not copied when the writer is created,
+// but read from `value` as chunks are returned, so `value` must outlive the
+// writer. Besides the chunk being returned, the writer only holds the header:
+// a copy of the value without that content.
+class ValueChunkWriter {
+ public:
+  explicit ValueChunkWriter(const v0::Value& value,
+                            size_t max_chunk_bytes = kDefaultValueChunkBytes);
+  ValueChunkWriter(v0::Value&& value,
+                   size_t max_chunk_bytes = kDefaultValueChunkBytes) = delete;
+
+  ValueChunkWriter(const ValueChunkWriter&) = delete;
+  ValueChunkWriter& operator=(const ValueChunkWriter&) = delete;
+
+  // Sets `chunk` to the next chunk of the value. Returns false once all
+  // chunks have been returned.
+  bool Next(v0::ValueChunk* chunk);
+
+ private:
+  const size_t max_chunk_bytes_;
+  absl::optional<v0::ValueChunk::Header> header_;
+  // Views of the content of the streamed tensors not yet returned, and the
+  // number of bytes of the first of them which have been.
+  std::deque<absl::string_view> contents_;
+  size_t front_offset_ = 0;
+};
+
+// Reassembles a `v0::Value` from the `v0::ValueChunk`s of a stream.
+//
+// The content of each streamed tensor is copied once, directly from the chunks
+// into the serialized `TensorProto` in the value, which is allocated at its
+// final size from the tensor's `dtype` and `tensor_shape` when the tensor is
+// started. The reader thus holds at most the value itself; with the chunk
+// being added, peak memory is the size of the value plus one chunk. Each
+// streamed tensor must still fit the 2 GiB limit of a serialized protobuf.
+class ValueChunkReader {
+ public:
+  ValueChunkReader() = default;
+
+  ValueChunkReader(const ValueChunkReader&) = delete;
+  ValueChunkReader& operator=(const ValueChunkReader&) = delete;
+
+  // Adds the next chunk of the stream.
+  absl::Status Add(v0::ValueChunk chunk);
+
+  // Returns the value, once all of its chunks have been added.
+  absl::StatusOr<v0::Value> Finish();
+
+  // Returns the memory held by the value being reassembled, including the
+  // space reserved for the content of the tensor being received.
+  size_t SpaceUsed() const;
+
+ private:
+  absl::Status ReadHeader(v0::ValueChunk::Header header);
+  absl::Status ReadTensorContent(const std::string& content);
+
+  // Allocates the next streamed tensor with non-empty content, if any.
+  absl::Status StartNextTensor();
+
+  absl::optional<v0::Value> value_;
+  // The `Any`s (owned by `value_`) of the streamed tensors, and the index of
+  // the next one to be started.
+  std::vector<google::protobuf::Any*> streamed_tensors_;
+  size_t next_tensor_ = 0;
+  // The tensor whose content is being received, if any, with the size of its
+  // content and the number of bytes of it received so far.
+  google::protobuf::Any* current_any_ = nullptr;
+  size_t current_size_ = 0;
+  size_t current_offset_ = 0;
+};
+
+// Returns the `google::protobuf::Any`s holding the tensors of `value`, visited
+// depth-first in order of struct elements and federated members.
+std::vector<google::protobuf::Any*> TensorsOfValue(v0::Value* value);
+
+}  // namespace tensorflow_federated
+
+#endif  // THIRD_PARTY_TENSORFLOW_FEDERATED_CC_CORE_IMPL_EXECUTORS_VALUE_STREAMING_H_
@@ -0,0 +1,153 @@
+/* Copyright 2022, The TensorFlow Federated Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+#include "tensorflow_federated/cc/core/impl/executors/value_streaming.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "googlemock/include/gmock/gmock.h"
+#include "googletest/include/gtest/gtest.h"
+#include "absl/status/status.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow_federated/cc/core/impl/executors/protobuf_matchers.h"
+#include "tensorflow_federated/cc/core/impl/executors/status_matchers.h"
+#include "tensorflow_federated/cc/core/impl/executors/value_test_utils.h"
+#include "tensorflow_federated/proto/v0/executor.pb.h"
+
+namespace tensorflow_federated {
+
+namespace {
+
+using ::absl::StatusCode;
+using ::tensorflow_federated::testing::ClientsV;
+using ::tensorflow_federated::testing::EqualsProto;
+using ::tensorflow_federated::testing::StructV;
+using ::tensorflow_federated::testing::TensorV;
+
+// Returns a float tensor of `num_elements` distinct elements.
+v0::Value LargeTensorV(int64_t num_elements) {
+  tensorflow::Tensor tensor(tensorflow::DT_FLOAT,
+                            tensorflow::TensorShape({num_elements}));
+  auto flat = tensor.flat<float>();
+  for (int64_t i = 0; i < num_elements; i++) {
+    flat(i) = static_cast<float>(i);
+  }
+  return TensorV(tensor);
+}
+
+std::vector<v0::ValueChunk> WriteChunks(const v0::Value& value,
+                                        size_t max_chunk_bytes) {
+  ValueChunkWriter writer(value, max_chunk_bytes);
+  std::vector<v0::ValueChunk> chunks;
+  v0::ValueChunk chunk;
+  while (writer.Next(&chunk)) {
+    chunks.push_back(chunk);
+  }
+  return chunks;
+}
+
+TEST(ValueStreamingTest, SmallValueIsSentInHeader) {
+  v0::Value value = StructV({TensorV(1.0f), TensorV(2)});
+  std::vector<v0::ValueChunk> chunks = WriteChunks(value, 1024);
+  ASSERT_EQ(chunks.size(), 1);
+  EXPECT_THAT(chunks[0].header().value(), EqualsProto(value));
+  EXPECT_EQ(chunks[0].header().streamed_tensor_size(), 0);
+
+  ValueChunkReader reader;
+  TFF_ASSERT_OK(reader.Add(chunks[0]));
+  EXPECT_THAT(reader.Finish(), IsOkAndHolds(EqualsProto(value)));
+}
+
+TEST(ValueStreamingTest, LargeTensorsAreStreamedInBoundedChunks) {
+  constexpr size_t kMaxChunkBytes = 10000;
+  v0::Value value =
+      StructV({LargeTensorV(10000), TensorV(3),
+               ClientsV({LargeTensorV(5000), LargeTensorV(20000)})});
+  std::vector<v0::ValueChunk> chunks = WriteChunks(value, kMaxChunkBytes);
+  ASSERT_GT(chunks.size(), 1);
+  EXPECT_THAT(chunks[0].header().streamed_tensor(),
+              ::testing::ElementsAre(0, 2, 3));
+  size_t content_bytes = 0;
+  for (size_t i = 1; i < chunks.size(); i++) {
+    ASSERT_TRUE(chunks[i].has_tensor_content());
+    EXPECT_LE(chunks[i].tensor_content().size(), kMaxChunkBytes);
+    content_bytes += chunks[i].tensor_content().size();
+  }
+  EXPECT_EQ(content_bytes, (10000 + 5000 + 20000) * sizeof(float));
+
+  ValueChunkReader reader;
+  for (const v0::ValueChunk& chunk : chunks) {
+    TFF_ASSERT_OK(reader.Add(chunk));
+  }
+  EXPECT_THAT(reader.Finish(), IsOkAndHolds(EqualsProto(value)));
+}
+
+TEST(ValueStreamingTest, WriterDoesNotModifyValue) {
+  const v0::Value value = StructV({LargeTensorV(10000), TensorV(3)});
+  const v0::Value original = value;
+  std::vector<v0::ValueChunk> chunks = WriteChunks(value, 1000);
+  ASSERT_GT(chunks.size(), 1);
+  EXPECT_THAT(value, EqualsProto(original));
+}
+
+TEST(ValueStreamingTest, ReaderHoldsAtMostTheReassembledValue) {
+  // The content of each tensor is copied once, into space reserved at the
+  // tensor's final size, so the reader never holds more than the complete
+  // value (with some slack for the allocator), however many chunks it has
+  // been sent.
+  constexpr size_t kSlackBytes = 1024;
+  v0::Value value = StructV({LargeTensorV(100000), LargeTensorV(50000)});
+  const size_t value_bytes = value.SpaceUsedLong();
+  ValueChunkReader reader;
+  for (const v0::ValueChunk& chunk : WriteChunks(value, 1000)) {
+    TFF_ASSERT_OK(reader.Add(chunk));
+    EXPECT_LE(reader.SpaceUsed(), value_bytes + kSlackBytes);
+  }
+  EXPECT_GE(reader.SpaceUsed(), (100000 + 50000) * sizeof(float));
+  EXPECT_THAT(reader.Finish(), IsOkAndHolds(EqualsProto(value)));
+}
+
+TEST(ValueStreamingTest, TruncatedStreamFails) {
+  std::vector<v0::ValueChunk> chunks = WriteChunks(LargeTensorV(10000), 1000);
+  chunks.pop_back();
+  ValueChunkReader reader;
+  for (const v0::ValueChunk& chunk : chunks) {
+    TFF_ASSERT_OK(reader.Add(chunk));
+  }
+  EXPECT_THAT(reader.Finish(), StatusIs(StatusCode::kInvalidArgument));
+}
+
+TEST(ValueStreamingTest, ExcessTensorContentFails) {
+  std::vector<v0::ValueChunk> chunks = WriteChunks(LargeTensorV(10000), 1000);
+  ValueChunkReader reader;
+  for (const v0::ValueChunk& chunk : chunks) {
+    TFF_ASSERT_OK(reader.Add(chunk));
+  }
+  EXPECT_THAT(reader.Add(chunks.back()),
+              StatusIs(StatusCode::kInvalidArgument));
+}
+
+TEST(ValueStreamingTest, TensorContentBeforeHeaderFails) {
+  std::vector<v0::ValueChunk> chunks = WriteChunks(LargeTensorV(10000), 1000);
+  ValueChunkReader reader;
+  EXPECT_THAT(reader.Add(chunks[1]), StatusIs(StatusCode::kInvalidArgument));
+}
+
+}  // namespace
+
+}  // namespace tensorflow_federated
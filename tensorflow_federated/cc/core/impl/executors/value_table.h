@@ -0,0 +1,214 @@
+/* Copyright 2022, The TensorFlow Federated Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+#ifndef THIRD_PARTY_TENSORFLOW_FEDERATED_CC_CORE_IMPL_EXECUTORS_VALUE_TABLE_H_
+#define THIRD_PARTY_TENSORFLOW_FEDERATED_CC_CORE_IMPL_EXECUTORS_VALUE_TABLE_H_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "absl/base/optimization.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+
+namespace tensorflow_federated {
+
+// A thread-safe map from sequentially-allocated `uint64_t` IDs to values,
+// used by `ExecutorBase` to track the values it has handed out.
+//
+// IDs are allocated with a single atomic increment, and values are spread
+// across `kNumShards` independently-locked shards by ID. Since consecutive IDs
+// land on different shards, concurrent callers creating, reading and disposing
+// of values rarely contend on the same lock.
+//
+// `Value` must be copy-constructible: `Get` returns a copy so that no lock is
+// held while the caller uses the value.
+template <class Value>
+class ValueTable {
+ public:
+  using Id = uint64_t;
+  static constexpr size_t kNumShards = 16;
+
+  ValueTable() = default;
+  ValueTable(const ValueTable&) = delete;
+  ValueTable& operator=(const ValueTable&) = delete;
+
+  // Stores `value` under a newly-allocated ID and returns that ID.
+  Id Insert(Value value) {
+    Id id = next_id_.fetch_add(1, std::memory_order_relaxed);
+    Shard& shard = ShardFor(id);
+    absl::WriterMutexLock lock(&shard.mutex);
+    shard.values.emplace(id, std::move(value));
+    return id;
+  }
+
+  // Stores each of `values` under a newly-allocated ID and returns the IDs, in
+  // the same order as `values`. Each shard is locked at most once.
+  std::vector<Id> InsertMany(std::vector<Value> values) {
+    Id first_id = next_id_.fetch_add(values.size(), std::memory_order_relaxed);
+    std::vector<Id> ids;
+    ids.reserve(values.size());
+    for (size_t i = 0; i < values.size(); i++) {
+      ids.push_back(first_id + i);
+    }
+    ForEachShard(ids, [&](size_t shard_index,
+                          absl::Span<const size_t> positions) {
+      Shard& shard = shards_[shard_index];
+      absl::WriterMutexLock lock(&shard.mutex);
+      for (size_t position : positions) {
+        shard.values.emplace(ids[position], std::move(values[position]));
+      }
+    });
+    return ids;
+  }
+
+  // Returns a copy of the value stored under `id`, or `absl::nullopt` if there
+  // is no such value.
+  absl::optional<Value> Get(Id id) const {
+    const Shard& shard = ShardFor(id);
+    absl::ReaderMutexLock lock(&shard.mutex);
+    auto iter = shard.values.find(id);
+    if (iter == shard.values.end()) {
+      return absl::nullopt;
+    }
+    return iter->second;
+  }
+
+  // Batched version of `Get`. Each shard is locked at most once.
+  std::vector<absl::optional<Value>> GetMany(absl::Span<const Id> ids) const {
+    std::vector<absl::optional<Value>> results(ids.size());
+    ForEachShard(ids, [&](size_t shard_index,
+                          absl::Span<const size_t> positions) {
+      const Shard& shard = shards_[shard_index];
+      absl::ReaderMutexLock lock(&shard.mutex);
+      for (size_t position : positions) {
+        auto iter = shard.values.find(ids[position]);
+        if (iter != shard.values.end()) {
+          results[position] = iter->second;
+        }
+      }
+    });
+    return results;
+  }
+
+  // Removes the value stored under `id` and returns it, or returns
+  // `absl::nullopt` if there is no such value. The value is returned rather
+  // than destroyed so that callers may destroy it after any locks of their own
+  // have been released.
+  absl::optional<Value> Remove(Id id) {
+    Shard& shard = ShardFor(id);
+    absl::optional<Value> removed;
+    absl::WriterMutexLock lock(&shard.mutex);
+    auto iter = shard.values.find(id);
+    if (iter != shard.values.end()) {
+      removed.emplace(std::move(iter->second));
+      shard.values.erase(iter);
+    }
+    return removed;
+  }
+
+  // Batched version of `Remove`. Each shard is locked at most once.
+  std::vector<absl::optional<Value>> RemoveMany(absl::Span<const Id> ids) {
+    std::vector<absl::optional<Value>> removed(ids.size());
+    ForEachShard(ids, [&](size_t shard_index,
+                          absl::Span<const size_t> positions) {
+      Shard& shard = shards_[shard_index];
+      absl::WriterMutexLock lock(&shard.mutex);
+      for (size_t position : positions) {
+        auto iter = shard.values.find(ids[position]);
+        if (iter != shard.values.end()) {
+          removed[position].emplace(std::move(iter->second));
+          shard.values.erase(iter);
+        }
+      }
+    });
+    return removed;
+  }
+
+  // Removes all values. Values are destroyed outside of the shard locks.
+  void Clear() {
+    for (Shard& shard : shards_) {
+      absl::flat_hash_map<Id, Value> values;
+      {
+        absl::WriterMutexLock lock(&shard.mutex);
+        values.swap(shard.values);
+      }
+    }
+  }
+
+  // Returns the number of values currently stored. Only a snapshot when the
+  // table is being concurrently modified.
+  size_t size() const {
+    size_t total = 0;
+    for (const Shard& shard : shards_) {
+      absl::ReaderMutexLock lock(&shard.mutex);
+      total += shard.values.size();
+    }
+    return total;
+  }
+
+ private:
+  // Aligned to a cache line so that locking one shard does not invalidate the
+  // cache line holding its neighbours' locks.
+  struct ABSL_CACHELINE_ALIGNED Shard {
+    mutable absl::Mutex mutex;
+    absl::flat_hash_map<Id, Value> values ABSL_GUARDED_BY(mutex);
+  };
+
+  Shard& ShardFor(Id id) { return shards_[id % kNumShards]; }
+  const Shard& ShardFor(Id id) const { return shards_[id % kNumShards]; }
+
+  // Calls `fn(shard_index, positions)` once for each shard owning any of
+  // `ids`, where `positions` are the indices into `ids` of the IDs owned by
+  // `shards_[shard_index]`.
+  template <class Fn>
+  static void ForEachShard(absl::Span<const Id> ids, Fn fn) {
+    // Counting sort of the positions in `ids` by shard.
+    std::array<size_t, kNumShards + 1> offsets = {};
+    for (Id id : ids) {
+      offsets[id % kNumShards + 1]++;
+    }
+    for (size_t shard = 0; shard < kNumShards; shard++) {
+      offsets[shard + 1] += offsets[shard];
+    }
+    std::vector<size_t> positions(ids.size());
+    std::array<size_t, kNumShards> filled = {};
+    for (size_t position = 0; position < ids.size(); position++) {
+      size_t shard = ids[position] % kNumShards;
+      positions[offsets[shard] + filled[shard]++] = position;
+    }
+    for (size_t shard = 0; shard < kNumShards; shard++) {
+      if (offsets[shard] != offsets[shard + 1]) {
+        fn(shard, absl::MakeConstSpan(positions)
+                      .subspan(offsets[shard],
+                               offsets[shard + 1] - offsets[shard]));
+      }
+    }
+  }
+
+  std::atomic<Id> next_id_{0};
+  std::array<Shard, kNumShards> shards_;
+};
+
+}  // namespace tensorflow_federated
+
+#endif  // THIRD_PARTY_TENSORFLOW_FEDERATED_CC_CORE_IMPL_EXECUTORS_VALUE_TABLE_H_
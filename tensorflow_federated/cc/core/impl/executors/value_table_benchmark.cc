@@ -0,0 +1,107 @@
+/* Copyright 2022, The TensorFlow Federated Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+// Measures contention on the table of tracked values shared by all callers of
+// an `ExecutorBase`. Each benchmark thread repeatedly performs the sequence of
+// table operations made by a `CreateValue`, a `CreateCall` (two lookups and an
+// insertion) and two `Dispose`s.
+//
+// `BM_SingleMutex*` measures a single `absl::Mutex`-guarded map, as
+// `ExecutorBase` used previously, for comparison.
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#include "benchmark/benchmark.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/optional.h"
+#include "tensorflow_federated/cc/core/impl/executors/value_table.h"
+
+namespace tensorflow_federated {
+
+namespace {
+
+using Value = std::shared_ptr<int64_t>;
+
+class SingleMutexTable {
+ public:
+  uint64_t Insert(Value value) {
+    absl::WriterMutexLock lock(&mutex_);
+    uint64_t id = next_id_++;
+    values_.emplace(id, std::move(value));
+    return id;
+  }
+
+  absl::optional<Value> Get(uint64_t id) {
+    absl::ReaderMutexLock lock(&mutex_);
+    auto iter = values_.find(id);
+    if (iter == values_.end()) {
+      return absl::nullopt;
+    }
+    return iter->second;
+  }
+
+  absl::optional<Value> Remove(uint64_t id) {
+    absl::WriterMutexLock lock(&mutex_);
+    auto iter = values_.find(id);
+    if (iter == values_.end()) {
+      return absl::nullopt;
+    }
+    Value removed = std::move(iter->second);
+    values_.erase(iter);
+    return removed;
+  }
+
+ private:
+  absl::Mutex mutex_;
+  uint64_t next_id_ ABSL_GUARDED_BY(mutex_) = 0;
+  absl::flat_hash_map<uint64_t, Value> values_ ABSL_GUARDED_BY(mutex_);
+};
+
+template <class Table>
+void RunExecutorLikeOps(benchmark::State& state, Table& table) {
+  auto value = std::make_shared<int64_t>(state.thread_index());
+  // A long-lived value, such as a function, looked up by every call.
+  uint64_t function = table.Insert(value);
+  for (auto _ : state) {
+    uint64_t argument = table.Insert(value);
+    benchmark::DoNotOptimize(table.Get(function));
+    benchmark::DoNotOptimize(table.Get(argument));
+    uint64_t result = table.Insert(value);
+    benchmark::DoNotOptimize(table.Remove(argument));
+    benchmark::DoNotOptimize(table.Remove(result));
+  }
+  table.Remove(function);
+  state.SetItemsProcessed(state.iterations());
+}
+
+void BM_ValueTable(benchmark::State& state) {
+  static ValueTable<Value>* table = new ValueTable<Value>();
+  RunExecutorLikeOps(state, *table);
+}
+BENCHMARK(BM_ValueTable)->ThreadRange(1, 64)->UseRealTime();
+
+void BM_SingleMutex(benchmark::State& state) {
+  static SingleMutexTable* table = new SingleMutexTable();
+  RunExecutorLikeOps(state, *table);
+}
+BENCHMARK(BM_SingleMutex)->ThreadRange(1, 64)->UseRealTime();
+
+}  // namespace
+
+}  // namespace tensorflow_federated
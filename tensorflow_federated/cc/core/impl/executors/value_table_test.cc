@@ -0,0 +1,135 @@
+/* Copyright 2022, The TensorFlow Federated Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+#include "tensorflow_federated/cc/core/impl/executors/value_table.h"
+
+#include <cstdint>
+#include <memory>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "googlemock/include/gmock/gmock.h"
+#include "googletest/include/gtest/gtest.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/optional.h"
+
+namespace tensorflow_federated {
+
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::Optional;
+
+class ValueTableTest : public ::testing::Test {};
+
+TEST_F(ValueTableTest, GetReturnsInsertedValue) {
+  ValueTable<int32_t> table;
+  ValueTable<int32_t>::Id first = table.Insert(1);
+  ValueTable<int32_t>::Id second = table.Insert(2);
+  EXPECT_NE(first, second);
+  EXPECT_THAT(table.Get(first), Optional(1));
+  EXPECT_THAT(table.Get(second), Optional(2));
+  EXPECT_EQ(table.size(), 2);
+}
+
+TEST_F(ValueTableTest, GetMissingReturnsNullopt) {
+  ValueTable<int32_t> table;
+  EXPECT_EQ(table.Get(0), absl::nullopt);
+  table.Insert(1);
+  EXPECT_EQ(table.Get(12345), absl::nullopt);
+}
+
+TEST_F(ValueTableTest, RemoveReturnsValueAndForgetsIt) {
+  ValueTable<int32_t> table;
+  ValueTable<int32_t>::Id id = table.Insert(5);
+  EXPECT_THAT(table.Remove(id), Optional(5));
+  EXPECT_EQ(table.Get(id), absl::nullopt);
+  EXPECT_EQ(table.Remove(id), absl::nullopt);
+  EXPECT_EQ(table.size(), 0);
+}
+
+TEST_F(ValueTableTest, InsertManyAllocatesIdsInOrder) {
+  ValueTable<int32_t> table;
+  std::vector<int32_t> values;
+  for (int32_t i = 0; i < 100; i++) {
+    values.push_back(i);
+  }
+  std::vector<ValueTable<int32_t>::Id> ids = table.InsertMany(values);
+  ASSERT_EQ(ids.size(), values.size());
+  for (size_t i = 0; i < ids.size(); i++) {
+    EXPECT_THAT(table.Get(ids[i]), Optional(values[i]));
+  }
+}
+
+TEST_F(ValueTableTest, GetManyAndRemoveManyPreserveOrder) {
+  ValueTable<int32_t> table;
+  std::vector<ValueTable<int32_t>::Id> ids = table.InsertMany({0, 1, 2, 3});
+  std::vector<ValueTable<int32_t>::Id> query = {ids[3], 12345, ids[0], ids[2]};
+  EXPECT_THAT(table.GetMany(query),
+              ElementsAre(Optional(3), absl::nullopt, Optional(0),
+                          Optional(2)));
+  EXPECT_THAT(table.RemoveMany(query),
+              ElementsAre(Optional(3), absl::nullopt, Optional(0),
+                          Optional(2)));
+  EXPECT_EQ(table.size(), 1);
+  EXPECT_THAT(table.Get(ids[1]), Optional(1));
+}
+
+TEST_F(ValueTableTest, ClearDestroysAllValues) {
+  ValueTable<std::shared_ptr<int32_t>> table;
+  auto value = std::make_shared<int32_t>(1);
+  for (int32_t i = 0; i < 100; i++) {
+    table.Insert(value);
+  }
+  EXPECT_EQ(value.use_count(), 101);
+  table.Clear();
+  EXPECT_EQ(value.use_count(), 1);
+  EXPECT_EQ(table.size(), 0);
+}
+
+TEST_F(ValueTableTest, ConcurrentInsertsAllocateUniqueIds) {
+  constexpr int32_t kNumThreads = 8;
+  constexpr int32_t kInsertsPerThread = 1000;
+  ValueTable<int32_t> table;
+  absl::Mutex mutex;
+  absl::flat_hash_set<ValueTable<int32_t>::Id> ids;
+  std::vector<std::thread> threads;
+  for (int32_t t = 0; t < kNumThreads; t++) {
+    threads.emplace_back([&table, &mutex, &ids, t]() {
+      std::vector<ValueTable<int32_t>::Id> local_ids;
+      for (int32_t i = 0; i < kInsertsPerThread; i++) {
+        ValueTable<int32_t>::Id id = table.Insert(t);
+        EXPECT_THAT(table.Get(id), Optional(t));
+        local_ids.push_back(id);
+      }
+      // Dispose of half of the values concurrently with other insertions.
+      for (size_t i = 0; i < local_ids.size(); i += 2) {
+        EXPECT_THAT(table.Remove(local_ids[i]), Optional(t));
+      }
+      absl::MutexLock lock(&mutex);
+      ids.insert(local_ids.begin(), local_ids.end());
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(ids.size(), kNumThreads * kInsertsPerThread);
+  EXPECT_EQ(table.size(), kNumThreads * kInsertsPerThread / 2);
+}
+
+}  // namespace
+
+}  // namespace tensorflow_federated
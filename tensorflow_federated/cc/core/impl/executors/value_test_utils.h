@@ -256,11 +256,14 @@ INTRINSIC_FUNC(FederatedAggregateV, federated_aggregate);
 INTRINSIC_FUNC(FederatedBroadcastV, federated_broadcast);
 INTRINSIC_FUNC(FederatedMapV, federated_map);
 INTRINSIC_FUNC(FederatedMapAllEqualV, federated_map_all_equal);
+INTRINSIC_FUNC(FederatedMeanV, federated_mean);
 INTRINSIC_FUNC(FederatedEvalAtClientsV, federated_eval_at_clients);
 INTRINSIC_FUNC(FederatedEvalAtServerV, federated_eval_at_server);
 INTRINSIC_FUNC(FederatedSelectV, federated_select);
+INTRINSIC_FUNC(FederatedSumV, federated_sum);
 INTRINSIC_FUNC(FederatedValueAtClientsV, federated_value_at_clients);
 INTRINSIC_FUNC(FederatedValueAtServerV, federated_value_at_server);
+INTRINSIC_FUNC(FederatedWeightedMeanV, federated_weighted_mean);
 INTRINSIC_FUNC(FederatedZipAtClientsV, federated_zip_at_clients);
 INTRINSIC_FUNC(FederatedZipAtServerV, federated_zip_at_server);
 
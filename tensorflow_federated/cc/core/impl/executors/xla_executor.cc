@@ -15,7 +15,6 @@ limitations under the License
 
 #include "tensorflow_federated/cc/core/impl/executors/xla_executor.h"
 
-#include <future>  // NOLINT
 #include <memory>
 #include <string>
 #include <utility>
@@ -393,7 +392,7 @@ XLAExecutorValue TFFTypeAndGlobalDataToValue(
   return XLAExecutorValue(std::move(data), tensor_dtype);
 }
 
-using ValueFuture = std::shared_future<absl::StatusOr<XLAExecutorValue>>;
+using ValueFuture = SharedFuture<absl::StatusOr<XLAExecutorValue>>;
 
 class XLAExecutor : public ExecutorBase<ValueFuture> {
  public:
@@ -412,23 +411,24 @@ class XLAExecutor : public ExecutorBase<ValueFuture> {
 
   absl::StatusOr<ValueFuture> CreateCall(
       ValueFuture fn, absl::optional<ValueFuture> arg) final {
-    return ThreadRun([fn, arg, this_shared = shared_from_this()]()
-                         -> absl::StatusOr<XLAExecutorValue> {
-      // shared_from_this() returns the base Executor* type, so we must
-      // cast to our derived type here.
-      XLAExecutor* this_executor = static_cast<XLAExecutor*>(this_shared.get());
-      XLAExecutorValue fn_value = TFF_TRY(Wait(fn));
-      if (fn_value.type() != XLAExecutorValue::ValueType::COMPUTATION) {
-        return absl::InvalidArgumentError(
-            "Attempted to call a non-functional value inside the XLA "
-            "Executor.");
-      }
-      std::shared_ptr<Computation> comp = fn_value.computation();
-      if (arg.has_value()) {
-        return this_executor->CallComputation(comp, TFF_TRY(Wait(arg.value())));
-      }
-      return this_executor->CallComputation(comp, absl::nullopt);
-    });
+    return MapCallAsync(
+        std::move(fn), std::move(arg),
+        [this_shared = shared_from_this()](
+            XLAExecutorValue fn_value,
+            absl::optional<XLAExecutorValue> arg_value)
+            -> absl::StatusOr<XLAExecutorValue> {
+          // shared_from_this() returns the base Executor* type, so we must
+          // cast to our derived type here.
+          XLAExecutor* this_executor =
+              static_cast<XLAExecutor*>(this_shared.get());
+          if (fn_value.type() != XLAExecutorValue::ValueType::COMPUTATION) {
+            return absl::InvalidArgumentError(
+                "Attempted to call a non-functional value inside the XLA "
+                "Executor.");
+          }
+          return this_executor->CallComputation(fn_value.computation(),
+                                                std::move(arg_value));
+        });
   }
 
   absl::StatusOr<ValueFuture> CreateStruct(
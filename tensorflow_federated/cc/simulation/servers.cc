@@ -25,6 +25,7 @@ limitations under the License
 #include "include/grpcpp/server.h"
 #include "include/grpcpp/server_builder.h"
 #include "tensorflow_federated/cc/core/impl/executor_stacks/local_stacks.h"
+#include "tensorflow_federated/cc/core/impl/executors/async_executor_service.h"
 #include "tensorflow_federated/cc/core/impl/executors/cardinalities.h"
 #include "tensorflow_federated/cc/core/impl/executors/executor.h"
 #include "tensorflow_federated/cc/core/impl/executors/executor_service.h"
@@ -43,15 +44,19 @@ void RunServer(std::function<absl::StatusOr<std::shared_ptr<Executor>>(
                    const CardinalityMap&)>
                    executor_fn,
                int port, std::shared_ptr<grpc::ServerCredentials> credentials,
-               int grpc_max_message_length_megabytes) {
+               int grpc_max_message_length_megabytes,
+               int32_t num_completion_queues, int32_t num_handler_threads) {
   std::string server_address = absl::StrCat("[::]:", port);
 
   grpc::ServerBuilder server_builder;
   server_builder.AddListeningPort(server_address, credentials);
 
-  std::unique_ptr<tff::ExecutorService> executor_service;
-  executor_service = std::make_unique<tff::ExecutorService>(executor_fn);
-  server_builder.RegisterService(executor_service.get());
+  tff::AsyncExecutorService::Options service_options;
+  service_options.num_completion_queues = num_completion_queues;
+  service_options.num_handler_threads = num_handler_threads;
+  auto executor_service =
+      std::make_unique<tff::AsyncExecutorService>(executor_fn, service_options);
+  executor_service->RegisterWith(server_builder);
 
   // These server builder methods take their arguments in bytes.
   int grpc_message_length_bytes =
@@ -67,13 +72,15 @@ void RunServer(std::function<absl::StatusOr<std::shared_ptr<Executor>>(
                   "for information.";
     return;
   }
+  executor_service->Start();
   LOG(INFO) << "TFF ExecutorService started, listening on " << server_address;
   server->Wait();
 }
 
 void RunWorker(int port, std::shared_ptr<grpc::ServerCredentials> credentials,
                int grpc_max_message_length_megabytes,
-               int32_t max_concurrent_computation_calls) {
+               int32_t max_concurrent_computation_calls,
+               int32_t num_completion_queues, int32_t num_handler_threads) {
   auto create_tf_executor_fn =
       [max_concurrent_computation_calls](
           int32_t unused) -> std::shared_ptr<Executor> {
@@ -85,7 +92,8 @@ void RunWorker(int port, std::shared_ptr<grpc::ServerCredentials> credentials,
     return CreateLocalExecutor(cardinality_map, create_tf_executor_fn);
   };
   RunServer(create_local_executor_fn, port, credentials,
-            grpc_max_message_length_megabytes);
+            grpc_max_message_length_megabytes, num_completion_queues,
+            num_handler_threads);
 }
 
 }  // namespace tensorflow_federated
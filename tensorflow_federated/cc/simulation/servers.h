@@ -23,6 +23,7 @@ limitations under the License
 #include "absl/types/optional.h"
 #include "grpcpp/grpcpp.h"
 #include "include/grpcpp/security/server_credentials.h"
+#include "tensorflow_federated/cc/core/impl/executors/async_executor_service.h"
 #include "tensorflow_federated/cc/core/impl/executors/cardinalities.h"
 #include "tensorflow_federated/cc/core/impl/executors/executor.h"
 #include "tensorflow_federated/cc/core/impl/executors/executor_service.h"
@@ -33,17 +34,25 @@ namespace tensorflow_federated {
 // Runs TFF ExecutorService backed by executors returned by the given
 // executor_fn, listening on port. This function blocks, and will only
 // return on error or shutdown.
+//
+// Requests are served asynchronously (see `AsyncExecutorService`), received on
+// `num_completion_queues` polling threads and run, except for `Compute`, on
+// `num_handler_threads` handler threads.
 void RunServer(std::function<absl::StatusOr<std::shared_ptr<Executor>>(
                    const CardinalityMap&)>
                    executor_fn,
                int port, std::shared_ptr<grpc::ServerCredentials> credentials,
-               int grpc_max_message_length_megabytes);
+               int grpc_max_message_length_megabytes,
+               int32_t num_completion_queues = 1,
+               int32_t num_handler_threads = -1);
 
 // Runs a specialized version of RunServer above; the running executor service
 // will execute federated computations on the local machine.
 void RunWorker(int port, std::shared_ptr<grpc::ServerCredentials> credentials,
                int grpc_max_message_length_megabytes,
-               int32_t max_concurrent_computation_calls = -1);
+               int32_t max_concurrent_computation_calls = -1,
+               int32_t num_completion_queues = 1,
+               int32_t num_handler_threads = -1);
 
 }  // namespace tensorflow_federated
 #endif  // THIRD_PARTY_TENSORFLOW_FEDERATED_CC_SIMULATION_SERVERS_H_
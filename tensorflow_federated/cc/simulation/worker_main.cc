@@ -19,8 +19,10 @@ limitations under the License
 
 #include "absl/flags/flag.h"
 #include "absl/flags/parse.h"
+#include "absl/status/status.h"
 #include "include/grpcpp/security/server_credentials.h"
 #include "tensorflow_federated/cc/core/impl/executors/cardinalities.h"
+#include "tensorflow_federated/cc/core/impl/executors/thread_pool.h"
 #include "tensorflow_federated/cc/simulation/servers.h"
 
 ABSL_FLAG(int32_t, port, 10000, "Port to run the executor service on");
@@ -34,15 +36,37 @@ ABSL_FLAG(int32_t, max_concurrent_computation_calls, -1,
           "helpful for users running into OOMs when using GPUs. Non-positive"
           " values result in no limiting.");
 
+ABSL_FLAG(int32_t, executor_thread_pool_size, -1,
+          "The number of threads in the pool running executor work, such as "
+          "`Compute` requests. Non-positive values use the number of hardware "
+          "threads.");
+
+ABSL_FLAG(int32_t, grpc_num_completion_queues, 1,
+          "The number of gRPC completion queues, each polled by its own "
+          "thread, on which executor service requests are received.");
+
+ABSL_FLAG(int32_t, grpc_num_handler_threads, -1,
+          "The number of threads running executor service requests other than"
+          " `Compute`, which runs on the executor thread pool. Non-positive "
+          "values use the number of hardware threads.");
+
 // TODO(b/234160632): Add option for secure server connections here.
 
 namespace tff = ::tensorflow_federated;
 
 int main(int argc, char* argv[]) {
   absl::ParseCommandLine(argc, argv);
+  absl::Status pool_status = tff::ThreadPool::ConfigureGlobal(
+      absl::GetFlag(FLAGS_executor_thread_pool_size));
+  if (!pool_status.ok()) {
+    LOG(ERROR) << pool_status;
+    return 1;
+  }
   std::shared_ptr<grpc::ServerCredentials> credentials =
       grpc::InsecureServerCredentials();
   tff::RunWorker(absl::GetFlag(FLAGS_port), credentials,
                  absl::GetFlag(FLAGS_grpc_max_message_length_megabytes),
-                 absl::GetFlag(FLAGS_max_concurrent_computation_calls));
+                 absl::GetFlag(FLAGS_max_concurrent_computation_calls),
+                 absl::GetFlag(FLAGS_grpc_num_completion_queues),
+                 absl::GetFlag(FLAGS_grpc_num_handler_threads));
 }
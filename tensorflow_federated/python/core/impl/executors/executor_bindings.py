@@ -40,6 +40,9 @@ create_tensorflow_executor = executor_bindings.create_tensorflow_executor
 create_reference_resolving_executor = executor_bindings.create_reference_resolving_executor
 create_composing_executor = executor_bindings.create_composing_executor
 
+# Import process-wide executor configuration.
+set_session_budget = executor_bindings.set_session_budget
+
 # Import executor constructor helpers.
 create_insecure_grpc_channel = executor_bindings.create_insecure_grpc_channel
 GRPCChannel = executor_bindings.GRPCChannelInterface
@@ -49,13 +52,18 @@ GRPCChannel = executor_bindings.GRPCChannelInterface
 # literals to strings.
 def create_federating_executor(
     inner_executor: executor_bindings.Executor,
-    cardinalities: Mapping[placements.PlacementLiteral, int]
+    cardinalities: Mapping[placements.PlacementLiteral, int],
+    num_aggregation_groups: int = 1,
+    select_slice_cache_size: int = 0,
 ) -> executor_bindings.Executor:
   """Constructs a FederatingExecutor with a specified placement."""
   uri_cardinalities = data_conversions.convert_cardinalities_dict_to_string_keyed(
       cardinalities)
-  return executor_bindings.create_federating_executor(inner_executor,
-                                                      uri_cardinalities)
+  return executor_bindings.create_federating_executor(
+      inner_executor,
+      uri_cardinalities,
+      num_aggregation_groups=num_aggregation_groups,
+      select_slice_cache_size=select_slice_cache_size)
 
 
 def create_remote_executor(
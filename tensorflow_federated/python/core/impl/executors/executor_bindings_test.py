@@ -269,6 +269,24 @@ class TensorFlowExecutorBindingsTest(parameterized.TestCase, tf.test.TestCase):
     with self.assertRaisesRegex(Exception, 'NOT_FOUND'):
       executor.materialize(0)
 
+  def test_set_session_budget(self):
+    executor_bindings.set_session_budget(
+        max_sessions=1, idle_session_ttl_seconds=60.0)
+    executor = executor_bindings.create_tensorflow_executor()
+
+    @tensorflow_computation.tf_computation
+    def foo():
+      return tf.constant(123.0)
+
+    comp_pb = executor_pb2.Value(computation=foo.get_proto(foo))
+    comp = executor.create_value(comp_pb)
+    result = executor.create_call(comp.ref, None)
+    result_value_pb = executor.materialize(result.ref)
+    result_tensor, _ = value_serialization.deserialize_value(result_value_pb)
+    self.assertEqual(result_tensor, 123.0)
+    # Restore the default of no limits for the other tests.
+    executor_bindings.set_session_budget()
+
 
 class ReferenceResolvingExecutorBindingsTest(tf.test.TestCase):
 
@@ -464,6 +482,20 @@ class FederatingExecutorBindingsTest(tf.test.TestCase):
             executor_bindings.create_tensorflow_executor(),
             {placements.CLIENTS: 0.5})
 
+  def test_construction_with_aggregation_groups(self):
+    federating_ex = executor_bindings.create_federating_executor(
+        executor_bindings.create_tensorflow_executor(),
+        {placements.CLIENTS: 10},
+        num_aggregation_groups=4)
+    self.assertIsInstance(federating_ex, executor_bindings.Executor)
+
+  def test_construction_with_select_slice_cache(self):
+    federating_ex = executor_bindings.create_federating_executor(
+        executor_bindings.create_tensorflow_executor(),
+        {placements.CLIENTS: 10},
+        select_slice_cache_size=16)
+    self.assertIsInstance(federating_ex, executor_bindings.Executor)
+
 
 class RemoteExecutorBindingsTest(tf.test.TestCase):
 
@@ -487,6 +519,34 @@ class ComposingExecutorBindingsTest(tf.test.TestCase):
     composing_ex = executor_bindings.create_composing_executor(server, children)
     self.assertIsInstance(composing_ex, executor_bindings.Executor)
 
+  def test_construction_with_aggregation_cutoff(self):
+    server = executor_bindings.create_tensorflow_executor()
+    children = [
+        executor_bindings.create_composing_child(
+            executor_bindings.create_tensorflow_executor(),
+            {placements.CLIENTS: 0})
+    ]
+    composing_ex = executor_bindings.create_composing_executor(
+        server,
+        children,
+        aggregation_deadline_seconds=1.0,
+        aggregation_quorum=0.5,
+        aggregation_stats_callback=lambda stats: None)
+    self.assertIsInstance(composing_ex, executor_bindings.Executor)
+
+  def test_construction_with_invalid_aggregation_quorum_fails(self):
+    server = executor_bindings.create_tensorflow_executor()
+    children = [
+        executor_bindings.create_composing_child(
+            executor_bindings.create_tensorflow_executor(),
+            {placements.CLIENTS: 0})
+    ]
+    for quorum in [0.0, -0.5, 1.5, float('nan')]:
+      with self.subTest(quorum=quorum):
+        with self.assertRaisesRegex(ValueError, 'aggregation_quorum'):
+          executor_bindings.create_composing_executor(
+              server, children, aggregation_quorum=quorum)
+
 
 class SerializeTensorTest(tf.test.TestCase, parameterized.TestCase):
 